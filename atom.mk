@@ -17,6 +17,7 @@ LOCAL_EXPORT_CUSTOM_VARIABLES := LIBARSDK_HEADERS=$\
 	$(LOCAL_PATH)/libarsdk/include/arsdk/arsdk.h:$\
 	$(LOCAL_PATH)/libarsdk/include/arsdk/arsdk_desc.h:$\
 	$(LOCAL_PATH)/libarsdk/include/arsdk/arsdk_cmd_itf.h:$\
+	$(LOCAL_PATH)/libarsdk/include/arsdk/arsdk_cmd_dispatcher.h:$\
 	$(LOCAL_PATH)/libarsdk/include/arsdk/arsdk_mngr.h:$\
 	$(LOCAL_PATH)/libarsdk/include/arsdk/arsdk_backend.h:$\
 	$(LOCAL_PATH)/libarsdk/include/arsdk/arsdk_backend_net.h:$\
@@ -36,6 +37,7 @@ LOCAL_SRC_FILES := \
 	libarsdk/src/cmd_itf/arsdk_cmd_itf.c \
 	libarsdk/src/cmd_itf/arsdk_cmd_itf1.c \
 	libarsdk/src/cmd_itf/arsdk_cmd_itf2.c \
+	libarsdk/src/arsdk_cmd_dispatcher.c \
 	libarsdk/src/arsdk_decoder.c \
 	libarsdk/src/arsdk_mngr.c \
 	libarsdk/src/arsdk_encoder.c \
@@ -113,6 +115,7 @@ LOCAL_EXPORT_CUSTOM_VARIABLES := LIBARSDKCTRL_HEADERS=$\
 	$(LOCAL_PATH)/libarsdkctrl/include/arsdkctrl/arsdkctrl.h:$\
 	$(LOCAL_PATH)/libarsdk/include/arsdk/arsdk.h:$\
 	$(LOCAL_PATH)/libarsdkctrl/include/arsdkctrl/arsdk_ctrl.h:$\
+	$(LOCAL_PATH)/libarsdkctrl/include/arsdkctrl/arsdk_ctrl_shards.h:$\
 	$(LOCAL_PATH)/libarsdk/include/arsdk/arsdk_backend.h:$\
 	$(LOCAL_PATH)/libarsdkctrl/include/arsdkctrl/arsdkctrl_backend.h:$\
 	$(LOCAL_PATH)/libarsdkctrl/include/arsdkctrl/arsdkctrl_backend_net.h:$\
@@ -141,17 +144,23 @@ LOCAL_SRC_FILES := \
 	libarsdkctrl/src/arsdkctrl_log.c \
 	libarsdkctrl/src/arsdk_discovery.c \
 	libarsdkctrl/src/arsdk_ctrl.c \
+	libarsdkctrl/src/arsdk_ctrl_shards.c \
 	libarsdkctrl/src/arsdk_device.c \
 	libarsdkctrl/src/arsdkctrl_backend.c \
 	libarsdkctrl/src/arsdk_ftp_itf.c \
 	libarsdkctrl/src/arsdk_media_itf.c \
+	libarsdkctrl/src/arsdk_media_index.c \
+	libarsdkctrl/src/arsdk_media_arena.c \
+	libarsdkctrl/src/arsdk_media_thumb.c \
 	libarsdkctrl/src/arsdk_updater_itf.c \
+	libarsdkctrl/src/arsdk_updater_fleet.c \
 	libarsdkctrl/src/arsdk_blackbox_itf.c \
 	libarsdkctrl/src/arsdk_crashml_itf.c \
 	libarsdkctrl/src/arsdk_flight_log_itf.c \
 	libarsdkctrl/src/arsdk_pud_itf.c \
 	libarsdkctrl/src/arsdk_ephemeris_itf.c \
 	libarsdkctrl/src/arsdk_md5.c \
+	libarsdkctrl/src/updater/arsdk_updater_digest.c \
 	libarsdkctrl/src/updater/arsdk_updater_transport.c \
 	libarsdkctrl/src/updater/arsdk_updater_transport_ftp.c \
 	libarsdkctrl/src/updater/arsdk_updater_transport_mux.c
@@ -169,6 +178,10 @@ LOCAL_SRC_FILES += \
 LOCAL_SRC_FILES += \
 	libarsdkctrl/src/ftp/arsdk_ftp.c \
 	libarsdkctrl/src/ftp/arsdk_ftp_conn.c \
+	libarsdkctrl/src/ftp/arsdk_ftp_facts.c \
+	libarsdkctrl/src/ftp/arsdk_ftp_journal.c \
+	libarsdkctrl/src/ftp/arsdk_ftp_rate.c \
+	libarsdkctrl/src/ftp/arsdk_ftp_sched.c \
 	libarsdkctrl/src/ftp/arsdk_ftp_seq.c \
 	libarsdkctrl/src/ftp/arsdk_ftp_cmd.c
 
@@ -184,7 +197,9 @@ LOCAL_CONDITIONAL_LIBRARIES += \
 	OPTIONAL:libpuf
 
 ifeq ("$(TARGET_OS)","windows")
-  LOCAL_LDLIBS += -lws2_32
+  LOCAL_LDLIBS += -lws2_32 -lwinpthread
+else ifneq ("$(TARGET_OS_FLAVOUR)","android")
+  LOCAL_LDLIBS += -lpthread
 endif
 
 include $(BUILD_LIBRARY)
@@ -220,6 +235,9 @@ include $(CLEAR_VARS)
 LOCAL_MODULE := tst-arsdk
 LOCAL_C_INCLUDES := \
 	$(LOCAL_PATH)/src \
+	$(LOCAL_PATH)/libarsdk/src \
+	$(LOCAL_PATH)/libarsdkctrl/include \
+	$(LOCAL_PATH)/libarsdkctrl/src \
 	$(LOCAL_PATH)/tests
 
 LIBARSDKCTRL_GEN_DIR := $(call local-get-build-dir)/gen
@@ -234,9 +252,32 @@ LOCAL_SRC_FILES := \
 	tests/arsdk_test_protoc_dev.c\
 	tests/arsdk_test_protoc_ctrl.c\
 	tests/arsdk_test_protoc.c \
-	tests/arsdk_test_enc_dec.c
-
-LOCAL_LIBRARIES := libarsdk libpomp avahi-client libcunit
+	tests/arsdk_test_enc_dec.c \
+	tests/arsdk_test_mpsc_ring.c \
+	tests/arsdk_test_ftp.c \
+	tests/arsdk_test_cmd_dispatcher.c \
+	tests/arsdk_test_updater.c \
+	tests/arsdk_test_media.c \
+	tests/arsdk_test_discovery_net.c
+
+# libarsdkctrl internals under test
+LOCAL_SRC_FILES += \
+	libarsdkctrl/src/arsdkctrl_log.c \
+	libarsdkctrl/src/arsdk_md5.c \
+	libarsdkctrl/src/arsdk_media_arena.c \
+	libarsdkctrl/src/arsdk_media_index.c \
+	libarsdkctrl/src/arsdk_media_itf.c \
+	libarsdkctrl/src/arsdk_media_thumb.c \
+	libarsdkctrl/src/arsdk_updater_fleet.c \
+	libarsdkctrl/src/ftp/arsdk_ftp_cmd.c \
+	libarsdkctrl/src/ftp/arsdk_ftp_facts.c \
+	libarsdkctrl/src/ftp/arsdk_ftp_journal.c \
+	libarsdkctrl/src/ftp/arsdk_ftp_rate.c \
+	libarsdkctrl/src/ftp/arsdk_ftp_sched.c \
+	libarsdkctrl/src/net/arsdk_discovery_net.c \
+	libarsdkctrl/src/updater/arsdk_updater_digest.c
+
+LOCAL_LIBRARIES := libarsdk libpomp avahi-client libcunit libfutils json
 
 LOCAL_CUSTOM_MACROS := \
 	arsdkgen-macro:$(LOCAL_PATH)/tools/arsdktestgen.py,$(call local-get-build-dir)/gen
@@ -244,7 +285,9 @@ LOCAL_CUSTOM_MACROS := \
 LOCAL_CONDITIONAL_LIBRARIES := OPTIONAL:libulog
 
 ifeq ("$(TARGET_OS)","windows")
-  LOCAL_LDLIBS += -lws2_32
+  LOCAL_LDLIBS += -lws2_32 -lwinpthread
+else ifneq ("$(TARGET_OS_FLAVOUR)","android")
+  LOCAL_LDLIBS += -lpthread
 endif
 
 include $(BUILD_EXECUTABLE)
@@ -115,6 +115,7 @@ struct arsdk_peer_info;
 
 #include "arsdk_desc.h"
 #include "arsdk_cmd_itf.h"
+#include "arsdk_cmd_dispatcher.h"
 
 #include "arsdk_mngr.h"
 #include "arsdk_backend.h"
@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_CMD_DISPATCHER_H_
+#define _ARSDK_CMD_DISPATCHER_H_
+
+struct arsdk_cmd_dispatcher;
+
+/**
+ * Function called when a registered command has been received.
+ * @param itf : interface object.
+ * @param cmd : command structure with header (ids) already decoded.
+ * @param desc : description of the command.
+ * @param userdata : user data given at registration.
+ *
+ * @remarks the arguments of the command are not decoded, the handler
+ * shall decode them itself with the matching generated arsdk_cmd_dec_*
+ * function if it needs them.
+ */
+typedef void (*arsdk_cmd_dispatcher_handler_t)(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd,
+		const struct arsdk_cmd_desc *desc,
+		void *userdata);
+
+/**
+ * Create a command dispatcher.
+ *
+ * A dispatcher routes received commands to the handler registered for their
+ * (project, class, command) ids with a direct lookup in the generated command
+ * index. Set 'arsdk_cmd_dispatcher_recv_cmd' as the 'recv_cmd' callback of a
+ * command interface with the dispatcher as user data to use it.
+ * @param ret_obj : will receive the dispatcher object.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_dispatcher_new(struct arsdk_cmd_dispatcher **ret_obj);
+
+/**
+ * Destroy a command dispatcher.
+ * @param self : dispatcher object.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_dispatcher_destroy(struct arsdk_cmd_dispatcher *self);
+
+/**
+ * Register the handler of a command.
+ * @param self : dispatcher object.
+ * @param desc : description of the command to handle
+ * (ex: &g_arsdk_cmd_desc_Common_Common_AllStates).
+ * @param handler : function to call when the command is received.
+ * @param userdata : user data given to the handler.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -EBUSY if a handler is already registered for the command.
+ */
+ARSDK_API int arsdk_cmd_dispatcher_register(struct arsdk_cmd_dispatcher *self,
+		const struct arsdk_cmd_desc *desc,
+		arsdk_cmd_dispatcher_handler_t handler,
+		void *userdata);
+
+/**
+ * Unregister the handler of a command.
+ * @param self : dispatcher object.
+ * @param desc : description of the command.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_dispatcher_unregister(struct arsdk_cmd_dispatcher *self,
+		const struct arsdk_cmd_desc *desc);
+
+/**
+ * Set the function called for received commands without registered handler.
+ * @param self : dispatcher object.
+ * @param recv_cmd : function to call, NULL to ignore such commands.
+ * @param userdata : user data given to the function.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_dispatcher_set_fallback(
+		struct arsdk_cmd_dispatcher *self,
+		void (*recv_cmd)(struct arsdk_cmd_itf *itf,
+				const struct arsdk_cmd *cmd,
+				void *userdata),
+		void *userdata);
+
+/**
+ * Dispatch a received command.
+ * @param self : dispatcher object.
+ * @param itf : interface object on which the command has been received.
+ * @param cmd : command structure with header (ids) already decoded.
+ * @return 0 in case of success, negative errno value in case of error.
+ * -ENOENT if the command has been given to the fallback function or ignored.
+ */
+ARSDK_API int arsdk_cmd_dispatcher_dispatch(struct arsdk_cmd_dispatcher *self,
+		struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd);
+
+/**
+ * Command interface 'recv_cmd' callback dispatching commands.
+ * @param itf : interface object.
+ * @param cmd : command structure.
+ * @param userdata : dispatcher object.
+ */
+ARSDK_API void arsdk_cmd_dispatcher_recv_cmd(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd,
+		void *userdata);
+
+#endif /* !_ARSDK_CMD_DISPATCHER_H_ */
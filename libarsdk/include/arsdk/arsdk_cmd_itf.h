@@ -184,6 +184,73 @@ struct arsdk_cmd_itf_cbs {
 			void *userdata);
 };
 
+/** Maximum count of transmission queues reported in metrics */
+#define ARSDK_CMD_ITF_METRICS_MAX_QUEUES 8
+
+/**
+ * Transport counters, cumulated since the transport creation.
+ */
+struct arsdk_transport_metrics {
+	uint64_t  bytes_out;      /**< Payload bytes sent */
+	uint64_t  packets_out;    /**< Packets sent */
+	uint64_t  bytes_in;       /**< Payload bytes received */
+	uint64_t  packets_in;     /**< Packets received */
+	uint64_t  tx_errors;      /**< Packets that failed to be sent */
+	uint64_t  tx_drops;       /**< Packets dropped by the lower layer */
+	uint32_t  ping_delay_us;  /**< Last ping round trip time */
+};
+
+/**
+ * Transmission queue counters, cumulated since the interface creation.
+ */
+struct arsdk_cmd_queue_metrics {
+	uint8_t   id;                  /**< Buffer identifier */
+	uint32_t  depth;               /**< Commands currently pending */
+	uint32_t  depth_hwm;           /**< Highest count of pending commands */
+	uint64_t  cmds_queued;         /**< Commands queued */
+	uint64_t  cmds_sent;           /**< Commands sent (retries excluded) */
+	uint64_t  cmds_acked;          /**< Commands acknowledged */
+	uint64_t  cmds_dropped;        /**< Commands canceled or timed out */
+	uint64_t  packets_sent;        /**< Packets sent (retries included) */
+	uint64_t  retransmits;         /**< Packets sent again */
+	uint64_t  acks;                /**< Acknowledgements received */
+	uint64_t  ack_latency_sum_us;  /**< Sum of acknowledgement latencies */
+	uint32_t  ack_latency_max_us;  /**< Highest acknowledgement latency */
+	uint32_t  ack_latency_last_us; /**< Last acknowledgement latency */
+	/**
+	 * Bytes of the command packs sent, retries excluded.
+	 * Fill ratio is 'pack_bytes' / 'pack_capacity'.
+	 * Always 0 with protocol version 1 which does not pack commands.
+	 */
+	uint64_t  pack_bytes;
+	/** Capacity of the command packs sent, retries excluded. */
+	uint64_t  pack_capacity;
+};
+
+/**
+ * Command interface metrics.
+ */
+struct arsdk_cmd_itf_metrics {
+	/** Counters of the underlying transport */
+	struct arsdk_transport_metrics  transport;
+	/** Commands received */
+	uint64_t                        cmds_in;
+	/** Count of valid entries in 'queues' */
+	uint32_t                        queue_count;
+	/** Counters of the transmission queues */
+	struct arsdk_cmd_queue_metrics  queues[ARSDK_CMD_ITF_METRICS_MAX_QUEUES];
+};
+
+/**
+ * Function called periodically with a snapshot of the interface metrics.
+ * @param itf : interface object.
+ * @param metrics : metrics snapshot.
+ * @param userdata : user data.
+ */
+typedef void (*arsdk_cmd_itf_metrics_cb_t)(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd_itf_metrics *metrics,
+		void *userdata);
+
 /**
  * Get the string description of a send status.
  * @param status : send status to convert.
@@ -221,6 +288,52 @@ ARSDK_API int arsdk_cmd_itf_send(struct arsdk_cmd_itf *itf,
 		arsdk_cmd_itf_send_status_cb_t send_status,
 		void *userdata);
 
+/**
+ * Submit a command from any thread.
+ *
+ * The command is queued in a lock-free queue and sent from the loop of the
+ * interface, as arsdk_cmd_itf_send() would do. If it can not be sent,
+ * send_status is called with ARSDK_CMD_ITF_SEND_STATUS_CANCELED.
+ * Callbacks are always called from the loop of the interface.
+ *
+ * @param itf : interface object.
+ * @param cmd : command structure; an extra reference on its buffer is taken.
+ * @param send_status : function to call with send status. If NULL, the one
+ * given at creation will be used.
+ * @param userdata : user data for send_status callback.
+ * @return 0 in case of success, -EAGAIN if the submission queue is full,
+ * negative errno value in case of error.
+ *
+ * @remarks the interface must not be destroyed while other threads can
+ * still submit commands.
+ */
+ARSDK_API int arsdk_cmd_itf_submit(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd,
+		arsdk_cmd_itf_send_status_cb_t send_status,
+		void *userdata);
+
+/**
+ * Get a snapshot of the metrics of the interface.
+ * @param itf : interface object.
+ * @param metrics : structure to fill.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_itf_get_metrics(struct arsdk_cmd_itf *itf,
+		struct arsdk_cmd_itf_metrics *metrics);
+
+/**
+ * Set the function called periodically with a snapshot of the metrics.
+ * @param itf : interface object.
+ * @param period_ms : period of the calls in milliseconds; 0 to disable.
+ * @param cb : function to call.
+ * @param userdata : user data for cb.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_cmd_itf_set_metrics_cb(struct arsdk_cmd_itf *itf,
+		uint32_t period_ms,
+		arsdk_cmd_itf_metrics_cb_t cb,
+		void *userdata);
+
 /**
  * Encode a command.
  * @param cmd : command structure to fill.
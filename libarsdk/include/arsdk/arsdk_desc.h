@@ -87,4 +87,20 @@ struct arsdk_cmd_desc {
 	uint32_t                       arg_desc_count;
 };
 
+/** Direct index of the command descriptions of a class */
+struct arsdk_cmd_desc_idx_cls {
+	/** descriptions indexed by command id (NULL for unused ids) */
+	const struct arsdk_cmd_desc * const  *table;
+	uint32_t                             count;
+	/** dispatch slot of the command id 0 of the class */
+	uint32_t                             base;
+};
+
+/** Direct index of the command descriptions of a project */
+struct arsdk_cmd_desc_idx_prj {
+	/** classes indexed by class id (NULL table for unused ids) */
+	const struct arsdk_cmd_desc_idx_cls  *table;
+	uint32_t                             count;
+};
+
 #endif /* _ARSDK_DESC_H_ */
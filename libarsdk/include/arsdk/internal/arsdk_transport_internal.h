@@ -183,6 +183,12 @@ ARSDK_API void arsdk_transport_log_cmd(
 
 ARSDK_API uint32_t arsdk_transport_get_proto_v(struct arsdk_transport *self);
 
+ARSDK_API int arsdk_transport_get_metrics(struct arsdk_transport *self,
+		struct arsdk_transport_metrics *metrics);
+
+/* To be called by implementations dropping a packet they accepted to send */
+ARSDK_API void arsdk_transport_count_tx_drop(struct arsdk_transport *self);
+
 /**
  */
 static inline void arsdk_transport_payload_init(
@@ -0,0 +1,198 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdk_priv.h"
+#include "arsdk_default_log.h"
+
+/** Handler registered for a command */
+struct arsdk_cmd_dispatcher_entry {
+	arsdk_cmd_dispatcher_handler_t  handler;
+	void                            *userdata;
+};
+
+/** Command dispatcher */
+struct arsdk_cmd_dispatcher {
+	/** handlers indexed by dispatch slot of the commands */
+	struct arsdk_cmd_dispatcher_entry  *entries;
+	/** function called for commands without handler */
+	void (*fallback)(struct arsdk_cmd_itf *itf,
+			const struct arsdk_cmd *cmd,
+			void *userdata);
+	void                               *fallback_userdata;
+};
+
+/**
+ */
+static int get_slot(const struct arsdk_cmd_desc *desc)
+{
+	const struct arsdk_cmd_desc *found = NULL;
+	int slot = arsdk_cmd_desc_lookup(desc->prj_id, desc->cls_id,
+			desc->cmd_id, &found);
+	if (slot < 0)
+		return slot;
+
+	/* Only generated descriptions can be registered */
+	if (found != desc)
+		return -ENOENT;
+	return slot;
+}
+
+/**
+ */
+int arsdk_cmd_dispatcher_new(struct arsdk_cmd_dispatcher **ret_obj)
+{
+	struct arsdk_cmd_dispatcher *self = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_obj != NULL, -EINVAL);
+
+	/* Allocate structure */
+	self = calloc(1, sizeof(*self));
+	if (self == NULL)
+		return -ENOMEM;
+
+	self->entries = calloc(ARSDK_CMD_DESC_SLOT_COUNT,
+			sizeof(*self->entries));
+	if (self->entries == NULL) {
+		free(self);
+		return -ENOMEM;
+	}
+
+	*ret_obj = self;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_dispatcher_destroy(struct arsdk_cmd_dispatcher *self)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	free(self->entries);
+	free(self);
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_dispatcher_register(struct arsdk_cmd_dispatcher *self,
+		const struct arsdk_cmd_desc *desc,
+		arsdk_cmd_dispatcher_handler_t handler,
+		void *userdata)
+{
+	int slot = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(handler != NULL, -EINVAL);
+
+	slot = get_slot(desc);
+	if (slot < 0) {
+		ARSDK_LOGE("Unknown command '%s'", desc->name);
+		return slot;
+	}
+
+	if (self->entries[slot].handler != NULL)
+		return -EBUSY;
+
+	self->entries[slot].handler = handler;
+	self->entries[slot].userdata = userdata;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_dispatcher_unregister(struct arsdk_cmd_dispatcher *self,
+		const struct arsdk_cmd_desc *desc)
+{
+	int slot = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(desc != NULL, -EINVAL);
+
+	slot = get_slot(desc);
+	if (slot < 0)
+		return slot;
+
+	if (self->entries[slot].handler == NULL)
+		return -ENOENT;
+
+	self->entries[slot].handler = NULL;
+	self->entries[slot].userdata = NULL;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_dispatcher_set_fallback(struct arsdk_cmd_dispatcher *self,
+		void (*recv_cmd)(struct arsdk_cmd_itf *itf,
+				const struct arsdk_cmd *cmd,
+				void *userdata),
+		void *userdata)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	self->fallback = recv_cmd;
+	self->fallback_userdata = userdata;
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_dispatcher_dispatch(struct arsdk_cmd_dispatcher *self,
+		struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd)
+{
+	int slot = 0;
+	const struct arsdk_cmd_desc *desc = NULL;
+	const struct arsdk_cmd_dispatcher_entry *entry = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cmd != NULL, -EINVAL);
+
+	slot = arsdk_cmd_desc_lookup(cmd->prj_id, cmd->cls_id, cmd->cmd_id,
+			&desc);
+	if (slot >= 0)
+		entry = &self->entries[slot];
+
+	if (entry == NULL || entry->handler == NULL) {
+		if (self->fallback != NULL)
+			(*self->fallback)(itf, cmd, self->fallback_userdata);
+		return -ENOENT;
+	}
+
+	(*entry->handler)(itf, cmd, desc, entry->userdata);
+	return 0;
+}
+
+/**
+ */
+void arsdk_cmd_dispatcher_recv_cmd(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd,
+		void *userdata)
+{
+	struct arsdk_cmd_dispatcher *self = userdata;
+	arsdk_cmd_dispatcher_dispatch(self, itf, cmd);
+}
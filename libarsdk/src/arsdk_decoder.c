@@ -480,41 +480,37 @@ out:
  */
 const struct arsdk_cmd_desc *arsdk_cmd_find_desc(const struct arsdk_cmd *cmd)
 {
-	const struct arsdk_cmd_desc * const * const * const *project_table =
-			g_arsdk_cmd_desc_table;
-	const struct arsdk_cmd_desc * const * const *class_table = NULL;
-	const struct arsdk_cmd_desc * const *cmd_table = NULL;
 	const struct arsdk_cmd_desc *cmd_desc = NULL;
-	int project_found = 0, class_found = 0;
-
-	while (*project_table != NULL) {
-		class_table = *project_table;
-		while (*class_table != NULL) {
-			cmd_table = *class_table;
-			while (*cmd_table != NULL) {
-				cmd_desc = *cmd_table;
-				if (cmd_desc->prj_id != cmd->prj_id)
-					goto next_product;
-				project_found = 1;
-				if (cmd_desc->cls_id != cmd->cls_id)
-					goto next_class;
-				class_found = 1;
-				if (cmd_desc->cmd_id == cmd->cmd_id)
-					return cmd_desc;
-				cmd_table++;
-			}
-next_class:
-			if (class_found)
-				return NULL;
-			class_table++;
-		}
-next_product:
-		if (project_found)
-			return NULL;
-		project_table++;
-	}
 
-	return NULL;
+	if (arsdk_cmd_desc_lookup(cmd->prj_id, cmd->cls_id, cmd->cmd_id,
+			&cmd_desc) < 0)
+		return NULL;
+
+	return cmd_desc;
+}
+
+/**
+ * Find the description of a command in the generated direct index.
+ * @return dispatch slot of the command in [0;ARSDK_CMD_DESC_SLOT_COUNT[,
+ * -ENOENT if the command is unknown.
+ */
+int arsdk_cmd_desc_lookup(uint8_t prj_id, uint8_t cls_id, uint16_t cmd_id,
+		const struct arsdk_cmd_desc **desc)
+{
+	const struct arsdk_cmd_desc_idx_prj *prj_idx =
+			&g_arsdk_cmd_desc_idx_table[prj_id];
+	const struct arsdk_cmd_desc_idx_cls *cls_idx = NULL;
+
+	if (cls_id >= prj_idx->count)
+		return -ENOENT;
+
+	cls_idx = &prj_idx->table[cls_id];
+	if (cmd_id >= cls_idx->count || cls_idx->table[cmd_id] == NULL)
+		return -ENOENT;
+
+	if (desc != NULL)
+		*desc = cls_idx->table[cmd_id];
+	return (int)(cls_idx->base + cmd_id);
 }
 
 int arsdk_cmd_get_values(const struct arsdk_cmd *cmd,
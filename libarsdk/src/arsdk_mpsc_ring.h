@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_MPSC_RING_H_
+#define _ARSDK_MPSC_RING_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * Bounded lock-free ring with multiple producers and a single consumer.
+ *
+ * Each cell carries a sequence number telling whether it is free for the
+ * producer owning position 'pos' (seq == pos) or ready for the consumer
+ * (seq == pos + 1). Producers reserve a position with a compare and swap
+ * on 'head', then publish the item by updating the cell sequence. The
+ * consumer is the only one to move 'tail'.
+ *
+ * Items are copied in and out of the ring; they should be small.
+ */
+struct arsdk_mpsc_ring {
+	uint8_t  *cells;      /**< Cells storage */
+	size_t   cell_size;   /**< Size of a cell (sequence + item) */
+	size_t   item_size;   /**< Size of an item */
+	size_t   mask;        /**< Number of cells minus one */
+	size_t   head;        /**< Next position to reserve by producers */
+	size_t   tail;        /**< Next position to read by the consumer */
+};
+
+/** Alignment of ring cells */
+#define ARSDK_MPSC_RING_ALIGN 16
+
+static inline size_t *
+arsdk_mpsc_ring_cell_seq(const struct arsdk_mpsc_ring *ring, size_t pos)
+{
+	return (size_t *)(ring->cells + (pos & ring->mask) * ring->cell_size);
+}
+
+static inline void *
+arsdk_mpsc_ring_cell_item(const struct arsdk_mpsc_ring *ring, size_t pos)
+{
+	return ring->cells + (pos & ring->mask) * ring->cell_size +
+			ARSDK_MPSC_RING_ALIGN;
+}
+
+/**
+ * Initialize a ring.
+ * @param ring : ring to initialize.
+ * @param item_size : size of the items.
+ * @param count : number of items, must be a power of 2.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+static inline int
+arsdk_mpsc_ring_init(struct arsdk_mpsc_ring *ring, size_t item_size,
+		size_t count)
+{
+	size_t i;
+
+	if (ring == NULL || item_size == 0 || count < 2 ||
+	    (count & (count - 1)) != 0)
+		return -EINVAL;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->item_size = item_size;
+	ring->cell_size = ARSDK_MPSC_RING_ALIGN +
+			((item_size + ARSDK_MPSC_RING_ALIGN - 1) &
+			~((size_t)ARSDK_MPSC_RING_ALIGN - 1));
+	ring->mask = count - 1;
+	ring->cells = calloc(count, ring->cell_size);
+	if (ring->cells == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++)
+		*arsdk_mpsc_ring_cell_seq(ring, i) = i;
+
+	return 0;
+}
+
+/**
+ * Release ring resources. Pending items are dropped.
+ * @param ring : ring to clear.
+ */
+static inline void
+arsdk_mpsc_ring_clear(struct arsdk_mpsc_ring *ring)
+{
+	if (ring == NULL)
+		return;
+
+	free(ring->cells);
+	memset(ring, 0, sizeof(*ring));
+}
+
+/**
+ * Push an item in the ring. Can be called from any thread.
+ * @param ring : ring.
+ * @param item : item to copy in the ring.
+ * @return 0 in case of success, -EAGAIN if the ring is full.
+ */
+static inline int
+arsdk_mpsc_ring_push(struct arsdk_mpsc_ring *ring, const void *item)
+{
+	size_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	size_t *seq;
+	intptr_t diff;
+
+	while (1) {
+		seq = arsdk_mpsc_ring_cell_seq(ring, pos);
+		diff = (intptr_t)__atomic_load_n(seq, __ATOMIC_ACQUIRE) -
+				(intptr_t)pos;
+		if (diff == 0) {
+			/* Cell free, try to reserve it */
+			if (__atomic_compare_exchange_n(&ring->head, &pos,
+					pos + 1, 1, __ATOMIC_RELAXED,
+					__ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			/* Consumer did not release the cell yet */
+			return -EAGAIN;
+		} else {
+			/* Another producer took it, retry */
+			pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy(arsdk_mpsc_ring_cell_item(ring, pos), item, ring->item_size);
+	__atomic_store_n(seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/**
+ * Pop an item from the ring. Must be called from the consumer thread only.
+ * @param ring : ring.
+ * @param item : will receive a copy of the item.
+ * @return 0 in case of success, -EAGAIN if the ring is empty.
+ */
+static inline int
+arsdk_mpsc_ring_pop(struct arsdk_mpsc_ring *ring, void *item)
+{
+	size_t pos = ring->tail;
+	size_t *seq = arsdk_mpsc_ring_cell_seq(ring, pos);
+
+	if (__atomic_load_n(seq, __ATOMIC_ACQUIRE) != pos + 1)
+		return -EAGAIN;
+
+	memcpy(item, arsdk_mpsc_ring_cell_item(ring, pos), ring->item_size);
+	__atomic_store_n(seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->tail, pos + 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+/**
+ * Get an estimation of the number of items in the ring.
+ * @param ring : ring.
+ * @return number of items.
+ */
+static inline size_t
+arsdk_mpsc_ring_count(const struct arsdk_mpsc_ring *ring)
+{
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+	return head - tail;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_ARSDK_MPSC_RING_H_ */
@@ -56,6 +56,7 @@
 /* Private headers */
 #include "arsdk_list.h"
 #include "arsdk_transport_ids.h"
+#include "arsdk_mpsc_ring.h"
 #include "cmd_itf/arsdk_cmd_itf_priv.h"
 
 /** Endianess detection */
@@ -141,6 +142,18 @@ struct arsdk_cmd_itf {
 		struct arsdk_cmd_itf1      *v1;
 		struct arsdk_cmd_itf2      *v2;
 	} core;
+	/** loop of the interface */
+	struct pomp_loop                   *loop;
+	/** commands submitted from other threads */
+	struct arsdk_mpsc_ring             submit_ring;
+	/** event signaled when commands are submitted */
+	struct pomp_evt                    *submit_evt;
+	/** periodic metrics snapshot */
+	struct {
+		struct pomp_timer          *timer;
+		arsdk_cmd_itf_metrics_cb_t cb;
+		void                       *userdata;
+	} metrics;
 };
 
 /** peer */
@@ -236,4 +249,7 @@ int arsdk_mngr_register_backend(struct arsdk_mngr *mngr,
 int arsdk_mngr_unregister_backend(struct arsdk_mngr *mngr,
 		struct arsdk_backend *backend);
 
+int arsdk_cmd_desc_lookup(uint8_t prj_id, uint8_t cls_id, uint16_t cmd_id,
+		const struct arsdk_cmd_desc **desc);
+
 #endif /* !_ARSDK_PRIV_H_ */
@@ -49,6 +49,8 @@ struct arsdk_transport {
 		uint32_t                  delay;
 		uint32_t                  failures;
 	} ping;
+
+	struct arsdk_transport_metrics    metrics;
 };
 
 /**
@@ -361,11 +363,24 @@ int arsdk_transport_send_data(struct arsdk_transport *self,
 		const void *extra_hdr,
 		size_t extra_hdrlen)
 {
+	int res = 0;
+	uint64_t tx_drops = 0;
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(payload != NULL, -EINVAL);
 	if (self->ops->send_data == NULL)
 		return -ENOSYS;
-	return (*self->ops->send_data)(self, header, payload,
+	tx_drops = self->metrics.tx_drops;
+	res = (*self->ops->send_data)(self, header, payload,
 			extra_hdr, extra_hdrlen);
+
+	/* a packet dropped by the implementation is only counted as such */
+	if (res < 0) {
+		self->metrics.tx_errors++;
+	} else if (self->metrics.tx_drops == tx_drops) {
+		self->metrics.packets_out++;
+		self->metrics.bytes_out += extra_hdrlen + payload->len;
+	}
+	return res;
 }
 
 /**
@@ -379,6 +394,9 @@ int arsdk_transport_recv_data(struct arsdk_transport *self,
 	ARSDK_RETURN_ERR_IF_FAILED(header != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(payload != NULL, -EINVAL);
 
+	self->metrics.packets_in++;
+	self->metrics.bytes_in += payload->len;
+
 	if (header->id == ARSDK_TRANSPORT_ID_PING) {
 		send_pong(self, header->type, header->seq, payload);
 	} else if (header->id == ARSDK_TRANSPORT_ID_PONG) {
@@ -450,3 +468,24 @@ uint32_t arsdk_transport_get_proto_v(struct arsdk_transport *self)
 	else
 		return 1;
 }
+
+/**
+ */
+int arsdk_transport_get_metrics(struct arsdk_transport *self,
+		struct arsdk_transport_metrics *metrics)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(metrics != NULL, -EINVAL);
+
+	*metrics = self->metrics;
+	metrics->ping_delay_us = self->ping.delay;
+	return 0;
+}
+
+/**
+ */
+void arsdk_transport_count_tx_drop(struct arsdk_transport *self)
+{
+	ARSDK_RETURN_IF_FAILED(self != NULL, -EINVAL);
+	self->metrics.tx_drops++;
+}
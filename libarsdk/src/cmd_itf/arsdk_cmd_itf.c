@@ -30,6 +30,16 @@
 #include "arsdk_cmd_itf2.h"
 #include "arsdk_default_log.h"
 
+/** Size of the thread-safe submission queue */
+#define ARSDK_CMD_ITF_SUBMIT_QUEUE_SIZE 256
+
+/** Command submitted from another thread */
+struct submit_entry {
+	struct arsdk_cmd                cmd;
+	arsdk_cmd_itf_send_status_cb_t  send_status;
+	void                            *userdata;
+};
+
 /**
  */
 const char *arsdk_cmd_itf_send_status_str(enum arsdk_cmd_itf_send_status val)
@@ -74,6 +84,112 @@ static void itf2_dispose(struct arsdk_cmd_itf2 *itf2, void *userdata)
 		(*self->cbs.dispose)(self, self->cbs.userdata);
 }
 
+/**
+ * Send or cancel all submitted commands.
+ */
+static void submit_flush(struct arsdk_cmd_itf *self, int cancel)
+{
+	struct submit_entry entry;
+	arsdk_cmd_itf_send_status_cb_t send_status = NULL;
+	void *userdata = NULL;
+	int res = -ECANCELED;
+
+	while (arsdk_mpsc_ring_pop(&self->submit_ring, &entry) == 0) {
+		if (!cancel) {
+			res = arsdk_cmd_itf_send(self, &entry.cmd,
+					entry.send_status, entry.userdata);
+		}
+
+		if (res < 0) {
+			/* Submitter can not get the error, notify it */
+			send_status = entry.send_status;
+			userdata = entry.userdata;
+			if (send_status == NULL) {
+				send_status = self->cbs.send_status;
+				userdata = self->cbs.userdata;
+			}
+			if (send_status != NULL) {
+				(*send_status)(self, &entry.cmd,
+						ARSDK_CMD_ITF_SEND_STATUS_CANCELED,
+						1, userdata);
+			}
+		}
+
+		arsdk_cmd_clear(&entry.cmd);
+	}
+}
+
+/**
+ */
+static void submit_evt_cb(struct pomp_evt *evt, void *userdata)
+{
+	struct arsdk_cmd_itf *self = userdata;
+
+	/* Clear first so that commands submitted while flushing signal
+	 * again */
+	pomp_evt_clear(evt);
+	submit_flush(self, 0);
+}
+
+/**
+ */
+static int submit_init(struct arsdk_cmd_itf *self)
+{
+	int res;
+
+	res = arsdk_mpsc_ring_init(&self->submit_ring,
+			sizeof(struct submit_entry),
+			ARSDK_CMD_ITF_SUBMIT_QUEUE_SIZE);
+	if (res < 0)
+		return res;
+
+	self->submit_evt = pomp_evt_new();
+	if (self->submit_evt == NULL)
+		return -ENOMEM;
+
+	res = pomp_evt_attach_to_loop(self->submit_evt, self->loop,
+			&submit_evt_cb, self);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_evt_attach_to_loop", -res);
+		pomp_evt_destroy(self->submit_evt);
+		self->submit_evt = NULL;
+		return res;
+	}
+
+	return 0;
+}
+
+/**
+ */
+static void submit_clear(struct arsdk_cmd_itf *self)
+{
+	if (self->submit_evt != NULL) {
+		pomp_evt_detach_from_loop(self->submit_evt, self->loop);
+		pomp_evt_destroy(self->submit_evt);
+		self->submit_evt = NULL;
+	}
+
+	if (self->submit_ring.cells != NULL)
+		submit_flush(self, 1);
+	arsdk_mpsc_ring_clear(&self->submit_ring);
+}
+
+/**
+ */
+static void metrics_timer_cb(struct pomp_timer *timer, void *userdata)
+{
+	struct arsdk_cmd_itf *self = userdata;
+	struct arsdk_cmd_itf_metrics metrics;
+
+	if (self->metrics.cb == NULL)
+		return;
+
+	if (arsdk_cmd_itf_get_metrics(self, &metrics) < 0)
+		return;
+
+	(*self->metrics.cb)(self, &metrics, self->metrics.userdata);
+}
+
 /**
  */
 int arsdk_cmd_itf_new(struct arsdk_transport *transport,
@@ -110,6 +226,12 @@ int arsdk_cmd_itf_new(struct arsdk_transport *transport,
 	self->cbs = *cbs;
 	self->internal_cbs = *internal_cbs;
 	self->proto_v = arsdk_transport_get_proto_v(transport);
+	self->loop = arsdk_transport_get_loop(transport);
+
+	res = submit_init(self);
+	if (res < 0)
+		goto error;
+
 	if (self->proto_v > 1) {
 		itf2_cbs.userdata = self;
 		res = arsdk_cmd_itf2_new(transport, &itf2_cbs, cbs, self,
@@ -137,11 +259,20 @@ int arsdk_cmd_itf_destroy(struct arsdk_cmd_itf *self)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
 
-	if (self->proto_v > 1)
-		arsdk_cmd_itf2_destroy(self->core.v2);
-	else
-		arsdk_cmd_itf1_destroy(self->core.v1);
+	submit_clear(self);
+
+	if (self->metrics.timer != NULL) {
+		pomp_timer_clear(self->metrics.timer);
+		pomp_timer_destroy(self->metrics.timer);
+	}
 
+	if (self->proto_v > 1) {
+		if (self->core.v2 != NULL)
+			arsdk_cmd_itf2_destroy(self->core.v2);
+	} else {
+		if (self->core.v1 != NULL)
+			arsdk_cmd_itf1_destroy(self->core.v1);
+	}
 
 	free(self);
 	return 0;
@@ -171,6 +302,13 @@ int arsdk_cmd_itf_stop(struct arsdk_cmd_itf *self)
 
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
 
+	/* Cancel submitted commands not yet sent */
+	submit_flush(self, 1);
+
+	/* Stop periodic metrics snapshot */
+	if (self->metrics.timer != NULL)
+		pomp_timer_clear(self->metrics.timer);
+
 	if (self->proto_v > 1)
 		res = arsdk_cmd_itf2_stop(self->core.v2);
 	else
@@ -201,6 +339,95 @@ int arsdk_cmd_itf_send(struct arsdk_cmd_itf *self,
 	return res;
 }
 
+/**
+ */
+int arsdk_cmd_itf_submit(struct arsdk_cmd_itf *self,
+		const struct arsdk_cmd *cmd,
+		arsdk_cmd_itf_send_status_cb_t send_status,
+		void *userdata)
+{
+	struct submit_entry entry;
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cmd != NULL, -EINVAL);
+
+	/* Buffer references are atomic, the queued copy shares it */
+	arsdk_cmd_copy(&entry.cmd, cmd);
+	entry.send_status = send_status;
+	entry.userdata = userdata;
+
+	res = arsdk_mpsc_ring_push(&self->submit_ring, &entry);
+	if (res < 0) {
+		arsdk_cmd_clear(&entry.cmd);
+		return res;
+	}
+
+	/* The command is queued and sent with the next signal, its status
+	 * is notified, the caller must not send it again */
+	res = pomp_evt_signal(self->submit_evt);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("pomp_evt_signal", -res);
+
+	return 0;
+}
+
+/**
+ */
+int arsdk_cmd_itf_get_metrics(struct arsdk_cmd_itf *self,
+		struct arsdk_cmd_itf_metrics *metrics)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(metrics != NULL, -EINVAL);
+
+	if (self->proto_v > 1)
+		res = arsdk_cmd_itf2_get_metrics(self->core.v2, metrics);
+	else
+		res = arsdk_cmd_itf1_get_metrics(self->core.v1, metrics);
+
+	return res;
+}
+
+/**
+ */
+int arsdk_cmd_itf_set_metrics_cb(struct arsdk_cmd_itf *self,
+		uint32_t period_ms,
+		arsdk_cmd_itf_metrics_cb_t cb,
+		void *userdata)
+{
+	int res;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(period_ms == 0 || cb != NULL, -EINVAL);
+
+	if (period_ms == 0) {
+		if (self->metrics.timer != NULL)
+			pomp_timer_clear(self->metrics.timer);
+		self->metrics.cb = NULL;
+		self->metrics.userdata = NULL;
+		return 0;
+	}
+
+	if (self->metrics.timer == NULL) {
+		self->metrics.timer = pomp_timer_new(self->loop,
+				&metrics_timer_cb, self);
+		if (self->metrics.timer == NULL)
+			return -ENOMEM;
+	}
+
+	self->metrics.cb = cb;
+	self->metrics.userdata = userdata;
+
+	res = pomp_timer_set_periodic(self->metrics.timer, period_ms,
+			period_ms);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("pomp_timer_set_periodic", -res);
+
+	return res;
+}
+
 /**
  */
 int arsdk_cmd_itf_recv_data(struct arsdk_cmd_itf *self,
@@ -54,6 +54,7 @@ struct queue {
 	uint32_t                     tail;
 	struct timespec              last_sent_ts;
 	uint8_t                      seq;
+	struct arsdk_cmd_queue_metrics  metrics;
 };
 
 /** */
@@ -78,6 +79,7 @@ struct arsdk_cmd_itf1 {
 		uint32_t                   rx_useless_count;
 		uint32_t                   rx_useful_count;
 	} lnqlt;
+	uint64_t                           cmds_in;
 };
 
 /**
@@ -149,6 +151,7 @@ static int queue_new(const struct arsdk_cmd_queue_info *info,
 
 	/* Initialize structure */
 	memcpy(&queue->info, info, sizeof(*info));
+	queue->metrics.id = info->id;
 
 	/* Sequence number will wrap to 0 before sending first packet */
 	queue->seq = UINT8_MAX;
@@ -165,6 +168,7 @@ static void queue_stop(struct queue *queue, struct arsdk_cmd_itf1 *self)
 	struct entry *entry = NULL;
 
 	/* Cancel all entries of queue */
+	queue->metrics.cmds_dropped += queue->count;
 	pos = queue->head;
 	for (i = 0; i < queue->count; i++) {
 		entry = &queue->entries[pos];
@@ -223,6 +227,8 @@ replace:
 	entry_clear(entry);
 	entry_init(entry, cmd, send_status, userdata,
 		   queue->info.default_max_retry_count);
+	queue->metrics.cmds_dropped++;
+	arsdk_cmd_queue_metrics_queued(&queue->metrics, queue->count);
 	return 0;
 }
 
@@ -287,6 +293,7 @@ static int queue_add(struct queue *queue,
 	if (queue->tail >= queue->depth)
 		queue->tail = 0;
 	queue->count++;
+	arsdk_cmd_queue_metrics_queued(&queue->metrics, queue->count);
 
 	return 0;
 }
@@ -418,6 +425,7 @@ again:
 			 * continue with next entry in queue */
 			entry_notify(entry, self,
 					ARSDK_CMD_ITF_SEND_STATUS_TIMEOUT, 1);
+			queue->metrics.cmds_dropped++;
 			queue_pop(queue);
 			goto again;
 		}
@@ -464,6 +472,12 @@ again:
 	if (res < 0)
 		return;
 
+	queue->metrics.packets_sent++;
+	if (entry->retry_count == 0)
+		queue->metrics.cmds_sent++;
+	else
+		queue->metrics.retransmits++;
+
 	entry_notify(entry, self, ARSDK_CMD_ITF_SEND_STATUS_SENT,
 			queue->info.type != ARSDK_TRANSPORT_DATA_TYPE_WITHACK);
 	queue->last_sent_ts = *tsnow;
@@ -563,6 +577,8 @@ static void recv_ack(struct arsdk_cmd_itf1 *self,
 		}
 
 		self->lnqlt.ack_count++;
+		arsdk_cmd_queue_metrics_acked(&queue->metrics,
+				&entry->sent_ts, 1);
 		entry_notify(entry, self,
 				ARSDK_CMD_ITF_SEND_STATUS_ACK_RECEIVED, 1);
 		queue_pop(queue);
@@ -808,6 +824,7 @@ int arsdk_cmd_itf1_recv_data(struct arsdk_cmd_itf1 *self,
 		ARSDK_LOG_ERRNO("arsdk_cmd_dec_header", -res);
 	} else {
 		cmd_log(self, &cmd, ARSDK_CMD_DIR_RX);
+		self->cmds_in++;
 		(*self->itf_cbs.recv_cmd)(self->itf, &cmd,
 				self->itf_cbs.userdata);
 	}
@@ -945,3 +962,29 @@ int arsdk_cmd_itf1_destroy(struct arsdk_cmd_itf1 *self)
 	free(self);
 	return 0;
 }
+
+/**
+ */
+int arsdk_cmd_itf1_get_metrics(struct arsdk_cmd_itf1 *self,
+		struct arsdk_cmd_itf_metrics *metrics)
+{
+	uint32_t i = 0;
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(metrics != NULL, -EINVAL);
+
+	memset(metrics, 0, sizeof(*metrics));
+	arsdk_transport_get_metrics(self->transport, &metrics->transport);
+	metrics->cmds_in = self->cmds_in;
+
+	for (i = 0; i < self->tx_count &&
+			i < ARSDK_CMD_ITF_METRICS_MAX_QUEUES; i++) {
+		queue = self->tx_queues[i];
+		metrics->queues[i] = queue->metrics;
+		metrics->queues[i].depth = queue->count;
+	}
+	metrics->queue_count = i;
+
+	return 0;
+}
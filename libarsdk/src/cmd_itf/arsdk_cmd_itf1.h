@@ -122,4 +122,15 @@ int arsdk_cmd_itf1_recv_data(struct arsdk_cmd_itf1 *self,
 		const struct arsdk_transport_header *header,
 		const struct arsdk_transport_payload *payload);
 
+/**
+ * Fills the metrics of the interface.
+ *
+ * @param self : Command interface.
+ * @param metrics : Metrics to fill.
+ *
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_cmd_itf1_get_metrics(struct arsdk_cmd_itf1 *self,
+		struct arsdk_cmd_itf_metrics *metrics);
+
 #endif /* !_ARSDK_CMD_ITF1_H_ */
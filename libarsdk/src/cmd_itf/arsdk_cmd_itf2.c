@@ -150,6 +150,8 @@ struct queue {
 		/** Count of acknowledgement received. */
 		uint32_t                ack_count;
 	} last_pack;
+	/** Queue counters. */
+	struct arsdk_cmd_queue_metrics  metrics;
 };
 
 /** Command interface version 2 */
@@ -199,6 +201,9 @@ struct arsdk_cmd_itf2 {
 		/** Count of useful packet received; reset by the timer. */
 		uint32_t                   rx_useful_count;
 	} lnqlt;
+
+	/** Count of commands received. */
+	uint64_t                           cmds_in;
 };
 
 /**
@@ -262,6 +267,7 @@ static int queue_new(const struct arsdk_cmd_queue_info *info,
 
 	/* Initialize structure */
 	memcpy(&queue->info, info, sizeof(*info));
+	queue->metrics.id = info->id;
 
 	/* Force infinite retry, as soon as possible without overwriting. */
 	queue->info.max_tx_rate_ms = 0;
@@ -293,6 +299,7 @@ static void queue_stop(struct queue *queue, struct arsdk_cmd_itf2 *itf)
 	struct entry *entry = NULL;
 
 	/* Cancel all entries of queue */
+	queue->metrics.cmds_dropped += queue->count;
 	pos = queue->head;
 	for (i = 0; i < queue->count; i++) {
 		entry = &queue->entries[pos];
@@ -372,6 +379,7 @@ static int queue_add(struct queue *queue,
 	if (queue->tail >= queue->depth)
 		queue->tail = 0;
 	queue->count++;
+	arsdk_cmd_queue_metrics_queued(&queue->metrics, queue->count);
 
 	return 0;
 }
@@ -488,6 +496,7 @@ static void check_tx_queue(struct arsdk_cmd_itf2 *self,
 	struct arsdk_transport_payload payload;
 	size_t len = 0;
 	uint32_t i = 0;
+	int retry = 0;
 
 again:
 
@@ -526,7 +535,8 @@ again:
 
 	/* If it is not a retry, increment the sequence number and
 	   pack new commands to send. */
-	if (queue->pack.cmd_count == 0) {
+	retry = queue->pack.cmd_count != 0;
+	if (!retry) {
 		queue->seq++;
 		queue_pack_cmds(queue);
 	}
@@ -549,6 +559,15 @@ again:
 	if (res < 0)
 		return;
 
+	queue->metrics.packets_sent++;
+	if (retry) {
+		queue->metrics.retransmits++;
+	} else {
+		queue->metrics.cmds_sent += queue->pack.cmd_count;
+		queue->metrics.pack_bytes += len;
+		queue->metrics.pack_capacity += ARSDK_PACK_MAX_SIZE;
+	}
+
 	/* notify each command sent in the pack */
 	queue_for_each_packed_entry(queue, entry) {
 		entry_notify(entry, self, ARSDK_CMD_ITF_SEND_STATUS_SENT,
@@ -675,6 +694,8 @@ static void recv_ack(struct arsdk_cmd_itf2 *self,
 		}
 
 		self->lnqlt.ack_count++;
+		arsdk_cmd_queue_metrics_acked(&queue->metrics,
+				&queue->pack.sent_ts, queue->pack.cmd_count);
 		/* notify and pop each command of the pack */
 		for (entry_i = 0; entry_i < queue->pack.cmd_count; entry_i++) {
 			entry = &queue->entries[queue->head];
@@ -924,6 +945,7 @@ static int unpack_cmds(struct arsdk_cmd_itf2 *self,
 			ARSDK_LOG_ERRNO("arsdk_cmd_dec_header", -res);
 		} else {
 			cmd_log(self, &cmd, ARSDK_CMD_DIR_RX);
+			self->cmds_in++;
 			(*self->itf_cbs.recv_cmd)(self->itf, &cmd,
 					self->itf_cbs.userdata);
 		}
@@ -1117,3 +1139,29 @@ int arsdk_cmd_itf2_destroy(struct arsdk_cmd_itf2 *itf)
 	free(itf);
 	return 0;
 }
+
+/**
+ */
+int arsdk_cmd_itf2_get_metrics(struct arsdk_cmd_itf2 *self,
+		struct arsdk_cmd_itf_metrics *metrics)
+{
+	uint32_t i = 0;
+	struct queue *queue = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(metrics != NULL, -EINVAL);
+
+	memset(metrics, 0, sizeof(*metrics));
+	arsdk_transport_get_metrics(self->transport, &metrics->transport);
+	metrics->cmds_in = self->cmds_in;
+
+	for (i = 0; i < self->tx_count &&
+			i < ARSDK_CMD_ITF_METRICS_MAX_QUEUES; i++) {
+		queue = self->tx_queues[i];
+		metrics->queues[i] = queue->metrics;
+		metrics->queues[i].depth = queue->count;
+	}
+	metrics->queue_count = i;
+
+	return 0;
+}
@@ -127,4 +127,52 @@ ARSDK_API int arsdk_cmd_itf_recv_data(struct arsdk_cmd_itf *itf,
 		const struct arsdk_transport_header *header,
 		const struct arsdk_transport_payload *payload);
 
+/**
+ * Updates queue metrics after a command has been queued.
+ *
+ * @param metrics : queue metrics.
+ * @param depth : count of commands pending in the queue.
+ */
+static inline void arsdk_cmd_queue_metrics_queued(
+		struct arsdk_cmd_queue_metrics *metrics,
+		uint32_t depth)
+{
+	metrics->cmds_queued++;
+	if (depth > metrics->depth_hwm)
+		metrics->depth_hwm = depth;
+}
+
+/**
+ * Updates queue metrics after an acknowledgement has been received.
+ *
+ * @param metrics : queue metrics.
+ * @param sent_ts : time of the last sending of the acknowledged data.
+ * @param cmd_count : count of commands acknowledged.
+ */
+static inline void arsdk_cmd_queue_metrics_acked(
+		struct arsdk_cmd_queue_metrics *metrics,
+		const struct timespec *sent_ts,
+		uint32_t cmd_count)
+{
+	struct timespec now = {0, 0};
+	uint64_t sent_us = 0, now_us = 0;
+	uint32_t latency_us = 0;
+
+	metrics->acks++;
+	metrics->cmds_acked += cmd_count;
+
+	if (time_get_monotonic(&now) < 0)
+		return;
+	time_timespec_to_us(sent_ts, &sent_us);
+	time_timespec_to_us(&now, &now_us);
+	if (now_us < sent_us)
+		return;
+
+	latency_us = (uint32_t)(now_us - sent_us);
+	metrics->ack_latency_sum_us += latency_us;
+	metrics->ack_latency_last_us = latency_us;
+	if (latency_us > metrics->ack_latency_max_us)
+		metrics->ack_latency_max_us = latency_us;
+}
+
 #endif /* !_ARSDK_CMD_ITF_PRIV_H_ */
@@ -938,6 +938,7 @@ static int arsdk_transport_net_send_data(struct arsdk_transport *base,
 				self->data_sock.fd, size, -res,
 				strerror(-res));
 			self->tx_fail++;
+			arsdk_transport_count_tx_drop(self->parent);
 			res = 0;
 		} else if (!ARSDK_WOULD_BLOCK(-res) &&
 				link_status == ARSDK_LINK_STATUS_OK) {
@@ -77,6 +77,36 @@ ARSDK_API int arsdk_ctrl_set_device_cbs(struct arsdk_ctrl *ctrl,
  */
 ARSDK_API struct pomp_loop *arsdk_ctrl_get_loop(struct arsdk_ctrl *ctrl);
 
+/**
+ * Configure the scheduler of the ftp transfers of the controller devices.
+ *
+ * The "get" and "put" requests of the devices running on the controller loop
+ * wait for a free slot when the limits are reached. Queued requests are
+ * started by priority, the devices being served in round-robin.
+ * @param ctrl : controller.
+ * @param max_transfers : maximum count of transfers in progress for all the
+ * devices; 0 for no limit (default).
+ * @param max_transfers_per_device : maximum count of transfers in progress
+ * per device; 0 for no limit (default).
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ctrl_set_ftp_sched_cfg(struct arsdk_ctrl *ctrl,
+		uint32_t max_transfers,
+		uint32_t max_transfers_per_device);
+
+/**
+ * Limit the bandwidth of the ftp transfers of the controller devices.
+ *
+ * The limit is shared by the "get" and "put" requests of the devices running
+ * on the controller loop; each transfer is paused while it exceeds it.
+ * @param ctrl : controller.
+ * @param max_rate : maximum rate of all the transfers in bytes per second;
+ * 0 for no limit (default).
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ctrl_set_ftp_max_rate(struct arsdk_ctrl *ctrl,
+		uint64_t max_rate);
+
 /**
  * Destroy controller.
  * @param ctrl : controller.
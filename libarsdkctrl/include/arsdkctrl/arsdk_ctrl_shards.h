@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_CTRL_SHARDS_H_
+#define _ARSDK_CTRL_SHARDS_H_
+
+/**
+ * Controller shards.
+ *
+ * A controller and all its backends, discoveries, devices and interfaces
+ * run on a single loop. To spread a large fleet of devices over several
+ * cores, shards run one controller per worker thread, each with its own
+ * loop. Backends and discoveries are created in each shard (typically
+ * with a net discovery probing a subset of addresses, see
+ * arsdk_ctrl_shards_get_shard_for_key), so that devices are owned by the
+ * shard which discovered them.
+ *
+ * Objects of a shard must only be accessed from the shard thread. Work is
+ * submitted to a shard with arsdk_ctrl_shards_run() and results are
+ * reported to the main loop with arsdk_ctrl_shards_post_main(). Both go
+ * through lock-free queues and can be called from any thread.
+ */
+
+struct arsdk_ctrl_shards;
+
+/**
+ * Function run on a shard or on the main loop.
+ * @param shards : shards object.
+ * @param idx : index of the shard which runs or posted the function.
+ * @param status : 0 when run by its loop, -ECANCELED when the shards are
+ * destroyed before it was run; it is then called from the thread
+ * destroying the shards and must only release its user data.
+ * @param userdata : user data.
+ */
+typedef void (*arsdk_ctrl_shards_task_cb_t)(struct arsdk_ctrl_shards *shards,
+		uint32_t idx,
+		int status,
+		void *userdata);
+
+/** Shards configuration */
+struct arsdk_ctrl_shards_cfg {
+	/** Number of shards; '0' for the number of online processors */
+	uint32_t  count;
+	/**
+	 * Size of the task queue of each shard and of the main loop;
+	 * must be a power of 2; '0' for default.
+	 */
+	uint32_t  queue_size;
+};
+
+/**
+ * Create the shards and start their threads.
+ * @param main_loop : loop receiving tasks posted with
+ * arsdk_ctrl_shards_post_main().
+ * @param cfg : shards configuration.
+ * @param ret_obj : will receive the shards object.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ctrl_shards_new(struct pomp_loop *main_loop,
+		const struct arsdk_ctrl_shards_cfg *cfg,
+		struct arsdk_ctrl_shards **ret_obj);
+
+/**
+ * Stop the shard threads and destroy the shards.
+ * All backends of the shards must have been destroyed before, from the
+ * shard threads. Functions still queued are called with -ECANCELED.
+ * @param shards : shards object.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ctrl_shards_destroy(struct arsdk_ctrl_shards *shards);
+
+/**
+ * Get the number of shards.
+ * @param shards : shards object.
+ * @return number of shards, 0 in case of error.
+ */
+ARSDK_API uint32_t arsdk_ctrl_shards_get_count(
+		struct arsdk_ctrl_shards *shards);
+
+/**
+ * Get the controller of a shard.
+ * @param shards : shards object.
+ * @param idx : shard index.
+ * @return controller in case of success, NULL in case of error.
+ *
+ * @remarks the controller must only be used from the shard thread.
+ */
+ARSDK_API struct arsdk_ctrl *arsdk_ctrl_shards_get_ctrl(
+		struct arsdk_ctrl_shards *shards,
+		uint32_t idx);
+
+/**
+ * Get the index of the shard a key is assigned to.
+ * The assignment is stable for a given number of shards.
+ * @param shards : shards object.
+ * @param key : key (device address, id...).
+ * @return shard index.
+ */
+ARSDK_API uint32_t arsdk_ctrl_shards_get_shard_for_key(
+		struct arsdk_ctrl_shards *shards,
+		const char *key);
+
+/**
+ * Run a function on a shard thread. Can be called from any thread.
+ * @param shards : shards object.
+ * @param idx : shard index.
+ * @param cb : function to run.
+ * @param userdata : user data given to the function.
+ * @return 0 in case of success, -EAGAIN if the shard queue is full,
+ * negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ctrl_shards_run(struct arsdk_ctrl_shards *shards,
+		uint32_t idx,
+		arsdk_ctrl_shards_task_cb_t cb,
+		void *userdata);
+
+/**
+ * Run a function on the main loop. Can be called from any thread,
+ * typically from a shard thread to report events.
+ * @param shards : shards object.
+ * @param idx : index of the calling shard, given back to the function.
+ * @param cb : function to run.
+ * @param userdata : user data given to the function.
+ * @return 0 in case of success, -EAGAIN if the main queue is full,
+ * negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ctrl_shards_post_main(struct arsdk_ctrl_shards *shards,
+		uint32_t idx,
+		arsdk_ctrl_shards_task_cb_t cb,
+		void *userdata);
+
+#endif /* !_ARSDK_CTRL_SHARDS_H_ */
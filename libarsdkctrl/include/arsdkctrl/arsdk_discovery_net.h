@@ -29,12 +29,52 @@
 
 struct arsdk_discovery_net;
 
+/** Net discovery probing configuration */
+struct arsdk_discovery_net_probe_cfg {
+	/** Addresses to probe; can be NULL if 'subnet' is given */
+	const char * const  *addrs;
+	/** Number of addresses in 'addrs' */
+	uint32_t            addrs_count;
+	/**
+	 * Subnet to probe in CIDR notation (ex: "192.168.42.0/24");
+	 * can be NULL. Prefix length must be in range [16;32].
+	 */
+	const char          *subnet;
+	/**
+	 * Maximum number of concurrent connection attempts;
+	 * '0' for default.
+	 */
+	uint32_t            max_probes;
+	/**
+	 * Time given to a connection attempt before probing the next
+	 * address, in milliseconds; '0' for default.
+	 * Only used if there are more addresses than 'max_probes'.
+	 */
+	uint32_t            probe_timeout_ms;
+};
+
 ARSDK_API int arsdk_discovery_net_new(struct arsdk_ctrl *ctrl,
 		struct arsdkctrl_backend_net *backend,
 		const struct arsdk_discovery_cfg *cfg,
 		const char *addr,
 		struct arsdk_discovery_net **ret_obj);
 
+/**
+ * Create a net discovery probing several addresses.
+ * Each address answering on the discovery port is reported as a device.
+ * @param ctrl : controller.
+ * @param backend : net backend.
+ * @param cfg : discovery configuration.
+ * @param probe_cfg : probing configuration.
+ * @param ret_obj : will receive the discovery object.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_discovery_net_new_with_probe_cfg(struct arsdk_ctrl *ctrl,
+		struct arsdkctrl_backend_net *backend,
+		const struct arsdk_discovery_cfg *cfg,
+		const struct arsdk_discovery_net_probe_cfg *probe_cfg,
+		struct arsdk_discovery_net **ret_obj);
+
 ARSDK_API int arsdk_discovery_net_destroy(struct arsdk_discovery_net *self);
 
 ARSDK_API int arsdk_discovery_net_start(struct arsdk_discovery_net *self);
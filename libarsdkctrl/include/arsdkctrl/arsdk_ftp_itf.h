@@ -54,6 +54,15 @@ enum arsdk_ftp_req_status {
 					/**< no more request can be sent.*/
 };
 
+/** Request priority, orders the transfers waiting for a free slot of the
+ *  controller transfer scheduler */
+enum arsdk_ftp_req_priority {
+	ARSDK_FTP_REQ_PRIORITY_LOW,     /**< background transfer */
+	ARSDK_FTP_REQ_PRIORITY_NORMAL,  /**< default priority */
+	ARSDK_FTP_REQ_PRIORITY_HIGH,    /**< transfer waited by the user */
+	ARSDK_FTP_REQ_PRIORITY_COUNT,   /**< count of priorities */
+};
+
 /** Types of file */
 enum arsdk_ftp_file_type {
 	ARSDK_FTP_FILE_TYPE_UNKNOWN = -1,       /**< Type unknown */
@@ -62,6 +71,18 @@ enum arsdk_ftp_file_type {
 	ARSDK_FTP_FILE_TYPE_LINK,               /**< Symbolic Link */
 };
 
+/** Bandwidth limitation of the transfers of a device */
+struct arsdk_ftp_bw_cfg {
+	/** Maximum rate of each transfer in bytes per second, 0 for no limit */
+	uint64_t transfer_max_rate;
+	/** Maximum rate of all the transfers in bytes per second,
+	 *  0 for no limit */
+	uint64_t max_rate;
+	/** Non-zero to lower the rate of all the transfers while the latency
+	 *  or the losses of the command link increase */
+	int adaptive;
+};
+
 /** "put" request callbacks */
 struct arsdk_ftp_req_put_cbs {
 	/** User data given in callbacks */
@@ -184,6 +205,19 @@ struct arsdk_ftp_req_list_cbs {
 			enum arsdk_ftp_req_status status,
 			int error,
 			void *userdata);
+
+	/**
+	 * Notify a file listed, as soon as its line is received. (optional)
+	 * The file can be referenced to be used after the request end.
+	 * @param itf : the ftp interface.
+	 * @param req : the request.
+	 * @param file : the file listed.
+	 * @param userdata :  user data.
+	 */
+	void (*file)(struct arsdk_ftp_itf *itf,
+			struct arsdk_ftp_req_list *req,
+			struct arsdk_ftp_file *file,
+			void *userdata);
 };
 
 /**
@@ -194,6 +228,122 @@ struct arsdk_ftp_req_list_cbs {
 ARSDK_API int arsdk_ftp_itf_cancel_all(
 		struct arsdk_ftp_itf *itf);
 
+/**
+ * Configure the data stream of the "put" requests created afterwards.
+ *
+ * Uploads keep 'frag_count' fragments of 'frag_len' bytes queued in the data
+ * socket, the buffers are recycled during the transfer.
+ * @param itf : the ftp interface.
+ * @param frag_len : length of the fragments sent; 0 for default (64 KiB).
+ * @param frag_count : count of fragments queued; 0 for default (4).
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ftp_itf_set_upload_cfg(
+		struct arsdk_ftp_itf *itf,
+		size_t frag_len,
+		uint32_t frag_count);
+
+/**
+ * Configure the parallel download of the "get" requests created afterwards.
+ *
+ * Downloads to a local file are split in byte ranges fetched concurrently on
+ * up to 'conn_count' connections, each range being at least 'min_range_len'
+ * bytes long. Smaller files use a single connection. If the download fails,
+ * the file is truncated to the data contiguously received so that it can be
+ * resumed.
+ * @param itf : the ftp interface.
+ * @param conn_count : maximum count of connections per download, at most 16;
+ * 0 or 1 to disable the parallel download.
+ * @param min_range_len : minimum length of the ranges; 0 for default (4 MiB).
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ftp_itf_set_download_cfg(
+		struct arsdk_ftp_itf *itf,
+		uint32_t conn_count,
+		size_t min_range_len);
+
+/**
+ * Limit the bandwidth of the transfers of the device.
+ *
+ * Transfers exceeding a limit are paused until they are under it again. In
+ * adaptive mode, the rate of all the transfers is halved each time the ping
+ * delay of the command link raises above its usual value or packets are
+ * lost, then increased again step by step up to 'max_rate'; so that the
+ * transfers do not delay the commands.
+ * @param itf : the ftp interface.
+ * @param cfg : the bandwidth limitation.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ftp_itf_set_bw_cfg(
+		struct arsdk_ftp_itf *itf,
+		const struct arsdk_ftp_bw_cfg *cfg);
+
+/**
+ * Configure the rate of the progress notifications of the requests.
+ *
+ * The progress is notified once 'min_len' bytes are transferred or
+ * 'period_ms' elapsed since the last notification, and at the end of the
+ * transfer. By default, every 64 KiB or 100 ms.
+ * @param itf : the ftp interface.
+ * @param min_len : minimal data transferred, 0 to ignore it.
+ * @param period_ms : minimal period in milliseconds, 0 to ignore it.
+ * Both 0 to notify each data received or sent.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ftp_itf_set_progress_cfg(
+		struct arsdk_ftp_itf *itf,
+		size_t min_len,
+		uint32_t period_ms);
+
+/**
+ * Enable the integrity journal of the "get" requests to a local file created
+ * afterwards.
+ *
+ * The journal, stored next to the local file with the ".journal" suffix,
+ * records the size and the modification time of the remote file and a
+ * checksum per MiB of data written. A resumed download restarts after the
+ * last block matching its checksum, from the start if the remote file
+ * changed. The size of the file is checked when the download completes and
+ * the journal is then deleted.
+ * @param itf : the ftp interface.
+ * @param enable : 1 to enable the journal, 0 to disable it.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ftp_itf_set_download_journal(
+		struct arsdk_ftp_itf *itf,
+		int enable);
+
+/**
+ * Get the state of a download from its journal.
+ * @param local_path : path of the local file downloaded.
+ * @param remote_size : will receive the size of the remote file.
+ * @param checkpoint : will receive the size of the data checksummed, the
+ * download can be resumed from it.
+ * @return 0 in case of success, -ENOENT if the file has no journal,
+ * negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ftp_itf_get_download_journal(
+		const char *local_path,
+		uint64_t *remote_size,
+		uint64_t *checkpoint);
+
+/**
+ * Open and log in a control connection to a ftp server of the device.
+ *
+ * The idle connections are kept alive and checked with NOOP commands, so the
+ * next request to this server is sent without waiting for the tcp connection
+ * and the login. Not supported on mux backends, where each request uses its
+ * own tunnel.
+ * @param itf : the ftp interface.
+ * @param dev_type : the device type.
+ * @param srv_type : the ftp server type.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ftp_itf_prepare_conn(
+		struct arsdk_ftp_itf *itf,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_srv_type srv_type);
+
 /**
  * Create and send a ftp "get" request.
  * @param itf : the ftp interface.
@@ -225,6 +375,18 @@ ARSDK_API int arsdk_ftp_itf_create_req_get(
  */
 ARSDK_API int arsdk_ftp_req_get_cancel(struct arsdk_ftp_req_get *req);
 
+/**
+ * Set the priority of a "get" request.
+ *
+ * The priority orders the request if it waits for a free transfer slot; it
+ * has no effect once the transfer is started.
+ * @param req : the request.
+ * @param prio : the priority (ARSDK_FTP_REQ_PRIORITY_NORMAL by default).
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ftp_req_get_set_priority(struct arsdk_ftp_req_get *req,
+		enum arsdk_ftp_req_priority prio);
+
 /**
  * Get the remote path of a ftp "get" request.
  * @param req : the request.
@@ -324,6 +486,18 @@ ARSDK_API int arsdk_ftp_itf_create_req_put_buff(
  */
 ARSDK_API int arsdk_ftp_req_put_cancel(struct arsdk_ftp_req_put *req);
 
+/**
+ * Set the priority of a "put" request.
+ *
+ * The priority orders the request if it waits for a free transfer slot; it
+ * has no effect once the transfer is started.
+ * @param req : the request.
+ * @param prio : the priority (ARSDK_FTP_REQ_PRIORITY_NORMAL by default).
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_ftp_req_put_set_priority(struct arsdk_ftp_req_put *req,
+		enum arsdk_ftp_req_priority prio);
+
 /**
  * Get the remote path of a ftp "put" request.
  * @param req : the request.
@@ -563,6 +737,16 @@ ARSDK_API size_t arsdk_ftp_file_get_size(
 ARSDK_API enum arsdk_ftp_file_type arsdk_ftp_file_get_type(
 		const struct arsdk_ftp_file *file);
 
+/**
+ * Get file last modification time.
+ * Only known if the server supports the machine listings ("MLSD").
+ * @param file : the file.
+ * @return the modification time in seconds since the Epoch (UTC), 0 if
+ * unknown.
+ */
+ARSDK_API time_t arsdk_ftp_file_get_mtime(
+		const struct arsdk_ftp_file *file);
+
 /**
  * Increase ref count of file.
  * @param file : the file.
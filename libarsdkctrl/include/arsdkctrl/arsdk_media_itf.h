@@ -34,6 +34,8 @@ struct arsdk_media_list;
 struct arsdk_media_req_list;
 struct arsdk_media_req_download;
 struct arsdk_media_req_delete;
+struct arsdk_media_req_delete_batch;
+struct arsdk_media_req_thumb;
 
 /** */
 enum arsdk_media_req_status {
@@ -163,6 +165,73 @@ ARSDK_API void arsdk_media_list_ref(struct arsdk_media_list *list);
  */
 ARSDK_API void arsdk_media_list_unref(struct arsdk_media_list *list);
 
+/** media index callbacks */
+struct arsdk_media_index_cbs {
+	/** User data given in callbacks */
+	void *userdata;
+
+	/**
+	 * Notify a media added since the previous refresh of the index.
+	 * (optional)
+	 * The media can be referenced to be used after the callback.
+	 * @param itf : the media interface.
+	 * @param media : the media.
+	 * @param userdata :  user data.
+	 */
+	void (*added)(struct arsdk_media_itf *itf,
+			struct arsdk_media *media,
+			void *userdata);
+
+	/**
+	 * Notify a media removed since the previous refresh of the index.
+	 * (optional)
+	 * A media whose resources changed is notified removed then added.
+	 * @param itf : the media interface.
+	 * @param name : name of the media.
+	 * @param userdata :  user data.
+	 */
+	void (*removed)(struct arsdk_media_itf *itf,
+			const char *name,
+			void *userdata);
+};
+
+/**
+ * Enable the media index.
+ * The medias of the device are indexed by each "list" request, in a file per
+ * device id and storage folder of the given directory, kept between the
+ * connections. The changes since the previous "list" request, or since the
+ * previous connection, are notified by the index callbacks.
+ * While enabled, the "list" request first checks the modification time of
+ * the media folder, and gives the medias of the index without listing the
+ * folder again if it is unchanged; this requires a server supporting "MLST".
+ * @param itf : the media interface.
+ * @param dir : directory of the index files, NULL to disable the index.
+ * @param cbs : index callbacks, can be NULL.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_media_itf_set_index(struct arsdk_media_itf *itf,
+		const char *dir,
+		const struct arsdk_media_index_cbs *cbs);
+
+
+/** Maximum number of storage roots of a type of device */
+#define ARSDK_MEDIA_STORAGE_ROOTS_MAX 8
+
+/**
+ * Set the storage roots of a type of device, "/internal_000/" by default.
+ * The media and thumbnail folders of all the roots are listed concurrently
+ * by the "list" request, and their medias merged in a single list; a root
+ * that can not be listed, like a missing removable storage, is skipped.
+ * @param itf : the media interface.
+ * @param dev_type : type of the device.
+ * @param roots : paths of the storage roots, like "/internal_000/".
+ * @param count : number of roots, 0 to restore the default root.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_media_itf_set_storage_roots(struct arsdk_media_itf *itf,
+		enum arsdk_device_type dev_type,
+		const char *const *roots,
+		size_t count);
 
 /** "download" request callbacks */
 struct arsdk_media_req_download_cbs {
@@ -259,6 +328,117 @@ ARSDK_API struct pomp_buffer *arsdk_media_req_download_get_buffer(
 ARSDK_API enum arsdk_device_type arsdk_media_req_download_get_dev_type(
 		const struct arsdk_media_req_download *req);
 
+/** thumbnail cache configuration */
+struct arsdk_media_thumb_cfg {
+	/** directory of the disk cache, NULL to cache in memory only */
+	const char *dir;
+	/** maximum size of the thumbnails cached in memory (bytes) */
+	size_t mem_max_size;
+	/** maximum size of the thumbnails cached on disk (bytes) */
+	uint64_t disk_max_size;
+	/** maximum count of thumbnails downloaded at once, 0 for default */
+	uint32_t max_downloads;
+};
+
+/** "thumbnail" request callbacks */
+struct arsdk_media_req_thumb_cbs {
+	/** User data given in callbacks */
+	void *userdata;
+
+	/**
+	 * Notify request completed.
+	 * The thumbnail is given by arsdk_media_req_thumb_get_buffer().
+	 * @param itf : the media interface.
+	 * @param req : the request.
+	 * @param status : request status.
+	 * @param error : request error.
+	 * @param userdata :  user data.
+	 */
+	void (*complete)(struct arsdk_media_itf *itf,
+			struct arsdk_media_req_thumb *req,
+			enum arsdk_media_req_status status,
+			int error,
+			void *userdata);
+};
+
+/**
+ * Configure the thumbnail cache.
+ * The thumbnails are cached in memory, and on disk if a directory is given,
+ * by device id and resource; the least recently used ones are removed
+ * when the cache is full.
+ * By default, the thumbnails are cached in memory only.
+ * @param itf : the media interface.
+ * @param cfg : configuration.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_media_itf_set_thumb_cfg(struct arsdk_media_itf *itf,
+		const struct arsdk_media_thumb_cfg *cfg);
+
+/**
+ * Create a request getting the thumbnail of a media, from the cache if
+ * possible.
+ * The thumbnails requested are downloaded before the prefetched ones, and
+ * a thumbnail requested several times is downloaded once.
+ * The completion is always notified asynchronously.
+ * @param itf : the media interface.
+ * @param cbs : request callback.
+ * @param media : the media.
+ * @param dev_type : type of the device to access.
+ * @param ret_req : will receive the request object.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_media_itf_create_req_thumb(
+		struct arsdk_media_itf *itf,
+		const struct arsdk_media_req_thumb_cbs *cbs,
+		const struct arsdk_media *media,
+		enum arsdk_device_type dev_type,
+		struct arsdk_media_req_thumb **ret_req);
+
+/**
+ * Cancel a "thumbnail" request.
+ * @param req : the request.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_media_req_thumb_cancel(
+		struct arsdk_media_req_thumb *req);
+
+/**
+ * Get the uri of the thumbnail of a "thumbnail" request.
+ * @param req : the request.
+ * @return the uri of the thumbnail.
+ */
+ARSDK_API const char *arsdk_media_req_thumb_get_uri(
+		const struct arsdk_media_req_thumb *req);
+
+/**
+ * Get the thumbnail of a "thumbnail" request.
+ * Only valid in the completion callback of a succeeded request.
+ * @param req : the request.
+ * @return the thumbnail, NULL if not available.
+ */
+ARSDK_API struct pomp_buffer *arsdk_media_req_thumb_get_buffer(
+		const struct arsdk_media_req_thumb *req);
+
+/**
+ * Get the type of the device intended by this "thumbnail" request.
+ * @param req : the request.
+ * @return the device intended by this request.
+ */
+ARSDK_API enum arsdk_device_type arsdk_media_req_thumb_get_dev_type(
+		const struct arsdk_media_req_thumb *req);
+
+/**
+ * Prefetch in the cache the thumbnails of a list of medias, in background.
+ * The prefetch is canceled by arsdk_media_itf_cancel_all().
+ * @param itf : the media interface.
+ * @param list : the medias.
+ * @param dev_type : type of the device to access.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_media_itf_prefetch_thumbs(struct arsdk_media_itf *itf,
+		struct arsdk_media_list *list,
+		enum arsdk_device_type dev_type);
+
 /** "delete" request callbacks */
 struct arsdk_media_req_delete_cbs {
 	/** User data given in callbacks */
@@ -312,6 +492,92 @@ arsdk_media_req_delete_get_media(
 ARSDK_API enum arsdk_device_type arsdk_media_req_delete_get_dev_type(
 		const struct arsdk_media_req_delete *req);
 
+/** "delete batch" request callbacks */
+struct arsdk_media_req_delete_batch_cbs {
+	/** User data given in callbacks */
+	void *userdata;
+
+	/**
+	 * Notify the deletion of a media of the batch done.
+	 * @param itf : the media interface.
+	 * @param req : the request.
+	 * @param media : the media.
+	 * @param status : deletion status of the media.
+	 * @param error : deletion error of the media.
+	 * @param done : number of medias of the batch done.
+	 * @param total : number of medias of the batch.
+	 * @param userdata :  user data.
+	 */
+	void (*progress)(struct arsdk_media_itf *itf,
+			struct arsdk_media_req_delete_batch *req,
+			const struct arsdk_media *media,
+			enum arsdk_media_req_status status,
+			int error,
+			size_t done,
+			size_t total,
+			void *userdata);
+
+	/**
+	 * Notify request completed.
+	 * @param itf : the media interface.
+	 * @param req : the request.
+	 * @param status : request status, failed if a media was not deleted.
+	 * @param error : request error.
+	 * @param userdata :  user data.
+	 */
+	void (*complete)(struct arsdk_media_itf *itf,
+			struct arsdk_media_req_delete_batch *req,
+			enum arsdk_media_req_status status,
+			int error,
+			void *userdata);
+};
+
+/**
+ * Create and send "delete batch" request.
+ * The resources of the medias are deleted a few at a time, reusing the
+ * pooled ftp connections, instead of a connection per resource.
+ * Medias without resources are ignored.
+ * @param itf : the media interface.
+ * @param cbs : request callbacks.
+ * @param medias : medias to delete.
+ * @param count : number of medias to delete.
+ * @param dev_type : type of the device to access.
+ * @param ret_req : will receive the request object.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_media_itf_create_req_delete_batch(
+		struct arsdk_media_itf *itf,
+		const struct arsdk_media_req_delete_batch_cbs *cbs,
+		struct arsdk_media **medias,
+		size_t count,
+		enum arsdk_device_type dev_type,
+		struct arsdk_media_req_delete_batch **ret_req);
+
+/**
+ * Cancel a "delete batch" request.
+ * Medias not deleted yet are notified canceled.
+ * @param req : the request.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_media_req_delete_batch_cancel(
+		struct arsdk_media_req_delete_batch *req);
+
+/**
+ * Get the number of medias of a "delete batch" request.
+ * @param req : the request.
+ * @return the number of medias to delete.
+ */
+ARSDK_API size_t arsdk_media_req_delete_batch_get_count(
+		const struct arsdk_media_req_delete_batch *req);
+
+/**
+ * Get the type of the device intended by this "delete batch" request.
+ * @param req : the request.
+ * @return the device intended by this request.
+ */
+ARSDK_API enum arsdk_device_type arsdk_media_req_delete_batch_get_dev_type(
+		const struct arsdk_media_req_delete_batch *req);
+
 /**
  * Cancel all requests pending or in progress.
  * @param itf : the media interface.
@@ -120,4 +120,111 @@ ARSDK_API int arsdk_updater_itf_cancel_all(struct arsdk_updater_itf *itf);
 ARSDK_API enum arsdk_device_type arsdk_updater_appid_to_devtype(
 		const uint32_t app_id);
 
+/**
+ * Fleet update.
+ *
+ * Uploads a firmware to several devices of a controller. The digest of the
+ * firmware is computed once before the first upload and shared by the
+ * uploads, which run concurrently up to a configurable count. Devices are
+ * identified by their handle, a device removed before its upload starts
+ * completes as aborted.
+ * All functions must be called from the loop of the controller.
+ */
+struct arsdk_updater_fleet;
+
+/** fleet update callbacks */
+struct arsdk_updater_fleet_cbs {
+	/** User data given in callbacks */
+	void *userdata;
+
+	/**
+	 * Notify the upload progression of a device.
+	 * @param fleet : the fleet update.
+	 * @param handle : handle of the device.
+	 * @param percent : progression percentage.
+	 * @param userdata : user data.
+	 */
+	void (*progress)(struct arsdk_updater_fleet *fleet,
+			uint16_t handle,
+			float percent,
+			void *userdata);
+
+	/**
+	 * Notify the upload of a device completed.
+	 * @param fleet : the fleet update.
+	 * @param handle : handle of the device.
+	 * @param status : upload status.
+	 * @param error : upload error.
+	 * @param userdata : user data.
+	 */
+	void (*device_complete)(struct arsdk_updater_fleet *fleet,
+			uint16_t handle,
+			enum arsdk_updater_req_status status,
+			int error,
+			void *userdata);
+
+	/**
+	 * Notify all the uploads completed; the fleet update may be destroyed
+	 * from this callback.
+	 * @param fleet : the fleet update.
+	 * @param ok_count : number of devices successfully updated.
+	 * @param total_count : number of devices.
+	 * @param userdata : user data.
+	 */
+	void (*complete)(struct arsdk_updater_fleet *fleet,
+			size_t ok_count,
+			size_t total_count,
+			void *userdata);
+};
+
+/**
+ * Create a fleet update.
+ * @param ctrl : the controller of the devices.
+ * @param fw_filepath : firmware file to upload.
+ * @param max_concurrent : maximum number of concurrent uploads,
+ * '0' for no limit.
+ * @param cbs : fleet update callbacks.
+ * @param ret_fleet : will receive the fleet update.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_updater_fleet_new(struct arsdk_ctrl *ctrl,
+		const char *fw_filepath,
+		uint32_t max_concurrent,
+		const struct arsdk_updater_fleet_cbs *cbs,
+		struct arsdk_updater_fleet **ret_fleet);
+
+/**
+ * Add a device to update; devices can be added until the fleet update
+ * completes.
+ * @param fleet : the fleet update.
+ * @param device : the device, connected.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_updater_fleet_add_device(
+		struct arsdk_updater_fleet *fleet,
+		struct arsdk_device *device);
+
+/**
+ * Start the fleet update.
+ * @param fleet : the fleet update.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_updater_fleet_start(struct arsdk_updater_fleet *fleet);
+
+/**
+ * Cancel the uploads; each device completes as canceled, then the fleet
+ * update completes, even if it has not been started.
+ * @param fleet : the fleet update.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_updater_fleet_cancel(struct arsdk_updater_fleet *fleet);
+
+/**
+ * Destroy a fleet update; uploads in progress are canceled without
+ * notification.
+ * @param fleet : the fleet update.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+ARSDK_API int arsdk_updater_fleet_destroy(struct arsdk_updater_fleet *fleet);
+
 #endif /* !_ARSDK_UPDATER_ITF_H_ */
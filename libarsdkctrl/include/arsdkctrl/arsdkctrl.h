@@ -31,6 +31,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <errno.h>
+#include <time.h>
 
 #include <libpomp.h>
 
@@ -69,6 +70,7 @@ struct arsdk_device_tcp_proxy;
 
 #include <arsdk/arsdk.h>
 #include "arsdk_ctrl.h"
+#include "arsdk_ctrl_shards.h"
 
 #include <arsdk/arsdk_backend.h>
 #include "arsdkctrl_backend.h"
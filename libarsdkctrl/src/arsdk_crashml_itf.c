@@ -566,6 +566,9 @@ static int ftp_get_tgz(struct arsdk_crashml_req *req,
 	if (res < 0)
 		return res;
 
+	/* Let the user transfers go first */
+	arsdk_ftp_req_get_set_priority(curr_req->ftp_get.reqs[0],
+			ARSDK_FTP_REQ_PRIORITY_LOW);
 	curr_req->ftp_get.count++;
 	return 0;
 }
@@ -601,6 +604,9 @@ static int ftp_get_file(struct arsdk_crashml_req *req,
 	if (res < 0)
 		return res;
 
+	arsdk_ftp_req_get_set_priority(
+			curr_req->ftp_get.reqs[curr_req->ftp_get.count],
+			ARSDK_FTP_REQ_PRIORITY_LOW);
 	curr_req->ftp_get.count++;
 	return 0;
 }
@@ -1166,6 +1172,7 @@ int arsdk_crashml_itf_create_req(struct arsdk_crashml_itf *itf,
 		goto error;
 	}
 
+	memset(&ftp_cbs, 0, sizeof(ftp_cbs));
 	memset(&ftp_cbs, 0, sizeof(ftp_cbs));
 	ftp_cbs.userdata = req;
 	ftp_cbs.complete = &main_dir_list_complete_cb;
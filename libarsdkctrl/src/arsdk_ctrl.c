@@ -26,6 +26,8 @@
 
 #include "arsdkctrl_priv.h"
 #include "arsdkctrl_default_log.h"
+#include "ftp/arsdk_ftp_sched.h"
+#include "updater/arsdk_updater_digest.h"
 
 
 struct arsdk_ctrl {
@@ -41,12 +43,17 @@ struct arsdk_ctrl {
 	struct list_node              backends;
 	/* discoveries list */
 	struct list_node              discoveries;
+	/* ftp transfer scheduler shared by the devices */
+	struct arsdk_ftp_sched        *ftp_sched;
+	/* firmware digest engine shared by the devices */
+	struct arsdk_updater_digest   *updater_digest;
 };
 
 /**
  */
 int arsdk_ctrl_new(struct pomp_loop *loop, struct arsdk_ctrl **ret_ctrl)
 {
+	int res = 0;
 	struct arsdk_ctrl *ctrl = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(loop != NULL, -EINVAL);
@@ -66,6 +73,20 @@ int arsdk_ctrl_new(struct pomp_loop *loop, struct arsdk_ctrl **ret_ctrl)
 	list_init(&ctrl->backends);
 	list_init(&ctrl->discoveries);
 
+	/* no transfer limit by default */
+	res = arsdk_ftp_sched_new(loop, &ctrl->ftp_sched);
+	if (res < 0) {
+		free(ctrl);
+		return res;
+	}
+
+	res = arsdk_updater_digest_new(loop, &ctrl->updater_digest);
+	if (res < 0) {
+		arsdk_ftp_sched_destroy(ctrl->ftp_sched);
+		free(ctrl);
+		return res;
+	}
+
 	*ret_ctrl = ctrl;
 	return 0;
 }
@@ -89,10 +110,43 @@ struct pomp_loop *arsdk_ctrl_get_loop(struct arsdk_ctrl *ctrl)
 	return ctrl ? ctrl->loop : NULL;
 }
 
+/**
+ */
+int arsdk_ctrl_set_ftp_sched_cfg(struct arsdk_ctrl *self,
+		uint32_t max_transfers,
+		uint32_t max_transfers_per_device)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	return arsdk_ftp_sched_set_limits(self->ftp_sched, max_transfers,
+			max_transfers_per_device);
+}
+
+/**
+ */
+int arsdk_ctrl_set_ftp_max_rate(struct arsdk_ctrl *self, uint64_t max_rate)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	return arsdk_ftp_sched_set_max_rate(self->ftp_sched, max_rate);
+}
+
+struct arsdk_ftp_sched *arsdk_ctrl_get_ftp_sched(struct arsdk_ctrl *self)
+{
+	return self ? self->ftp_sched : NULL;
+}
+
+struct arsdk_updater_digest *arsdk_ctrl_get_updater_digest(
+		struct arsdk_ctrl *self)
+{
+	return self ? self->updater_digest : NULL;
+}
+
 /**
  */
 int arsdk_ctrl_destroy(struct arsdk_ctrl *self)
 {
+	int res = 0;
 	struct arsdk_discovery *disc, *disctmp;
 	struct arsdkctrl_backend *backend, *backendtmp;
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
@@ -108,6 +162,14 @@ int arsdk_ctrl_destroy(struct arsdk_ctrl *self)
 		arsdk_ctrl_unregister_backend(self, backend);
 	}
 
+	res = arsdk_ftp_sched_destroy(self->ftp_sched);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("arsdk_ftp_sched_destroy", -res);
+
+	res = arsdk_updater_digest_destroy(self->updater_digest);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("arsdk_updater_digest_destroy", -res);
+
 	free(self);
 	return 0;
 }
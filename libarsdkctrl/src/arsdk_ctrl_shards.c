@@ -0,0 +1,423 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdkctrl_default_log.h"
+#include "arsdk_mpsc_ring.h"
+
+#include <pthread.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else /* !_WIN32 */
+#  include <unistd.h>
+#endif /* !_WIN32 */
+
+/** Default size of task queues */
+#define ARSDK_CTRL_SHARDS_DEFAULT_QUEUE_SIZE 256
+
+/** Task queued to a loop */
+struct arsdk_ctrl_shards_task {
+	arsdk_ctrl_shards_task_cb_t  cb;
+	void                         *userdata;
+	uint32_t                     idx;
+};
+
+/** Task queue consumed by a loop */
+struct arsdk_ctrl_shards_queue {
+	struct arsdk_ctrl_shards  *shards;
+	struct pomp_loop          *loop;
+	struct pomp_evt           *evt;
+	struct arsdk_mpsc_ring    ring;
+};
+
+/** Shard */
+struct arsdk_ctrl_shard {
+	struct arsdk_ctrl_shards        *shards;
+	uint32_t                        idx;
+	struct pomp_loop                *loop;
+	struct arsdk_ctrl               *ctrl;
+	struct arsdk_ctrl_shards_queue  queue;
+	pthread_t                       thread;
+	int                             thread_started;
+	int                             stopped;
+};
+
+/** */
+struct arsdk_ctrl_shards {
+	struct arsdk_ctrl_shard         *shards;
+	uint32_t                        count;
+	struct arsdk_ctrl_shards_queue  main_queue;
+};
+
+/**
+ */
+static void queue_evt_cb(struct pomp_evt *evt, void *userdata)
+{
+	struct arsdk_ctrl_shards_queue *queue = userdata;
+	struct arsdk_ctrl_shards_task task;
+
+	/* Clear first so that tasks pushed while draining signal again */
+	pomp_evt_clear(evt);
+
+	while (arsdk_mpsc_ring_pop(&queue->ring, &task) == 0)
+		(*task.cb)(queue->shards, task.idx, 0, task.userdata);
+}
+
+/**
+ */
+static int queue_init(struct arsdk_ctrl_shards_queue *queue,
+		struct arsdk_ctrl_shards *shards,
+		struct pomp_loop *loop,
+		uint32_t size)
+{
+	int res = 0;
+
+	queue->shards = shards;
+	queue->loop = loop;
+
+	res = arsdk_mpsc_ring_init(&queue->ring,
+			sizeof(struct arsdk_ctrl_shards_task), size);
+	if (res < 0)
+		return res;
+
+	queue->evt = pomp_evt_new();
+	if (queue->evt == NULL)
+		return -ENOMEM;
+
+	res = pomp_evt_attach_to_loop(queue->evt, loop, &queue_evt_cb, queue);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_evt_attach_to_loop", -res);
+		pomp_evt_destroy(queue->evt);
+		queue->evt = NULL;
+		return res;
+	}
+
+	return 0;
+}
+
+/**
+ */
+static void queue_clear(struct arsdk_ctrl_shards_queue *queue)
+{
+	struct arsdk_ctrl_shards_task task;
+
+	if (queue->evt != NULL) {
+		pomp_evt_detach_from_loop(queue->evt, queue->loop);
+		pomp_evt_destroy(queue->evt);
+		queue->evt = NULL;
+	}
+
+	/* Tasks not run are canceled so that they release their userdata;
+	 * the consumer loop is stopped, nothing else pops from the ring */
+	if (queue->ring.cells != NULL) {
+		while (arsdk_mpsc_ring_pop(&queue->ring, &task) == 0)
+			(*task.cb)(queue->shards, task.idx, -ECANCELED,
+					task.userdata);
+	}
+
+	arsdk_mpsc_ring_clear(&queue->ring);
+}
+
+/**
+ */
+static int queue_push(struct arsdk_ctrl_shards_queue *queue,
+		uint32_t idx,
+		arsdk_ctrl_shards_task_cb_t cb,
+		void *userdata)
+{
+	struct arsdk_ctrl_shards_task task = {
+		.cb = cb,
+		.userdata = userdata,
+		.idx = idx,
+	};
+	int res = 0;
+
+	res = arsdk_mpsc_ring_push(&queue->ring, &task);
+	if (res < 0)
+		return res;
+
+	/* The task is queued and runs with the next signal of the queue,
+	 * it must not be released nor pushed again by the caller */
+	res = pomp_evt_signal(queue->evt);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("pomp_evt_signal", -res);
+
+	return 0;
+}
+
+/**
+ */
+static void *shard_thread(void *userdata)
+{
+	struct arsdk_ctrl_shard *shard = userdata;
+
+	while (!__atomic_load_n(&shard->stopped, __ATOMIC_ACQUIRE))
+		pomp_loop_wait_and_process(shard->loop, -1);
+
+	return NULL;
+}
+
+/**
+ */
+static void shard_stop_task(struct arsdk_ctrl_shards *shards,
+		uint32_t idx,
+		int status,
+		void *userdata)
+{
+	struct arsdk_ctrl_shard *shard = userdata;
+
+	__atomic_store_n(&shard->stopped, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ */
+static int shard_init(struct arsdk_ctrl_shard *shard,
+		struct arsdk_ctrl_shards *shards,
+		uint32_t idx,
+		uint32_t queue_size)
+{
+	int res = 0;
+
+	shard->shards = shards;
+	shard->idx = idx;
+
+	shard->loop = pomp_loop_new();
+	if (shard->loop == NULL)
+		return -ENOMEM;
+
+	res = arsdk_ctrl_new(shard->loop, &shard->ctrl);
+	if (res < 0)
+		return res;
+
+	res = queue_init(&shard->queue, shards, shard->loop, queue_size);
+	if (res < 0)
+		return res;
+
+	res = pthread_create(&shard->thread, NULL, &shard_thread, shard);
+	if (res != 0) {
+		ARSDK_LOG_ERRNO("pthread_create", res);
+		return -res;
+	}
+	shard->thread_started = 1;
+
+	return 0;
+}
+
+/**
+ */
+static void shard_clear(struct arsdk_ctrl_shard *shard)
+{
+	int res = 0;
+
+	if (shard->thread_started) {
+		/* Stop from the shard thread to wake up its loop; fall back
+		 * to a direct wakeup if the queue is full */
+		res = queue_push(&shard->queue, shard->idx, &shard_stop_task,
+				shard);
+		if (res < 0) {
+			__atomic_store_n(&shard->stopped, 1, __ATOMIC_RELEASE);
+			pomp_loop_wakeup(shard->loop);
+		}
+		pthread_join(shard->thread, NULL);
+		shard->thread_started = 0;
+	}
+
+	queue_clear(&shard->queue);
+
+	if (shard->ctrl != NULL) {
+		arsdk_ctrl_destroy(shard->ctrl);
+		shard->ctrl = NULL;
+	}
+
+	if (shard->loop != NULL) {
+		res = pomp_loop_destroy(shard->loop);
+		if (res < 0)
+			ARSDK_LOG_ERRNO("pomp_loop_destroy", -res);
+		shard->loop = NULL;
+	}
+}
+
+/**
+ * Gives the count of online processors, 0 or less if unknown.
+ */
+static long get_cpu_count(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return (long)info.dwNumberOfProcessors;
+#else /* !_WIN32 */
+	return sysconf(_SC_NPROCESSORS_ONLN);
+#endif /* !_WIN32 */
+}
+
+/**
+ */
+int arsdk_ctrl_shards_new(struct pomp_loop *main_loop,
+		const struct arsdk_ctrl_shards_cfg *cfg,
+		struct arsdk_ctrl_shards **ret_obj)
+{
+	struct arsdk_ctrl_shards *self = NULL;
+	uint32_t queue_size = 0;
+	uint32_t count = 0;
+	uint32_t i = 0;
+	long nproc = 0;
+	int res = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_obj != NULL, -EINVAL);
+	*ret_obj = NULL;
+	ARSDK_RETURN_ERR_IF_FAILED(main_loop != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cfg != NULL, -EINVAL);
+
+	count = cfg->count;
+	if (count == 0) {
+		nproc = get_cpu_count();
+		count = nproc > 0 ? (uint32_t)nproc : 1;
+	}
+	queue_size = cfg->queue_size != 0 ? cfg->queue_size :
+			ARSDK_CTRL_SHARDS_DEFAULT_QUEUE_SIZE;
+	ARSDK_RETURN_ERR_IF_FAILED((queue_size & (queue_size - 1)) == 0,
+			-EINVAL);
+
+	/* Allocate structure */
+	self = calloc(1, sizeof(*self));
+	if (self == NULL)
+		return -ENOMEM;
+
+	self->shards = calloc(count, sizeof(*self->shards));
+	if (self->shards == NULL) {
+		free(self);
+		return -ENOMEM;
+	}
+
+	/* Initialize structure */
+	res = queue_init(&self->main_queue, self, main_loop, queue_size);
+	if (res < 0)
+		goto error;
+
+	for (i = 0; i < count; i++) {
+		self->count++;
+		res = shard_init(&self->shards[i], self, i, queue_size);
+		if (res < 0) {
+			ARSDK_LOG_ERRNO("shard_init", -res);
+			goto error;
+		}
+	}
+
+	ARSDK_LOGI("%u controller shards started", count);
+
+	*ret_obj = self;
+	return 0;
+
+	/* Cleanup in case of error */
+error:
+	arsdk_ctrl_shards_destroy(self);
+	return res;
+}
+
+/**
+ */
+int arsdk_ctrl_shards_destroy(struct arsdk_ctrl_shards *self)
+{
+	uint32_t i = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+
+	for (i = 0; i < self->count; i++)
+		shard_clear(&self->shards[i]);
+
+	queue_clear(&self->main_queue);
+
+	free(self->shards);
+	free(self);
+	return 0;
+}
+
+/**
+ */
+uint32_t arsdk_ctrl_shards_get_count(struct arsdk_ctrl_shards *self)
+{
+	return self == NULL ? 0 : self->count;
+}
+
+/**
+ */
+struct arsdk_ctrl *arsdk_ctrl_shards_get_ctrl(struct arsdk_ctrl_shards *self,
+		uint32_t idx)
+{
+	ARSDK_RETURN_VAL_IF_FAILED(self != NULL, -EINVAL, NULL);
+	ARSDK_RETURN_VAL_IF_FAILED(idx < self->count, -EINVAL, NULL);
+
+	return self->shards[idx].ctrl;
+}
+
+/**
+ */
+uint32_t arsdk_ctrl_shards_get_shard_for_key(struct arsdk_ctrl_shards *self,
+		const char *key)
+{
+	/* FNV-1a hash */
+	uint32_t hash = 2166136261u;
+
+	if (self == NULL || self->count == 0 || key == NULL)
+		return 0;
+
+	while (*key != '\0') {
+		hash ^= (uint8_t)*key++;
+		hash *= 16777619u;
+	}
+
+	return hash % self->count;
+}
+
+/**
+ */
+int arsdk_ctrl_shards_run(struct arsdk_ctrl_shards *self,
+		uint32_t idx,
+		arsdk_ctrl_shards_task_cb_t cb,
+		void *userdata)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(idx < self->count, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cb != NULL, -EINVAL);
+
+	return queue_push(&self->shards[idx].queue, idx, cb, userdata);
+}
+
+/**
+ */
+int arsdk_ctrl_shards_post_main(struct arsdk_ctrl_shards *self,
+		uint32_t idx,
+		arsdk_ctrl_shards_task_cb_t cb,
+		void *userdata)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cb != NULL, -EINVAL);
+
+	return queue_push(&self->main_queue, idx, cb, userdata);
+}
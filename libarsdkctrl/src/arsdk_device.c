@@ -691,6 +691,7 @@ int arsdk_device_get_ftp_itf(
 	int res = 0;
 	struct arsdk_ftp_itf_internal_cbs internal_cbs;
 	struct mux_ctx *mux = NULL;
+	struct arsdk_ctrl *ctrl = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_itf != NULL, -EINVAL);
 	*ret_itf = NULL;
@@ -722,12 +723,23 @@ int arsdk_device_get_ftp_itf(
 			&self->info,
 			mux,
 			ret_itf);
-	if (res == 0) {
-		/* Keep it */
-		self->ftp_itf = *ret_itf;
+	if (res < 0)
+		return res;
+
+	/* Share the transfer scheduler of the controller if the device runs
+	 * on its loop */
+	ctrl = self->backend->ctrl;
+	if (arsdk_transport_get_loop(self->transport) ==
+			arsdk_ctrl_get_loop(ctrl)) {
+		res = arsdk_ftp_itf_set_sched(*ret_itf,
+				arsdk_ctrl_get_ftp_sched(ctrl));
+		if (res < 0)
+			ARSDK_LOG_ERRNO("arsdk_ftp_itf_set_sched", -res);
 	}
 
-	return res;
+	/* Keep it */
+	self->ftp_itf = *ret_itf;
+	return 0;
 }
 
 /**
@@ -763,7 +775,9 @@ int arsdk_device_get_media_itf(
 	}
 
 	/* Create media interface */
-	res = arsdk_media_itf_new(ftp_itf, ret_itf);
+	res = arsdk_media_itf_new(ftp_itf,
+			arsdk_transport_get_loop(self->transport),
+			self->id, ret_itf);
 	if (res == 0) {
 		/* Keep it */
 		self->media_itf = *ret_itf;
@@ -781,6 +795,7 @@ int arsdk_device_get_updater_itf(
 	int res = 0;
 	struct arsdk_ftp_itf *ftp_itf = NULL;
 	struct mux_ctx *mux = NULL;
+	struct arsdk_ctrl *ctrl = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_itf != NULL, -EINVAL);
 	*ret_itf = NULL;
@@ -806,13 +821,26 @@ int arsdk_device_get_updater_itf(
 	}
 
 	/* Create updater interface */
-	res = arsdk_updater_itf_new(&self->info, ftp_itf, mux, ret_itf);
-	if (res == 0) {
-		/* Keep it */
-		self->updater_itf = *ret_itf;
+	res = arsdk_updater_itf_new(&self->info,
+			arsdk_transport_get_loop(self->transport),
+			ftp_itf, mux, ret_itf);
+	if (res < 0)
+		return res;
+
+	/* Share the firmware digest engine of the controller if the device
+	 * runs on its loop */
+	ctrl = self->backend->ctrl;
+	if (arsdk_transport_get_loop(self->transport) ==
+			arsdk_ctrl_get_loop(ctrl)) {
+		res = arsdk_updater_itf_set_digest(*ret_itf,
+				arsdk_ctrl_get_updater_digest(ctrl));
+		if (res < 0)
+			ARSDK_LOG_ERRNO("arsdk_updater_itf_set_digest", -res);
 	}
 
-	return res;
+	/* Keep it */
+	self->updater_itf = *ret_itf;
+	return 0;
 }
 
 int arsdk_device_get_blackbox_itf(
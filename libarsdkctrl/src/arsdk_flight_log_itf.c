@@ -367,6 +367,9 @@ static int ftp_get_log(struct arsdk_flight_log_req *req,
 	if (res < 0)
 		return res;
 
+	/* Let the user transfers go first */
+	arsdk_ftp_req_get_set_priority(curr_req->ftp_get,
+			ARSDK_FTP_REQ_PRIORITY_LOW);
 	return 0;
 }
 
@@ -731,6 +734,7 @@ int arsdk_flight_log_itf_create_req(struct arsdk_flight_log_itf *itf,
 		goto error;
 	}
 
+	memset(&ftp_cbs, 0, sizeof(ftp_cbs));
 	memset(&ftp_cbs, 0, sizeof(ftp_cbs));
 	ftp_cbs.userdata = req;
 	ftp_cbs.complete = &main_log_list_complete_cb;
@@ -27,9 +27,12 @@
 #include "arsdkctrl_priv.h"
 #include "arsdk_ftp_itf_priv.h"
 #include "ftp/arsdk_ftp.h"
+#include "ftp/arsdk_ftp_facts.h"
+#include "ftp/arsdk_ftp_journal.h"
 #include "arsdkctrl_default_log.h"
 
 #include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef BUILD_LIBMUX
 #  include <libmux.h>
@@ -42,6 +45,25 @@ struct arsdk_ftp_itf {
 	const struct arsdk_device_info     *dev_info;
 	struct mux_ctx                     *mux;
 	struct arsdk_ftp                   *ftp_ctx;
+	/* parallel "get" requests */
+	struct {
+		uint32_t                   conn_count;
+		size_t                     min_range_len;
+		/* downloads to a file are journaled */
+		int                        journal;
+	} get_cfg;
+	/* bandwidth limitation */
+	struct {
+		struct arsdk_ftp_bw_cfg    cfg;
+		/* adaptive mode */
+		struct pomp_timer          *timer;
+		/* rate adapted, 0 if not limited */
+		uint64_t                   rate;
+		uint64_t                   transferred;
+		uint32_t                   rtt_base;
+		uint32_t                   rtt_last;
+		uint64_t                   losses;
+	} bw;
 };
 
 /** */
@@ -50,7 +72,10 @@ struct arsdk_ftp_file {
 	enum arsdk_ftp_file_type        type;
 	const char                      *name;
 	size_t                          size;
+	time_t                          mtime;
 	struct list_node                node;
+	/* list allocating the file, NULL if allocated alone */
+	struct arsdk_ftp_file_list      *owner;
 };
 
 /** */
@@ -79,6 +104,17 @@ struct arsdk_ftp_req_put {
 	size_t                          ulsize;
 	size_t                          total_size;
 	struct arsdk_ftp_req            *ftp_size_req;
+	enum arsdk_ftp_req_priority     prio;
+};
+
+/** byte range of a parallel "get" request */
+struct arsdk_ftp_req_get_range {
+	struct arsdk_ftp_req_get        *req_get;
+	struct arsdk_ftp_req            *ftpreq;
+	uint64_t                        off;
+	uint64_t                        len;
+	uint64_t                        written;
+	int                             done;
 };
 
 /** */
@@ -86,12 +122,27 @@ struct arsdk_ftp_req_get {
 	struct arsdk_ftp_req_base       *base;
 	struct arsdk_ftp_req_get_cbs    cbs;
 	FILE                            *fout;
+	char                            *fout_buff;
 	struct pomp_buffer              *buff;
 	char                            *remote_path;
 	char                            *local_path;
 	float                           dlpercent;
 	size_t                          dlsize;
 	size_t                          total_size;
+	enum arsdk_ftp_req_priority     prio;
+	/* parallel download */
+	int                             is_parallel;
+	struct pomp_loop                *loop;
+	struct arsdk_ftp_req            *ftp_size_req;
+	struct arsdk_ftp_req_get_range  *ranges;
+	uint32_t                        range_count;
+	uint32_t                        ranges_pending;
+	size_t                          ranges_off;
+	enum arsdk_ftp_req_status       ranges_status;
+	int                             ranges_error;
+	/* integrity journal of the local file */
+	int                             use_journal;
+	struct arsdk_ftp_journal        *journal;
 };
 
 /** */
@@ -109,18 +160,54 @@ struct arsdk_ftp_req_delete {
 	char                            *path;
 };
 
+/** */
+struct arsdk_ftp_req_stat {
+	struct arsdk_ftp_req_base       *base;
+	struct arsdk_ftp_req_stat_cbs   cbs;
+};
+
+/** Count of files allocated at once by a file list */
+#define FILE_BLOCK_COUNT 128
+
+/** Minimum size of the blocks storing the names of a file list */
+#define NAME_BLOCK_SIZE 8192
+
+/** block of files of a file list */
+struct arsdk_ftp_file_block {
+	struct list_node                node;
+	uint32_t                        count;
+	struct arsdk_ftp_file           files[FILE_BLOCK_COUNT];
+};
+
+/** block of file names of a file list */
+struct arsdk_ftp_name_block {
+	struct list_node                node;
+	size_t                          len;
+	size_t                          size;
+	char                            data[];
+};
+
 struct arsdk_ftp_file_list {
 	uint32_t                        refcount;
 	struct list_node                files;
+	size_t                          count;
+	/* storage of the files and of their names */
+	struct list_node                file_blocks;
+	struct list_node                name_blocks;
 };
 
 /** */
 struct arsdk_ftp_req_list {
 	struct arsdk_ftp_req_base       *base;
 	struct arsdk_ftp_req_list_cbs   cbs;
-	struct pomp_buffer              *buffer;
 	char                            *path;
 	struct arsdk_ftp_file_list      *result;
+	/* files parsed while received */
+	struct arsdk_ftp_file_list      *files;
+	int                             first_line;
+	char                            *line;
+	size_t                          line_len;
+	size_t                          line_size;
 };
 
 struct arsdk_ftp_req_ops {
@@ -134,11 +221,32 @@ struct arsdk_ftp_req_ops {
 			size_t size, size_t nmemb);
 	size_t (*read)(struct arsdk_ftp_req_base *req, void *ptr,
 			size_t size, size_t nmemb);
+	/* optional: file descriptor and offset to upload from */
+	int (*read_fd)(struct arsdk_ftp_req_base *req, off_t *offset);
 	void (*destroy)(struct arsdk_ftp_req_base *req);
 };
 
 #define DEFAULT_BUFFER_SIZE 256
 
+/** Size of the stdio buffer of downloaded files, the received fragments are
+ *  written to the file by blocks of this size */
+#define GET_FILE_BUFFER_SIZE (256 * 1024)
+
+/** Maximum count of connections of a parallel "get" request */
+#define GET_CONN_COUNT_MAX 16
+
+/** Default minimum length of the ranges of a parallel "get" request */
+#define GET_MIN_RANGE_LEN_DEFAULT (4 * 1024 * 1024)
+
+/** Period of the adaptation of the bandwidth to the command link (ms) */
+#define BW_ADAPT_PERIOD 1000
+
+/** Minimum rate of the adaptive bandwidth (bytes per second) */
+#define BW_ADAPT_MIN_RATE (64 * 1024)
+
+/** Ping delay increase considered as a congestion of the link (us) */
+#define BW_ADAPT_RTT_MARGIN 50000
+
 /**
  */
 static size_t default_read_data(struct arsdk_ftp_req_base *req,
@@ -230,6 +338,21 @@ static size_t req_write_data_cb(struct arsdk_ftp *ftp_ctx,
 	return (*req->ops->write)(req, ptr, size, nmemb);
 }
 
+/**
+ */
+static int req_read_fd_cb(struct arsdk_ftp *ftp_ctx,
+		struct arsdk_ftp_req *ftpreq,
+		off_t *offset,
+		void *userdata)
+{
+	struct arsdk_ftp_req_base *req = userdata;
+
+	if (req->ops->read_fd == NULL)
+		return -1;
+
+	return (*req->ops->read_fd)(req, offset);
+}
+
 /**
  */
 static void req_progress_cb(struct arsdk_ftp *ftp_ctx,
@@ -248,6 +371,30 @@ static void req_progress_cb(struct arsdk_ftp *ftp_ctx,
 			ultotal, ulnow, ulpercent);
 }
 
+/**
+ */
+static int to_req_status(enum arsdk_ftp_status ftpstatus,
+		enum arsdk_ftp_req_status *status)
+{
+	switch (ftpstatus) {
+	case ARSDK_FTP_STATUS_OK:
+		*status = ARSDK_FTP_REQ_STATUS_OK;
+		return 0;
+	case ARSDK_FTP_STATUS_CANCELED:
+		*status = ARSDK_FTP_REQ_STATUS_CANCELED;
+		return 0;
+	case ARSDK_FTP_STATUS_FAILED:
+		*status = ARSDK_FTP_REQ_STATUS_FAILED;
+		return 0;
+	case ARSDK_FTP_STATUS_ABORTED:
+		*status = ARSDK_FTP_REQ_STATUS_ABORTED;
+		return 0;
+	default:
+		ARSDK_LOGW("Unknown ftp status: %d", ftpstatus);
+		return -EINVAL;
+	}
+}
+
 /**
  */
 static void req_complete_cb(struct arsdk_ftp *ftp_ctx,
@@ -260,23 +407,8 @@ static void req_complete_cb(struct arsdk_ftp *ftp_ctx,
 	enum arsdk_ftp_req_status status = 0;
 
 	/* Convert status */
-	switch (ftpstatus) {
-	case ARSDK_FTP_STATUS_OK:
-		status = ARSDK_FTP_REQ_STATUS_OK;
-		break;
-	case ARSDK_FTP_STATUS_CANCELED:
-		status = ARSDK_FTP_REQ_STATUS_CANCELED;
-		break;
-	case ARSDK_FTP_STATUS_FAILED:
-		status = ARSDK_FTP_REQ_STATUS_FAILED;
-		break;
-	case ARSDK_FTP_STATUS_ABORTED:
-		status = ARSDK_FTP_REQ_STATUS_ABORTED;
-		break;
-	default:
-		ARSDK_LOGW("Unknown ftp status: %d", ftpstatus);
+	if (to_req_status(ftpstatus, &status) < 0)
 		return;
-	}
 
 	/* Notify and cleanup request */
 	(*req->ops->complete)(req, status, error);
@@ -377,6 +509,7 @@ static int req_new(struct arsdk_ftp_itf *itf,
 	req->itf = itf;
 	req->ftpcbs.userdata = req;
 	req->ftpcbs.read_data = &req_read_data_cb;
+	req->ftpcbs.read_fd = &req_read_fd_cb;
 	req->ftpcbs.write_data = &req_write_data_cb;
 	req->ftpcbs.progress = &req_progress_cb;
 	req->ftpcbs.complete = &req_complete_cb;
@@ -455,6 +588,10 @@ int arsdk_ftp_itf_new(struct arsdk_transport *transport,
 	if (res < 0)
 		goto error;
 
+	/* each mux request uses a new tunnel, seen as a new server */
+	if (itf->mux != NULL)
+		arsdk_ftp_set_feat_query(itf->ftp_ctx, 0);
+
 	*ret_itf = itf;
 	return 0;
 
@@ -501,12 +638,25 @@ int arsdk_ftp_itf_stop(struct arsdk_ftp_itf *itf)
 
 	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
 	itf->transport = NULL;
+	if (itf->bw.timer != NULL) {
+		pomp_timer_clear(itf->bw.timer);
+		pomp_timer_destroy(itf->bw.timer);
+		itf->bw.timer = NULL;
+	}
 	res = arsdk_ftp_stop(itf->ftp_ctx);
 	if (res < 0)
 		ARSDK_LOG_ERRNO("arsdk_ftp_stop", -res);
 	return 0;
 }
 
+int arsdk_ftp_itf_set_sched(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_sched *sched)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+
+	return arsdk_ftp_set_sched(itf->ftp_ctx, sched);
+}
+
 int arsdk_ftp_itf_cancel_all(struct arsdk_ftp_itf *itf)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
@@ -514,8 +664,244 @@ int arsdk_ftp_itf_cancel_all(struct arsdk_ftp_itf *itf)
 	return arsdk_ftp_cancel_all(itf->ftp_ctx);
 }
 
+int arsdk_ftp_itf_set_upload_cfg(struct arsdk_ftp_itf *itf,
+		size_t frag_len,
+		uint32_t frag_count)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+
+	return arsdk_ftp_set_upload_cfg(itf->ftp_ctx, frag_len, frag_count);
+}
+
+int arsdk_ftp_itf_set_download_cfg(struct arsdk_ftp_itf *itf,
+		uint32_t conn_count,
+		size_t min_range_len)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(conn_count <= GET_CONN_COUNT_MAX, -EINVAL);
+
+	itf->get_cfg.conn_count = conn_count;
+	itf->get_cfg.min_range_len = (min_range_len != 0) ? min_range_len :
+			GET_MIN_RANGE_LEN_DEFAULT;
+	return 0;
+}
+
+int arsdk_ftp_itf_prepare_conn(struct arsdk_ftp_itf *itf,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_srv_type srv_type)
+{
+	int res = 0;
+	int port = -1;
+	const char *host = NULL;
+	char url[64];
+
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(srv_type >= ARSDK_FTP_SRV_TYPE_MEDIA &&
+			srv_type <= ARSDK_FTP_SRV_TYPE_FLIGHT_PLAN, -EINVAL);
+
+	if (itf->transport == NULL)
+		return -EPIPE;
+
+	/* the tunnel of a mux request is closed with it */
+	if (itf->mux != NULL)
+		return -ENOTSUP;
+
+	res = resolution(itf, dev_type, srv_type, &port, &host);
+	if (res < 0)
+		return res;
+
+	snprintf(url, sizeof(url), "ftp://%s:%d/", host, port);
+	return arsdk_ftp_prepare_conn(itf->ftp_ctx, url);
+}
+
+/**
+ * Adapts the rate of the transfers to the command link: halved on a
+ * congestion, the ping delay being above its base value or packets being
+ * lost, and increased otherwise.
+ */
+static void bw_adapt_timer_cb(struct pomp_timer *timer, void *userdata)
+{
+	int congested = 0;
+	uint32_t rtt = 0;
+	uint64_t losses = 0;
+	uint64_t transferred = 0;
+	uint64_t throughput = 0;
+	uint64_t rate = 0;
+	uint64_t step = 0;
+	struct arsdk_transport_metrics metrics;
+	struct arsdk_ftp_itf *itf = userdata;
+
+	if (itf->transport == NULL ||
+	    arsdk_transport_get_metrics(itf->transport, &metrics) < 0)
+		return;
+
+	/* throughput of the last period */
+	transferred = arsdk_ftp_get_transferred(itf->ftp_ctx);
+	throughput = (transferred - itf->bw.transferred) * 1000 /
+			BW_ADAPT_PERIOD;
+	itf->bw.transferred = transferred;
+
+	losses = metrics.tx_drops + metrics.tx_errors;
+	if (losses != itf->bw.losses)
+		congested = 1;
+	itf->bw.losses = losses;
+
+	/* the ping delay is updated once per ping period */
+	rtt = metrics.ping_delay_us;
+	if (rtt != 0 && rtt != itf->bw.rtt_last) {
+		itf->bw.rtt_last = rtt;
+		if (itf->bw.rtt_base == 0 || rtt < itf->bw.rtt_base)
+			itf->bw.rtt_base = rtt;
+		else if (rtt > itf->bw.rtt_base + BW_ADAPT_RTT_MARGIN &&
+			 rtt > 2 * itf->bw.rtt_base)
+			congested = 1;
+		else
+			/* follow the slow changes of the link */
+			itf->bw.rtt_base += (rtt - itf->bw.rtt_base) / 16;
+	} else if (!congested) {
+		return;
+	}
+
+	if (congested) {
+		/* multiplicative decrease from the rate in use */
+		rate = (itf->bw.rate != 0) ? itf->bw.rate : itf->bw.cfg.max_rate;
+		if (rate == 0 || (throughput != 0 && throughput < rate))
+			rate = throughput;
+		if (rate == 0)
+			return;
+		rate /= 2;
+		if (rate < BW_ADAPT_MIN_RATE)
+			rate = BW_ADAPT_MIN_RATE;
+	} else if (itf->bw.rate != 0) {
+		/* additive increase up to the limit */
+		step = itf->bw.rate / 8;
+		rate = itf->bw.rate + ((step > BW_ADAPT_MIN_RATE) ? step :
+				BW_ADAPT_MIN_RATE);
+		if (itf->bw.cfg.max_rate != 0 && rate >= itf->bw.cfg.max_rate)
+			rate = 0;
+		else if (itf->bw.cfg.max_rate == 0 && throughput < rate / 2)
+			rate = 0;
+	} else {
+		return;
+	}
+
+	if (rate != itf->bw.rate) {
+		ARSDK_LOGD("ftp rate: %" PRIu64 " B/s (throughput %" PRIu64
+				" B/s, ping %u us)", rate, throughput, rtt);
+	}
+	itf->bw.rate = rate;
+	arsdk_ftp_set_max_rate(itf->ftp_ctx,
+			(rate != 0) ? rate : itf->bw.cfg.max_rate);
+}
+
+int arsdk_ftp_itf_set_bw_cfg(struct arsdk_ftp_itf *itf,
+		const struct arsdk_ftp_bw_cfg *cfg)
+{
+	int res = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cfg != NULL, -EINVAL);
+
+	if (itf->transport == NULL)
+		return -EPIPE;
+
+	if (cfg->adaptive && itf->bw.timer == NULL) {
+		itf->bw.timer = pomp_timer_new(
+				arsdk_transport_get_loop(itf->transport),
+				&bw_adapt_timer_cb, itf);
+		if (itf->bw.timer == NULL)
+			return -ENOMEM;
+
+		res = pomp_timer_set_periodic(itf->bw.timer, BW_ADAPT_PERIOD,
+				BW_ADAPT_PERIOD);
+		if (res < 0) {
+			pomp_timer_destroy(itf->bw.timer);
+			itf->bw.timer = NULL;
+			return res;
+		}
+		itf->bw.transferred = arsdk_ftp_get_transferred(itf->ftp_ctx);
+	} else if (!cfg->adaptive && itf->bw.timer != NULL) {
+		pomp_timer_clear(itf->bw.timer);
+		pomp_timer_destroy(itf->bw.timer);
+		itf->bw.timer = NULL;
+	}
+
+	/* the adaptation restarts from the new limit */
+	itf->bw.cfg = *cfg;
+	itf->bw.rate = 0;
+	arsdk_ftp_set_req_max_rate(itf->ftp_ctx, cfg->transfer_max_rate);
+	return arsdk_ftp_set_max_rate(itf->ftp_ctx, cfg->max_rate);
+}
+
+int arsdk_ftp_itf_set_progress_cfg(struct arsdk_ftp_itf *itf,
+		size_t min_len,
+		uint32_t period_ms)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+
+	return arsdk_ftp_set_progress_cfg(itf->ftp_ctx, min_len, period_ms);
+}
+
+int arsdk_ftp_itf_set_download_journal(struct arsdk_ftp_itf *itf,
+		int enable)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+
+	itf->get_cfg.journal = enable;
+	return 0;
+}
+
+int arsdk_ftp_itf_get_download_journal(const char *local_path,
+		uint64_t *remote_size,
+		uint64_t *checkpoint)
+{
+	return arsdk_ftp_journal_get_info(local_path, remote_size, checkpoint);
+}
+
+/* Size request : */
+
+static size_t size_read_data(struct arsdk_ftp *itf,
+			struct arsdk_ftp_req *req,
+			void *ptr,
+			size_t size,
+			size_t nmemb,
+			void *userdata)
+{
+	/* Do nothing */
+
+	return nmemb;
+}
+
+static size_t size_write_data(struct arsdk_ftp *ctx,
+			struct arsdk_ftp_req *req,
+			const void *ptr,
+			size_t size,
+			size_t nmemb,
+			void *userdata)
+{
+	/* Do nothing */
+
+	return nmemb;
+}
+
+static void size_progress(struct arsdk_ftp *ctx,
+			struct arsdk_ftp_req *req,
+			double dltotal,
+			double dlnow,
+			float dlpercent,
+			double ultotal,
+			double ulnow,
+			float ulpercent,
+			void *userdata)
+{
+	/* Do nothing */
+}
+
 /* Get request : */
 
+/* forward declaration */
+static void ranges_cancel_idle_cb(void *userdata);
+
 /**
  */
 static void arsdk_ftp_req_get_destroy(struct arsdk_ftp_req_get *req_get)
@@ -524,8 +910,15 @@ static void arsdk_ftp_req_get_destroy(struct arsdk_ftp_req_get *req_get)
 
 	req_destroy(req_get->base);
 
+	if (req_get->journal != NULL)
+		arsdk_ftp_journal_close(req_get->journal);
 	if (req_get->fout != NULL)
 		fclose(req_get->fout);
+	free(req_get->fout_buff);
+	if (req_get->ranges != NULL)
+		pomp_loop_idle_remove(req_get->loop, &ranges_cancel_idle_cb,
+				req_get);
+	free(req_get->ranges);
 
 	if (req_get->buff != NULL)
 		pomp_buffer_unref(req_get->buff);
@@ -540,29 +933,60 @@ static void req_get_destroy(struct arsdk_ftp_req_base *req)
 	arsdk_ftp_req_get_destroy(req->child);
 }
 
+/**
+ * Checksums the data written to the output file; the journal is dropped
+ * on error, its checkpoints remain valid.
+ */
+static void req_get_journal_write(struct arsdk_ftp_req_get *req_get,
+		const void *ptr, size_t len)
+{
+	int res = 0;
+
+	res = arsdk_ftp_journal_write(req_get->journal, req_get->fout, ptr,
+			len);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("arsdk_ftp_journal_write", -res);
+		arsdk_ftp_journal_close(req_get->journal);
+		req_get->journal = NULL;
+	}
+}
+
 static size_t req_get_write_data(struct arsdk_ftp_req_base *req,
 		const void *ptr,
 		size_t size, size_t nmemb)
 {
 	int res = 0;
+	size_t wr = 0;
 	size_t len = size * nmemb;
 	struct arsdk_ftp_req_get *req_get = req->child;
 
 	if (req_get->fout != NULL) {
 		/* Write in output file */
-		return fwrite(ptr, size, nmemb, req_get->fout);
-	} else if (req_get->buff != NULL) {
-		/* Write in pomp buffer */
-		res = pomp_buffer_append_data(req_get->buff, ptr, len);
-		if (res < 0)
-			ARSDK_LOGE("pomp_buffer_append failed");
+		wr = fwrite(ptr, size, nmemb, req_get->fout);
+		if (req_get->journal != NULL)
+			req_get_journal_write(req_get, ptr, wr * size);
+		return wr;
+	}
+
+	if (req_get->buff == NULL) {
+		/* Create the pomp buffer to the size of the file, given before
+		 * the data, so that the data is copied once */
+		req_get->buff = pomp_buffer_new(
+				arsdk_ftp_req_get_size(req->ftpreq));
+		if (req_get->buff == NULL) {
+			ARSDK_LOGE("Failed to create buffer of capacity of %zu",
+					arsdk_ftp_req_get_size(req->ftpreq));
+			return 0;
+		}
+	}
 
-		return nmemb;
+	/* Write in pomp buffer */
+	res = pomp_buffer_append_data(req_get->buff, ptr, len);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_buffer_append_data", -res);
+		return 0;
 	}
 
-	/* No write */
-	ARSDK_LOGW("No output for req %p: size=%lu nmemb=%lu",
-			req, (unsigned long)size, (unsigned long)nmemb);
 	return nmemb;
 }
 
@@ -574,17 +998,6 @@ static void req_get_progress(struct arsdk_ftp_req_base *req,
 {
 	struct arsdk_ftp_req_get *req_get = req->child;
 
-	if ((req_get->fout == NULL) &&
-	    (req_get->buff == NULL) &&
-	    (dltotal > 0)) {
-		/* Create the pomp buffer to Save data */
-		req_get->buff = pomp_buffer_new(dltotal);
-		if (req_get->buff == NULL) {
-			ARSDK_LOGW("Failed to create buffer of capacity of %zu",
-					(size_t)dltotal);
-		}
-	}
-
 	if (req_get->dlpercent != dlpercent) {
 		req_get->dlsize = dlnow;
 		req_get->total_size = dltotal;
@@ -594,11 +1007,65 @@ static void req_get_progress(struct arsdk_ftp_req_base *req,
 	}
 }
 
+/**
+ * Closes the journal at the end of the download: it is deleted once the
+ * size of the file is checked, otherwise it is completed with the data
+ * received to resume the download.
+ */
+static void req_get_close_journal(struct arsdk_ftp_req_get *req_get,
+		enum arsdk_ftp_req_status *status, int *error)
+{
+	int res = 0;
+	struct stat st;
+
+	if (fstat(fileno(req_get->fout), &st) < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("fstat", -res);
+		goto out;
+	}
+
+	if (*status == ARSDK_FTP_REQ_STATUS_OK) {
+		if ((size_t)st.st_size == req_get->total_size) {
+			arsdk_ftp_journal_remove(req_get->journal);
+			req_get->journal = NULL;
+			return;
+		}
+
+		ARSDK_LOGE("'%s': size %" PRIu64 " instead of %zu",
+				req_get->local_path, (uint64_t)st.st_size,
+				req_get->total_size);
+		*status = ARSDK_FTP_REQ_STATUS_FAILED;
+		*error = -EPROTO;
+	}
+
+	res = arsdk_ftp_journal_sync(req_get->journal, st.st_size);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("arsdk_ftp_journal_sync", -res);
+
+out:
+	arsdk_ftp_journal_close(req_get->journal);
+	req_get->journal = NULL;
+}
+
 static void req_get_complete(struct arsdk_ftp_req_base *req,
 		enum arsdk_ftp_req_status status, int error)
 {
+	int res = 0;
 	struct arsdk_ftp_req_get *req_get = req->child;
 
+	/* write the buffered data before the file is used by the user */
+	if (req_get->fout != NULL && fflush(req_get->fout) != 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("fflush", -res);
+		if (status == ARSDK_FTP_REQ_STATUS_OK) {
+			status = ARSDK_FTP_REQ_STATUS_FAILED;
+			error = res;
+		}
+	}
+
+	if (req_get->journal != NULL)
+		req_get_close_journal(req_get, &status, &error);
+
 	/* Notify */
 	(*req_get->cbs.complete)(req->itf, req_get, status, error,
 			req_get->cbs.userdata);
@@ -614,6 +1081,414 @@ static const struct arsdk_ftp_req_ops s_req_get_ops = {
 	.destroy = &req_get_destroy,
 };
 
+/**
+ * Gives a large buffer to the output file to write the received data by
+ * blocks instead of one write per received fragment.
+ * Must be called before any operation on the file.
+ */
+static void req_get_set_fout_buff(struct arsdk_ftp_req_get *req_get)
+{
+	int res = 0;
+
+	req_get->fout_buff = malloc(GET_FILE_BUFFER_SIZE);
+	if (req_get->fout_buff == NULL)
+		return;
+
+	res = setvbuf(req_get->fout, req_get->fout_buff, _IOFBF,
+			GET_FILE_BUFFER_SIZE);
+	if (res != 0) {
+		free(req_get->fout_buff);
+		req_get->fout_buff = NULL;
+	}
+}
+
+/**
+ * Gives the end of the data downloaded from the start of the file; the
+ * ranges after the first incomplete one are dropped to keep the file
+ * resumable.
+ */
+static size_t req_get_ranges_contiguous_size(struct arsdk_ftp_req_get *req_get)
+{
+	uint32_t i = 0;
+	struct arsdk_ftp_req_get_range *range = NULL;
+
+	for (i = 0; i < req_get->range_count; i++) {
+		range = &req_get->ranges[i];
+		if (!range->done)
+			return range->off + range->written;
+	}
+
+	return req_get->total_size;
+}
+
+static void req_get_ranges_complete(struct arsdk_ftp_req_get *req_get)
+{
+	int res = 0;
+	size_t size = 0;
+
+	if (req_get->ranges_status != ARSDK_FTP_REQ_STATUS_OK) {
+		size = req_get_ranges_contiguous_size(req_get);
+		if (fflush(req_get->fout) != 0 ||
+		    ftruncate(fileno(req_get->fout), size) < 0) {
+			res = -errno;
+			ARSDK_LOG_ERRNO("ftruncate", -res);
+		}
+		req_get->dlsize = size;
+	}
+
+	/* Notify and cleanup request */
+	(*req_get->base->ops->complete)(req_get->base,
+			req_get->ranges_status, req_get->ranges_error);
+	(*req_get->base->ops->destroy)(req_get->base);
+}
+
+static size_t range_read_data(struct arsdk_ftp *ctx,
+		struct arsdk_ftp_req *ftpreq,
+		void *ptr,
+		size_t size,
+		size_t nmemb,
+		void *userdata)
+{
+	return nmemb;
+}
+
+/**
+ * Writes data at an offset of a file, without going through its stdio
+ * buffer nor moving its position.
+ */
+static size_t file_write_at(FILE *file,
+		const void *ptr,
+		size_t len,
+		uint64_t off)
+{
+#ifdef _WIN32
+	if (fseeko(file, off, SEEK_SET) < 0) {
+		ARSDK_LOG_ERRNO("fseeko", errno);
+		return 0;
+	}
+
+	return fwrite(ptr, 1, len, file);
+#else /* !_WIN32 */
+	ssize_t res = 0;
+	size_t wr = 0;
+
+	while (wr < len) {
+		res = pwrite(fileno(file), (const uint8_t *)ptr + wr, len - wr,
+				off + wr);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0) {
+			ARSDK_LOG_ERRNO("pwrite", res < 0 ? errno : EIO);
+			break;
+		}
+		wr += res;
+	}
+
+	return wr;
+#endif /* !_WIN32 */
+}
+
+static size_t range_write_data(struct arsdk_ftp *ctx,
+		struct arsdk_ftp_req *ftpreq,
+		const void *ptr,
+		size_t size,
+		size_t nmemb,
+		void *userdata)
+{
+	size_t wr = 0;
+	struct arsdk_ftp_req_get_range *range = userdata;
+	struct arsdk_ftp_req_get *req_get = range->req_get;
+
+	/* callbacks of all ranges are called from the loop */
+	wr = file_write_at(req_get->fout, ptr, size * nmemb,
+			range->off + range->written);
+
+	/* the data following the checksummed data is checksummed on the fly,
+	 * the others when the download completes */
+	if (req_get->journal != NULL &&
+	    range->off + range->written ==
+			arsdk_ftp_journal_get_end(req_get->journal))
+		req_get_journal_write(req_get, ptr, wr);
+
+	range->written += wr;
+	return size == 0 ? 0 : wr / size;
+}
+
+static void range_progress(struct arsdk_ftp *ctx,
+		struct arsdk_ftp_req *ftpreq,
+		double dltotal,
+		double dlnow,
+		float dlpercent,
+		double ultotal,
+		double ulnow,
+		float ulpercent,
+		void *userdata)
+{
+	uint32_t i = 0;
+	struct arsdk_ftp_req_get_range *range = userdata;
+	struct arsdk_ftp_req_get *req_get = range->req_get;
+	double total = req_get->total_size;
+	double now = req_get->ranges_off;
+
+	for (i = 0; i < req_get->range_count; i++)
+		now += req_get->ranges[i].written;
+
+	(*req_get->base->ops->progress)(req_get->base, total, now,
+			(float)((now / total) * 100), 0, 0, 0);
+}
+
+static void ranges_cancel_idle_cb(void *userdata)
+{
+	uint32_t i = 0;
+	int last = 0;
+	struct arsdk_ftp_req_get *req_get = userdata;
+	struct arsdk_ftp_req *ftpreq = NULL;
+
+	for (i = 0; i < req_get->range_count; i++) {
+		ftpreq = req_get->ranges[i].ftpreq;
+		if (ftpreq == NULL)
+			continue;
+
+		/* the request is destroyed with the last range completed */
+		last = (req_get->ranges_pending == 1);
+		arsdk_ftp_cancel_req(req_get->base->itf->ftp_ctx, ftpreq);
+		if (last)
+			return;
+	}
+}
+
+static void range_complete(struct arsdk_ftp *ctx,
+		struct arsdk_ftp_req *ftpreq,
+		enum arsdk_ftp_status ftpstatus,
+		int error,
+		void *userdata)
+{
+	enum arsdk_ftp_req_status status = ARSDK_FTP_REQ_STATUS_FAILED;
+	struct arsdk_ftp_req_get_range *range = userdata;
+	struct arsdk_ftp_req_get *req_get = range->req_get;
+
+	range->ftpreq = NULL;
+	range->done = (ftpstatus == ARSDK_FTP_STATUS_OK) &&
+			(range->written == range->len);
+	if (ftpstatus == ARSDK_FTP_STATUS_OK && !range->done) {
+		ARSDK_LOGW("range at %" PRIu64 ": %" PRIu64 "/%" PRIu64
+				" bytes written", range->off, range->written,
+				range->len);
+		ftpstatus = ARSDK_FTP_STATUS_FAILED;
+		error = -EIO;
+	}
+
+	if (!range->done &&
+	    req_get->ranges_status == ARSDK_FTP_REQ_STATUS_OK) {
+		to_req_status(ftpstatus, &status);
+		req_get->ranges_status = status;
+		req_get->ranges_error = error;
+
+		/* the download failed, stop the other ranges out of the
+		 * ftp callbacks */
+		pomp_loop_idle_add(req_get->loop, &ranges_cancel_idle_cb,
+				req_get);
+	}
+
+	req_get->ranges_pending--;
+	if (req_get->ranges_pending == 0)
+		req_get_ranges_complete(req_get);
+}
+
+/**
+ * Splits the remaining data in ranges downloaded on separate connections.
+ * Returns -EAGAIN if the file is too small to be split.
+ */
+static int req_get_start_ranges(struct arsdk_ftp_req_get *req_get,
+		const char *url)
+{
+	int res = 0;
+	uint32_t i = 0;
+	uint32_t count = 0;
+	uint64_t remaining = 0;
+	uint64_t off = 0;
+	struct arsdk_ftp_req_get_range *range = NULL;
+	struct arsdk_ftp_itf *itf = req_get->base->itf;
+	struct arsdk_ftp_req_cbs cbs;
+
+	if (req_get->total_size <= req_get->dlsize)
+		return -EAGAIN;
+
+	remaining = req_get->total_size - req_get->dlsize;
+	count = remaining / itf->get_cfg.min_range_len;
+	if (count > itf->get_cfg.conn_count)
+		count = itf->get_cfg.conn_count;
+	if (count < 2)
+		return -EAGAIN;
+
+	/* the ranges write to the file descriptor directly */
+	if (fflush(req_get->fout) != 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("fflush", -res);
+		return res;
+	}
+
+	req_get->ranges = calloc(count, sizeof(*req_get->ranges));
+	if (req_get->ranges == NULL)
+		return -ENOMEM;
+
+	req_get->loop = arsdk_transport_get_loop(itf->transport);
+	req_get->range_count = count;
+	req_get->ranges_off = req_get->dlsize;
+	req_get->ranges_status = ARSDK_FTP_REQ_STATUS_OK;
+
+	/* the last range gets the remainder */
+	off = req_get->dlsize;
+	for (i = 0; i < count; i++) {
+		range = &req_get->ranges[i];
+		range->req_get = req_get;
+		range->off = off;
+		range->len = (i < count - 1) ? remaining / count :
+				req_get->total_size - off;
+		off += range->len;
+	}
+
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.read_data = &range_read_data;
+	cbs.write_data = &range_write_data;
+	cbs.progress = &range_progress;
+	cbs.complete = &range_complete;
+
+	for (i = 0; i < count; i++) {
+		range = &req_get->ranges[i];
+		cbs.userdata = range;
+		res = arsdk_ftp_get_range(itf->ftp_ctx, &cbs, url, range->off,
+				range->len, &range->ftpreq);
+		if (res < 0)
+			break;
+		req_get->ranges_pending++;
+		arsdk_ftp_set_req_priority(range->ftpreq, req_get->prio);
+	}
+
+	if (res < 0 && req_get->ranges_pending == 0) {
+		free(req_get->ranges);
+		req_get->ranges = NULL;
+		req_get->range_count = 0;
+		return res;
+	}
+
+	if (res < 0) {
+		/* fail the range, the ranges started are canceled and the
+		 * request completes with them */
+		ARSDK_LOG_ERRNO("arsdk_ftp_get_range", -res);
+		req_get->ranges_pending++;
+		range_complete(itf->ftp_ctx, NULL, ARSDK_FTP_STATUS_FAILED,
+				res, &req_get->ranges[i]);
+	}
+
+	return 0;
+}
+
+/**
+ * Opens the journal of the download, the data after the last checkpoint
+ * matching the local file and the remote file is downloaded again.
+ */
+static void req_get_open_journal(struct arsdk_ftp_req_get *req_get,
+		time_t mtime)
+{
+	int res = 0;
+	uint64_t off = 0;
+
+	/* the remote file is unknown */
+	if (req_get->total_size == 0)
+		return;
+
+	res = arsdk_ftp_journal_open(req_get->local_path,
+			req_get->total_size, mtime, req_get->dlsize,
+			&req_get->journal, &off);
+	if (res < 0)
+		return;
+
+	if (off == req_get->dlsize)
+		return;
+
+	ARSDK_LOGI("'%s': resume from %" PRIu64 " instead of %zu",
+			req_get->local_path, off, req_get->dlsize);
+	if (fflush(req_get->fout) != 0 ||
+	    ftruncate(fileno(req_get->fout), off) < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("ftruncate", -res);
+		arsdk_ftp_journal_close(req_get->journal);
+		req_get->journal = NULL;
+		return;
+	}
+
+	req_get->dlsize = off;
+}
+
+static void get_size_complete(struct arsdk_ftp *ctx,
+			struct arsdk_ftp_req *req,
+			enum arsdk_ftp_status status,
+			int error,
+			void *userdata)
+{
+	int res = 0;
+	const char *url = NULL;
+	enum arsdk_ftp_req_status req_status = ARSDK_FTP_REQ_STATUS_FAILED;
+	struct arsdk_ftp_req_get *req_get = userdata;
+
+	req_get->ftp_size_req = NULL;
+	if ((status == ARSDK_FTP_STATUS_CANCELED) ||
+	    (status == ARSDK_FTP_STATUS_ABORTED)) {
+		res = error;
+		goto complete;
+	}
+
+	/* the size request is reported failed as no data is received, the
+	 * size is valid if not null */
+	req_get->total_size = arsdk_ftp_req_get_size(req);
+	url = arsdk_ftp_req_get_url(req);
+
+	if (req_get->use_journal)
+		req_get_open_journal(req_get, arsdk_ftp_req_get_mtime(req));
+
+	res = req_get_start_ranges(req_get, url);
+	if (res == 0)
+		return;
+
+	/* single connection download */
+	res = fseeko(req_get->fout, req_get->dlsize, SEEK_SET);
+	if (res < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("fseeko", -res);
+		goto complete;
+	}
+
+	res = arsdk_ftp_get(req_get->base->itf->ftp_ctx,
+			&req_get->base->ftpcbs, url, req_get->dlsize,
+			&req_get->base->ftpreq);
+	if (res < 0)
+		goto complete;
+
+	arsdk_ftp_set_req_priority(req_get->base->ftpreq, req_get->prio);
+	return;
+
+complete:
+	to_req_status(status, &req_status);
+	(*req_get->base->ops->complete)(req_get->base, req_status, res);
+	(*req_get->base->ops->destroy)(req_get->base);
+}
+
+/**
+ * Opens the output file of a resumed parallel download, written at any
+ * offset; the file is created if needed.
+ */
+static FILE *fopen_resume_parallel(const char *path)
+{
+	FILE *fout = NULL;
+
+	fout = fopen(path, "r+b");
+	if (fout == NULL && errno == ENOENT)
+		fout = fopen(path, "wb");
+
+	return fout;
+}
+
 static int create_req_lpath(const char *local_path,
 		const char *remote_path, char **ret_req_lpath)
 {
@@ -659,6 +1534,7 @@ int arsdk_ftp_itf_create_req_get(struct arsdk_ftp_itf *itf,
 	int res = 0;
 	struct arsdk_ftp_req_get *req_get = NULL;
 	char *url = NULL;
+	struct arsdk_ftp_req_cbs req_size_cb;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_req != NULL, -EINVAL);
 	*ret_req = NULL;
@@ -679,6 +1555,11 @@ int arsdk_ftp_itf_create_req_get(struct arsdk_ftp_itf *itf,
 	if (res < 0)
 		goto error;
 
+	/* files can be downloaded by ranges on several connections */
+	req_get->is_parallel = (local_path != NULL) &&
+			(itf->get_cfg.conn_count > 1);
+	req_get->use_journal = (local_path != NULL) && itf->get_cfg.journal;
+
 	if (local_path != NULL) {
 		/* Save data in output file */
 
@@ -688,8 +1569,15 @@ int arsdk_ftp_itf_create_req_get(struct arsdk_ftp_itf *itf,
 			goto error;
 
 		if (is_resume) {
-			/* Append to the file */
-			req_get->fout = fopen(req_get->local_path, "ab");
+			if (req_get->is_parallel) {
+				/* Write from the end of the file */
+				req_get->fout = fopen_resume_parallel(
+						req_get->local_path);
+			} else {
+				/* Append to the file */
+				req_get->fout = fopen(req_get->local_path,
+						"ab");
+			}
 			if (req_get->fout == NULL) {
 				res = -errno;
 				ARSDK_LOGE("Failed to create '%s': err=%d(%s)",
@@ -697,6 +1585,14 @@ int arsdk_ftp_itf_create_req_get(struct arsdk_ftp_itf *itf,
 						errno, strerror(errno));
 				goto error;
 			}
+			req_get_set_fout_buff(req_get);
+
+			if (req_get->is_parallel &&
+			    fseeko(req_get->fout, 0, SEEK_END) < 0) {
+				res = -errno;
+				ARSDK_LOG_ERRNO("fseeko failed", errno);
+				goto error;
+			}
 
 			/* update downloaded size */
 			res = ftell(req_get->fout);
@@ -716,10 +1612,12 @@ int arsdk_ftp_itf_create_req_get(struct arsdk_ftp_itf *itf,
 						errno, strerror(errno));
 				goto error;
 			}
+			req_get_set_fout_buff(req_get);
 		}
 	} /* Else Save data in pomp buffer */
 
 	req_get->dlpercent = -1;
+	req_get->prio = ARSDK_FTP_REQ_PRIORITY_NORMAL;
 	req_get->remote_path = xstrdup(remote_path);
 	req_get->cbs = *cbs;
 	url = get_url(req_get->base, remote_path);
@@ -728,10 +1626,25 @@ int arsdk_ftp_itf_create_req_get(struct arsdk_ftp_itf *itf,
 		goto error;
 	}
 
-	res = arsdk_ftp_get(itf->ftp_ctx, &req_get->base->ftpcbs, url,
-			req_get->dlsize, &req_get->base->ftpreq);
-	if (res < 0)
-		goto error;
+	if (req_get->is_parallel || req_get->use_journal) {
+		/* Send a size request to split the file and check the
+		 * journal */
+		memset(&req_size_cb, 0, sizeof(req_size_cb));
+		req_size_cb.read_data = &size_read_data;
+		req_size_cb.write_data = &size_write_data;
+		req_size_cb.progress = &size_progress;
+		req_size_cb.complete = &get_size_complete;
+		req_size_cb.userdata = req_get;
+		res = arsdk_ftp_size(itf->ftp_ctx, &req_size_cb, url,
+				&req_get->ftp_size_req);
+		if (res < 0)
+			goto error;
+	} else {
+		res = arsdk_ftp_get(itf->ftp_ctx, &req_get->base->ftpcbs, url,
+				req_get->dlsize, &req_get->base->ftpreq);
+		if (res < 0)
+			goto error;
+	}
 
 	free(url);
 	*ret_req = req_get;
@@ -745,14 +1658,49 @@ error:
 
 int arsdk_ftp_req_get_cancel(struct arsdk_ftp_req_get *req)
 {
+	uint32_t i = 0;
+
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(req->base->itf != NULL, -EINVAL);
 
+	if (req->ftp_size_req != NULL)
+		return arsdk_ftp_cancel_req(req->base->itf->ftp_ctx,
+				req->ftp_size_req);
+
+	/* the first range canceled cancels the others, the request completes
+	 * with the last one */
+	for (i = 0; i < req->range_count; i++) {
+		if (req->ranges[i].ftpreq != NULL)
+			return arsdk_ftp_cancel_req(req->base->itf->ftp_ctx,
+					req->ranges[i].ftpreq);
+	}
+
 	return arsdk_ftp_cancel_req(req->base->itf->ftp_ctx,
 			req->base->ftpreq);
 }
 
+int arsdk_ftp_req_get_set_priority(struct arsdk_ftp_req_get *req,
+		enum arsdk_ftp_req_priority prio)
+{
+	uint32_t i = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(prio < ARSDK_FTP_REQ_PRIORITY_COUNT,
+			-EINVAL);
+
+	req->prio = prio;
+	for (i = 0; i < req->range_count; i++) {
+		if (req->ranges[i].ftpreq != NULL)
+			arsdk_ftp_set_req_priority(req->ranges[i].ftpreq, prio);
+	}
+
+	if (req->base->ftpreq != NULL)
+		return arsdk_ftp_set_req_priority(req->base->ftpreq, prio);
+
+	return 0;
+}
+
 const char *arsdk_ftp_req_get_get_remote_path(
 		const struct arsdk_ftp_req_get *req)
 {
@@ -897,53 +1845,37 @@ static void req_put_complete(struct arsdk_ftp_req_base *req,
 			req_put->cbs.userdata);
 }
 
+/**
+ */
+static int req_put_read_fd(struct arsdk_ftp_req_base *req, off_t *offset)
+{
+	long pos = 0;
+	struct arsdk_ftp_req_put *req_put = req->child;
+
+	if (req_put->fin == NULL)
+		return -1;
+
+	/* resume offset; the file descriptor offset may differ from the
+	 * stream one, so the stream is left untouched */
+	pos = ftell(req_put->fin);
+	if (pos < 0)
+		return -1;
+
+	*offset = pos;
+	return fileno(req_put->fin);
+}
+
 /**
  */
 static const struct arsdk_ftp_req_ops s_req_put_ops = {
 	.read = &req_put_read_data,
+	.read_fd = &req_put_read_fd,
 	.write = &default_write_data,
 	.progress = &req_put_progress,
 	.complete = &req_put_complete,
 	.destroy = &req_put_destroy,
 };
 
-static size_t size_read_data(struct arsdk_ftp *itf,
-			struct arsdk_ftp_req *req,
-			void *ptr,
-			size_t size,
-			size_t nmemb,
-			void *userdata)
-{
-	/* Do nothing */
-
-	return nmemb;
-}
-
-static size_t size_write_data(struct arsdk_ftp *ctx,
-			struct arsdk_ftp_req *req,
-			const void *ptr,
-			size_t size,
-			size_t nmemb,
-			void *userdata)
-{
-	/* Do nothing */
-
-	return nmemb;
-}
-
-static void size_progress(struct arsdk_ftp *ctx,
-			struct arsdk_ftp_req *req,
-			double dltotal,
-			double dlnow,
-			float dlpercent,
-			double ultotal,
-			double ulnow,
-			float ulpercent,
-			void *userdata)
-{
-	/* Do nothing */
-}
-
 static void size_complete(struct arsdk_ftp *ctx,
 			struct arsdk_ftp_req *req,
 			enum arsdk_ftp_status status,
@@ -955,6 +1887,7 @@ static void size_complete(struct arsdk_ftp *ctx,
 	const char *url = NULL;
 	struct arsdk_ftp_req_put *req_put = userdata;
 
+	req_put->ftp_size_req = NULL;
 	if ((status == ARSDK_FTP_STATUS_CANCELED) ||
 	    (status == ARSDK_FTP_STATUS_ABORTED)) {
 		res = error;
@@ -979,6 +1912,8 @@ static void size_complete(struct arsdk_ftp *ctx,
 	if (res < 0)
 		goto complete;
 
+	arsdk_ftp_set_req_priority(req_put->base->ftpreq, req_put->prio);
+
 	return;
 
 complete:
@@ -1060,6 +1995,7 @@ static int create_req_put(struct arsdk_ftp_itf *itf,
 	}
 
 	req_put->ulpercent = -1;
+	req_put->prio = ARSDK_FTP_REQ_PRIORITY_NORMAL;
 	req_put->remote_path = xstrdup(remote_path);
 	req_put->cbs = *cbs;
 	url = get_url(req_put->base, remote_path);
@@ -1134,9 +2070,27 @@ int arsdk_ftp_req_put_cancel(struct arsdk_ftp_req_put *req)
 	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(req->base->itf != NULL, -EINVAL);
 
+	if (req->ftp_size_req != NULL)
+		return arsdk_ftp_cancel_req(req->base->itf->ftp_ctx,
+				req->ftp_size_req);
+
 	return arsdk_ftp_cancel_req(req->base->itf->ftp_ctx, req->base->ftpreq);
 }
 
+int arsdk_ftp_req_put_set_priority(struct arsdk_ftp_req_put *req,
+		enum arsdk_ftp_req_priority prio)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(prio < ARSDK_FTP_REQ_PRIORITY_COUNT,
+			-EINVAL);
+
+	req->prio = prio;
+	if (req->base->ftpreq != NULL)
+		return arsdk_ftp_set_req_priority(req->base->ftpreq, prio);
+
+	return 0;
+}
+
 const char *arsdk_ftp_req_put_get_remote_path(
 		const struct arsdk_ftp_req_put *req)
 {
@@ -1287,6 +2241,117 @@ enum arsdk_device_type arsdk_ftp_req_delete_get_dev_type(
 	return req->base->dev_type;
 }
 
+/* Stat request : */
+
+/**
+ */
+static void arsdk_ftp_req_stat_destroy(struct arsdk_ftp_req_stat *req_stat)
+{
+	ARSDK_RETURN_IF_FAILED(req_stat != NULL, -EINVAL);
+
+	req_destroy(req_stat->base);
+
+	free(req_stat);
+}
+
+static void req_stat_destroy(struct arsdk_ftp_req_base *req)
+{
+	arsdk_ftp_req_stat_destroy(req->child);
+}
+
+static void req_stat_complete(struct arsdk_ftp_req_base *req,
+		enum arsdk_ftp_req_status status, int error)
+{
+	struct arsdk_ftp_req_stat *req_stat = req->child;
+	size_t size = 0;
+	time_t mtime = 0;
+
+	if (req->ftpreq != NULL) {
+		size = arsdk_ftp_req_get_size(req->ftpreq);
+		mtime = arsdk_ftp_req_get_mtime(req->ftpreq);
+	}
+
+	/* the size request is reported failed as no data is received, the
+	 * facts are valid if known */
+	if (status == ARSDK_FTP_REQ_STATUS_FAILED && (size != 0 || mtime != 0))
+		status = ARSDK_FTP_REQ_STATUS_OK;
+
+	/* Notify */
+	(*req_stat->cbs.complete)(req->itf, req_stat, status, error,
+			size, mtime, req_stat->cbs.userdata);
+}
+
+/**
+ */
+static const struct arsdk_ftp_req_ops s_req_stat_ops = {
+	.read = &default_read_data,
+	.write = &default_write_data,
+	.progress = &default_progress,
+	.complete = &req_stat_complete,
+	.destroy = &req_stat_destroy,
+};
+
+int arsdk_ftp_itf_create_req_stat(
+		struct arsdk_ftp_itf *itf,
+		const struct arsdk_ftp_req_stat_cbs *cbs,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_srv_type srv_type,
+		const char *remote_path,
+		struct arsdk_ftp_req_stat **ret_req)
+{
+	int res = 0;
+	struct arsdk_ftp_req_stat *req_stat = NULL;
+	char *url = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_req != NULL, -EINVAL);
+	*ret_req = NULL;
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(remote_path != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs->complete != NULL, -EINVAL);
+
+	/* Allocate structure */
+	req_stat = calloc(1, sizeof(*req_stat));
+	if (req_stat == NULL)
+		return -ENOMEM;
+
+	res = req_new(itf, dev_type, srv_type, &s_req_stat_ops, req_stat,
+			&req_stat->base);
+	if (res < 0)
+		goto error;
+
+	req_stat->cbs = *cbs;
+	url = get_url(req_stat->base, remote_path);
+	if (url == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
+	res = arsdk_ftp_size(itf->ftp_ctx, &req_stat->base->ftpcbs,
+			url, &req_stat->base->ftpreq);
+	if (res < 0)
+		goto error;
+
+	free(url);
+	*ret_req = req_stat;
+	return 0;
+
+error:
+	arsdk_ftp_req_stat_destroy(req_stat);
+	free(url);
+	return res;
+}
+
+int arsdk_ftp_req_stat_cancel(struct arsdk_ftp_req_stat *req)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base->itf != NULL, -EINVAL);
+
+	return arsdk_ftp_cancel_req(req->base->itf->ftp_ctx,
+			req->base->ftpreq);
+}
+
 /* Rename request : */
 
 /**
@@ -1417,14 +2482,22 @@ enum arsdk_device_type arsdk_ftp_req_rename_get_dev_type(
 
 static int arsdk_ftp_file_list_destroy(struct arsdk_ftp_file_list *list)
 {
-	struct arsdk_ftp_file *file;
-	struct arsdk_ftp_file *file_tmp;
+	struct arsdk_ftp_file_block *fblock, *fblock_tmp;
+	struct arsdk_ftp_name_block *nblock, *nblock_tmp;
 
 	ARSDK_RETURN_ERR_IF_FAILED(list != NULL, -EINVAL);
 
-	list_walk_entry_forward_safe(&list->files, file, file_tmp, node) {
-		list_del(&file->node);
-		arsdk_ftp_file_unref(file);
+	/* files and names are owned by the blocks */
+	list_walk_entry_forward_safe(&list->file_blocks, fblock, fblock_tmp,
+			node) {
+		list_del(&fblock->node);
+		free(fblock);
+	}
+
+	list_walk_entry_forward_safe(&list->name_blocks, nblock, nblock_tmp,
+			node) {
+		list_del(&nblock->node);
+		free(nblock);
 	}
 
 	free(list);
@@ -1444,11 +2517,61 @@ static int arsdk_ftp_file_list_new(struct arsdk_ftp_file_list **ret_list)
 
 	list->refcount = 1;
 	list_init(&list->files);
+	list_init(&list->file_blocks);
+	list_init(&list->name_blocks);
 
 	*ret_list = list;
 	return 0;
 }
 
+/**
+ * Allocates a file owned by a list, with its name.
+ */
+static struct arsdk_ftp_file *file_list_add(struct arsdk_ftp_file_list *list,
+		const char *name)
+{
+	size_t len = strlen(name) + 1;
+	struct arsdk_ftp_file_block *fblock = NULL;
+	struct arsdk_ftp_name_block *nblock = NULL;
+	struct arsdk_ftp_file *file = NULL;
+
+	/* last blocks are at the head */
+	if (!list_is_empty(&list->file_blocks)) {
+		fblock = list_entry(list_first(&list->file_blocks),
+				struct arsdk_ftp_file_block, node);
+	}
+	if (fblock == NULL || fblock->count == FILE_BLOCK_COUNT) {
+		fblock = calloc(1, sizeof(*fblock));
+		if (fblock == NULL)
+			return NULL;
+		list_add_after(&list->file_blocks, &fblock->node);
+	}
+
+	if (!list_is_empty(&list->name_blocks)) {
+		nblock = list_entry(list_first(&list->name_blocks),
+				struct arsdk_ftp_name_block, node);
+	}
+	if (nblock == NULL || nblock->size - nblock->len < len) {
+		nblock = malloc(sizeof(*nblock) +
+				(len > NAME_BLOCK_SIZE ? len : NAME_BLOCK_SIZE));
+		if (nblock == NULL)
+			return NULL;
+		nblock->len = 0;
+		nblock->size = len > NAME_BLOCK_SIZE ? len : NAME_BLOCK_SIZE;
+		list_add_after(&list->name_blocks, &nblock->node);
+	}
+
+	file = &fblock->files[fblock->count++];
+	file->owner = list;
+	file->name = memcpy(&nblock->data[nblock->len], name, len);
+	nblock->len += len;
+
+	/* same order as the former head insertion */
+	list_add_after(&list->files, &file->node);
+	list->count++;
+	return file;
+}
+
 /* List request : */
 
 /**
@@ -1459,9 +2582,10 @@ static void arsdk_ftp_req_list_destroy(
 	ARSDK_RETURN_IF_FAILED(req_list != NULL, -EINVAL);
 
 	arsdk_ftp_file_list_unref(req_list->result);
+	if (req_list->files != NULL)
+		arsdk_ftp_file_list_unref(req_list->files);
 	req_destroy(req_list->base);
-	if (req_list->buffer != NULL)
-		pomp_buffer_unref(req_list->buffer);
+	free(req_list->line);
 	free(req_list->path);
 	free(req_list);
 }
@@ -1471,62 +2595,189 @@ static void req_list_destroy(struct arsdk_ftp_req_base *req)
 	arsdk_ftp_req_list_destroy(req->child);
 }
 
-static size_t req_list_write_data(struct arsdk_ftp_req_base *req,
-		const void *ptr, size_t size, size_t nmemb)
+/** fields of a listed file */
+struct list_line {
+	enum arsdk_ftp_file_type        type;
+	size_t                          size;
+	time_t                          mtime;
+	char                            name[256];
+};
+
+/**
+ * Parses a "MLSD" line: "fact=value;...; name".
+ * @return 1 if the line is to be listed, 0 to ignore it.
+ */
+static int mlsd_line_parse(const char *line, struct list_line *entry)
 {
 	int res = 0;
-	struct arsdk_ftp_req_list *req_list = req->child;
-	size_t len = size * nmemb;
+	size_t name_len = 0;
+	struct arsdk_ftp_facts facts;
 
-	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(req_list != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(req_list->buffer != NULL, -EINVAL);
+	res = arsdk_ftp_facts_parse(line, &facts);
+	if (res < 0)
+		return res;
 
-	res = pomp_buffer_append_data(req_list->buffer, ptr, len);
-	if (res < 0) {
-		ARSDK_LOGE("pomp_buffer_append failed");
-		return nmemb;
-	}
+	if (facts.name[0] == '\0')
+		return -EINVAL;
 
-	return nmemb;
+	name_len = strlen(facts.name);
+	if (name_len >= sizeof(entry->name))
+		return -ENAMETOOLONG;
+	memcpy(entry->name, facts.name, name_len + 1);
+
+	entry->type = facts.type;
+	entry->size = facts.size;
+	entry->mtime = facts.mtime;
+	return facts.listed;
 }
 
-static int list_line_to_file(const char *line, struct arsdk_ftp_file *file)
+static int list_line_parse(const char *line, struct list_line *entry)
 {
 	int res = 0;
 	char perm[11];
-	char name[256];
+	const char *sep = NULL;
 
-	ARSDK_RETURN_ERR_IF_FAILED(line != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(file != NULL, -EINVAL);
+	memset(entry, 0, sizeof(*entry));
+
+	/* facts of the machine listings contain '=' before the first space */
+	sep = strpbrk(line, "= ");
+	if (sep != NULL && *sep == '=') {
+		res = mlsd_line_parse(line, entry);
+		if (res < 0)
+			ARSDK_LOGW("Failed to parse ftp list line. \"%s\"",
+					line);
+		return res;
+	}
 
 	res = sscanf(line, "%10s %*d %*d %*d %zu %*s %*u %*[0-9:] %255s",
 			perm,
-			&file->size,
-			name);
+			&entry->size,
+			entry->name);
 	if (res < 3) {
 		ARSDK_LOGW("Failed to parse ftp list line. \"%s\"", line);
 		return -EINVAL;
 	}
 
-	file->name = xstrdup(name);
-
 	switch (perm[0]) {
 	case 'd':
-		file->type = ARSDK_FTP_FILE_TYPE_DIR;
+		entry->type = ARSDK_FTP_FILE_TYPE_DIR;
 		break;
 	case 'l':
-		file->type = ARSDK_FTP_FILE_TYPE_LINK;
+		entry->type = ARSDK_FTP_FILE_TYPE_LINK;
 		break;
 	case '-':
 	default:
-		file->type = ARSDK_FTP_FILE_TYPE_FILE;
+		entry->type = ARSDK_FTP_FILE_TYPE_FILE;
 		break;
 	}
 
+	return 1;
+}
+
+/**
+ * Adds the file of the line pending to the list and notifies it.
+ */
+static int req_list_process_line(struct arsdk_ftp_req_list *req_list)
+{
+	static const char *total_str = "total";
+	int res = 0;
+	struct list_line entry;
+	struct arsdk_ftp_file *file = NULL;
+
+	/* strip the carriage return of the end of line */
+	if (req_list->line_len > 0 &&
+	    req_list->line[req_list->line_len - 1] == '\r')
+		req_list->line_len--;
+	req_list->line[req_list->line_len] = '\0';
+	req_list->line_len = 0;
+
+	/* skip the first line if it starts by "total". */
+	if (req_list->first_line) {
+		req_list->first_line = 0;
+		res = strncmp(req_list->line, total_str, sizeof(*total_str));
+		if (res == 0)
+			return 0;
+	}
+
+	res = list_line_parse(req_list->line, &entry);
+	if (res <= 0)
+		return 0;
+
+	file = file_list_add(req_list->files, entry.name);
+	if (file == NULL)
+		return -ENOMEM;
+
+	file->type = entry.type;
+	file->size = entry.size;
+	file->mtime = entry.mtime;
+
+	if (req_list->cbs.file != NULL) {
+		(*req_list->cbs.file)(req_list->base->itf, req_list, file,
+				req_list->cbs.userdata);
+	}
+	return 0;
+}
+
+static int req_list_append_line(struct arsdk_ftp_req_list *req_list,
+		const char *data, size_t len)
+{
+	size_t size = req_list->line_size;
+	char *line = NULL;
+
+	/* keep room for the null character */
+	if (req_list->line_len + len >= size) {
+		while (req_list->line_len + len >= size)
+			size *= 2;
+		line = realloc(req_list->line, size);
+		if (line == NULL)
+			return -ENOMEM;
+		req_list->line = line;
+		req_list->line_size = size;
+	}
+
+	memcpy(&req_list->line[req_list->line_len], data, len);
+	req_list->line_len += len;
 	return 0;
 }
 
+static size_t req_list_write_data(struct arsdk_ftp_req_base *req,
+		const void *ptr, size_t size, size_t nmemb)
+{
+	int res = 0;
+	struct arsdk_ftp_req_list *req_list = req->child;
+	const char *data = ptr;
+	size_t len = size * nmemb;
+	const char *eol = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req_list != NULL, -EINVAL);
+
+	/* parse the lines as they are received */
+	while (len > 0) {
+		eol = memchr(data, '\n', len);
+		if (eol == NULL) {
+			res = req_list_append_line(req_list, data, len);
+			break;
+		}
+
+		res = req_list_append_line(req_list, data, eol - data);
+		if (res < 0)
+			break;
+
+		res = req_list_process_line(req_list);
+		if (res < 0)
+			break;
+
+		len -= eol + 1 - data;
+		data = eol + 1;
+	}
+
+	if (res < 0)
+		ARSDK_LOG_ERRNO("req_list_write_data", -res);
+
+	return nmemb;
+}
+
 /**
  */
 int arsdk_ftp_file_new(struct arsdk_ftp_file **ret_file)
@@ -1575,15 +2826,7 @@ int arsdk_ftp_file_set_name(struct arsdk_ftp_file *file,
 static void req_list_complete(struct arsdk_ftp_req_base *req,
 		enum arsdk_ftp_req_status status, int error)
 {
-	static const char *total_str = "total";
-	char *data = NULL;
-	size_t len = 0;
-	size_t capacity = 0;
 	int res = 0;
-	char *tok = NULL;
-	char *line = NULL;
-	struct arsdk_ftp_file *file = NULL;
-	struct arsdk_ftp_file_list *response = NULL;
 	struct arsdk_ftp_req_list *req_list = req->child;
 
 	if (status != ARSDK_FTP_REQ_STATUS_OK) {
@@ -1591,61 +2834,18 @@ static void req_list_complete(struct arsdk_ftp_req_base *req,
 		goto end;
 	}
 
-	/* Append null character to the buffer */
-	res = pomp_buffer_append_data(req_list->buffer, "", 1);
-	if (res < 0) {
-		ARSDK_LOGE("pomp_buffer_get_cdata failed.");
-		status = ARSDK_FTP_REQ_STATUS_FAILED;
-		goto end;
-	}
-
-	res = pomp_buffer_get_data(req_list->buffer, (void **)&data,
-			&len, &capacity);
-	if (res < 0) {
-		ARSDK_LOGE("pomp_buffer_get_cdata failed.");
-		status = ARSDK_FTP_REQ_STATUS_FAILED;
-		goto end;
-	}
-
-	if (data == NULL) {
-		ARSDK_LOGE("No data to parse.");
-		status = ARSDK_FTP_REQ_STATUS_FAILED;
-		goto end;
-	}
-
-	res = arsdk_ftp_file_list_new(&response);
-	if (res < 0) {
-		status = ARSDK_FTP_REQ_STATUS_FAILED;
-		res = -ENOMEM;
-		goto end;
-	}
-	req_list->result = response;
-
-	line = strtok_r(data, "\n", &tok);
-	if (line == NULL)
-		goto end;
-
-	/* skip the first line if it starts by "total". */
-	res = strncmp(line, total_str, sizeof(*total_str));
-	if (res == 0)
-		line = strtok_r(NULL, "\n", &tok);
-
-	while (line != NULL) {
-		res = arsdk_ftp_file_new(&file);
+	/* last line without end of line */
+	if (req_list->line_len > 0) {
+		res = req_list_process_line(req_list);
 		if (res < 0) {
 			status = ARSDK_FTP_REQ_STATUS_FAILED;
 			goto end;
 		}
-
-		res = list_line_to_file(line, file);
-		if (res == 0)
-			list_add_after(&response->files, &file->node);
-		else
-			arsdk_ftp_file_unref(file);
-
-		line = strtok_r(NULL, "\n", &tok);
 	}
 
+	req_list->result = req_list->files;
+	req_list->files = NULL;
+
 end:
 	/* list callback */
 	(*req_list->cbs.complete)(req->itf, req_list,
@@ -1694,12 +2894,18 @@ int arsdk_ftp_itf_create_req_list(
 
 	req_list->path = xstrdup(remote_path);
 	req_list->cbs = *cbs;
-	req_list->buffer = pomp_buffer_new(DEFAULT_BUFFER_SIZE);
-	if (req_list->buffer == NULL) {
+	req_list->first_line = 1;
+	req_list->line_size = DEFAULT_BUFFER_SIZE;
+	req_list->line = malloc(req_list->line_size);
+	if (req_list->line == NULL) {
 		res = -ENOMEM;
 		goto error;
 	}
 
+	res = arsdk_ftp_file_list_new(&req_list->files);
+	if (res < 0)
+		goto error;
+
 	url = get_url(req_list->base, remote_path);
 	if (url == NULL) {
 		res = -ENOMEM;
@@ -1784,7 +2990,7 @@ size_t arsdk_ftp_file_list_get_count(
 	if (!list)
 		return 0;
 
-	return list_length(&list->files);
+	return list->count;
 }
 
 void arsdk_ftp_file_list_ref(struct arsdk_ftp_file_list *list)
@@ -1824,6 +3030,11 @@ ARSDK_API enum arsdk_ftp_file_type arsdk_ftp_file_get_type(
 	return file->type;
 }
 
+time_t arsdk_ftp_file_get_mtime(const struct arsdk_ftp_file *file)
+{
+	return (file != NULL) ? file->mtime : 0;
+}
+
 /*
  * See documentation in public header.
  */
@@ -1831,6 +3042,12 @@ void arsdk_ftp_file_ref(struct arsdk_ftp_file *file)
 {
 	ARSDK_RETURN_IF_FAILED(file != NULL, -EINVAL);
 
+	/* the files of a list live as long as it */
+	if (file->owner != NULL) {
+		arsdk_ftp_file_list_ref(file->owner);
+		return;
+	}
+
 	file->refcount++;
 }
 
@@ -1841,6 +3058,11 @@ void arsdk_ftp_file_unref(struct arsdk_ftp_file *file)
 {
 	ARSDK_RETURN_IF_FAILED(file != NULL, -EINVAL);
 
+	if (file->owner != NULL) {
+		arsdk_ftp_file_list_unref(file->owner);
+		return;
+	}
+
 	file->refcount--;
 
 	/* Free resource when ref count reaches 0 */
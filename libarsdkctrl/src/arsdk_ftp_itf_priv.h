@@ -27,6 +27,8 @@
 #ifndef _ARSDK_FTP_ITF_PRIV_H_
 #define _ARSDK_FTP_ITF_PRIV_H_
 
+struct arsdk_ftp_sched;
+
 /** */
 struct arsdk_ftp_itf_internal_cbs {
 	void *userdata;
@@ -56,6 +58,57 @@ int arsdk_ftp_itf_destroy(struct arsdk_ftp_itf *itf);
  */
 int arsdk_ftp_itf_stop(struct arsdk_ftp_itf *itf);
 
+/**
+ * Shares a transfer scheduler with other interfaces; must be called before
+ * any request.
+ */
+int arsdk_ftp_itf_set_sched(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_sched *sched);
+
+struct arsdk_ftp_req_stat;
+
+/** "stat" request callbacks */
+struct arsdk_ftp_req_stat_cbs {
+	/** User data given in callbacks */
+	void *userdata;
+
+	/**
+	 * Notify request completed.
+	 * @param itf : the ftp interface.
+	 * @param req : the request.
+	 * @param status : request status.
+	 * @param error : request error.
+	 * @param size : size of the file, 0 for a directory.
+	 * @param mtime : modification time in seconds since the Epoch (UTC),
+	 * 0 if unknown.
+	 * @param userdata : user data.
+	 */
+	void (*complete)(struct arsdk_ftp_itf *itf,
+			struct arsdk_ftp_req_stat *req,
+			enum arsdk_ftp_req_status status,
+			int error,
+			size_t size,
+			time_t mtime,
+			void *userdata);
+};
+
+/**
+ * Create and send a "stat" request, getting the size and the modification
+ * time of a remote file or directory.
+ * The modification time is only known if the server supports "MLST".
+ */
+int arsdk_ftp_itf_create_req_stat(
+		struct arsdk_ftp_itf *itf,
+		const struct arsdk_ftp_req_stat_cbs *cbs,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_srv_type srv_type,
+		const char *remote_path,
+		struct arsdk_ftp_req_stat **ret_req);
+
+/**
+ */
+int arsdk_ftp_req_stat_cancel(struct arsdk_ftp_req_stat *req);
+
 /**
  */
 int arsdk_ftp_file_new(struct arsdk_ftp_file **ret_file);
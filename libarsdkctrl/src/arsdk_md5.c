@@ -95,10 +95,24 @@
  * The check for little-endian architectures that tolerate unaligned
  * memory accesses is just an optimization.  Nothing will break if it
  * doesn't work.
+ *
+ * The words are loaded with memcpy: a plain dereference of an unaligned
+ * pointer lets the compiler merge adjacent loads into LDRD/LDM on 32-bit
+ * ARM, which fault on unaligned addresses even with unaligned access
+ * support.
  */
-#if defined(__i386__) || defined(__x86_64__) || defined(__vax__)
+#if defined(__i386__) || defined(__x86_64__) || defined(__vax__) || \
+	((defined(__aarch64__) || defined(__ARM_FEATURE_UNALIGNED)) && \
+	defined(__BYTE_ORDER__) && \
+	(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__))
+static inline unsigned int load_word(const unsigned char *ptr)
+{
+	uint32_t word;
+	memcpy(&word, ptr, sizeof(word));
+	return word;
+}
 #define SET(n) \
-	(*(unsigned int *)&ptr[(n) * 4])
+	load_word(&ptr[(n) * 4])
 #define GET(n) \
 	SET(n)
 #else
@@ -322,25 +336,41 @@ void arsdk_md5_final(unsigned char *result, struct arsdk_md5_ctx *ctx)
 	memset(ctx, 0, sizeof(*ctx));
 }
 
-int arsdk_md5_compute(int fd, uint8_t md5[ARSDK_MD5_LENGTH])
+int arsdk_md5_compute_stoppable(int fd, uint8_t md5[ARSDK_MD5_LENGTH],
+		const int *stop)
 {
 	struct arsdk_md5_ctx ctx;
-	int res;
-	uint8_t buf[512];
+	ssize_t res;
+	uint8_t *buf;
 
 	if (!md5 || (fd < 0))
 		return -EINVAL;
 
+	buf = malloc(ARSDK_MD5_READ_SIZE);
+	if (buf == NULL)
+		return -ENOMEM;
+
 	lseek(fd, 0, SEEK_SET);
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif /* POSIX_FADV_SEQUENTIAL */
 
 	arsdk_md5_init(&ctx);
 
 	/* read whole file */
 	while (1) {
-		res = read(fd, buf, sizeof(buf));
+		if (stop != NULL && __atomic_load_n(stop, __ATOMIC_ACQUIRE)) {
+			res = -ECANCELED;
+			goto out;
+		}
+
+		res = read(fd, buf, ARSDK_MD5_READ_SIZE);
 		if (res < 0) {
-			ULOGE("compute md5 read error : %s", strerror(errno));
-			return -errno;
+			if (errno == EINTR)
+				continue;
+			res = -errno;
+			ULOGE("compute md5 read error : %s", strerror(-res));
+			goto out;
 		}
 		/* check eof */
 		if (res == 0)
@@ -352,7 +382,14 @@ int arsdk_md5_compute(int fd, uint8_t md5[ARSDK_MD5_LENGTH])
 
 	arsdk_md5_final(md5, &ctx);
 
-	return 0;
+out:
+	free(buf);
+	return res;
+}
+
+int arsdk_md5_compute(int fd, uint8_t md5[ARSDK_MD5_LENGTH])
+{
+	return arsdk_md5_compute_stoppable(fd, md5, NULL);
 }
 
 char *arsdk_md5_to_str(const uint8_t *md5, char *str, size_t strlen)
@@ -54,6 +54,9 @@
 
 #define ARSDK_MD5_LENGTH 16
 
+/** Size of the reads of arsdk_md5_compute */
+#define ARSDK_MD5_READ_SIZE (256 * 1024)
+
 struct arsdk_md5_ctx {
 	unsigned int lo, hi;
 	unsigned int a, b, c, d;
@@ -66,8 +69,26 @@ void arsdk_md5_update(struct arsdk_md5_ctx *ctx, const void *data,
 		unsigned long size);
 void arsdk_md5_final(unsigned char *result, struct arsdk_md5_ctx *ctx);
 
+/**
+ * Compute the md5 of a whole file.
+ * @param fd : file descriptor, read from its beginning.
+ * @param md5 : will receive the md5.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
 int arsdk_md5_compute(int fd, uint8_t md5[ARSDK_MD5_LENGTH]);
 
+/**
+ * Compute the md5 of a whole file, checking a stop flag between reads.
+ * @param fd : file descriptor, read from its beginning.
+ * @param md5 : will receive the md5.
+ * @param stop : flag set by another thread to stop the computation,
+ * may be NULL.
+ * @return 0 in case of success, -ECANCELED if stopped, negative errno value
+ * in case of error.
+ */
+int arsdk_md5_compute_stoppable(int fd, uint8_t md5[ARSDK_MD5_LENGTH],
+		const int *stop);
+
 /**
  * Convert md5 to string.
  * @param md5 : md5.
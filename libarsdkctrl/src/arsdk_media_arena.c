@@ -0,0 +1,277 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdk_media_arena_priv.h"
+#include "arsdk_media_index_priv.h"
+#include "arsdkctrl_default_log.h"
+
+/* size of the chunks, a media with its resources takes about 500 bytes */
+#define ARENA_CHUNK_SIZE (16 * 1024)
+/* allocations larger than this get their own chunk */
+#define ARENA_LARGE_SIZE (ARENA_CHUNK_SIZE / 4)
+#define ARENA_ALIGN sizeof(uint64_t)
+#define ARENA_INTERN_INIT_SIZE 16
+
+/** */
+struct arena_chunk {
+	struct arena_chunk              *next;
+	size_t                          size;
+	size_t                          used;
+	uint64_t                        data[];
+};
+
+/** */
+struct intern_entry {
+	struct intern_entry             *next;
+	uint32_t                        hash;
+	char                            str[];
+};
+
+/** */
+struct arsdk_media_arena {
+	uint32_t                        refcount;
+	/* current chunk first */
+	struct arena_chunk              *chunks;
+	/* interned strings */
+	struct {
+		struct intern_entry     **buckets;
+		size_t                  size;
+		size_t                  count;
+	} intern;
+};
+
+int arsdk_media_arena_new(struct arsdk_media_arena **ret_arena)
+{
+	struct arsdk_media_arena *arena = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_arena != NULL, -EINVAL);
+
+	arena = calloc(1, sizeof(*arena));
+	if (arena == NULL)
+		return -ENOMEM;
+
+	arena->refcount = 1;
+
+	*ret_arena = arena;
+	return 0;
+}
+
+static void arena_destroy(struct arsdk_media_arena *arena)
+{
+	struct arena_chunk *chunk = NULL;
+
+	while (arena->chunks != NULL) {
+		chunk = arena->chunks;
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+
+	free(arena->intern.buckets);
+	free(arena);
+}
+
+void arsdk_media_arena_ref(struct arsdk_media_arena *arena)
+{
+	ARSDK_RETURN_IF_FAILED(arena != NULL, -EINVAL);
+
+	arena->refcount++;
+}
+
+void arsdk_media_arena_unref(struct arsdk_media_arena *arena)
+{
+	ARSDK_RETURN_IF_FAILED(arena != NULL, -EINVAL);
+
+	arena->refcount--;
+
+	/* Free resource when ref count reaches 0 */
+	if (arena->refcount == 0)
+		arena_destroy(arena);
+}
+
+static struct arena_chunk *chunk_new(size_t size)
+{
+	struct arena_chunk *chunk = NULL;
+
+	chunk = calloc(1, sizeof(*chunk) + size);
+	if (chunk == NULL)
+		return NULL;
+
+	chunk->size = size;
+	return chunk;
+}
+
+void *arsdk_media_arena_alloc(struct arsdk_media_arena *arena, size_t size)
+{
+	struct arena_chunk *chunk = NULL;
+	void *ptr = NULL;
+
+	ARSDK_RETURN_VAL_IF_FAILED(arena != NULL, -EINVAL, NULL);
+
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+	chunk = arena->chunks;
+	if (chunk != NULL && chunk->size - chunk->used >= size) {
+		ptr = (uint8_t *)chunk->data + chunk->used;
+		chunk->used += size;
+		return ptr;
+	}
+
+	if (size > ARENA_LARGE_SIZE) {
+		/* keep filling the current chunk */
+		chunk = chunk_new(size);
+		if (chunk == NULL)
+			return NULL;
+
+		chunk->used = size;
+		if (arena->chunks != NULL) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+		} else {
+			arena->chunks = chunk;
+		}
+		return chunk->data;
+	}
+
+	chunk = chunk_new(ARENA_CHUNK_SIZE);
+	if (chunk == NULL)
+		return NULL;
+
+	chunk->used = size;
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	return chunk->data;
+}
+
+char *arsdk_media_arena_strndup(struct arsdk_media_arena *arena,
+		const char *str, size_t len)
+{
+	char *copy = NULL;
+
+	if (str == NULL)
+		return NULL;
+
+	copy = arsdk_media_arena_alloc(arena, len + 1);
+	if (copy == NULL)
+		return NULL;
+
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+	return copy;
+}
+
+char *arsdk_media_arena_concat(struct arsdk_media_arena *arena,
+		const char *prefix, const char *suffix)
+{
+	size_t prefix_len = 0;
+	size_t suffix_len = 0;
+	char *str = NULL;
+
+	ARSDK_RETURN_VAL_IF_FAILED(prefix != NULL, -EINVAL, NULL);
+	ARSDK_RETURN_VAL_IF_FAILED(suffix != NULL, -EINVAL, NULL);
+
+	prefix_len = strlen(prefix);
+	suffix_len = strlen(suffix);
+
+	str = arsdk_media_arena_alloc(arena, prefix_len + suffix_len + 1);
+	if (str == NULL)
+		return NULL;
+
+	memcpy(str, prefix, prefix_len);
+	memcpy(str + prefix_len, suffix, suffix_len + 1);
+	return str;
+}
+
+static int intern_grow(struct arsdk_media_arena *arena)
+{
+	size_t size = 0;
+	size_t i = 0;
+	struct intern_entry **buckets = NULL;
+	struct intern_entry *entry = NULL;
+	struct intern_entry *next = NULL;
+
+	size = arena->intern.size != 0 ? arena->intern.size * 2 :
+			ARENA_INTERN_INIT_SIZE;
+	buckets = calloc(size, sizeof(*buckets));
+	if (buckets == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < arena->intern.size; i++) {
+		for (entry = arena->intern.buckets[i]; entry; entry = next) {
+			next = entry->next;
+			entry->next = buckets[entry->hash & (size - 1)];
+			buckets[entry->hash & (size - 1)] = entry;
+		}
+	}
+
+	free(arena->intern.buckets);
+	arena->intern.buckets = buckets;
+	arena->intern.size = size;
+	return 0;
+}
+
+const char *arsdk_media_arena_intern(struct arsdk_media_arena *arena,
+		const char *str)
+{
+	size_t len = 0;
+	uint32_t hash = 0;
+	struct intern_entry *entry = NULL;
+	struct intern_entry **bucket = NULL;
+
+	ARSDK_RETURN_VAL_IF_FAILED(arena != NULL, -EINVAL, NULL);
+
+	if (str == NULL)
+		return NULL;
+
+	len = strlen(str);
+	hash = arsdk_media_index_hash(ARSDK_MEDIA_INDEX_HASH_INIT, str, len);
+
+	if (arena->intern.size != 0) {
+		entry = arena->intern.buckets[hash & (arena->intern.size - 1)];
+		for (; entry != NULL; entry = entry->next) {
+			if (entry->hash == hash && strcmp(entry->str, str) == 0)
+				return entry->str;
+		}
+	}
+
+	/* keep the load factor below 1 */
+	if (arena->intern.count >= arena->intern.size &&
+	    intern_grow(arena) < 0)
+		return NULL;
+
+	entry = arsdk_media_arena_alloc(arena, sizeof(*entry) + len + 1);
+	if (entry == NULL)
+		return NULL;
+
+	entry->hash = hash;
+	memcpy(entry->str, str, len + 1);
+
+	bucket = &arena->intern.buckets[hash & (arena->intern.size - 1)];
+	entry->next = *bucket;
+	*bucket = entry;
+	arena->intern.count++;
+	return entry->str;
+}
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_MEDIA_ARENA_PRIV_H_
+#define _ARSDK_MEDIA_ARENA_PRIV_H_
+
+/**
+ * Memory arena of a media list: the medias, resources and strings of a list
+ * are allocated from a few large chunks, all freed at once when the last
+ * reference is released.
+ */
+struct arsdk_media_arena;
+
+/**
+ * Create a media arena, with a reference owned by the caller.
+ * @param ret_arena : will receive the arena.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_media_arena_new(struct arsdk_media_arena **ret_arena);
+
+/**
+ * Increase the reference count of an arena.
+ * @param arena : the arena.
+ */
+void arsdk_media_arena_ref(struct arsdk_media_arena *arena);
+
+/**
+ * Decrease the reference count of an arena, freeing all its allocations
+ * when it reaches 0.
+ * @param arena : the arena.
+ */
+void arsdk_media_arena_unref(struct arsdk_media_arena *arena);
+
+/**
+ * Allocate zeroed memory from an arena.
+ * The memory is only released with the arena.
+ * @param arena : the arena.
+ * @param size : size to allocate.
+ * @return the memory, NULL in case of error.
+ */
+void *arsdk_media_arena_alloc(struct arsdk_media_arena *arena, size_t size);
+
+/**
+ * Copy a string in an arena.
+ * @param arena : the arena.
+ * @param str : string to copy, can be NULL.
+ * @param len : length of the string to copy.
+ * @return the copy, NULL if str is NULL or in case of error.
+ */
+char *arsdk_media_arena_strndup(struct arsdk_media_arena *arena,
+		const char *str, size_t len);
+
+/**
+ * Concatenate two strings in an arena.
+ * @param arena : the arena.
+ * @param prefix : first string.
+ * @param suffix : second string.
+ * @return the concatenation, NULL in case of error.
+ */
+char *arsdk_media_arena_concat(struct arsdk_media_arena *arena,
+		const char *prefix, const char *suffix);
+
+/**
+ * Intern a string in an arena: equal strings interned in the same arena
+ * share a single copy.
+ * @param arena : the arena.
+ * @param str : string to intern, can be NULL.
+ * @return the interned string, NULL if str is NULL or in case of error.
+ */
+const char *arsdk_media_arena_intern(struct arsdk_media_arena *arena,
+		const char *str);
+
+#endif /* !_ARSDK_MEDIA_ARENA_PRIV_H_ */
@@ -0,0 +1,444 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdk_media_index_priv.h"
+#include "arsdkctrl_default_log.h"
+
+#include <unistd.h>
+
+#define INDEX_MAGIC "arsdk-media-index"
+#define INDEX_VERSION 2
+#define INDEX_TMP_SUFFIX ".tmp"
+
+/** Initial count of buckets of an index */
+#define INDEX_BUCKETS_MIN 64
+
+/** media of an index */
+struct index_entry {
+	char                            *name;
+	uint32_t                        hash;
+	uint32_t                        sig;
+	/* refresh generation when last updated */
+	uint32_t                        gen;
+	struct index_entry              *next;
+};
+
+/** */
+struct arsdk_media_index {
+	char                            *path;
+	time_t                          dir_mtime;
+	/* wall time of the last refresh listing */
+	time_t                          list_time;
+	/* most recent modification seen by the last refresh */
+	time_t                          newest_mtime;
+	uint32_t                        gen;
+	struct index_entry              **buckets;
+	size_t                          size;
+	size_t                          count;
+	/* modified since loaded or saved */
+	int                             dirty;
+};
+
+uint32_t arsdk_media_index_hash(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+
+	while (len-- > 0) {
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static uint32_t name_hash(const char *name)
+{
+	return arsdk_media_index_hash(ARSDK_MEDIA_INDEX_HASH_INIT, name,
+			strlen(name));
+}
+
+static struct index_entry *index_find(struct arsdk_media_index *index,
+		const char *name, uint32_t hash)
+{
+	struct index_entry *entry;
+
+	entry = index->buckets[hash & (index->size - 1)];
+	while (entry != NULL) {
+		if (entry->hash == hash && strcmp(entry->name, name) == 0)
+			return entry;
+		entry = entry->next;
+	}
+
+	return NULL;
+}
+
+static int index_grow(struct arsdk_media_index *index)
+{
+	struct index_entry **buckets = NULL;
+	struct index_entry *entry = NULL;
+	struct index_entry *next = NULL;
+	size_t size = index->size << 1;
+	size_t i;
+
+	buckets = calloc(size, sizeof(*buckets));
+	if (buckets == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < index->size; i++) {
+		for (entry = index->buckets[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			entry->next = buckets[entry->hash & (size - 1)];
+			buckets[entry->hash & (size - 1)] = entry;
+		}
+	}
+
+	free(index->buckets);
+	index->buckets = buckets;
+	index->size = size;
+	return 0;
+}
+
+static int index_add(struct arsdk_media_index *index, const char *name,
+		uint32_t hash, uint32_t sig)
+{
+	struct index_entry *entry = NULL;
+	size_t bucket;
+
+	/* keep the load factor below 1 */
+	if (index->count >= index->size && index_grow(index) < 0)
+		return -ENOMEM;
+
+	entry = calloc(1, sizeof(*entry));
+	if (entry == NULL)
+		return -ENOMEM;
+
+	entry->name = strdup(name);
+	if (entry->name == NULL) {
+		free(entry);
+		return -ENOMEM;
+	}
+	entry->hash = hash;
+	entry->sig = sig;
+	entry->gen = index->gen;
+
+	bucket = hash & (index->size - 1);
+	entry->next = index->buckets[bucket];
+	index->buckets[bucket] = entry;
+	index->count++;
+	index->dirty = 1;
+	return 0;
+}
+
+static void index_clear(struct arsdk_media_index *index)
+{
+	struct index_entry *entry = NULL;
+	struct index_entry *next = NULL;
+	size_t i;
+
+	for (i = 0; i < index->size; i++) {
+		for (entry = index->buckets[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			free(entry->name);
+			free(entry);
+		}
+		index->buckets[i] = NULL;
+	}
+
+	index->count = 0;
+	index->dir_mtime = 0;
+	index->list_time = 0;
+	index->newest_mtime = 0;
+}
+
+/**
+ * Load the index file:
+ * a header line
+ * "arsdk-media-index <version> <dir_mtime> <list_time> <newest_mtime>"
+ * followed by a line "<sig> <name>" per media, the signature in hexadecimal.
+ */
+static int index_load(struct arsdk_media_index *index)
+{
+	int res = 0;
+	FILE *file = NULL;
+	char *line = NULL;
+	size_t line_size = 0;
+	ssize_t len;
+	unsigned int version = 0;
+	long long dir_mtime = 0;
+	long long list_time = 0;
+	long long newest_mtime = 0;
+	unsigned long sig;
+	char *name = NULL;
+
+	file = fopen(index->path, "r");
+	if (file == NULL)
+		return -errno;
+
+	len = getline(&line, &line_size, file);
+	if (len < 0 ||
+	    sscanf(line, INDEX_MAGIC " %u %lld %lld %lld", &version,
+			&dir_mtime, &list_time, &newest_mtime) != 4 ||
+	    version != INDEX_VERSION) {
+		res = -EPROTO;
+		goto out;
+	}
+
+	while ((len = getline(&line, &line_size, file)) > 0) {
+		if (line[len - 1] == '\n')
+			line[--len] = '\0';
+
+		sig = strtoul(line, &name, 16);
+		if (name == line || *name != ' ' || name[1] == '\0') {
+			res = -EPROTO;
+			goto out;
+		}
+		name++;
+
+		res = index_add(index, name, name_hash(name), sig);
+		if (res < 0)
+			goto out;
+	}
+
+	index->dir_mtime = (time_t)dir_mtime;
+	index->list_time = (time_t)list_time;
+	index->newest_mtime = (time_t)newest_mtime;
+	index->dirty = 0;
+
+out:
+	if (res < 0)
+		index_clear(index);
+	free(line);
+	fclose(file);
+	return res;
+}
+
+/**
+ * Save the index file, written to a temporary file renamed once complete.
+ */
+static int index_save(struct arsdk_media_index *index)
+{
+	int res = 0;
+	FILE *file = NULL;
+	char *tmp_path = NULL;
+	struct index_entry *entry = NULL;
+	size_t i;
+
+	res = asprintf(&tmp_path, "%s" INDEX_TMP_SUFFIX, index->path);
+	if (res < 0)
+		return -ENOMEM;
+
+	file = fopen(tmp_path, "w");
+	if (file == NULL) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("fopen", -res);
+		goto out;
+	}
+
+	fprintf(file, INDEX_MAGIC " %u %lld %lld %lld\n", INDEX_VERSION,
+			(long long)index->dir_mtime,
+			(long long)index->list_time,
+			(long long)index->newest_mtime);
+	for (i = 0; i < index->size; i++) {
+		for (entry = index->buckets[i]; entry != NULL;
+		     entry = entry->next)
+			fprintf(file, "%08x %s\n", entry->sig, entry->name);
+	}
+
+	if (fclose(file) != 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("fclose", -res);
+		goto out;
+	}
+
+	if (rename(tmp_path, index->path) < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("rename", -res);
+		goto out;
+	}
+
+	index->dirty = 0;
+	res = 0;
+
+out:
+	if (res < 0)
+		unlink(tmp_path);
+	free(tmp_path);
+	return res;
+}
+
+int arsdk_media_index_new(const char *path,
+		struct arsdk_media_index **ret_index)
+{
+	int res = 0;
+	struct arsdk_media_index *index = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_index != NULL, -EINVAL);
+	*ret_index = NULL;
+	ARSDK_RETURN_ERR_IF_FAILED(path != NULL, -EINVAL);
+
+	index = calloc(1, sizeof(*index));
+	if (index == NULL)
+		return -ENOMEM;
+
+	index->size = INDEX_BUCKETS_MIN;
+	index->buckets = calloc(index->size, sizeof(*index->buckets));
+	index->path = strdup(path);
+	if (index->buckets == NULL || index->path == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
+	/* an index missing or invalid is rebuilt by the next refresh */
+	res = index_load(index);
+	if (res < 0 && res != -ENOENT)
+		ARSDK_LOGW("media index '%s' not loaded: %s", path,
+				strerror(-res));
+
+	*ret_index = index;
+	return 0;
+
+error:
+	arsdk_media_index_destroy(index);
+	return res;
+}
+
+void arsdk_media_index_destroy(struct arsdk_media_index *index)
+{
+	if (index == NULL)
+		return;
+
+	if (index->buckets != NULL)
+		index_clear(index);
+	free(index->buckets);
+	free(index->path);
+	free(index);
+}
+
+int arsdk_media_index_is_current(const struct arsdk_media_index *index,
+		time_t dir_mtime)
+{
+	ARSDK_RETURN_VAL_IF_FAILED(index != NULL, -EINVAL, 0);
+
+	if (dir_mtime == 0 || dir_mtime != index->dir_mtime)
+		return 0;
+
+	/* modification times have a 1 second resolution and the modification
+	 * of a file does not change its directory: a change close to the
+	 * listing, or a file still written, can be missed by it */
+	return index->list_time - index->newest_mtime >=
+			ARSDK_MEDIA_INDEX_MTIME_MARGIN;
+}
+
+int arsdk_media_index_invalidate(struct arsdk_media_index *index)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(index != NULL, -EINVAL);
+
+	if (index->dir_mtime == 0)
+		return 0;
+
+	index->dir_mtime = 0;
+	index->list_time = 0;
+	index->newest_mtime = 0;
+	return index_save(index);
+}
+
+void arsdk_media_index_begin(struct arsdk_media_index *index)
+{
+	ARSDK_RETURN_IF_FAILED(index != NULL, -EINVAL);
+
+	index->gen++;
+}
+
+int arsdk_media_index_update(struct arsdk_media_index *index,
+		const char *name, uint32_t sig)
+{
+	int res = 0;
+	struct index_entry *entry = NULL;
+	uint32_t hash;
+
+	ARSDK_RETURN_ERR_IF_FAILED(index != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(name != NULL, -EINVAL);
+
+	hash = name_hash(name);
+	entry = index_find(index, name, hash);
+	if (entry == NULL) {
+		res = index_add(index, name, hash, sig);
+		return res < 0 ? res : 1;
+	}
+
+	entry->gen = index->gen;
+	if (entry->sig == sig)
+		return 0;
+
+	entry->sig = sig;
+	index->dirty = 1;
+	return 2;
+}
+
+int arsdk_media_index_end(struct arsdk_media_index *index,
+		time_t dir_mtime,
+		time_t list_time,
+		time_t newest_mtime,
+		arsdk_media_index_removed_cb_t removed_cb,
+		void *userdata)
+{
+	struct index_entry **prev = NULL;
+	struct index_entry *entry = NULL;
+	size_t i;
+
+	ARSDK_RETURN_ERR_IF_FAILED(index != NULL, -EINVAL);
+
+	/* remove the medias not updated by this refresh */
+	for (i = 0; i < index->size; i++) {
+		prev = &index->buckets[i];
+		while ((entry = *prev) != NULL) {
+			if (entry->gen == index->gen) {
+				prev = &entry->next;
+				continue;
+			}
+
+			*prev = entry->next;
+			index->count--;
+			index->dirty = 1;
+			if (removed_cb != NULL)
+				(*removed_cb)(entry->name, userdata);
+			free(entry->name);
+			free(entry);
+		}
+	}
+
+	if (index->dir_mtime != dir_mtime ||
+	    index->list_time != list_time ||
+	    index->newest_mtime != newest_mtime) {
+		index->dir_mtime = dir_mtime;
+		index->list_time = list_time;
+		index->newest_mtime = newest_mtime;
+		index->dirty = 1;
+	}
+
+	return index->dirty ? index_save(index) : 0;
+}
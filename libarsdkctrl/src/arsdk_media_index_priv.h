@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_MEDIA_INDEX_PRIV_H_
+#define _ARSDK_MEDIA_INDEX_PRIV_H_
+
+/** Initial value of a media index hash */
+#define ARSDK_MEDIA_INDEX_HASH_INIT 2166136261u
+
+/**
+ * Minimum delay between the most recent modification seen by a listing and
+ * the listing itself for the index to be trusted (seconds).
+ */
+#define ARSDK_MEDIA_INDEX_MTIME_MARGIN 2
+
+struct arsdk_media_index;
+
+/**
+ * Media removed from an index callback.
+ * @param name : name of the media.
+ * @param userdata : user data.
+ */
+typedef void (*arsdk_media_index_removed_cb_t)(const char *name,
+		void *userdata);
+
+/**
+ * Update a FNV-1a hash with data.
+ * @param hash : hash to update, ARSDK_MEDIA_INDEX_HASH_INIT to start.
+ * @param data : data to hash.
+ * @param len : length of the data.
+ * @return the updated hash.
+ */
+uint32_t arsdk_media_index_hash(uint32_t hash, const void *data, size_t len);
+
+/**
+ * Create a media index persisted in a file.
+ * The index is loaded from the file if it exists and is valid, else it is
+ * empty.
+ * @param path : path of the index file.
+ * @param ret_index : will receive the index.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_media_index_new(const char *path,
+		struct arsdk_media_index **ret_index);
+
+/**
+ * Destroy a media index; it is not saved.
+ * @param index : the index.
+ */
+void arsdk_media_index_destroy(struct arsdk_media_index *index);
+
+/**
+ * Check whether the index is up to date with the media directory.
+ * The index is not trusted if the most recent modification seen by its last
+ * refresh was too close to the listing, it may have missed later changes.
+ * @param index : the index.
+ * @param dir_mtime : current modification time of the media directory,
+ * 0 if unknown.
+ * @return 1 if the index is up to date, 0 if the directory must be listed.
+ */
+int arsdk_media_index_is_current(const struct arsdk_media_index *index,
+		time_t dir_mtime);
+
+/**
+ * Invalidate the index without refreshing it: its medias are kept but the
+ * media directory is listed by the next refresh.
+ * @param index : the index.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_media_index_invalidate(struct arsdk_media_index *index);
+
+/**
+ * Start a refresh of the index; the medias not updated before
+ * arsdk_media_index_end() are removed.
+ * @param index : the index.
+ */
+void arsdk_media_index_begin(struct arsdk_media_index *index);
+
+/**
+ * Update a media during a refresh.
+ * @param index : the index.
+ * @param name : name of the media.
+ * @param sig : signature of the media resources.
+ * @return 1 if the media is new, 2 if its signature changed, 0 if unchanged,
+ * negative errno value in case of error.
+ */
+int arsdk_media_index_update(struct arsdk_media_index *index,
+		const char *name, uint32_t sig);
+
+/**
+ * End a refresh of the index: remove the medias not updated and save the
+ * index file if modified.
+ * @param index : the index.
+ * @param dir_mtime : modification time of the media directory, 0 if unknown.
+ * @param list_time : wall time at which the directory was listed.
+ * @param newest_mtime : most recent modification time of the directory and
+ * the medias listed.
+ * @param removed_cb : called for each media removed, can be NULL.
+ * @param userdata : user data of removed_cb.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_media_index_end(struct arsdk_media_index *index,
+		time_t dir_mtime,
+		time_t list_time,
+		time_t newest_mtime,
+		arsdk_media_index_removed_cb_t removed_cb,
+		void *userdata);
+
+#endif /* !_ARSDK_MEDIA_INDEX_PRIV_H_ */
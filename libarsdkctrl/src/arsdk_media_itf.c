@@ -27,22 +27,62 @@
 #include "arsdkctrl_priv.h"
 #include "arsdk_ftp_itf_priv.h"
 #include "arsdk_media_itf_priv.h"
+#include "arsdk_media_arena_priv.h"
+#include "arsdk_media_index_priv.h"
+#include "arsdk_media_thumb_priv.h"
 #include "arsdkctrl_default_log.h"
 
+#include <ctype.h>
+
 #define ROOT_FLD "/internal_000/"
 #define MEDIA_FLD "media/"
 #define THUMB_FLD "thumb/"
+#define INDEX_SUFFIX ".index"
+
+/* resources deleted at once by a batch, as many as idle ftp connections */
+#define DELETE_BATCH_WINDOW 4
 
 enum arsdk_media_req_type {
 	ARSDK_MEDIA_REQ_LIST,
 	ARSDK_MEDIA_REQ_DOWNLOAD,
 	ARSDK_MEDIA_REQ_DELETE,
+	ARSDK_MEDIA_REQ_THUMB,
+	ARSDK_MEDIA_REQ_DELETE_BATCH,
 };
 
 /** */
 struct arsdk_media_itf {
 	struct arsdk_ftp_itf            *ftp;
 	struct list_node                reqs;
+	/* device id, naming the index files */
+	char                            *dev_id;
+	/* media index, enabled if dir is not NULL */
+	struct {
+		char                            *dir;
+		struct arsdk_media_index_cbs    cbs;
+		struct list_node                caches;
+	} index;
+	/* thumbnail cache and downloads */
+	struct arsdk_media_thumbs       *thumbs;
+	/* storage roots configured per device type */
+	struct list_node                roots;
+};
+
+/** storage roots of a type of device */
+struct media_roots {
+	enum arsdk_device_type          dev_type;
+	char                            **roots;
+	size_t                          count;
+	struct list_node                node;
+};
+
+/** indexed medias of a device folder */
+struct media_cache {
+	const char                      *dev_fld;
+	struct arsdk_media_index        *index;
+	/* medias of the last listing, NULL if not listed yet */
+	struct arsdk_media_list         *medias;
+	struct list_node                node;
 };
 
 /** */
@@ -58,12 +98,23 @@ struct arsdk_media_res {
 /** */
 struct arsdk_media {
 	uint32_t                        refcount;
+	/* memory of the media, its resources and strings */
+	struct arsdk_media_arena        *arena;
 	char                            *name;
-	char                            *runid;
+	const char                      *runid;
 	enum arsdk_media_type           type;
 	struct tm                       date;
 	struct list_node                res;
 	struct list_node                node;
+	uint32_t                        name_hash;
+	struct arsdk_media              *index_next;
+};
+
+/** Index of the medias by name, used to group resources while listing. */
+struct media_index {
+	struct arsdk_media              **buckets;
+	size_t                          size;
+	size_t                          count;
 };
 
 /** */
@@ -80,15 +131,47 @@ struct arsdk_media_req_base {
 struct arsdk_media_list {
 	uint32_t                        refcount;
 	struct list_node                medias;
+	/* memory of the medias built for the list */
+	struct arsdk_media_arena        *arena;
+};
+
+/** listing of a storage root by a "list" request */
+struct req_list_root {
+	struct arsdk_media_req_list         *req_list;
+	char                                *media_path;
+	char                                *thumb_path;
+	struct arsdk_ftp_req_list           *ftp_list_req;
+	struct arsdk_ftp_req_stat           *ftp_stat_req;
+	time_t                              dir_mtime;
+	int                                 listed;
 };
 
 /** */
 struct arsdk_media_req_list {
 	struct arsdk_media_req_base         *base;
 	struct arsdk_media_req_list_cbs     cbs;
-	struct arsdk_ftp_req_list           *ftp_list_req;
 	uint32_t                            types;
 	struct arsdk_media_list             *result;
+	/* storage roots, listed concurrently */
+	struct req_list_root                *roots;
+	size_t                              roots_nb;
+	size_t                              listed_nb;
+	/* ftp requests in progress */
+	size_t                              pending;
+	/* callbacks being processed, completion deferred until 0 */
+	int                                 busy;
+	enum arsdk_media_req_status         status;
+	int                                 error;
+	/* medias of all the roots, created when listing */
+	struct arsdk_media_list             *response;
+	struct media_index                  index;
+	/* media index */
+	struct media_cache                  *cache;
+	time_t                              dir_mtime;
+	/* wall time of the listing */
+	time_t                              list_time;
+	/* most recent modification time of the folders and files listed */
+	time_t                              newest_mtime;
 };
 
 /** */
@@ -100,6 +183,16 @@ struct arsdk_media_req_download {
 	struct arsdk_ftp_req_get            *ftp_get_req;
 };
 
+/** */
+struct arsdk_media_req_thumb {
+	struct arsdk_media_req_base         *base;
+	struct arsdk_media_req_thumb_cbs    cbs;
+	char                                *uri;
+	struct arsdk_media_thumb_waiter     *waiter;
+	/* thumbnail, only set while notified */
+	struct pomp_buffer                  *buf;
+};
+
 /** */
 struct arsdk_media_req_delete {
 	struct arsdk_media_req_base         *base;
@@ -112,12 +205,58 @@ struct arsdk_media_req_delete {
 	int                                 error;
 };
 
+/** */
+struct delete_batch_item {
+	struct arsdk_media                  *media;
+	/* next resource to delete, NULL once all are sent */
+	struct arsdk_media_res              *next_res;
+	/* resource deletions in progress */
+	size_t                              pending;
+	enum arsdk_media_req_status         status;
+	int                                 error;
+	int                                 is_notified;
+};
+
+/** */
+struct delete_batch_slot {
+	struct arsdk_ftp_req_delete         *req;
+	size_t                              item;
+};
+
+/** */
+struct arsdk_media_req_delete_batch {
+	struct arsdk_media_req_base         *base;
+	struct arsdk_media_req_delete_batch_cbs cbs;
+	struct delete_batch_item            *items;
+	size_t                              items_nb;
+	/* first item with resources not sent yet */
+	size_t                              next_item;
+	size_t                              done_nb;
+	size_t                              failed_nb;
+	struct delete_batch_slot            slots[DELETE_BATCH_WINDOW];
+	size_t                              inflight;
+	/* callbacks being processed, completion deferred until 0 */
+	int                                 busy;
+	/* no more resource deletion sent */
+	int                                 is_stopped;
+	enum arsdk_media_req_status         status;
+	int                                 error;
+};
+
+static void media_caches_clear(struct arsdk_media_itf *itf);
+static void media_roots_clear(struct arsdk_media_itf *itf);
+static void media_index_clear(struct media_index *index);
+
 int arsdk_media_itf_new(struct arsdk_ftp_itf *ftp_itf,
+		struct pomp_loop *loop,
+		const char *dev_id,
 		struct arsdk_media_itf **ret_itf)
 {
+	int res = 0;
 	struct arsdk_media_itf *itf = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ftp_itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(loop != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(ret_itf != NULL, -EINVAL);
 
 	/* Allocate structure */
@@ -127,9 +266,26 @@ int arsdk_media_itf_new(struct arsdk_ftp_itf *ftp_itf,
 
 	itf->ftp = ftp_itf;
 	list_init(&itf->reqs);
+	list_init(&itf->index.caches);
+	list_init(&itf->roots);
+	itf->dev_id = xstrdup(dev_id != NULL ? dev_id : "unknown");
+	if (itf->dev_id == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
+	res = arsdk_media_thumbs_new(ftp_itf, loop, itf->dev_id,
+			&itf->thumbs);
+	if (res < 0)
+		goto error;
 
 	*ret_itf = itf;
 	return 0;
+
+error:
+	free(itf->dev_id);
+	free(itf);
+	return res;
 }
 
 int arsdk_media_itf_destroy(struct arsdk_media_itf *itf)
@@ -138,6 +294,11 @@ int arsdk_media_itf_destroy(struct arsdk_media_itf *itf)
 
 	arsdk_media_itf_stop(itf);
 
+	arsdk_media_thumbs_destroy(itf->thumbs);
+	media_caches_clear(itf);
+	media_roots_clear(itf);
+	free(itf->index.dir);
+	free(itf->dev_id);
 	free(itf);
 	return 0;
 }
@@ -173,21 +334,21 @@ static int arsdk_media_res_destroy(struct arsdk_media_res *res)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(res != NULL, -EINVAL);
 
+	/* memory is released with the arena */
 	arsdk_ftp_file_unref(res->file);
-
-	free(res->uri);
-	free(res);
+	res->file = NULL;
 
 	return 0;
 }
 
-static int arsdk_media_res_new(struct arsdk_media_res **ret_res)
+static int arsdk_media_res_new(struct arsdk_media_arena *arena,
+		struct arsdk_media_res **ret_res)
 {
 	struct arsdk_media_res *resource = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_res != NULL, -EINVAL);
 
-	resource = calloc(1, sizeof(*resource));
+	resource = arsdk_media_arena_alloc(arena, sizeof(*resource));
 	if (resource == NULL)
 		return -ENOMEM;
 
@@ -197,7 +358,8 @@ static int arsdk_media_res_new(struct arsdk_media_res **ret_res)
 	return 0;
 }
 
-static int arsdk_media_res_new_from_file(const char *path,
+static int arsdk_media_res_new_from_file(struct arsdk_media_arena *arena,
+		const char *path,
 		struct arsdk_ftp_file *file,
 		struct arsdk_media_res **ret_res)
 {
@@ -205,6 +367,8 @@ static int arsdk_media_res_new_from_file(const char *path,
 	struct arsdk_media_res *resource = NULL;
 	const char *name = NULL;
 	char *ext = NULL;
+	enum arsdk_media_res_type type;
+	enum arsdk_media_res_format format;
 
 	ARSDK_RETURN_ERR_IF_FAILED(file != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(ret_res != NULL, -EINVAL);
@@ -218,84 +382,85 @@ static int arsdk_media_res_new_from_file(const char *path,
 		return -EINVAL;
 	ext += 1;
 
-	res = arsdk_media_res_new(&resource);
+	/* nothing allocated in the arena for unknown files */
+	res = parse_ext(ext, &type, &format);
 	if (res < 0)
-		goto error;
-
-	arsdk_ftp_file_ref(file);
-	resource->file = file;
+		return res;
 
-	res = parse_ext(ext, &resource->type, &resource->format);
+	res = arsdk_media_res_new(arena, &resource);
 	if (res < 0)
-		goto error;
+		return res;
 
-	res = asprintf(&resource->uri, "%s%s", path,
-			arsdk_ftp_file_get_name(file));
-	if (res < 0)
-		goto error;
+	resource->type = type;
+	resource->format = format;
+	resource->uri = arsdk_media_arena_concat(arena, path, name);
+	if (resource->uri == NULL)
+		return -ENOMEM;
+
+	arsdk_ftp_file_ref(file);
+	resource->file = file;
 
 	*ret_res = resource;
 	return 0;
-
-error:
-	arsdk_media_res_destroy(resource);
-	return res;
 }
 
-static int parse_file_name(const char *name, char **product,
-		char **date_str,
-		char **runid,
-		char **ext)
+/** fields of a media file name */
+struct media_file_name {
+	char                            product[11];
+	char                            date_str[31];
+	char                            runid[11];
+	char                            ext[11];
+	int                             has_runid;
+};
+
+static int parse_file_name(const char *name, struct media_file_name *fields)
 {
-	char scan_product[11];
-	char scan_date_str[31];
-	char scan_runid[11];
-	char scan_ext[11];
+	char name_cp[256];
 	char *cursor = NULL;
 	int res = 0;
 
 	ARSDK_RETURN_ERR_IF_FAILED(name != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(product != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(date_str != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(ext != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(fields != NULL, -EINVAL);
+
+	if (strlen(name) >= sizeof(name_cp))
+		return -EINVAL;
+	strcpy(name_cp, name);
 
 	/* reformat name
 	 * [product name]_[date]_<runid>.[ext] to
 	 * [product name] [date] <runid> [ext]
 	 */
 
-	cursor = strrchr(name, '.');
+	cursor = strrchr(name_cp, '.');
 	if (cursor == NULL)
 		return -EINVAL;
 	*cursor = ' ';
 
-	cursor = strrchr(name, '_');
+	cursor = strrchr(name_cp, '_');
 	if (cursor == NULL)
 		return -EINVAL;
 	*cursor = ' ';
 
-	cursor = strrchr(name, '_');
+	cursor = strrchr(name_cp, '_');
 	if (cursor == NULL)
 		return -EINVAL;
 	*cursor = ' ';
 
 	/* parsing */
-	res = sscanf(name, "%10s %30s %10s %10s",
-			scan_product, scan_date_str, scan_runid, scan_ext);
+	res = sscanf(name_cp, "%10s %30s %10s %10s",
+			fields->product, fields->date_str, fields->runid,
+			fields->ext);
 
 	if (res < 3)
 		return -EINVAL;
 
-	*product = xstrdup(scan_product);
-	*date_str = xstrdup(scan_date_str);
-
 	if (res == 3) {
 		/* no runid*/
-		*runid = NULL;
-		*ext = xstrdup(scan_runid);
+		fields->has_runid = 0;
+		strcpy(fields->ext, fields->runid);
+		fields->runid[0] = '\0';
 	} else {
-		*runid = xstrdup(scan_runid);
-		*ext = xstrdup(scan_ext);
+		fields->has_runid = 1;
 	}
 
 	return 0;
@@ -337,101 +502,97 @@ static uint8_t filter_type(uint32_t types, enum arsdk_media_res_type res_type)
 	}
 }
 
-static int arsdk_media_res_new_thumb(struct arsdk_media_req_list *req_list,
-		const char *product,
-		const char *date_str,
-		const char *ext,
+static int arsdk_media_res_new_thumb(struct arsdk_media_arena *arena,
+		const char *thumb_path,
+		const struct media_file_name *fields,
 		enum arsdk_media_type type,
-		const char *runid,
 		struct arsdk_media_res **ret_res)
 {
 	struct arsdk_ftp_file *thumb_file = NULL;
-	const char *runid_str = "";
-	char *name = NULL;
-	char *thumb_path = NULL;
+	char name[128];
 	int res = 0;
 
-	res = arsdk_ftp_file_new(&thumb_file);
-	if (res < 0)
-		return res;
-
 	switch (type) {
 	case ARSDK_MEDIA_TYPE_PHOTO:
-		if (runid != NULL)
-			runid_str = runid;
-
-		res = asprintf(&name, "%s_%s_%s.jpg",
-				product,
-				date_str,
-				runid_str);
-		if (res < 0)
-			goto error;
+		res = snprintf(name, sizeof(name), "%s_%s_%s.jpg",
+				fields->product,
+				fields->date_str,
+				fields->runid);
 		break;
 	case ARSDK_MEDIA_TYPE_VIDEO:
-		if (runid != NULL)
-			runid_str = runid;
-
-		res = asprintf(&name, "%s_%s_%s.%s.jpg",
-				product,
-				date_str,
-				runid_str,
-				ext);
-		if (res < 0)
-			goto error;
+		res = snprintf(name, sizeof(name), "%s_%s_%s.%s.jpg",
+				fields->product,
+				fields->date_str,
+				fields->runid,
+				fields->ext);
 		break;
 	default:
-		res = -EINVAL;
-		goto error;
+		return -EINVAL;
 	}
+	if (res < 0 || (size_t)res >= sizeof(name))
+		return -EINVAL;
 
-	res = arsdk_ftp_file_set_name(thumb_file, name);
+	res = arsdk_ftp_file_new(&thumb_file);
 	if (res < 0)
-		goto error;
+		return res;
 
-	res = asprintf(&thumb_path, "%s%s/%s", ROOT_FLD,
-			req_list->base->dev_fld, THUMB_FLD);
+	res = arsdk_ftp_file_set_name(thumb_file, name);
 	if (res < 0)
-		goto error;
+		goto out;
 
-	res = arsdk_media_res_new_from_file(thumb_path, thumb_file, ret_res);
+	res = arsdk_media_res_new_from_file(arena, thumb_path, thumb_file,
+			ret_res);
 	if (res < 0)
-		goto error;
+		goto out;
 
 	(*ret_res)->type = ARSDK_MEDIA_RES_TYPE_THUMBNAIL;
-	free(name);
-	free(thumb_path);
-	arsdk_ftp_file_unref(thumb_file);
 
-	return 0;
-
-error:
-	free(name);
-	free(thumb_path);
+out:
 	arsdk_ftp_file_unref(thumb_file);
 	return res;
 }
 
-static int file_to_media_name(struct arsdk_ftp_file *file, char **ret_name)
+/**
+ * Get the length of the name of the media of a file: the file name without
+ * its extension.
+ */
+static int file_to_media_name_len(struct arsdk_ftp_file *file, size_t *ret_len)
 {
 	const char *f_name = NULL;
-	char *name_end = NULL;
-	char *name = NULL;
+	const char *name_end = NULL;
+
 	ARSDK_RETURN_ERR_IF_FAILED(file != NULL, -EINVAL);
 
 	f_name = arsdk_ftp_file_get_name(file);
-	name = xstrdup(f_name);
+	if (f_name == NULL)
+		return -EINVAL;
 
-	name_end = strrchr(name, '.');
-	if (name_end == NULL) {
-		free(name);
+	name_end = strrchr(f_name, '.');
+	if (name_end == NULL)
 		return -EINVAL;
-	}
-	*name_end = '\0';
 
-	*ret_name = name;
+	*ret_len = name_end - f_name;
 	return 0;
 }
 
+static int file_to_res_type(struct arsdk_ftp_file *file,
+		enum arsdk_media_res_type *type)
+{
+	const char *name = NULL;
+	const char *ext = NULL;
+	enum arsdk_media_res_format format;
+
+	name = arsdk_ftp_file_get_name(file);
+	if (name == NULL)
+		return -EINVAL;
+
+	ext = strrchr(name, '.');
+	if (ext == NULL)
+		return -EINVAL;
+
+	return parse_ext(ext + 1, type, &format);
+}
+
 static int apply_tzone(struct tm *date, const char *tzone_str)
 {
 	struct tm tzone;
@@ -468,16 +629,13 @@ static int apply_tzone(struct tm *date, const char *tzone_str)
 	return 0;
 }
 
-static int file_to_media(struct arsdk_media_req_list *req_list,
-		const char *path,
+static int file_to_media(const char *thumb_path,
 		struct arsdk_ftp_file *file,
 		struct arsdk_media *media)
 {
 	const char *name = NULL;
-	char *name_cp = NULL;
-	char *product = NULL;
-	char *date_str = NULL;
-	char *ext = NULL;
+	size_t name_len = 0;
+	struct media_file_name fields;
 	int res = 0;
 	char *fmt_res = NULL;
 	struct arsdk_media_res *thumb;
@@ -485,52 +643,52 @@ static int file_to_media(struct arsdk_media_req_list *req_list,
 	ARSDK_RETURN_ERR_IF_FAILED(file != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(media != NULL, -EINVAL);
 
-	res = file_to_media_name(file, &media->name);
+	res = file_to_media_name_len(file, &name_len);
 	if (res < 0)
-		goto cleanup;
+		return res;
 
 	name = arsdk_ftp_file_get_name(file);
-	name_cp = xstrdup(name);
-	res = parse_file_name(name_cp, &product, &date_str,
-			&media->runid, &ext);
+	media->name = arsdk_media_arena_strndup(media->arena, name, name_len);
+	if (media->name == NULL)
+		return -ENOMEM;
+
+	res = parse_file_name(name, &fields);
 	if (res < 0)
-		goto cleanup;
+		return res;
+
+	/* run ids are shared by the medias of a flight */
+	if (fields.has_runid) {
+		media->runid = arsdk_media_arena_intern(media->arena,
+				fields.runid);
+		if (media->runid == NULL)
+			return -ENOMEM;
+	}
 
-	res = ext_to_type(ext, &media->type);
+	res = ext_to_type(fields.ext, &media->type);
 	if (res < 0)
-		goto cleanup;
+		return res;
 
 	memset(&media->date, 0, sizeof(media->date));
-	fmt_res = strptime(date_str, "%Y-%m-%dT%H%M%S", &media->date);
-	if (fmt_res == NULL) {
-		res = -EINVAL;
-		goto cleanup;
-	}
+	fmt_res = strptime(fields.date_str, "%Y-%m-%dT%H%M%S", &media->date);
+	if (fmt_res == NULL)
+		return -EINVAL;
 
 	/* Apply the timezone to the date. */
 	res = apply_tzone(&media->date, fmt_res);
 	if (res < 0)
-		goto cleanup;
+		return res;
 
 	/* Add thumbnail resource */
-	res = arsdk_media_res_new_thumb(req_list,
-			product,
-			date_str,
-			ext,
+	res = arsdk_media_res_new_thumb(media->arena,
+			thumb_path,
+			&fields,
 			media->type,
-			media->runid,
 			&thumb);
 	if (res < 0)
-		goto cleanup;
+		return res;
 
 	list_add_after(&media->res, &thumb->node);
-
-cleanup:
-	free(name_cp);
-	free(product);
-	free(date_str);
-	free(ext);
-	return res;
+	return 0;
 }
 
 static int arsdk_media_destroy(struct arsdk_media *media)
@@ -545,26 +703,31 @@ static int arsdk_media_destroy(struct arsdk_media *media)
 		arsdk_media_res_destroy(res);
 	}
 
-	free(media->name);
-	free(media->runid);
-	free(media);
+	/* the media and its strings are released with the arena */
+	arsdk_media_arena_unref(media->arena);
 
 	return 0;
 }
 
-static int arsdk_media_new(struct arsdk_media **ret_media)
+static int arsdk_media_new(struct arsdk_media_arena *arena,
+		struct arsdk_media **ret_media)
 {
 	struct arsdk_media *media = NULL;
 
+	ARSDK_RETURN_ERR_IF_FAILED(arena != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(ret_media != NULL, -EINVAL);
 
-	media = calloc(1, sizeof(*media));
+	media = arsdk_media_arena_alloc(arena, sizeof(*media));
 	if (media == NULL)
 		return -ENOMEM;
 
 	media->refcount = 1;
 	list_init(&media->res);
 
+	/* a media can outlive its list, keep its memory */
+	arsdk_media_arena_ref(arena);
+	media->arena = arena;
+
 	*ret_media = media;
 	return 0;
 }
@@ -581,6 +744,7 @@ static int arsdk_media_list_destroy(struct arsdk_media_list *list)
 		arsdk_media_unref(media);
 	}
 
+	arsdk_media_arena_unref(list->arena);
 	free(list);
 
 	return 0;
@@ -588,6 +752,7 @@ static int arsdk_media_list_destroy(struct arsdk_media_list *list)
 
 static int arsdk_media_list_new(struct arsdk_media_list **ret_list)
 {
+	int res = 0;
 	struct arsdk_media_list *list = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_list != NULL, -EINVAL);
@@ -596,6 +761,12 @@ static int arsdk_media_list_new(struct arsdk_media_list **ret_list)
 	if (list == NULL)
 		return -ENOMEM;
 
+	res = arsdk_media_arena_new(&list->arena);
+	if (res < 0) {
+		free(list);
+		return res;
+	}
+
 	list->refcount = 1;
 	list_init(&list->medias);
 
@@ -603,8 +774,8 @@ static int arsdk_media_list_new(struct arsdk_media_list **ret_list)
 	return 0;
 }
 
-static int arsdk_media_new_from_file(struct arsdk_media_req_list *req_list,
-		const char *path,
+static int arsdk_media_new_from_file(struct arsdk_media_arena *arena,
+		const char *thumb_path,
 		struct arsdk_ftp_file *file,
 		struct arsdk_media **ret_media)
 {
@@ -614,13 +785,66 @@ static int arsdk_media_new_from_file(struct arsdk_media_req_list *req_list,
 	ARSDK_RETURN_ERR_IF_FAILED(file != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(ret_media != NULL, -EINVAL);
 
-	res = arsdk_media_new(&media);
+	res = arsdk_media_new(arena, &media);
+	if (res < 0)
+		goto error;
+
+	res = file_to_media(thumb_path, file, media);
 	if (res < 0)
 		goto error;
 
-	res = file_to_media(req_list, path, file, media);
+	*ret_media = media;
+	return 0;
+
+error:
+	arsdk_media_unref(media);
+	return res;
+}
+
+/**
+ * Copy a media in an arena, sharing the files of its resources.
+ */
+static int arsdk_media_copy(struct arsdk_media_arena *arena,
+		const struct arsdk_media *src,
+		struct arsdk_media **ret_media)
+{
+	int res = 0;
+	struct arsdk_media *media = NULL;
+	struct arsdk_media_res *src_res = NULL;
+	struct arsdk_media_res *resource = NULL;
+
+	res = arsdk_media_new(arena, &media);
 	if (res < 0)
+		return res;
+
+	media->name = arsdk_media_arena_strndup(arena, src->name,
+			strlen(src->name));
+	media->runid = arsdk_media_arena_intern(arena, src->runid);
+	media->type = src->type;
+	media->date = src->date;
+	if (media->name == NULL ||
+	    (src->runid != NULL && media->runid == NULL)) {
+		res = -ENOMEM;
 		goto error;
+	}
+
+	list_walk_entry_forward(&src->res, src_res, node) {
+		res = arsdk_media_res_new(arena, &resource);
+		if (res < 0)
+			goto error;
+
+		resource->type = src_res->type;
+		resource->format = src_res->format;
+		resource->uri = arsdk_media_arena_strndup(arena, src_res->uri,
+				strlen(src_res->uri));
+		if (resource->uri == NULL) {
+			res = -ENOMEM;
+			goto error;
+		}
+		arsdk_ftp_file_ref(src_res->file);
+		resource->file = src_res->file;
+		list_add_before(&media->res, &resource->node);
+	}
 
 	*ret_media = media;
 	return 0;
@@ -705,221 +929,1434 @@ error:
 static void arsdk_media_req_list_destroy(
 	struct arsdk_media_req_list *req_list)
 {
+	size_t i = 0;
+
 	ARSDK_RETURN_IF_FAILED(req_list != NULL, -EINVAL);
 
-	if (req_list->ftp_list_req != NULL)
+	if (req_list->pending != 0)
 		ARSDK_LOGW("request %p still pending", req_list);
 
+	for (i = 0; i < req_list->roots_nb; i++) {
+		free(req_list->roots[i].media_path);
+		free(req_list->roots[i].thumb_path);
+	}
+	free(req_list->roots);
+
+	media_index_clear(&req_list->index);
 	req_destroy(req_list->base);
+	if (req_list->response != NULL)
+		arsdk_media_list_unref(req_list->response);
 	arsdk_media_list_unref(req_list->result);
 
 	free(req_list);
 }
 
-static enum arsdk_media_req_status ftp_to_media_status(
-		enum arsdk_ftp_req_status ftp_status)
+/**
+ * FNV-1a hash of a media name.
+ */
+static uint32_t media_name_hash(const char *name)
 {
-	switch (ftp_status) {
-	case ARSDK_FTP_REQ_STATUS_OK:
-		return ARSDK_MEDIA_REQ_STATUS_OK;
-	case ARSDK_FTP_REQ_STATUS_CANCELED:
-		return ARSDK_MEDIA_REQ_STATUS_CANCELED;
-	case ARSDK_FTP_REQ_STATUS_FAILED:
-		return ARSDK_MEDIA_REQ_STATUS_FAILED;
-	case ARSDK_FTP_REQ_STATUS_ABORTED:
-		return ARSDK_MEDIA_REQ_STATUS_ABORTED;
-	default:
-		ARSDK_LOGE("ftp status not known. %d", ftp_status);
-		return ARSDK_MEDIA_REQ_STATUS_FAILED;
-	}
+	return arsdk_media_index_hash(ARSDK_MEDIA_INDEX_HASH_INIT, name,
+			strlen(name));
 }
 
-static void pfld_list_complete_cb(struct arsdk_ftp_itf *itf,
-			struct arsdk_ftp_req_list *req,
-			enum arsdk_ftp_req_status status,
-			int error,
-			void *userdata)
+/**
+ * Make room in the index for more medias.
+ */
+static int media_index_reserve(struct media_index *index, size_t count)
 {
-	struct arsdk_media_req_list *req_list = userdata;
-	int res = error;
-	struct arsdk_ftp_file_list *file_list = NULL;
-	struct arsdk_ftp_file *next = NULL;
-	struct arsdk_ftp_file *curr = NULL;
-	struct arsdk_media *media_tmp = NULL;
+	size_t size = 16;
+	size_t i = 0;
+	struct arsdk_media **buckets = NULL;
 	struct arsdk_media *media = NULL;
-	struct arsdk_media_res *resource = NULL;
-	const char *path = NULL;
-	char *media_name = NULL;
-	struct arsdk_media_list *response = NULL;
-	enum arsdk_media_req_status media_status = ARSDK_MEDIA_REQ_STATUS_OK;
+	struct arsdk_media *next = NULL;
 
-	ARSDK_RETURN_IF_FAILED(req_list != NULL, -EINVAL);
+	/* keep the load factor below 1 */
+	count += index->count;
+	if (index->buckets != NULL && count <= index->size)
+		return 0;
 
-	if (req_list->base->is_aborted) {
-		media_status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
-		goto end;
-	}
+	while (size < count)
+		size <<= 1;
 
-	if (status != ARSDK_FTP_REQ_STATUS_OK) {
-		media_status = ftp_to_media_status(status);
-		res = error;
-		goto end;
-	}
+	buckets = calloc(size, sizeof(*buckets));
+	if (buckets == NULL)
+		return -ENOMEM;
 
-	if (req == NULL) {
-		media_status = ARSDK_MEDIA_REQ_STATUS_FAILED;
-		res = -EINVAL;
-		goto end;
+	for (i = 0; i < index->size; i++) {
+		for (media = index->buckets[i]; media != NULL; media = next) {
+			next = media->index_next;
+			media->index_next = buckets[media->name_hash &
+					(size - 1)];
+			buckets[media->name_hash & (size - 1)] = media;
+		}
 	}
 
-	res = arsdk_media_list_new(&response);
-	if (res < 0) {
-		media_status = ARSDK_MEDIA_REQ_STATUS_FAILED;
-		res = -ENOMEM;
-		goto end;
-	}
-	req_list->result = response;
+	free(index->buckets);
+	index->buckets = buckets;
+	index->size = size;
+	return 0;
+}
 
-	path = arsdk_ftp_req_list_get_path(req);
+static void media_index_clear(struct media_index *index)
+{
+	free(index->buckets);
+	index->buckets = NULL;
+	index->size = 0;
+	index->count = 0;
+}
 
-	file_list = arsdk_ftp_req_list_get_result(req);
-	next = arsdk_ftp_file_list_next_file(file_list, curr);
-	while (next != NULL) {
-		curr = next;
-		next = arsdk_ftp_file_list_next_file(file_list, curr);
+static struct arsdk_media *media_index_find(struct media_index *index,
+		const char *name, size_t len, uint32_t hash)
+{
+	struct arsdk_media *media;
 
-		/* create the resource */
-		res = arsdk_media_res_new_from_file(path, curr, &resource);
-		if (res < 0)
-			continue;
+	media = index->buckets[hash & (index->size - 1)];
+	while (media != NULL) {
+		if (media->name_hash == hash &&
+		    strncmp(media->name, name, len) == 0 &&
+		    media->name[len] == '\0')
+			return media;
+		media = media->index_next;
+	}
 
-		/* media filter */
-		res = filter_type(req_list->types, resource->type);
-		if (!res) {
-			arsdk_media_res_destroy(resource);
-			continue;
-		}
+	return NULL;
+}
 
-		res = file_to_media_name(curr, &media_name);
-		if (res < 0) {
-			arsdk_media_res_destroy(resource);
-			continue;
-		}
+static void media_index_add(struct media_index *index,
+		struct arsdk_media *media, uint32_t hash)
+{
+	size_t bucket = hash & (index->size - 1);
 
-		/* search the media */
-		media = NULL;
-		list_walk_entry_forward(&response->medias, media_tmp, node) {
-			if (strcmp(media_tmp->name, media_name) == 0) {
-				media = media_tmp;
-				break;
-			}
-		}
+	media->name_hash = hash;
+	media->index_next = index->buckets[bucket];
+	index->buckets[bucket] = media;
+	index->count++;
+}
 
-		if (media == NULL) {
-			/* create the media */
-			res = arsdk_media_new_from_file(req_list, path, curr,
-					&media);
-			if (res < 0) {
-				arsdk_media_res_destroy(resource);
-				free(media_name);
-				continue;
-			}
+/**
+ * Signature of the resources of a media, independent of their order.
+ */
+static uint32_t media_sig(const struct arsdk_media *media)
+{
+	struct arsdk_media_res *resource = NULL;
+	uint64_t size;
+	int64_t mtime;
+	uint32_t hash;
+	uint32_t sig = 0;
+
+	list_walk_entry_forward(&media->res, resource, node) {
+		size = arsdk_ftp_file_get_size(resource->file);
+		mtime = arsdk_ftp_file_get_mtime(resource->file);
+		hash = media_name_hash(arsdk_ftp_file_get_name(resource->file));
+		hash = arsdk_media_index_hash(hash, &size, sizeof(size));
+		hash = arsdk_media_index_hash(hash, &mtime, sizeof(mtime));
+		sig += hash;
+	}
 
-			list_add_after(&response->medias, &media->node);
+	return sig;
+}
+
+static void media_cache_destroy(struct media_cache *cache)
+{
+	arsdk_media_index_destroy(cache->index);
+	if (cache->medias != NULL)
+		arsdk_media_list_unref(cache->medias);
+	free(cache);
+}
+
+static void media_caches_clear(struct arsdk_media_itf *itf)
+{
+	struct media_cache *cache = NULL;
+	struct media_cache *cache_tmp = NULL;
+
+	list_walk_entry_forward_safe(&itf->index.caches, cache, cache_tmp,
+			node) {
+		list_del(&cache->node);
+		media_cache_destroy(cache);
+	}
+}
+
+/**
+ * Get the cache of a device folder, loading its index file
+ * "<dir>/<device id>-<folder>.index" the first time.
+ */
+static int media_cache_get(struct arsdk_media_itf *itf, const char *dev_fld,
+		struct media_cache **ret_cache)
+{
+	int res = 0;
+	struct media_cache *cache = NULL;
+	char *name = NULL;
+	char *path = NULL;
+	char *c = NULL;
+
+	list_walk_entry_forward(&itf->index.caches, cache, node) {
+		if (strcmp(cache->dev_fld, dev_fld) == 0) {
+			*ret_cache = cache;
+			return 0;
+		}
+	}
+
+	res = asprintf(&name, "%s-%.*s", itf->dev_id,
+			(int)strcspn(dev_fld, "/"), dev_fld);
+	if (res < 0)
+		return -ENOMEM;
+
+	/* the device id is not a valid file name in any case */
+	for (c = name; *c != '\0'; c++) {
+		if (!isalnum((unsigned char)*c) && *c != '-' && *c != '_')
+			*c = '_';
+	}
+
+	res = asprintf(&path, "%s/%s" INDEX_SUFFIX, itf->index.dir, name);
+	free(name);
+	if (res < 0)
+		return -ENOMEM;
+
+	cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		res = -ENOMEM;
+		goto out;
+	}
+
+	cache->dev_fld = dev_fld;
+	res = arsdk_media_index_new(path, &cache->index);
+	if (res < 0) {
+		free(cache);
+		goto out;
+	}
+
+	list_add_after(&itf->index.caches, &cache->node);
+	*ret_cache = cache;
+
+out:
+	free(path);
+	return res;
+}
+
+static void media_index_removed_cb(const char *name, void *userdata)
+{
+	struct arsdk_media_itf *itf = userdata;
+
+	if (itf->index.cbs.removed != NULL)
+		(*itf->index.cbs.removed)(itf, name, itf->index.cbs.userdata);
+}
+
+/**
+ * Refresh the index of a cache from the medias listed, notifying the changes.
+ */
+static void media_cache_refresh(struct media_cache *cache,
+		struct arsdk_media_itf *itf,
+		struct arsdk_media_list *list,
+		time_t dir_mtime,
+		time_t list_time,
+		time_t newest_mtime)
+{
+	int res = 0;
+	struct arsdk_media *media = NULL;
+
+	arsdk_media_index_begin(cache->index);
+
+	list_walk_entry_forward(&list->medias, media, node) {
+		res = arsdk_media_index_update(cache->index, media->name,
+				media_sig(media));
+		if (res < 0) {
+			ARSDK_LOG_ERRNO("arsdk_media_index_update", -res);
+			continue;
+		}
+
+		/* a media changed is notified removed then added */
+		if (res == 2)
+			media_index_removed_cb(media->name, itf);
+		if (res > 0 && itf->index.cbs.added != NULL)
+			(*itf->index.cbs.added)(itf, media,
+					itf->index.cbs.userdata);
+	}
+
+	res = arsdk_media_index_end(cache->index, dir_mtime, list_time,
+			newest_mtime, &media_index_removed_cb, itf);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("arsdk_media_index_end", -res);
+
+	arsdk_media_list_ref(list);
+	if (cache->medias != NULL)
+		arsdk_media_list_unref(cache->medias);
+	cache->medias = list;
+}
+
+/**
+ * Get the medias of a cache of the given types; the medias of a list can not
+ * be shared with another one, they are copied if filtered.
+ */
+static int media_cache_get_result(struct media_cache *cache, uint32_t types,
+		struct arsdk_media_list **ret_list)
+{
+	int res = 0;
+	struct arsdk_media_list *list = NULL;
+	struct arsdk_media *media = NULL;
+	struct arsdk_media *copy = NULL;
+
+	if ((types & ARSDK_MEDIA_TYPE_ALL) == ARSDK_MEDIA_TYPE_ALL) {
+		arsdk_media_list_ref(cache->medias);
+		*ret_list = cache->medias;
+		return 0;
+	}
+
+	res = arsdk_media_list_new(&list);
+	if (res < 0)
+		return res;
+
+	list_walk_entry_forward(&cache->medias->medias, media, node) {
+		if (!(media->type & types))
+			continue;
+
+		res = arsdk_media_copy(list->arena, media, &copy);
+		if (res < 0) {
+			arsdk_media_list_unref(list);
+			return res;
+		}
+		list_add_before(&list->medias, &copy->node);
+	}
+
+	*ret_list = list;
+	return 0;
+}
+
+static enum arsdk_media_req_status ftp_to_media_status(
+		enum arsdk_ftp_req_status ftp_status)
+{
+	switch (ftp_status) {
+	case ARSDK_FTP_REQ_STATUS_OK:
+		return ARSDK_MEDIA_REQ_STATUS_OK;
+	case ARSDK_FTP_REQ_STATUS_CANCELED:
+		return ARSDK_MEDIA_REQ_STATUS_CANCELED;
+	case ARSDK_FTP_REQ_STATUS_FAILED:
+		return ARSDK_MEDIA_REQ_STATUS_FAILED;
+	case ARSDK_FTP_REQ_STATUS_ABORTED:
+		return ARSDK_MEDIA_REQ_STATUS_ABORTED;
+	default:
+		ARSDK_LOGE("ftp status not known. %d", ftp_status);
+		return ARSDK_MEDIA_REQ_STATUS_FAILED;
+	}
+}
+
+static void req_list_done(struct arsdk_media_req_list *req_list,
+		enum arsdk_media_req_status status,
+		int error)
+{
+	(*req_list->cbs.complete)(req_list->base->itf,
+			req_list,
+			status,
+			error,
+			req_list->cbs.userdata);
+
+	/* cleanup */
+	list_del(&req_list->base->node);
+	arsdk_media_req_list_destroy(req_list);
+}
+
+static void req_list_check_done(struct arsdk_media_req_list *req_list);
+
+/**
+ * Add the medias of the files of a storage root to the result of a "list"
+ * request, grouping the resources of a media, also across the roots.
+ */
+static int req_list_add_files(struct arsdk_media_req_list *req_list,
+		struct req_list_root *root,
+		struct arsdk_ftp_file_list *file_list)
+{
+	int res = 0;
+	struct arsdk_ftp_file *next = NULL;
+	struct arsdk_ftp_file *curr = NULL;
+	struct arsdk_media *media = NULL;
+	struct arsdk_media_res *resource = NULL;
+	struct arsdk_media_list *response = req_list->response;
+	const char *name = NULL;
+	size_t name_len = 0;
+	enum arsdk_media_res_type res_type;
+	uint32_t media_hash = 0;
+	uint32_t types;
+	time_t mtime;
+
+	/* the index is built from all the medias */
+	types = req_list->cache != NULL ? ARSDK_MEDIA_TYPE_ALL :
+			req_list->types;
+
+	/* index the medias by name to group their resources in linear time */
+	res = media_index_reserve(&req_list->index,
+			arsdk_ftp_file_list_get_count(file_list));
+	if (res < 0)
+		return res;
+
+	next = arsdk_ftp_file_list_next_file(file_list, curr);
+	while (next != NULL) {
+		curr = next;
+		next = arsdk_ftp_file_list_next_file(file_list, curr);
+
+		/* a file still written makes the listing not reliable */
+		mtime = arsdk_ftp_file_get_mtime(curr);
+		if (mtime > req_list->newest_mtime)
+			req_list->newest_mtime = mtime;
+
+		/* media filter, before allocating in the arena */
+		res = file_to_res_type(curr, &res_type);
+		if (res < 0 || !filter_type(types, res_type))
+			continue;
+
+		res = file_to_media_name_len(curr, &name_len);
+		if (res < 0)
+			continue;
+
+		/* search the media */
+		name = arsdk_ftp_file_get_name(curr);
+		media_hash = arsdk_media_index_hash(ARSDK_MEDIA_INDEX_HASH_INIT,
+				name, name_len);
+		media = media_index_find(&req_list->index, name, name_len,
+				media_hash);
+
+		if (media == NULL) {
+			/* create the media */
+			res = arsdk_media_new_from_file(response->arena,
+					root->thumb_path, curr, &media);
+			if (res < 0)
+				continue;
+
+			list_add_after(&response->medias, &media->node);
+			media_index_add(&req_list->index, media, media_hash);
 		}
 
+		/* create the resource */
+		res = arsdk_media_res_new_from_file(response->arena,
+				root->media_path, curr, &resource);
+		if (res < 0)
+			continue;
+
 		list_add_after(&media->res, &resource->node);
-		free(media_name);
+	}
+
+	return 0;
+}
+
+static void root_list_complete_cb(struct arsdk_ftp_itf *itf,
+			struct arsdk_ftp_req_list *req,
+			enum arsdk_ftp_req_status status,
+			int error,
+			void *userdata)
+{
+	struct req_list_root *root = userdata;
+	struct arsdk_media_req_list *req_list = NULL;
+	int res = 0;
+
+	ARSDK_RETURN_IF_FAILED(root != NULL, -EINVAL);
+
+	req_list = root->req_list;
+	root->ftp_list_req = NULL;
+	req_list->pending--;
+
+	if (req_list->base->is_aborted) {
+		req_list->status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
+	} else if (status == ARSDK_FTP_REQ_STATUS_CANCELED ||
+		   status == ARSDK_FTP_REQ_STATUS_ABORTED) {
+		req_list->status = ftp_to_media_status(status);
+		req_list->error = error;
+	} else if (req_list->status != ARSDK_MEDIA_REQ_STATUS_OK) {
+		/* result not used */
+	} else if (status != ARSDK_FTP_REQ_STATUS_OK || req == NULL) {
+		/* a removable storage can be missing */
+		ARSDK_LOGW("storage %s not listed", root->media_path);
+		req_list->error = error;
+	} else {
+		res = req_list_add_files(req_list, root,
+				arsdk_ftp_req_list_get_result(req));
+		if (res < 0) {
+			req_list->status = ARSDK_MEDIA_REQ_STATUS_FAILED;
+			req_list->error = res;
+		} else {
+			root->listed = 1;
+			req_list->listed_nb++;
+		}
+	}
+
+	req_list_check_done(req_list);
+}
+
+static int req_list_send(struct arsdk_media_req_list *req_list)
+{
+	int res = 0;
+	size_t i = 0;
+	struct arsdk_ftp_req_list_cbs ftp_cbs;
+	struct req_list_root *root = NULL;
+
+	res = arsdk_media_list_new(&req_list->response);
+	if (res < 0)
+		return res;
+
+	/* a folder modified just before its stat may still be modified,
+	 * the listing is trusted only once far enough from it */
+	req_list->list_time = time(NULL);
+	for (i = 0; i < req_list->roots_nb; i++) {
+		if (req_list->roots[i].dir_mtime > req_list->newest_mtime)
+			req_list->newest_mtime = req_list->roots[i].dir_mtime;
+	}
+
+	memset(&ftp_cbs, 0, sizeof(ftp_cbs));
+	ftp_cbs.complete = &root_list_complete_cb;
+
+	/* the storage roots are listed concurrently */
+	for (i = 0; i < req_list->roots_nb; i++) {
+		root = &req_list->roots[i];
+		ftp_cbs.userdata = root;
+
+		res = arsdk_ftp_itf_create_req_list(req_list->base->itf->ftp,
+				&ftp_cbs, req_list->base->dev_type,
+				ARSDK_FTP_SRV_TYPE_MEDIA, root->media_path,
+				&root->ftp_list_req);
+		if (res < 0) {
+			ARSDK_LOG_ERRNO("arsdk_ftp_itf_create_req_list", -res);
+			req_list->error = res;
+			continue;
+		}
+
+		req_list->pending++;
+	}
+
+	return req_list->pending != 0 ? 0 : res;
+}
+
+/**
+ * Modification time of the media folders of all the storage roots, 0 if
+ * one is unknown.
+ */
+static time_t req_list_dir_mtime(const struct arsdk_media_req_list *req_list)
+{
+	size_t i = 0;
+	uint32_t hash = ARSDK_MEDIA_INDEX_HASH_INIT;
+	time_t mtime;
+
+	if (req_list->roots_nb == 1)
+		return req_list->roots[0].dir_mtime;
+
+	for (i = 0; i < req_list->roots_nb; i++) {
+		mtime = req_list->roots[i].dir_mtime;
+		if (mtime == 0)
+			return 0;
+
+		hash = arsdk_media_index_hash(hash, &mtime, sizeof(mtime));
+	}
+
+	/* a changed folder changes the value, which is never 0 */
+	return (time_t)(hash | 1);
+}
+
+/**
+ * Check whether a media has a resource in a storage root not listed.
+ */
+static int req_list_is_unlisted(const struct arsdk_media_req_list *req_list,
+		const struct arsdk_media *media)
+{
+	size_t i = 0;
+	const struct req_list_root *root = NULL;
+	struct arsdk_media_res *resource = NULL;
+
+	for (i = 0; i < req_list->roots_nb; i++) {
+		root = &req_list->roots[i];
+		if (root->listed)
+			continue;
+
+		list_walk_entry_forward(&media->res, resource, node) {
+			if (strncmp(resource->uri, root->media_path,
+					strlen(root->media_path)) == 0)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Keep in the response the medias of the cache from the storage roots not
+ * listed, they are neither removed from the index nor notified.
+ */
+static int req_list_keep_unlisted(struct arsdk_media_req_list *req_list)
+{
+	int res = 0;
+	struct arsdk_media_list *response = req_list->response;
+	struct arsdk_media *media = NULL;
+	struct arsdk_media *copy = NULL;
+	uint32_t hash;
+
+	list_walk_entry_forward(&req_list->cache->medias->medias, media, node) {
+		if (!req_list_is_unlisted(req_list, media))
+			continue;
+
+		/* listed in another root */
+		hash = arsdk_media_index_hash(ARSDK_MEDIA_INDEX_HASH_INIT,
+				media->name, strlen(media->name));
+		if (media_index_find(&req_list->index, media->name,
+				strlen(media->name), hash) != NULL)
+			continue;
+
+		res = arsdk_media_copy(response->arena, media, &copy);
+		if (res < 0)
+			return res;
+		list_add_before(&response->medias, &copy->node);
+	}
+
+	return 0;
+}
+
+static void req_list_complete(struct arsdk_media_req_list *req_list)
+{
+	int res = 0;
+	struct arsdk_media_list *response = req_list->response;
+	int partial = req_list->listed_nb != req_list->roots_nb;
+
+	/* a storage not listed keeps its medias */
+	if (req_list->cache != NULL && partial &&
+	    req_list->cache->medias != NULL)
+		res = req_list_keep_unlisted(req_list);
+
+	/* the index does not own the medias */
+	media_index_clear(&req_list->index);
+
+	if (res < 0) {
+		req_list_done(req_list, ARSDK_MEDIA_REQ_STATUS_FAILED, res);
+		return;
+	}
+
+	if (req_list->cache == NULL) {
+		req_list->result = response;
+		req_list->response = NULL;
+		req_list_done(req_list, ARSDK_MEDIA_REQ_STATUS_OK, 0);
+		return;
+	}
+
+	if (partial && req_list->cache->medias == NULL) {
+		/* the medias of the index are not known by storage root, it
+		 * is not refreshed but only invalidated */
+		res = arsdk_media_index_invalidate(req_list->cache->index);
+		if (res < 0)
+			ARSDK_LOG_ERRNO("arsdk_media_index_invalidate", -res);
+		arsdk_media_list_ref(response);
+		req_list->cache->medias = response;
+	} else {
+		/* a partial listing is not trusted by the next one */
+		media_cache_refresh(req_list->cache, req_list->base->itf,
+				response, partial ? 0 : req_list->dir_mtime,
+				req_list->list_time, req_list->newest_mtime);
+	}
+
+	res = media_cache_get_result(req_list->cache, req_list->types,
+			&req_list->result);
+	req_list_done(req_list, res < 0 ? ARSDK_MEDIA_REQ_STATUS_FAILED :
+			ARSDK_MEDIA_REQ_STATUS_OK, res);
+}
+
+static void req_list_check_done(struct arsdk_media_req_list *req_list)
+{
+	int res = 0;
+	struct media_cache *cache = req_list->cache;
+
+	if (req_list->busy != 0 || req_list->pending != 0)
+		return;
+
+	if (req_list->status != ARSDK_MEDIA_REQ_STATUS_OK) {
+		req_list_done(req_list, req_list->status, req_list->error);
+		return;
+	}
+
+	if (req_list->response != NULL) {
+		/* listing done, it fails if no storage could be listed */
+		if (req_list->listed_nb == 0) {
+			req_list_done(req_list, ARSDK_MEDIA_REQ_STATUS_FAILED,
+					req_list->error);
+			return;
+		}
+
+		req_list_complete(req_list);
+		return;
+	}
+
+	/* the medias of the index are given if the folders are unchanged,
+	 * they are listed again if a modification time is unknown or was too
+	 * close to the last listing */
+	req_list->dir_mtime = req_list_dir_mtime(req_list);
+	if (cache->medias != NULL &&
+	    arsdk_media_index_is_current(cache->index, req_list->dir_mtime)) {
+		res = media_cache_get_result(cache, req_list->types,
+				&req_list->result);
+		req_list_done(req_list, res < 0 ?
+				ARSDK_MEDIA_REQ_STATUS_FAILED :
+				ARSDK_MEDIA_REQ_STATUS_OK, res);
+		return;
+	}
+
+	res = req_list_send(req_list);
+	if (res < 0)
+		req_list_done(req_list, ARSDK_MEDIA_REQ_STATUS_FAILED, res);
+}
+
+static void dir_stat_complete_cb(struct arsdk_ftp_itf *itf,
+			struct arsdk_ftp_req_stat *req,
+			enum arsdk_ftp_req_status status,
+			int error,
+			size_t size,
+			time_t mtime,
+			void *userdata)
+{
+	struct req_list_root *root = userdata;
+	struct arsdk_media_req_list *req_list = NULL;
+
+	ARSDK_RETURN_IF_FAILED(root != NULL, -EINVAL);
+
+	req_list = root->req_list;
+	root->ftp_stat_req = NULL;
+	req_list->pending--;
+
+	if (req_list->base->is_aborted) {
+		req_list->status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
+	} else if (status == ARSDK_FTP_REQ_STATUS_CANCELED ||
+		   status == ARSDK_FTP_REQ_STATUS_ABORTED) {
+		req_list->status = ftp_to_media_status(status);
+		req_list->error = error;
+	}
+
+	root->dir_mtime = status == ARSDK_FTP_REQ_STATUS_OK ? mtime : 0;
+	req_list_check_done(req_list);
+}
+
+static int req_list_send_stat(struct arsdk_media_req_list *req_list)
+{
+	int res = 0;
+	size_t i = 0;
+	struct arsdk_ftp_req_stat_cbs ftp_cbs;
+	struct req_list_root *root = NULL;
+
+	memset(&ftp_cbs, 0, sizeof(ftp_cbs));
+	ftp_cbs.complete = &dir_stat_complete_cb;
+
+	for (i = 0; i < req_list->roots_nb; i++) {
+		root = &req_list->roots[i];
+		ftp_cbs.userdata = root;
+
+		/* an unknown modification time only forces the listing */
+		res = arsdk_ftp_itf_create_req_stat(req_list->base->itf->ftp,
+				&ftp_cbs, req_list->base->dev_type,
+				ARSDK_FTP_SRV_TYPE_MEDIA, root->media_path,
+				&root->ftp_stat_req);
+		if (res < 0) {
+			ARSDK_LOG_ERRNO("arsdk_ftp_itf_create_req_stat", -res);
+			continue;
+		}
+
+		req_list->pending++;
+	}
+
+	return req_list->pending != 0 ? 0 : res;
+}
+
+/**
+ * Get the storage roots of a type of device.
+ */
+static const struct media_roots *media_roots_get(struct arsdk_media_itf *itf,
+		enum arsdk_device_type dev_type)
+{
+	static char *default_roots[] = {ROOT_FLD};
+	static const struct media_roots default_cfg = {
+		.roots = default_roots,
+		.count = 1,
+	};
+	const struct media_roots *cfg = NULL;
+
+	list_walk_entry_forward(&itf->roots, cfg, node) {
+		if (cfg->dev_type == dev_type)
+			return cfg;
+	}
+
+	return &default_cfg;
+}
+
+static int req_list_init_roots(struct arsdk_media_req_list *req_list)
+{
+	int res = 0;
+	size_t i = 0;
+	const struct media_roots *cfg = NULL;
+	struct req_list_root *root = NULL;
+
+	cfg = media_roots_get(req_list->base->itf, req_list->base->dev_type);
+
+	req_list->roots = calloc(cfg->count, sizeof(*req_list->roots));
+	if (req_list->roots == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < cfg->count; i++) {
+		root = &req_list->roots[i];
+		root->req_list = req_list;
+		req_list->roots_nb++;
+
+		res = asprintf(&root->media_path, "%s%s/%s", cfg->roots[i],
+				req_list->base->dev_fld, MEDIA_FLD);
+		if (res < 0) {
+			root->media_path = NULL;
+			return -ENOMEM;
+		}
+
+		res = asprintf(&root->thumb_path, "%s%s/%s", cfg->roots[i],
+				req_list->base->dev_fld, THUMB_FLD);
+		if (res < 0) {
+			root->thumb_path = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+int arsdk_media_itf_create_req_list(
+		struct arsdk_media_itf *itf,
+		const struct arsdk_media_req_list_cbs *cbs,
+		uint32_t types,
+		enum arsdk_device_type dev_type,
+		struct arsdk_media_req_list **ret_req)
+{
+	int res = 0;
+	struct arsdk_media_req_list *req_list = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_req != NULL, -EINVAL);
+	*ret_req = NULL;
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs->complete != NULL, -EINVAL);
+
+	/* Allocate structure */
+	req_list = calloc(1, sizeof(*req_list));
+	if (req_list == NULL)
+		return -ENOMEM;
+
+	res = req_new(itf, req_list, ARSDK_MEDIA_REQ_LIST, dev_type,
+			&req_list->base);
+	if (res < 0)
+		goto error;
+
+	req_list->cbs = *cbs;
+	req_list->types = types;
+	req_list->status = ARSDK_MEDIA_REQ_STATUS_OK;
+
+	res = req_list_init_roots(req_list);
+	if (res < 0)
+		goto error;
+
+	if (itf->index.dir != NULL) {
+		/* check the media folders changed before listing them */
+		res = media_cache_get(itf, req_list->base->dev_fld,
+				&req_list->cache);
+		if (res < 0)
+			goto error;
+
+		res = req_list_send_stat(req_list);
+	} else {
+		res = req_list_send(req_list);
+	}
+	if (res < 0)
+		goto error;
+
+	list_add_after(&itf->reqs, &req_list->base->node);
+	*ret_req = req_list;
+	return 0;
+
+error:
+	arsdk_media_req_list_destroy(req_list);
+	return res;
+}
+
+int arsdk_media_req_list_cancel(struct arsdk_media_req_list *req)
+{
+	size_t i = 0;
+	struct req_list_root *root = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base->itf != NULL, -EINVAL);
+
+	/* canceled requests may complete synchronously */
+	req->busy++;
+	for (i = 0; i < req->roots_nb; i++) {
+		root = &req->roots[i];
+		if (root->ftp_stat_req != NULL)
+			arsdk_ftp_req_stat_cancel(root->ftp_stat_req);
+		if (root->ftp_list_req != NULL)
+			arsdk_ftp_req_list_cancel(root->ftp_list_req);
+	}
+	req->busy--;
+
+	req_list_check_done(req);
+	return 0;
+}
+
+int arsdk_media_itf_set_index(struct arsdk_media_itf *itf,
+		const char *dir,
+		const struct arsdk_media_index_cbs *cbs)
+{
+	struct arsdk_media_req_base *req = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+
+	/* the pending "list" requests use the current index */
+	list_walk_entry_forward(&itf->reqs, req, node) {
+		if (req->type == ARSDK_MEDIA_REQ_LIST)
+			return -EBUSY;
+	}
+
+	media_caches_clear(itf);
+	free(itf->index.dir);
+	itf->index.dir = NULL;
+	memset(&itf->index.cbs, 0, sizeof(itf->index.cbs));
+
+	if (dir == NULL)
+		return 0;
+
+	itf->index.dir = xstrdup(dir);
+	if (itf->index.dir == NULL)
+		return -ENOMEM;
+
+	if (cbs != NULL)
+		itf->index.cbs = *cbs;
+
+	return 0;
+}
+
+static void media_roots_destroy(struct media_roots *cfg)
+{
+	size_t i = 0;
+
+	for (i = 0; i < cfg->count; i++)
+		free(cfg->roots[i]);
+
+	free(cfg->roots);
+	free(cfg);
+}
+
+static void media_roots_clear(struct arsdk_media_itf *itf)
+{
+	struct media_roots *cfg = NULL;
+	struct media_roots *cfg_tmp = NULL;
+
+	list_walk_entry_forward_safe(&itf->roots, cfg, cfg_tmp, node) {
+		list_del(&cfg->node);
+		media_roots_destroy(cfg);
+	}
+}
+
+int arsdk_media_itf_set_storage_roots(struct arsdk_media_itf *itf,
+		enum arsdk_device_type dev_type,
+		const char *const *roots,
+		size_t count)
+{
+	size_t i = 0;
+	size_t len = 0;
+	struct media_roots *cfg = NULL;
+	struct media_roots *pos = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(roots != NULL || count == 0, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(count <= ARSDK_MEDIA_STORAGE_ROOTS_MAX,
+			-EINVAL);
+
+	for (i = 0; i < count; i++) {
+		ARSDK_RETURN_ERR_IF_FAILED(roots[i] != NULL &&
+				roots[i][0] == '/', -EINVAL);
+	}
+
+	if (count > 0) {
+		cfg = calloc(1, sizeof(*cfg));
+		if (cfg == NULL)
+			return -ENOMEM;
+
+		cfg->dev_type = dev_type;
+		cfg->roots = calloc(count, sizeof(*cfg->roots));
+		if (cfg->roots == NULL) {
+			free(cfg);
+			return -ENOMEM;
+		}
+
+		for (; cfg->count < count; cfg->count++) {
+			/* the media folders are appended to the roots */
+			len = strlen(roots[cfg->count]);
+			if (asprintf(&cfg->roots[cfg->count], "%s%s",
+					roots[cfg->count],
+					roots[cfg->count][len - 1] == '/' ?
+					"" : "/") < 0) {
+				cfg->roots[cfg->count] = NULL;
+				media_roots_destroy(cfg);
+				return -ENOMEM;
+			}
+		}
+	}
+
+	/* replace the previous roots, the pending requests keep theirs */
+	list_walk_entry_forward(&itf->roots, pos, node) {
+		if (pos->dev_type == dev_type) {
+			list_del(&pos->node);
+			media_roots_destroy(pos);
+			break;
+		}
+	}
+
+	if (cfg != NULL)
+		list_add_before(&itf->roots, &cfg->node);
+
+	return 0;
+}
+
+static int arsdk_media_req_list_abort(struct arsdk_media_req_list *req)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
+
+	req->base->is_aborted = 1;
+	return arsdk_media_req_list_cancel(req);
+}
+
+enum arsdk_device_type arsdk_media_req_list_get_dev_type(
+		const struct arsdk_media_req_list *req)
+{
+	if ((req == NULL) ||
+	    (req->base == NULL))
+		return ARSDK_DEVICE_TYPE_UNKNOWN;
+
+	return req->base->dev_type;
+}
+
+struct arsdk_media_list *arsdk_media_req_list_get_result(
+		struct arsdk_media_req_list *req)
+{
+	if (req == NULL)
+		return NULL;
+
+	return req->result;
+}
+
+struct arsdk_media *arsdk_media_list_next_media(
+		struct arsdk_media_list *list,
+		struct arsdk_media *prev)
+{
+	struct list_node *node;
+	struct arsdk_media *next;
+
+	if (!list)
+		return NULL;
+
+	node = list_next(&list->medias, prev ? &prev->node : &list->medias);
+	if (!node)
+		return NULL;
+
+	next = list_entry(node, struct arsdk_media, node);
+	return next;
+}
+
+size_t arsdk_media_list_get_count(
+		struct arsdk_media_list *list)
+{
+	if (!list)
+		return 0;
+
+	return list_length(&list->medias);
+}
+
+void arsdk_media_list_ref(struct arsdk_media_list *list)
+{
+	ARSDK_RETURN_IF_FAILED(list != NULL, -EINVAL);
+
+	list->refcount++;
+}
+
+
+void arsdk_media_list_unref(struct arsdk_media_list *list)
+{
+	ARSDK_RETURN_IF_FAILED(list != NULL, -EINVAL);
+
+	list->refcount--;
+
+	/* Free resource when ref count reaches 0 */
+	if (list->refcount == 0)
+		(void)arsdk_media_list_destroy(list);
+}
+
+/**
+ */
+static void arsdk_media_req_download_destroy(
+	struct arsdk_media_req_download *req)
+{
+	ARSDK_RETURN_IF_FAILED(req != NULL, -EINVAL);
+
+	if (req->ftp_get_req != NULL)
+		ARSDK_LOGW("request %p still pending", req);
+
+	req_destroy(req->base);
+	free(req->uri);
+	free(req->local_path);
+	free(req);
+}
+
+static void ftpget_progress_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_get *req,
+		float percent,
+		void *userdata)
+{
+	struct arsdk_media_req_download *req_dl = userdata;
+
+	ARSDK_RETURN_IF_FAILED(req_dl != NULL, -EINVAL);
+
+	(*req_dl->cbs.progress)(req_dl->base->itf,
+			req_dl,
+			percent,
+			req_dl->cbs.userdata);
+
+}
+
+static void ftpget_complete_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_get *req,
+		enum arsdk_ftp_req_status status,
+		int error,
+		void *userdata)
+{
+	struct arsdk_media_req_download *req_dl = userdata;
+	enum arsdk_media_req_status media_status = ftp_to_media_status(status);
+
+	ARSDK_RETURN_IF_FAILED(req_dl != NULL, -EINVAL);
+
+	if (req_dl->base->is_aborted)
+		media_status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
+
+	(*req_dl->cbs.complete)(req_dl->base->itf,
+			req_dl,
+			media_status,
+			error,
+			req_dl->cbs.userdata);
+
+	/* cleanup */
+	req_dl->ftp_get_req = NULL;
+	list_del(&req_dl->base->node);
+	arsdk_media_req_download_destroy(req_dl);
+}
+
+int arsdk_media_itf_create_req_download(
+		struct arsdk_media_itf *itf,
+		const struct arsdk_media_req_download_cbs *cbs,
+		const char *uri,
+		const char *local_path,
+		enum arsdk_device_type dev_type,
+		uint8_t is_resume,
+		struct arsdk_media_req_download **ret_req)
+{
+	int res = 0;
+	struct arsdk_media_req_download *req_dl = NULL;
+	struct arsdk_ftp_req_get_cbs ftp_cbs;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_req != NULL, -EINVAL);
+	*ret_req = NULL;
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs->complete != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs->progress != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(uri != NULL, -EINVAL);
+
+	/* Allocate structure */
+	req_dl = calloc(1, sizeof(*req_dl));
+	if (req_dl == NULL)
+		return -ENOMEM;
+
+	res = req_new(itf, req_dl, ARSDK_MEDIA_REQ_DOWNLOAD, dev_type,
+			&req_dl->base);
+	if (res < 0)
+		goto error;
+
+	req_dl->cbs = *cbs;
+	req_dl->uri = xstrdup(uri);
+	req_dl->local_path = xstrdup(local_path);
+
+	ftp_cbs.userdata = req_dl;
+	ftp_cbs.complete = &ftpget_complete_cb;
+	ftp_cbs.progress = &ftpget_progress_cb;
+
+	res =  arsdk_ftp_itf_create_req_get(itf->ftp, &ftp_cbs, dev_type,
+			ARSDK_FTP_SRV_TYPE_MEDIA, uri, local_path, is_resume,
+			&req_dl->ftp_get_req);
+	if (res < 0)
+		goto error;
+
+	list_add_after(&itf->reqs, &req_dl->base->node);
+	*ret_req = req_dl;
+	return 0;
+
+error:
+	arsdk_media_req_download_destroy(req_dl);
+	return res;
+}
+
+int arsdk_media_req_download_cancel(struct arsdk_media_req_download *req)
+{
+	struct arsdk_media_itf *itf = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base->itf != NULL, -EINVAL);
+
+	itf = req->base->itf;
+	return arsdk_ftp_req_get_cancel(req->ftp_get_req);
+}
+
+static int arsdk_media_req_download_abort(
+		struct arsdk_media_req_download *req)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
+
+	req->base->is_aborted = 1;
+	return arsdk_media_req_download_cancel(req);
+}
+
+const char *arsdk_media_req_download_get_uri(
+		const struct arsdk_media_req_download *req)
+{
+	if (!req)
+		return NULL;
+
+	return req->uri;
+}
+
+const char *arsdk_media_req_download_get_local_path(
+		const struct arsdk_media_req_download *req)
+{
+	if (!req)
+		return NULL;
+
+	return req->local_path;
+}
+
+struct pomp_buffer *arsdk_media_req_download_get_buffer(
+		const struct arsdk_media_req_download *req)
+{
+	if ((req == NULL) ||
+	    (req->ftp_get_req == NULL))
+		return NULL;
+
+	return arsdk_ftp_req_get_get_buffer(req->ftp_get_req);
+}
+
+enum arsdk_device_type arsdk_media_req_download_get_dev_type(
+		const struct arsdk_media_req_download *req)
+{
+	if ((req == NULL) ||
+	    (req->base == NULL))
+		return ARSDK_DEVICE_TYPE_UNKNOWN;
+
+	return req->base->dev_type;
+}
+
+struct arsdk_media_res *arsdk_media_next_res(
+		struct arsdk_media *media,
+		struct arsdk_media_res *prev)
+{
+	struct list_node *node;
+	struct arsdk_media_res *next;
+
+	if (!media)
+		return NULL;
+
+	node = list_next(&media->res, prev ? &prev->node : &media->res);
+	if (!node)
+		return NULL;
+
+	next = list_entry(node, struct arsdk_media_res, node);
+	return next;
+	return NULL;
+}
+
+size_t arsdk_media_get_res_count(const struct arsdk_media *media)
+{
+	if (!media)
+		return 0;
+
+	return list_length(&media->res);
+}
+
+/**
+ */
+static void arsdk_media_req_delete_destroy(
+	struct arsdk_media_req_delete *req)
+{
+	ARSDK_RETURN_IF_FAILED(req != NULL, -EINVAL);
+
+	if (req->reqs_nb != 0)
+		ARSDK_LOGW("request %p still pending", req);
+
+	free(req->reqs);
+	arsdk_media_unref(req->media);
+	req_destroy(req->base);
+	free(req);
+}
+
+static void ftpdel_complete_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_delete *req,
+		enum arsdk_ftp_req_status status,
+		int error,
+		void *userdata)
+{
+	struct arsdk_media_req_delete *req_del = userdata;
+	size_t i = 0;
+
+	ARSDK_RETURN_IF_FAILED(req_del != NULL, -EINVAL);
+
+	if (req_del->base->is_aborted) {
+		req_del->status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
+		goto end;
+	}
+
+	if (req_del->status != ARSDK_MEDIA_REQ_STATUS_OK)
+		goto end;
+
+	switch (status) {
+	case ARSDK_FTP_REQ_STATUS_FAILED:
+		break;
+	case ARSDK_FTP_REQ_STATUS_CANCELED:
+	case ARSDK_FTP_REQ_STATUS_ABORTED:
+		req_del->status = ftp_to_media_status(status);
+		break;
+	case ARSDK_FTP_REQ_STATUS_OK:
+		break;
+	default:
+		break;
 	}
 
 end:
-	req_list->ftp_list_req = NULL;
+	/* Remove request form the array */
+	for (i = 0; i < req_del->reqs_size; i++) {
+		if (req_del->reqs[i] == req) {
+			req_del->reqs[i] = NULL;
+			req_del->reqs_nb--;
+			break;
+		}
+	}
 
-	(*req_list->cbs.complete)(req_list->base->itf,
-			req_list,
-			media_status,
-			res,
-			req_list->cbs.userdata);
+	if (req_del->reqs_nb != 0)
+		return;
+
+	(*req_del->cbs.complete)(req_del->base->itf,
+			req_del,
+			req_del->status,
+			req_del->error,
+			req_del->cbs.userdata);
 
 	/* cleanup */
-	list_del(&req_list->base->node);
-	arsdk_media_req_list_destroy(req_list);
+	list_del(&req_del->base->node);
+	arsdk_media_req_delete_destroy(req_del);
 }
 
-int arsdk_media_itf_create_req_list(
-		struct arsdk_media_itf *itf,
-		const struct arsdk_media_req_list_cbs *cbs,
-		uint32_t types,
-		enum arsdk_device_type dev_type,
-		struct arsdk_media_req_list **ret_req)
+int arsdk_media_itf_create_req_delete(
+	struct arsdk_media_itf *itf,
+	const struct arsdk_media_req_delete_cbs *cbs,
+	struct arsdk_media *media,
+	enum arsdk_device_type dev_type,
+	struct arsdk_media_req_delete **ret_req)
 {
 	int res = 0;
-	struct arsdk_media_req_list *req_list = NULL;
-	struct arsdk_ftp_req_list_cbs ftp_cbs;
-	char dev_fld_path[500] = "";
+	struct arsdk_media_req_delete *req_del = NULL;
+	struct arsdk_ftp_req_delete_cbs ftp_cbs;
+	struct arsdk_media_res *resource = NULL;
+	const char *uri = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_req != NULL, -EINVAL);
 	*ret_req = NULL;
 	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(cbs != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(cbs->complete != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(media != NULL, -EINVAL);
 
 	/* Allocate structure */
-	req_list = calloc(1, sizeof(*req_list));
-	if (req_list == NULL)
+	req_del = calloc(1, sizeof(*req_del));
+	if (req_del == NULL)
 		return -ENOMEM;
 
-	res = req_new(itf, req_list, ARSDK_MEDIA_REQ_LIST, dev_type,
-			&req_list->base);
+	res = req_new(itf, req_del, ARSDK_MEDIA_REQ_DELETE, dev_type,
+			&req_del->base);
 	if (res < 0)
 		goto error;
 
-	req_list->cbs = *cbs;
-	req_list->types = types;
+	req_del->reqs_size = arsdk_media_get_res_count(media);
+	req_del->reqs = calloc(req_del->reqs_size, sizeof(*req_del->reqs));
+	if (req_del->reqs == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
 
-	ftp_cbs.userdata = req_list;
-	ftp_cbs.complete = &pfld_list_complete_cb;
+	arsdk_media_ref(media);
+	req_del->media = media;
+	req_del->status = ARSDK_MEDIA_REQ_STATUS_OK;
+	req_del->cbs = *cbs;
 
-	snprintf(dev_fld_path, sizeof(dev_fld_path), "%s%s/%s", ROOT_FLD,
-			req_list->base->dev_fld, MEDIA_FLD);
+	ftp_cbs.userdata = req_del;
+	ftp_cbs.complete = &ftpdel_complete_cb;
+	resource = arsdk_media_next_res(media, resource);
+	while (resource != NULL) {
+		uri = arsdk_media_res_get_uri(resource);
 
-	res =  arsdk_ftp_itf_create_req_list(itf->ftp, &ftp_cbs, dev_type,
-			ARSDK_FTP_SRV_TYPE_MEDIA, dev_fld_path,
-			&req_list->ftp_list_req);
-	if (res < 0)
-		goto error;
+		res =  arsdk_ftp_itf_create_req_delete(itf->ftp, &ftp_cbs,
+				dev_type,
+				ARSDK_FTP_SRV_TYPE_MEDIA, uri,
+				&req_del->reqs[req_del->reqs_nb]);
+		if (res < 0)
+			goto error;
 
-	list_add_after(&itf->reqs, &req_list->base->node);
-	*ret_req = req_list;
+		req_del->reqs_nb++;
+		resource = arsdk_media_next_res(media, resource);
+	}
+
+	list_add_after(&itf->reqs, &req_del->base->node);
+	*ret_req = req_del;
 	return 0;
 
 error:
-	arsdk_media_req_list_destroy(req_list);
+	arsdk_media_req_delete_destroy(req_del);
 	return res;
 }
 
-int arsdk_media_req_list_cancel(struct arsdk_media_req_list *req)
+static int arsdk_media_req_delete_cancel(struct arsdk_media_req_delete *req)
 {
-	struct arsdk_media_itf *itf = NULL;
+	size_t i = 0;
+
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(req->base->itf != NULL, -EINVAL);
 
-	itf = req->base->itf;
-	return arsdk_ftp_req_list_cancel(req->ftp_list_req);
+	for (i = 0; i < req->reqs_size; i++) {
+		if (req->reqs[i] == NULL)
+			continue;
+
+		arsdk_ftp_req_delete_cancel(req->reqs[i]);
+	}
+
+	return 0;
 }
 
-static int arsdk_media_req_list_abort(struct arsdk_media_req_list *req)
+static int arsdk_media_req_delete_abort(struct arsdk_media_req_delete *req)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
 
 	req->base->is_aborted = 1;
-	return arsdk_media_req_list_cancel(req);
+	return arsdk_media_req_delete_cancel(req);
 }
 
-enum arsdk_device_type arsdk_media_req_list_get_dev_type(
-		const struct arsdk_media_req_list *req)
+const struct arsdk_media *arsdk_media_req_delete_get_media(
+		const struct arsdk_media_req_delete *req)
+{
+	if (!req)
+		return NULL;
+
+	return req->media;
+}
+
+enum arsdk_device_type arsdk_media_req_delete_get_dev_type(
+		const struct arsdk_media_req_delete *req)
 {
 	if ((req == NULL) ||
 	    (req->base == NULL))
@@ -928,225 +2365,319 @@ enum arsdk_device_type arsdk_media_req_list_get_dev_type(
 	return req->base->dev_type;
 }
 
-struct arsdk_media_list *arsdk_media_req_list_get_result(
-		struct arsdk_media_req_list *req)
+/**
+ */
+static void arsdk_media_req_delete_batch_destroy(
+	struct arsdk_media_req_delete_batch *req)
 {
-	if (req == NULL)
-		return NULL;
-
-	return req->result;
-}
+	size_t i = 0;
 
-struct arsdk_media *arsdk_media_list_next_media(
-		struct arsdk_media_list *list,
-		struct arsdk_media *prev)
-{
-	struct list_node *node;
-	struct arsdk_media *next;
+	ARSDK_RETURN_IF_FAILED(req != NULL, -EINVAL);
 
-	if (!list)
-		return NULL;
+	if (req->inflight != 0)
+		ARSDK_LOGW("request %p still pending", req);
 
-	node = list_next(&list->medias, prev ? &prev->node : &list->medias);
-	if (!node)
-		return NULL;
+	for (i = 0; i < req->items_nb; i++)
+		arsdk_media_unref(req->items[i].media);
 
-	next = list_entry(node, struct arsdk_media, node);
-	return next;
+	free(req->items);
+	req_destroy(req->base);
+	free(req);
 }
 
-size_t arsdk_media_list_get_count(
-		struct arsdk_media_list *list)
-{
-	if (!list)
-		return 0;
-
-	return list_length(&list->medias);
-}
+static void ftpdel_batch_complete_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_delete *req,
+		enum arsdk_ftp_req_status status,
+		int error,
+		void *userdata);
 
-void arsdk_media_list_ref(struct arsdk_media_list *list)
+static int delete_batch_fill(struct arsdk_media_req_delete_batch *req)
 {
-	ARSDK_RETURN_IF_FAILED(list != NULL, -EINVAL);
+	int res = 0;
+	size_t i = 0;
+	struct delete_batch_item *item = NULL;
+	struct arsdk_ftp_req_delete_cbs ftp_cbs;
 
-	list->refcount++;
-}
+	memset(&ftp_cbs, 0, sizeof(ftp_cbs));
+	ftp_cbs.userdata = req;
+	ftp_cbs.complete = &ftpdel_batch_complete_cb;
+
+	while (!req->is_stopped &&
+	       req->inflight < DELETE_BATCH_WINDOW &&
+	       req->next_item < req->items_nb) {
+		/* find a free slot */
+		for (i = 0; i < DELETE_BATCH_WINDOW; i++) {
+			if (req->slots[i].req == NULL)
+				break;
+		}
 
+		item = &req->items[req->next_item];
+		res = arsdk_ftp_itf_create_req_delete(req->base->itf->ftp,
+				&ftp_cbs, req->base->dev_type,
+				ARSDK_FTP_SRV_TYPE_MEDIA,
+				arsdk_media_res_get_uri(item->next_res),
+				&req->slots[i].req);
+		if (res < 0)
+			return res;
 
-void arsdk_media_list_unref(struct arsdk_media_list *list)
-{
-	ARSDK_RETURN_IF_FAILED(list != NULL, -EINVAL);
+		req->slots[i].item = req->next_item;
+		req->inflight++;
+		item->pending++;
 
-	list->refcount--;
+		item->next_res = arsdk_media_next_res(item->media,
+				item->next_res);
+		if (item->next_res == NULL)
+			req->next_item++;
+	}
 
-	/* Free resource when ref count reaches 0 */
-	if (list->refcount == 0)
-		(void)arsdk_media_list_destroy(list);
+	return 0;
 }
 
-/**
- */
-static void arsdk_media_req_download_destroy(
-	struct arsdk_media_req_download *req)
+static void delete_batch_item_done(struct arsdk_media_req_delete_batch *req,
+		struct delete_batch_item *item)
 {
-	ARSDK_RETURN_IF_FAILED(req != NULL, -EINVAL);
+	/* resources left when the batch stopped */
+	if (item->next_res != NULL && item->status == ARSDK_MEDIA_REQ_STATUS_OK) {
+		item->status = req->status;
+		item->error = req->error;
+	}
 
-	if (req->ftp_get_req != NULL)
-		ARSDK_LOGW("request %p still pending", req);
+	item->is_notified = 1;
+	req->done_nb++;
+	if (item->status != ARSDK_MEDIA_REQ_STATUS_OK)
+		req->failed_nb++;
 
-	req_destroy(req->base);
-	free(req->uri);
-	free(req->local_path);
-	free(req);
+	if (req->cbs.progress == NULL)
+		return;
+
+	(*req->cbs.progress)(req->base->itf,
+			req,
+			item->media,
+			item->status,
+			item->error,
+			req->done_nb,
+			req->items_nb,
+			req->cbs.userdata);
 }
 
-static void ftpget_progress_cb(struct arsdk_ftp_itf *itf,
-		struct arsdk_ftp_req_get *req,
-		float percent,
-		void *userdata)
+static void delete_batch_check_done(struct arsdk_media_req_delete_batch *req)
 {
-	struct arsdk_media_req_download *req_dl = userdata;
+	size_t i = 0;
+	enum arsdk_media_req_status status = req->status;
+	int error = req->error;
 
-	ARSDK_RETURN_IF_FAILED(req_dl != NULL, -EINVAL);
+	if (req->busy != 0 || req->inflight != 0)
+		return;
 
-	(*req_dl->cbs.progress)(req_dl->base->itf,
-			req_dl,
-			percent,
-			req_dl->cbs.userdata);
+	if (!req->is_stopped && req->next_item < req->items_nb)
+		return;
+
+	/* notify medias never sent */
+	req->busy++;
+	for (i = 0; i < req->items_nb; i++) {
+		if (!req->items[i].is_notified)
+			delete_batch_item_done(req, &req->items[i]);
+	}
+	req->busy--;
 
+	if (status == ARSDK_MEDIA_REQ_STATUS_OK && req->failed_nb != 0) {
+		status = ARSDK_MEDIA_REQ_STATUS_FAILED;
+		error = -EIO;
+	}
+
+	(*req->cbs.complete)(req->base->itf,
+			req,
+			status,
+			error,
+			req->cbs.userdata);
+
+	/* cleanup */
+	list_del(&req->base->node);
+	arsdk_media_req_delete_batch_destroy(req);
 }
 
-static void ftpget_complete_cb(struct arsdk_ftp_itf *itf,
-		struct arsdk_ftp_req_get *req,
+static void ftpdel_batch_complete_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_delete *req,
 		enum arsdk_ftp_req_status status,
 		int error,
 		void *userdata)
 {
-	struct arsdk_media_req_download *req_dl = userdata;
-	enum arsdk_media_req_status media_status = ftp_to_media_status(status);
+	int res = 0;
+	size_t i = 0;
+	struct arsdk_media_req_delete_batch *req_batch = userdata;
+	struct delete_batch_item *item = NULL;
 
-	ARSDK_RETURN_IF_FAILED(req_dl != NULL, -EINVAL);
+	ARSDK_RETURN_IF_FAILED(req_batch != NULL, -EINVAL);
 
-	if (req_dl->base->is_aborted)
-		media_status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
+	for (i = 0; i < DELETE_BATCH_WINDOW; i++) {
+		if (req_batch->slots[i].req == req)
+			break;
+	}
+	ARSDK_RETURN_IF_FAILED(i < DELETE_BATCH_WINDOW, -ENOENT);
+
+	item = &req_batch->items[req_batch->slots[i].item];
+	req_batch->slots[i].req = NULL;
+	req_batch->inflight--;
+	item->pending--;
+
+	if (req_batch->base->is_aborted) {
+		item->status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
+	} else if (item->status == ARSDK_MEDIA_REQ_STATUS_OK &&
+		   status != ARSDK_FTP_REQ_STATUS_OK) {
+		item->status = ftp_to_media_status(status);
+		item->error = error;
+	}
 
-	(*req_dl->cbs.complete)(req_dl->base->itf,
-			req_dl,
-			media_status,
-			error,
-			req_dl->cbs.userdata);
+	req_batch->busy++;
 
-	/* cleanup */
-	req_dl->ftp_get_req = NULL;
-	list_del(&req_dl->base->node);
-	arsdk_media_req_download_destroy(req_dl);
+	if (item->pending == 0 &&
+	    (item->next_res == NULL || req_batch->is_stopped))
+		delete_batch_item_done(req_batch, item);
+
+	res = delete_batch_fill(req_batch);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("delete_batch_fill", -res);
+		req_batch->is_stopped = 1;
+		req_batch->status = ARSDK_MEDIA_REQ_STATUS_FAILED;
+		req_batch->error = res;
+	}
+
+	req_batch->busy--;
+	delete_batch_check_done(req_batch);
 }
 
-int arsdk_media_itf_create_req_download(
-		struct arsdk_media_itf *itf,
-		const struct arsdk_media_req_download_cbs *cbs,
-		const char *uri,
-		const char *local_path,
-		enum arsdk_device_type dev_type,
-		uint8_t is_resume,
-		struct arsdk_media_req_download **ret_req)
+int arsdk_media_itf_create_req_delete_batch(
+	struct arsdk_media_itf *itf,
+	const struct arsdk_media_req_delete_batch_cbs *cbs,
+	struct arsdk_media **medias,
+	size_t count,
+	enum arsdk_device_type dev_type,
+	struct arsdk_media_req_delete_batch **ret_req)
 {
 	int res = 0;
-	struct arsdk_media_req_download *req_dl = NULL;
-	struct arsdk_ftp_req_get_cbs ftp_cbs;
+	size_t i = 0;
+	struct arsdk_media_req_delete_batch *req_batch = NULL;
+	struct delete_batch_item *item = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_req != NULL, -EINVAL);
 	*ret_req = NULL;
 	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(cbs != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(cbs->complete != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(cbs->progress != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(uri != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(medias != NULL || count == 0, -EINVAL);
 
 	/* Allocate structure */
-	req_dl = calloc(1, sizeof(*req_dl));
-	if (req_dl == NULL)
+	req_batch = calloc(1, sizeof(*req_batch));
+	if (req_batch == NULL)
 		return -ENOMEM;
 
-	res = req_new(itf, req_dl, ARSDK_MEDIA_REQ_DOWNLOAD, dev_type,
-			&req_dl->base);
+	res = req_new(itf, req_batch, ARSDK_MEDIA_REQ_DELETE_BATCH, dev_type,
+			&req_batch->base);
 	if (res < 0)
 		goto error;
 
-	req_dl->cbs = *cbs;
-	req_dl->uri = xstrdup(uri);
-	req_dl->local_path = xstrdup(local_path);
+	req_batch->items = calloc(count > 0 ? count : 1,
+			sizeof(*req_batch->items));
+	if (req_batch->items == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
 
-	ftp_cbs.userdata = req_dl;
-	ftp_cbs.complete = &ftpget_complete_cb;
-	ftp_cbs.progress = &ftpget_progress_cb;
+	for (i = 0; i < count; i++) {
+		if (medias[i] == NULL) {
+			res = -EINVAL;
+			goto error;
+		}
 
-	res =  arsdk_ftp_itf_create_req_get(itf->ftp, &ftp_cbs, dev_type,
-			ARSDK_FTP_SRV_TYPE_MEDIA, uri, local_path, is_resume,
-			&req_dl->ftp_get_req);
-	if (res < 0)
+		if (arsdk_media_get_res_count(medias[i]) == 0)
+			continue;
+
+		item = &req_batch->items[req_batch->items_nb++];
+		arsdk_media_ref(medias[i]);
+		item->media = medias[i];
+		item->next_res = arsdk_media_next_res(medias[i], NULL);
+		item->status = ARSDK_MEDIA_REQ_STATUS_OK;
+	}
+
+	if (req_batch->items_nb == 0) {
+		res = -ENOENT;
 		goto error;
+	}
 
-	list_add_after(&itf->reqs, &req_dl->base->node);
-	*ret_req = req_dl;
+	req_batch->status = ARSDK_MEDIA_REQ_STATUS_OK;
+	req_batch->cbs = *cbs;
+
+	res = delete_batch_fill(req_batch);
+	if (res < 0) {
+		if (req_batch->inflight == 0)
+			goto error;
+
+		/* report the failure once the sent deletions are done */
+		ARSDK_LOG_ERRNO("delete_batch_fill", -res);
+		req_batch->is_stopped = 1;
+		req_batch->status = ARSDK_MEDIA_REQ_STATUS_FAILED;
+		req_batch->error = res;
+	}
+
+	list_add_after(&itf->reqs, &req_batch->base->node);
+	*ret_req = req_batch;
 	return 0;
 
 error:
-	arsdk_media_req_download_destroy(req_dl);
+	arsdk_media_req_delete_batch_destroy(req_batch);
 	return res;
 }
 
-int arsdk_media_req_download_cancel(struct arsdk_media_req_download *req)
+int arsdk_media_req_delete_batch_cancel(
+		struct arsdk_media_req_delete_batch *req)
 {
-	struct arsdk_media_itf *itf = NULL;
+	size_t i = 0;
 
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(req->base->itf != NULL, -EINVAL);
 
-	itf = req->base->itf;
-	return arsdk_ftp_req_get_cancel(req->ftp_get_req);
+	if (!req->is_stopped) {
+		req->is_stopped = 1;
+		req->status = req->base->is_aborted ?
+				ARSDK_MEDIA_REQ_STATUS_ABORTED :
+				ARSDK_MEDIA_REQ_STATUS_CANCELED;
+	}
+
+	/* canceled deletions may complete synchronously */
+	req->busy++;
+	for (i = 0; i < DELETE_BATCH_WINDOW; i++) {
+		if (req->slots[i].req == NULL)
+			continue;
+
+		arsdk_ftp_req_delete_cancel(req->slots[i].req);
+	}
+	req->busy--;
+
+	delete_batch_check_done(req);
+	return 0;
 }
 
-static int arsdk_media_req_download_abort(
-		struct arsdk_media_req_download *req)
+static int arsdk_media_req_delete_batch_abort(
+		struct arsdk_media_req_delete_batch *req)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
 
 	req->base->is_aborted = 1;
-	return arsdk_media_req_download_cancel(req);
-}
-
-const char *arsdk_media_req_download_get_uri(
-		const struct arsdk_media_req_download *req)
-{
-	if (!req)
-		return NULL;
-
-	return req->uri;
+	return arsdk_media_req_delete_batch_cancel(req);
 }
 
-const char *arsdk_media_req_download_get_local_path(
-		const struct arsdk_media_req_download *req)
+size_t arsdk_media_req_delete_batch_get_count(
+		const struct arsdk_media_req_delete_batch *req)
 {
 	if (!req)
-		return NULL;
-
-	return req->local_path;
-}
-
-struct pomp_buffer *arsdk_media_req_download_get_buffer(
-		const struct arsdk_media_req_download *req)
-{
-	if ((req == NULL) ||
-	    (req->ftp_get_req == NULL))
-		return NULL;
+		return 0;
 
-	return arsdk_ftp_req_get_get_buffer(req->ftp_get_req);
+	return req->items_nb;
 }
 
-enum arsdk_device_type arsdk_media_req_download_get_dev_type(
-		const struct arsdk_media_req_download *req)
+enum arsdk_device_type arsdk_media_req_delete_batch_get_dev_type(
+		const struct arsdk_media_req_delete_batch *req)
 {
 	if ((req == NULL) ||
 	    (req->base == NULL))
@@ -1155,117 +2686,112 @@ enum arsdk_device_type arsdk_media_req_download_get_dev_type(
 	return req->base->dev_type;
 }
 
-struct arsdk_media_res *arsdk_media_next_res(
-		struct arsdk_media *media,
-		struct arsdk_media_res *prev)
-{
-	struct list_node *node;
-	struct arsdk_media_res *next;
-
-	if (!media)
-		return NULL;
-
-	node = list_next(&media->res, prev ? &prev->node : &media->res);
-	if (!node)
-		return NULL;
-
-	next = list_entry(node, struct arsdk_media_res, node);
-	return next;
-	return NULL;
-}
-
-size_t arsdk_media_get_res_count(const struct arsdk_media *media)
-{
-	if (!media)
-		return 0;
-
-	return list_length(&media->res);
-}
-
 /**
  */
-static void arsdk_media_req_delete_destroy(
-	struct arsdk_media_req_delete *req)
+static void arsdk_media_req_thumb_destroy(struct arsdk_media_req_thumb *req)
 {
 	ARSDK_RETURN_IF_FAILED(req != NULL, -EINVAL);
 
-	if (req->reqs_nb != 0)
+	if (req->waiter != NULL)
 		ARSDK_LOGW("request %p still pending", req);
 
-	free(req->reqs);
-	arsdk_media_unref(req->media);
 	req_destroy(req->base);
+	free(req->uri);
 	free(req);
 }
 
-static void ftpdel_complete_cb(struct arsdk_ftp_itf *itf,
-		struct arsdk_ftp_req_delete *req,
-		enum arsdk_ftp_req_status status,
+static void thumb_fetched_cb(struct arsdk_media_thumb_waiter *waiter,
+		enum arsdk_media_req_status status,
 		int error,
+		struct pomp_buffer *buf,
 		void *userdata)
 {
-	struct arsdk_media_req_delete *req_del = userdata;
-	size_t i = 0;
+	struct arsdk_media_req_thumb *req_thumb = userdata;
 
-	ARSDK_RETURN_IF_FAILED(req_del != NULL, -EINVAL);
+	ARSDK_RETURN_IF_FAILED(req_thumb != NULL, -EINVAL);
 
-	if (req_del->base->is_aborted) {
-		req_del->status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
-		goto end;
-	}
+	req_thumb->waiter = NULL;
+	if (req_thumb->base->is_aborted)
+		status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
 
-	if (req_del->status != ARSDK_MEDIA_REQ_STATUS_OK)
-		goto end;
+	req_thumb->buf = buf;
+	(*req_thumb->cbs.complete)(req_thumb->base->itf,
+			req_thumb,
+			status,
+			error,
+			req_thumb->cbs.userdata);
+	req_thumb->buf = NULL;
 
-	switch (status) {
-	case ARSDK_FTP_REQ_STATUS_FAILED:
-		break;
-	case ARSDK_FTP_REQ_STATUS_CANCELED:
-	case ARSDK_FTP_REQ_STATUS_ABORTED:
-		req_del->status = ftp_to_media_status(status);
-		break;
-	case ARSDK_FTP_REQ_STATUS_OK:
-		break;
-	default:
-		break;
+	/* cleanup */
+	list_del(&req_thumb->base->node);
+	arsdk_media_req_thumb_destroy(req_thumb);
+}
+
+/**
+ * Get the thumbnail resource of a media.
+ */
+static const struct arsdk_media_res *media_get_thumb(
+		const struct arsdk_media *media)
+{
+	struct arsdk_media_res *resource = NULL;
+
+	list_walk_entry_forward(&media->res, resource, node) {
+		if (resource->type == ARSDK_MEDIA_RES_TYPE_THUMBNAIL)
+			return resource;
 	}
 
-end:
-	/* Remove request form the array */
-	for (i = 0; i < req_del->reqs_size; i++) {
-		if (req_del->reqs[i] == req) {
-			req_del->reqs[i] = NULL;
-			req_del->reqs_nb--;
-			break;
+	return NULL;
+}
+
+/**
+ * Version of a media keying its cached thumbnail: 64 bits FNV-1a hash of
+ * the sizes and modification times listed of its resources, changed by a
+ * media replaced under the same name. 0 if none is known.
+ */
+static uint64_t media_get_version(const struct arsdk_media *media)
+{
+	const struct arsdk_media_res *resource = NULL;
+	uint64_t hash = 14695981039346656037ull;
+	uint64_t values[2];
+	const uint8_t *p = NULL;
+	size_t i;
+	int known = 0;
+
+	list_walk_entry_forward(&media->res, resource, node) {
+		values[0] = arsdk_ftp_file_get_size(resource->file);
+		values[1] = (uint64_t)arsdk_ftp_file_get_mtime(resource->file);
+		if (values[0] != 0 || values[1] != 0)
+			known = 1;
+
+		p = (const uint8_t *)values;
+		for (i = 0; i < sizeof(values); i++) {
+			hash ^= p[i];
+			hash *= 1099511628211ull;
 		}
 	}
 
-	if (req_del->reqs_nb != 0)
-		return;
+	return known ? hash : 0;
+}
 
-	(*req_del->cbs.complete)(req_del->base->itf,
-			req_del,
-			req_del->status,
-			req_del->error,
-			req_del->cbs.userdata);
+int arsdk_media_itf_set_thumb_cfg(struct arsdk_media_itf *itf,
+		const struct arsdk_media_thumb_cfg *cfg)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cfg != NULL, -EINVAL);
 
-	/* cleanup */
-	list_del(&req_del->base->node);
-	arsdk_media_req_delete_destroy(req_del);
+	return arsdk_media_thumbs_set_cfg(itf->thumbs, cfg);
 }
 
-int arsdk_media_itf_create_req_delete(
-	struct arsdk_media_itf *itf,
-	const struct arsdk_media_req_delete_cbs *cbs,
-	struct arsdk_media *media,
-	enum arsdk_device_type dev_type,
-	struct arsdk_media_req_delete **ret_req)
+int arsdk_media_itf_create_req_thumb(
+		struct arsdk_media_itf *itf,
+		const struct arsdk_media_req_thumb_cbs *cbs,
+		const struct arsdk_media *media,
+		enum arsdk_device_type dev_type,
+		struct arsdk_media_req_thumb **ret_req)
 {
 	int res = 0;
-	struct arsdk_media_req_delete *req_del = NULL;
-	struct arsdk_ftp_req_delete_cbs ftp_cbs;
-	struct arsdk_media_res *resource = NULL;
-	const char *uri = NULL;
+	struct arsdk_media_req_thumb *req_thumb = NULL;
+	const struct arsdk_media_res *thumb = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_req != NULL, -EINVAL);
 	*ret_req = NULL;
@@ -1274,90 +2800,81 @@ int arsdk_media_itf_create_req_delete(
 	ARSDK_RETURN_ERR_IF_FAILED(cbs->complete != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(media != NULL, -EINVAL);
 
+	thumb = media_get_thumb(media);
+	if (thumb == NULL)
+		return -ENOENT;
+
 	/* Allocate structure */
-	req_del = calloc(1, sizeof(*req_del));
-	if (req_del == NULL)
+	req_thumb = calloc(1, sizeof(*req_thumb));
+	if (req_thumb == NULL)
 		return -ENOMEM;
 
-	res = req_new(itf, req_del, ARSDK_MEDIA_REQ_DELETE, dev_type,
-			&req_del->base);
+	res = req_new(itf, req_thumb, ARSDK_MEDIA_REQ_THUMB, dev_type,
+			&req_thumb->base);
 	if (res < 0)
 		goto error;
 
-	req_del->reqs_size = arsdk_media_get_res_count(media);
-	req_del->reqs = calloc(req_del->reqs_size, sizeof(*req_del->reqs));
-	if (req_del->reqs == NULL) {
+	req_thumb->cbs = *cbs;
+	req_thumb->uri = xstrdup(thumb->uri);
+	if (req_thumb->uri == NULL) {
 		res = -ENOMEM;
 		goto error;
 	}
 
-	arsdk_media_ref(media);
-	req_del->media = media;
-	req_del->status = ARSDK_MEDIA_REQ_STATUS_OK;
-	req_del->cbs = *cbs;
-
-	ftp_cbs.userdata = req_del;
-	ftp_cbs.complete = &ftpdel_complete_cb;
-	resource = arsdk_media_next_res(media, resource);
-	while (resource != NULL) {
-		uri = arsdk_media_res_get_uri(resource);
-
-		res =  arsdk_ftp_itf_create_req_delete(itf->ftp, &ftp_cbs,
-				dev_type,
-				ARSDK_FTP_SRV_TYPE_MEDIA, uri,
-				&req_del->reqs[req_del->reqs_nb]);
-		if (res < 0)
-			goto error;
-
-		req_del->reqs_nb++;
-		resource = arsdk_media_next_res(media, resource);
+	/* linked before the fetch, the callback unlinks the request */
+	list_add_after(&itf->reqs, &req_thumb->base->node);
+	res = arsdk_media_thumbs_fetch(itf->thumbs, req_thumb->uri,
+			media_get_version(media), dev_type,
+			ARSDK_FTP_REQ_PRIORITY_HIGH, &thumb_fetched_cb,
+			req_thumb, &req_thumb->waiter);
+	if (res < 0) {
+		list_del(&req_thumb->base->node);
+		goto error;
 	}
 
-	list_add_after(&itf->reqs, &req_del->base->node);
-	*ret_req = req_del;
+	*ret_req = req_thumb;
 	return 0;
 
 error:
-	arsdk_media_req_delete_destroy(req_del);
+	arsdk_media_req_thumb_destroy(req_thumb);
 	return res;
 }
 
-static int arsdk_media_req_delete_cancel(struct arsdk_media_req_delete *req)
+int arsdk_media_req_thumb_cancel(struct arsdk_media_req_thumb *req)
 {
-	size_t i = 0;
-
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(req->base->itf != NULL, -EINVAL);
 
-	for (i = 0; i < req->reqs_size; i++) {
-		if (req->reqs[i] == NULL)
-			continue;
-
-		arsdk_ftp_req_delete_cancel(req->reqs[i]);
-	}
+	if (req->waiter == NULL)
+		return -EALREADY;
 
-	return 0;
+	return arsdk_media_thumbs_cancel(req->base->itf->thumbs, req->waiter);
 }
 
-static int arsdk_media_req_delete_abort(struct arsdk_media_req_delete *req)
+static int arsdk_media_req_thumb_abort(struct arsdk_media_req_thumb *req)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(req->base != NULL, -EINVAL);
 
 	req->base->is_aborted = 1;
-	return arsdk_media_req_delete_cancel(req);
+	return arsdk_media_req_thumb_cancel(req);
 }
 
-const struct arsdk_media *arsdk_media_req_delete_get_media(
-		const struct arsdk_media_req_delete *req)
+const char *arsdk_media_req_thumb_get_uri(
+		const struct arsdk_media_req_thumb *req)
 {
-	if (!req)
-		return NULL;
+	return req ? req->uri : NULL;
+}
 
-	return req->media;
+struct pomp_buffer *arsdk_media_req_thumb_get_buffer(
+		const struct arsdk_media_req_thumb *req)
+{
+	return req ? req->buf : NULL;
 }
 
-enum arsdk_device_type arsdk_media_req_delete_get_dev_type(
-		const struct arsdk_media_req_delete *req)
+enum arsdk_device_type arsdk_media_req_thumb_get_dev_type(
+		const struct arsdk_media_req_thumb *req)
 {
 	if ((req == NULL) ||
 	    (req->base == NULL))
@@ -1366,6 +2883,33 @@ enum arsdk_device_type arsdk_media_req_delete_get_dev_type(
 	return req->base->dev_type;
 }
 
+int arsdk_media_itf_prefetch_thumbs(struct arsdk_media_itf *itf,
+		struct arsdk_media_list *list,
+		enum arsdk_device_type dev_type)
+{
+	int res = 0;
+	struct arsdk_media *media = NULL;
+	const struct arsdk_media_res *thumb = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(list != NULL, -EINVAL);
+
+	list_walk_entry_forward(&list->medias, media, node) {
+		thumb = media_get_thumb(media);
+		if (thumb == NULL)
+			continue;
+
+		res = arsdk_media_thumbs_fetch(itf->thumbs, thumb->uri,
+				media_get_version(media), dev_type,
+				ARSDK_FTP_REQ_PRIORITY_LOW,
+				NULL, NULL, NULL);
+		if (res < 0)
+			return res;
+	}
+
+	return 0;
+}
+
 static int arsdk_media_req_base_cancel(struct arsdk_media_req_base *base)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(base != NULL, -EINVAL);
@@ -1377,6 +2921,10 @@ static int arsdk_media_req_base_cancel(struct arsdk_media_req_base *base)
 		return arsdk_media_req_download_cancel(base->child);
 	case ARSDK_MEDIA_REQ_DELETE:
 		return arsdk_media_req_delete_cancel(base->child);
+	case ARSDK_MEDIA_REQ_THUMB:
+		return arsdk_media_req_thumb_cancel(base->child);
+	case ARSDK_MEDIA_REQ_DELETE_BATCH:
+		return arsdk_media_req_delete_batch_cancel(base->child);
 	default:
 		return -EINVAL;
 	}
@@ -1393,6 +2941,7 @@ int arsdk_media_itf_cancel_all(struct arsdk_media_itf *itf)
 		arsdk_media_req_base_cancel(base);
 	}
 
+	arsdk_media_thumbs_cancel_prefetch(itf->thumbs);
 	return 0;
 }
 
@@ -1407,6 +2956,10 @@ static int arsdk_media_req_base_abort(struct arsdk_media_req_base *base)
 		return arsdk_media_req_download_abort(base->child);
 	case ARSDK_MEDIA_REQ_DELETE:
 		return arsdk_media_req_delete_abort(base->child);
+	case ARSDK_MEDIA_REQ_THUMB:
+		return arsdk_media_req_thumb_abort(base->child);
+	case ARSDK_MEDIA_REQ_DELETE_BATCH:
+		return arsdk_media_req_delete_batch_abort(base->child);
 	default:
 		return -EINVAL;
 	}
@@ -1431,6 +2984,7 @@ int arsdk_media_itf_stop(struct arsdk_media_itf *itf)
 	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
 
 	arsdk_media_itf_abort_all(itf);
+	arsdk_media_thumbs_stop(itf->thumbs);
 
 	return 0;
 }
@@ -28,6 +28,8 @@
 #define _ARSDK_MEDIA_ITF_PRIV_H_
 
 int arsdk_media_itf_new(struct arsdk_ftp_itf *ftp_itf,
+		struct pomp_loop *loop,
+		const char *dev_id,
 		struct arsdk_media_itf **ret_itf);
 
 int arsdk_media_itf_destroy(struct arsdk_media_itf *itf);
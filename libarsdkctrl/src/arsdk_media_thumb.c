@@ -0,0 +1,954 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdk_media_index_priv.h"
+#include "arsdk_media_thumb_priv.h"
+#include "arsdkctrl_default_log.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+/** Default maximum size of the thumbnails kept in memory (bytes) */
+#define THUMB_MEM_MAX_SIZE_DEFAULT (8 * 1024 * 1024)
+
+/** Default maximum size of the thumbnails kept on disk (bytes) */
+#define THUMB_DISK_MAX_SIZE_DEFAULT (256 * 1024 * 1024)
+
+/** Default and maximum counts of thumbnails downloaded at once */
+#define THUMB_DOWNLOADS_DEFAULT 2
+#define THUMB_DOWNLOADS_MAX 8
+
+/** The disk cache is trimmed to this percentage of its maximum size */
+#define THUMB_DISK_TRIM_PERCENT 90
+
+/** Count of buckets of the memory cache */
+#define THUMB_BUCKETS 1024
+
+#define THUMB_SUFFIX ".thumb"
+#define THUMB_TMP_SUFFIX ".tmp"
+
+/** thumbnail kept in memory */
+struct thumb_entry {
+	char                            *uri;
+	uint32_t                        hash;
+	uint64_t                        version;
+	struct pomp_buffer              *buf;
+	size_t                          size;
+	struct thumb_entry              *next;
+	/* most recently used first */
+	struct list_node                lru;
+};
+
+/** thumbnail download, shared by the waiters of a same thumbnail */
+struct thumb_job {
+	struct arsdk_media_thumbs       *thumbs;
+	char                            *uri;
+	uint32_t                        hash;
+	uint64_t                        version;
+	enum arsdk_device_type          dev_type;
+	enum arsdk_ftp_req_priority     prio;
+	/* downloaded without waiter */
+	int                             prefetch;
+	/* NULL while queued */
+	struct arsdk_ftp_req_get        *ftp_req;
+	struct list_node                waiters;
+	struct list_node                node;
+};
+
+/** */
+struct arsdk_media_thumb_waiter {
+	/* NULL once done */
+	struct thumb_job                *job;
+	arsdk_media_thumb_cb_t          cb;
+	void                            *userdata;
+	/* result notified by the idle callback */
+	enum arsdk_media_req_status     status;
+	int                             error;
+	struct pomp_buffer              *buf;
+	struct list_node                node;
+};
+
+/** */
+struct arsdk_media_thumbs {
+	struct arsdk_ftp_itf            *ftp;
+	struct pomp_loop                *loop;
+	char                            *dev_id;
+	struct {
+		char                    *dir;
+		size_t                  mem_max_size;
+		uint64_t                disk_max_size;
+		uint32_t                max_downloads;
+	} cfg;
+	/* memory cache */
+	struct thumb_entry              *buckets[THUMB_BUCKETS];
+	struct list_node                lru;
+	size_t                          mem_size;
+	/* disk cache, 0 if not scanned yet */
+	uint64_t                        disk_size;
+	/* downloads */
+	struct list_node                queue[ARSDK_FTP_REQ_PRIORITY_COUNT];
+	struct list_node                running;
+	uint32_t                        running_count;
+	/* waiters notified by the idle callback */
+	struct list_node                done;
+	int                             stopped;
+};
+
+static uint32_t uri_hash(const char *uri)
+{
+	return arsdk_media_index_hash(ARSDK_MEDIA_INDEX_HASH_INIT, uri,
+			strlen(uri));
+}
+
+/**
+ * 64 bits FNV-1a hash, naming the thumbnails cached on disk.
+ */
+static uint64_t uri_hash64(const char *uri)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	while (*uri != '\0') {
+		hash ^= (uint8_t)*uri++;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+/* Memory cache : */
+
+static struct thumb_entry *mem_find(struct arsdk_media_thumbs *thumbs,
+		const char *uri, uint32_t hash)
+{
+	struct thumb_entry *entry = thumbs->buckets[hash % THUMB_BUCKETS];
+
+	while (entry != NULL) {
+		if (entry->hash == hash && strcmp(entry->uri, uri) == 0)
+			return entry;
+		entry = entry->next;
+	}
+
+	return NULL;
+}
+
+static void mem_remove(struct arsdk_media_thumbs *thumbs,
+		struct thumb_entry *entry)
+{
+	struct thumb_entry **prev = &thumbs->buckets[entry->hash %
+			THUMB_BUCKETS];
+
+	while (*prev != entry)
+		prev = &(*prev)->next;
+	*prev = entry->next;
+
+	list_del(&entry->lru);
+	thumbs->mem_size -= entry->size;
+	pomp_buffer_unref(entry->buf);
+	free(entry->uri);
+	free(entry);
+}
+
+static void mem_trim(struct arsdk_media_thumbs *thumbs, size_t max_size)
+{
+	struct thumb_entry *entry = NULL;
+
+	while (thumbs->mem_size > max_size && !list_is_empty(&thumbs->lru)) {
+		entry = list_entry(list_last(&thumbs->lru),
+				struct thumb_entry, lru);
+		mem_remove(thumbs, entry);
+	}
+}
+
+static void mem_add(struct arsdk_media_thumbs *thumbs, const char *uri,
+		uint32_t hash, uint64_t version, struct pomp_buffer *buf)
+{
+	struct thumb_entry *entry = NULL;
+	size_t len = 0;
+
+	pomp_buffer_get_cdata(buf, NULL, &len, NULL);
+	if (len > thumbs->cfg.mem_max_size)
+		return;
+
+	/* the thumbnail of another version of the media is replaced */
+	entry = mem_find(thumbs, uri, hash);
+	if (entry != NULL && entry->version == version)
+		return;
+	else if (entry != NULL)
+		mem_remove(thumbs, entry);
+
+	entry = calloc(1, sizeof(*entry));
+	if (entry == NULL)
+		return;
+
+	entry->uri = strdup(uri);
+	if (entry->uri == NULL) {
+		free(entry);
+		return;
+	}
+
+	pomp_buffer_ref(buf);
+	entry->buf = buf;
+	entry->hash = hash;
+	entry->version = version;
+	entry->size = len;
+	entry->next = thumbs->buckets[hash % THUMB_BUCKETS];
+	thumbs->buckets[hash % THUMB_BUCKETS] = entry;
+	list_add_after(&thumbs->lru, &entry->lru);
+	thumbs->mem_size += len;
+
+	mem_trim(thumbs, thumbs->cfg.mem_max_size);
+}
+
+/* Disk cache : */
+
+/**
+ * The thumbnails of the other versions of a media are not found, and
+ * removed by the trim of the disk cache.
+ */
+static char *disk_path(struct arsdk_media_thumbs *thumbs, const char *uri,
+		uint64_t version)
+{
+	char *path = NULL;
+
+	if (asprintf(&path, "%s/%s-%016" PRIx64 "-%016" PRIx64 THUMB_SUFFIX,
+			thumbs->cfg.dir, thumbs->dev_id, uri_hash64(uri),
+			version) < 0)
+		return NULL;
+
+	return path;
+}
+
+/** thumbnail file found by a scan of the disk cache */
+struct disk_file {
+	char                            *name;
+	time_t                          mtime;
+	off_t                           size;
+};
+
+static int disk_file_cmp(const void *a, const void *b)
+{
+	const struct disk_file *fa = a;
+	const struct disk_file *fb = b;
+
+	return (fa->mtime > fb->mtime) - (fa->mtime < fb->mtime);
+}
+
+/**
+ * Scan the disk cache to get its size, and remove the least recently used
+ * thumbnails, by modification time, while larger than max_size.
+ */
+static void disk_scan(struct arsdk_media_thumbs *thumbs, uint64_t max_size)
+{
+	DIR *dir = NULL;
+	struct dirent *de = NULL;
+	struct stat st;
+	struct disk_file *files = NULL;
+	struct disk_file *tmp = NULL;
+	size_t count = 0;
+	size_t size = 0;
+	size_t len;
+	size_t i;
+	char *path = NULL;
+
+	thumbs->disk_size = 0;
+
+	dir = opendir(thumbs->cfg.dir);
+	if (dir == NULL) {
+		ARSDK_LOG_ERRNO("opendir", errno);
+		return;
+	}
+
+	while ((de = readdir(dir)) != NULL) {
+		len = strlen(de->d_name);
+		if (len <= strlen(THUMB_SUFFIX) ||
+		    strcmp(de->d_name + len - strlen(THUMB_SUFFIX),
+				THUMB_SUFFIX) != 0)
+			continue;
+
+		if (fstatat(dirfd(dir), de->d_name, &st, 0) < 0)
+			continue;
+
+		if (count == size) {
+			size = size == 0 ? 256 : size * 2;
+			tmp = realloc(files, size * sizeof(*files));
+			if (tmp == NULL)
+				break;
+			files = tmp;
+		}
+
+		files[count].name = strdup(de->d_name);
+		if (files[count].name == NULL)
+			break;
+		files[count].mtime = st.st_mtime;
+		files[count].size = st.st_size;
+		thumbs->disk_size += st.st_size;
+		count++;
+	}
+	closedir(dir);
+
+	if (thumbs->disk_size > max_size)
+		qsort(files, count, sizeof(*files), &disk_file_cmp);
+
+	for (i = 0; i < count; i++) {
+		if (thumbs->disk_size > max_size &&
+		    asprintf(&path, "%s/%s", thumbs->cfg.dir,
+				files[i].name) >= 0) {
+			if (unlink(path) == 0)
+				thumbs->disk_size -= files[i].size;
+			free(path);
+		}
+		free(files[i].name);
+	}
+	free(files);
+}
+
+static int disk_read(struct arsdk_media_thumbs *thumbs, const char *uri,
+		uint64_t version, struct pomp_buffer **ret_buf)
+{
+	int res = 0;
+	char *path = NULL;
+	FILE *file = NULL;
+	struct stat st;
+	struct pomp_buffer *buf = NULL;
+	void *data = NULL;
+
+	path = disk_path(thumbs, uri, version);
+	if (path == NULL)
+		return -ENOMEM;
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		res = -errno;
+		goto out;
+	}
+
+	if (fstat(fileno(file), &st) < 0 || st.st_size == 0) {
+		res = -EIO;
+		goto out;
+	}
+
+	buf = pomp_buffer_new_get_data(st.st_size, &data);
+	if (buf == NULL) {
+		res = -ENOMEM;
+		goto out;
+	}
+
+	if (fread(data, 1, st.st_size, file) != (size_t)st.st_size) {
+		res = -EIO;
+		goto out;
+	}
+	pomp_buffer_set_len(buf, st.st_size);
+
+	/* the modification time orders the thumbnails by last use */
+	utime(path, NULL);
+
+	*ret_buf = buf;
+	buf = NULL;
+
+out:
+	if (buf != NULL)
+		pomp_buffer_unref(buf);
+	if (file != NULL)
+		fclose(file);
+	free(path);
+	return res;
+}
+
+static void disk_write(struct arsdk_media_thumbs *thumbs, const char *uri,
+		uint64_t version, struct pomp_buffer *buf)
+{
+	char *path = NULL;
+	char *tmp_path = NULL;
+	FILE *file = NULL;
+	const void *data = NULL;
+	size_t len = 0;
+	int err = 0;
+
+	pomp_buffer_get_cdata(buf, &data, &len, NULL);
+	if (len == 0 || len > thumbs->cfg.disk_max_size)
+		return;
+
+	path = disk_path(thumbs, uri, version);
+	if (path == NULL ||
+	    asprintf(&tmp_path, "%s" THUMB_TMP_SUFFIX, path) < 0) {
+		free(path);
+		return;
+	}
+
+	/* written to a temporary file to never read a partial thumbnail */
+	file = fopen(tmp_path, "wb");
+	if (file == NULL) {
+		ARSDK_LOG_ERRNO("fopen", errno);
+		goto out;
+	}
+
+	if (fwrite(data, 1, len, file) != len)
+		err = 1;
+	if (fclose(file) != 0)
+		err = 1;
+	if (err || rename(tmp_path, path) < 0) {
+		ARSDK_LOGW("failed to cache thumbnail '%s'", uri);
+		unlink(tmp_path);
+		goto out;
+	}
+
+	if (thumbs->disk_size == 0)
+		disk_scan(thumbs, thumbs->cfg.disk_max_size);
+	else
+		thumbs->disk_size += len;
+
+	if (thumbs->disk_size > thumbs->cfg.disk_max_size)
+		disk_scan(thumbs, thumbs->cfg.disk_max_size *
+				THUMB_DISK_TRIM_PERCENT / 100);
+
+out:
+	free(tmp_path);
+	free(path);
+}
+
+/* Waiters : */
+
+static void done_idle_cb(void *userdata)
+{
+	struct arsdk_media_thumbs *thumbs = userdata;
+	struct arsdk_media_thumb_waiter *waiter = NULL;
+
+	while (!list_is_empty(&thumbs->done)) {
+		waiter = list_entry(list_first(&thumbs->done),
+				struct arsdk_media_thumb_waiter, node);
+		list_del(&waiter->node);
+
+		(*waiter->cb)(waiter, waiter->status, waiter->error,
+				waiter->buf, waiter->userdata);
+
+		if (waiter->buf != NULL)
+			pomp_buffer_unref(waiter->buf);
+		free(waiter);
+	}
+}
+
+/**
+ * Notify a waiter from the idle callback.
+ */
+static void waiter_done(struct arsdk_media_thumbs *thumbs,
+		struct arsdk_media_thumb_waiter *waiter,
+		enum arsdk_media_req_status status,
+		int error,
+		struct pomp_buffer *buf)
+{
+	waiter->job = NULL;
+	waiter->status = status;
+	waiter->error = error;
+	waiter->buf = buf;
+	if (buf != NULL)
+		pomp_buffer_ref(buf);
+
+	if (list_is_empty(&thumbs->done))
+		pomp_loop_idle_add(thumbs->loop, &done_idle_cb, thumbs);
+	list_add_before(&thumbs->done, &waiter->node);
+}
+
+/* Downloads : */
+
+static void job_destroy(struct thumb_job *job)
+{
+	free(job->uri);
+	free(job);
+}
+
+static void thumbs_dispatch(struct arsdk_media_thumbs *thumbs);
+
+/**
+ * Notify the waiters of a job from the idle callback and destroy it.
+ * Jobs may complete within arsdk_media_thumbs_fetch, whose caller does
+ * not expect its callback before the function returns.
+ */
+static void job_complete(struct thumb_job *job,
+		enum arsdk_media_req_status status,
+		int error,
+		struct pomp_buffer *buf)
+{
+	struct arsdk_media_thumb_waiter *waiter = NULL;
+
+	list_del(&job->node);
+
+	while (!list_is_empty(&job->waiters)) {
+		waiter = list_entry(list_first(&job->waiters),
+				struct arsdk_media_thumb_waiter, node);
+		list_del(&waiter->node);
+		waiter_done(job->thumbs, waiter, status, error, buf);
+	}
+
+	job_destroy(job);
+}
+
+static enum arsdk_media_req_status to_media_status(
+		enum arsdk_ftp_req_status status)
+{
+	switch (status) {
+	case ARSDK_FTP_REQ_STATUS_OK:
+		return ARSDK_MEDIA_REQ_STATUS_OK;
+	case ARSDK_FTP_REQ_STATUS_CANCELED:
+		return ARSDK_MEDIA_REQ_STATUS_CANCELED;
+	case ARSDK_FTP_REQ_STATUS_ABORTED:
+		return ARSDK_MEDIA_REQ_STATUS_ABORTED;
+	case ARSDK_FTP_REQ_STATUS_FAILED:
+	default:
+		return ARSDK_MEDIA_REQ_STATUS_FAILED;
+	}
+}
+
+static void job_progress_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_get *req,
+		float percent,
+		void *userdata)
+{
+	/* Do nothing */
+}
+
+static void job_complete_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_get *req,
+		enum arsdk_ftp_req_status status,
+		int error,
+		void *userdata)
+{
+	struct thumb_job *job = userdata;
+	struct arsdk_media_thumbs *thumbs = job->thumbs;
+	enum arsdk_media_req_status media_status = to_media_status(status);
+	struct pomp_buffer *buf = NULL;
+
+	job->ftp_req = NULL;
+	thumbs->running_count--;
+
+	if (thumbs->stopped)
+		media_status = ARSDK_MEDIA_REQ_STATUS_ABORTED;
+
+	if (media_status == ARSDK_MEDIA_REQ_STATUS_OK) {
+		buf = arsdk_ftp_req_get_get_buffer(req);
+		if (buf != NULL) {
+			mem_add(thumbs, job->uri, job->hash, job->version,
+					buf);
+			if (thumbs->cfg.dir != NULL)
+				disk_write(thumbs, job->uri, job->version,
+						buf);
+		} else {
+			media_status = ARSDK_MEDIA_REQ_STATUS_FAILED;
+			error = -ENODATA;
+		}
+	}
+
+	job_complete(job, media_status, error, buf);
+	thumbs_dispatch(thumbs);
+}
+
+static int job_start(struct thumb_job *job)
+{
+	int res = 0;
+	struct arsdk_media_thumbs *thumbs = job->thumbs;
+	struct arsdk_ftp_req_get_cbs cbs;
+
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.userdata = job;
+	cbs.progress = &job_progress_cb;
+	cbs.complete = &job_complete_cb;
+
+	res = arsdk_ftp_itf_create_req_get(thumbs->ftp, &cbs, job->dev_type,
+			ARSDK_FTP_SRV_TYPE_MEDIA, job->uri, NULL, 0,
+			&job->ftp_req);
+	if (res < 0)
+		return res;
+
+	arsdk_ftp_req_get_set_priority(job->ftp_req, job->prio);
+
+	list_del(&job->node);
+	list_add_before(&thumbs->running, &job->node);
+	thumbs->running_count++;
+	return 0;
+}
+
+/**
+ * Start the queued downloads, by priority, up to the maximum count.
+ */
+static void thumbs_dispatch(struct arsdk_media_thumbs *thumbs)
+{
+	struct thumb_job *job = NULL;
+	int prio;
+	int res = 0;
+
+	while (!thumbs->stopped &&
+	       thumbs->running_count < thumbs->cfg.max_downloads) {
+		job = NULL;
+		for (prio = ARSDK_FTP_REQ_PRIORITY_COUNT - 1; prio >= 0;
+		     prio--) {
+			if (!list_is_empty(&thumbs->queue[prio])) {
+				job = list_entry(list_first(
+						&thumbs->queue[prio]),
+						struct thumb_job, node);
+				break;
+			}
+		}
+		if (job == NULL)
+			return;
+
+		res = job_start(job);
+		if (res < 0)
+			job_complete(job, ARSDK_MEDIA_REQ_STATUS_FAILED, res,
+					NULL);
+	}
+}
+
+static struct thumb_job *job_find(struct list_node *jobs, const char *uri,
+		uint32_t hash, uint64_t version)
+{
+	struct thumb_job *job = NULL;
+
+	list_walk_entry_forward(jobs, job, node) {
+		if (job->hash == hash && job->version == version &&
+		    strcmp(job->uri, uri) == 0)
+			return job;
+	}
+
+	return NULL;
+}
+
+static struct thumb_job *thumbs_find_job(struct arsdk_media_thumbs *thumbs,
+		const char *uri, uint32_t hash, uint64_t version)
+{
+	struct thumb_job *job = NULL;
+	int prio;
+
+	job = job_find(&thumbs->running, uri, hash, version);
+	for (prio = 0; job == NULL && prio < ARSDK_FTP_REQ_PRIORITY_COUNT;
+	     prio++)
+		job = job_find(&thumbs->queue[prio], uri, hash, version);
+
+	return job;
+}
+
+/**
+ * Raise the priority of a job waited with a higher priority.
+ */
+static void job_raise_prio(struct thumb_job *job,
+		enum arsdk_ftp_req_priority prio)
+{
+	if (prio <= job->prio)
+		return;
+
+	job->prio = prio;
+	if (job->ftp_req != NULL) {
+		arsdk_ftp_req_get_set_priority(job->ftp_req, prio);
+	} else {
+		list_del(&job->node);
+		list_add_before(&job->thumbs->queue[prio], &job->node);
+	}
+}
+
+int arsdk_media_thumbs_new(struct arsdk_ftp_itf *ftp,
+		struct pomp_loop *loop,
+		const char *dev_id,
+		struct arsdk_media_thumbs **ret_thumbs)
+{
+	struct arsdk_media_thumbs *thumbs = NULL;
+	char *c = NULL;
+	int prio;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_thumbs != NULL, -EINVAL);
+	*ret_thumbs = NULL;
+	ARSDK_RETURN_ERR_IF_FAILED(ftp != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(loop != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(dev_id != NULL, -EINVAL);
+
+	thumbs = calloc(1, sizeof(*thumbs));
+	if (thumbs == NULL)
+		return -ENOMEM;
+
+	thumbs->dev_id = strdup(dev_id);
+	if (thumbs->dev_id == NULL) {
+		free(thumbs);
+		return -ENOMEM;
+	}
+
+	/* the device id is not a valid file name in any case */
+	for (c = thumbs->dev_id; *c != '\0'; c++) {
+		if (!isalnum((unsigned char)*c) && *c != '-' && *c != '_')
+			*c = '_';
+	}
+
+	thumbs->ftp = ftp;
+	thumbs->loop = loop;
+	thumbs->cfg.mem_max_size = THUMB_MEM_MAX_SIZE_DEFAULT;
+	thumbs->cfg.disk_max_size = THUMB_DISK_MAX_SIZE_DEFAULT;
+	thumbs->cfg.max_downloads = THUMB_DOWNLOADS_DEFAULT;
+	list_init(&thumbs->lru);
+	list_init(&thumbs->running);
+	list_init(&thumbs->done);
+	for (prio = 0; prio < ARSDK_FTP_REQ_PRIORITY_COUNT; prio++)
+		list_init(&thumbs->queue[prio]);
+
+	*ret_thumbs = thumbs;
+	return 0;
+}
+
+void arsdk_media_thumbs_destroy(struct arsdk_media_thumbs *thumbs)
+{
+	if (thumbs == NULL)
+		return;
+
+	arsdk_media_thumbs_stop(thumbs);
+
+	if (!list_is_empty(&thumbs->running)) {
+		ARSDK_LOGW("thumbnails %p still downloading", thumbs);
+		while (!list_is_empty(&thumbs->running)) {
+			job_complete(list_entry(list_first(&thumbs->running),
+					struct thumb_job, node),
+					ARSDK_MEDIA_REQ_STATUS_ABORTED,
+					-EPIPE, NULL);
+		}
+	}
+
+	/* notify the waiters still pending */
+	pomp_loop_idle_remove(thumbs->loop, &done_idle_cb, thumbs);
+	done_idle_cb(thumbs);
+
+	mem_trim(thumbs, 0);
+	free(thumbs->cfg.dir);
+	free(thumbs->dev_id);
+	free(thumbs);
+}
+
+void arsdk_media_thumbs_stop(struct arsdk_media_thumbs *thumbs)
+{
+	struct thumb_job *job = NULL;
+	struct thumb_job *job_tmp = NULL;
+	int prio;
+
+	ARSDK_RETURN_IF_FAILED(thumbs != NULL, -EINVAL);
+
+	thumbs->stopped = 1;
+
+	for (prio = 0; prio < ARSDK_FTP_REQ_PRIORITY_COUNT; prio++) {
+		while (!list_is_empty(&thumbs->queue[prio])) {
+			job = list_entry(list_first(&thumbs->queue[prio]),
+					struct thumb_job, node);
+			job_complete(job, ARSDK_MEDIA_REQ_STATUS_ABORTED,
+					-EPIPE, NULL);
+		}
+	}
+
+	/* completed as aborted */
+	list_walk_entry_forward_safe(&thumbs->running, job, job_tmp, node)
+		arsdk_ftp_req_get_cancel(job->ftp_req);
+}
+
+int arsdk_media_thumbs_set_cfg(struct arsdk_media_thumbs *thumbs,
+		const struct arsdk_media_thumb_cfg *cfg)
+{
+	char *dir = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(thumbs != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cfg != NULL, -EINVAL);
+
+	if (cfg->dir != NULL) {
+		if (mkdir(cfg->dir, 0755) < 0 && errno != EEXIST) {
+			ARSDK_LOG_ERRNO("mkdir", errno);
+			return -errno;
+		}
+
+		dir = strdup(cfg->dir);
+		if (dir == NULL)
+			return -ENOMEM;
+	}
+
+	free(thumbs->cfg.dir);
+	thumbs->cfg.dir = dir;
+	thumbs->cfg.mem_max_size = cfg->mem_max_size;
+	thumbs->cfg.disk_max_size = cfg->disk_max_size;
+	thumbs->cfg.max_downloads = cfg->max_downloads;
+	if (thumbs->cfg.max_downloads == 0)
+		thumbs->cfg.max_downloads = THUMB_DOWNLOADS_DEFAULT;
+	else if (thumbs->cfg.max_downloads > THUMB_DOWNLOADS_MAX)
+		thumbs->cfg.max_downloads = THUMB_DOWNLOADS_MAX;
+
+	mem_trim(thumbs, thumbs->cfg.mem_max_size);
+	thumbs->disk_size = 0;
+	if (thumbs->cfg.dir != NULL)
+		disk_scan(thumbs, thumbs->cfg.disk_max_size);
+
+	thumbs_dispatch(thumbs);
+	return 0;
+}
+
+int arsdk_media_thumbs_fetch(struct arsdk_media_thumbs *thumbs,
+		const char *uri,
+		uint64_t version,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_req_priority prio,
+		arsdk_media_thumb_cb_t cb,
+		void *userdata,
+		struct arsdk_media_thumb_waiter **ret_waiter)
+{
+	int res = 0;
+	uint32_t hash;
+	struct thumb_entry *entry = NULL;
+	struct pomp_buffer *buf = NULL;
+	struct thumb_job *job = NULL;
+	struct arsdk_media_thumb_waiter *waiter = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(thumbs != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(uri != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(prio < ARSDK_FTP_REQ_PRIORITY_COUNT,
+			-EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cb == NULL || ret_waiter != NULL, -EINVAL);
+
+	if (thumbs->stopped)
+		return -EPIPE;
+
+	if (cb != NULL) {
+		waiter = calloc(1, sizeof(*waiter));
+		if (waiter == NULL)
+			return -ENOMEM;
+		waiter->cb = cb;
+		waiter->userdata = userdata;
+	}
+
+	/* cached in memory */
+	hash = uri_hash(uri);
+	entry = mem_find(thumbs, uri, hash);
+	if (entry != NULL && entry->version != version) {
+		/* thumbnail of a media replaced under the same name */
+		mem_remove(thumbs, entry);
+	} else if (entry != NULL) {
+		list_del(&entry->lru);
+		list_add_after(&thumbs->lru, &entry->lru);
+		buf = entry->buf;
+		pomp_buffer_ref(buf);
+	}
+
+	/* cached on disk */
+	if (buf == NULL && thumbs->cfg.dir != NULL &&
+	    disk_read(thumbs, uri, version, &buf) == 0)
+		mem_add(thumbs, uri, hash, version, buf);
+
+	if (buf != NULL) {
+		if (waiter != NULL) {
+			waiter_done(thumbs, waiter, ARSDK_MEDIA_REQ_STATUS_OK,
+					0, buf);
+			*ret_waiter = waiter;
+		}
+		pomp_buffer_unref(buf);
+		return 0;
+	}
+
+	/* downloaded, once for all the waiters */
+	job = thumbs_find_job(thumbs, uri, hash, version);
+	if (job == NULL) {
+		job = calloc(1, sizeof(*job));
+		if (job == NULL) {
+			res = -ENOMEM;
+			goto error;
+		}
+
+		job->uri = strdup(uri);
+		if (job->uri == NULL) {
+			free(job);
+			res = -ENOMEM;
+			goto error;
+		}
+
+		job->thumbs = thumbs;
+		job->hash = hash;
+		job->version = version;
+		job->dev_type = dev_type;
+		job->prio = prio;
+		list_init(&job->waiters);
+		list_add_before(&thumbs->queue[prio], &job->node);
+	} else {
+		job_raise_prio(job, prio);
+	}
+
+	if (waiter != NULL) {
+		waiter->job = job;
+		list_add_before(&job->waiters, &waiter->node);
+		*ret_waiter = waiter;
+	} else {
+		job->prefetch = 1;
+	}
+
+	thumbs_dispatch(thumbs);
+	return 0;
+
+error:
+	free(waiter);
+	return res;
+}
+
+int arsdk_media_thumbs_cancel(struct arsdk_media_thumbs *thumbs,
+		struct arsdk_media_thumb_waiter *waiter)
+{
+	struct thumb_job *job = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(thumbs != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(waiter != NULL, -EINVAL);
+
+	job = waiter->job;
+	if (job == NULL)
+		return -EALREADY;
+
+	list_del(&waiter->node);
+	waiter_done(thumbs, waiter, ARSDK_MEDIA_REQ_STATUS_CANCELED,
+			-ECANCELED, NULL);
+
+	/* a download started is kept to cache the thumbnail */
+	if (list_is_empty(&job->waiters) && !job->prefetch &&
+	    job->ftp_req == NULL)
+		job_complete(job, ARSDK_MEDIA_REQ_STATUS_CANCELED,
+				-ECANCELED, NULL);
+
+	return 0;
+}
+
+void arsdk_media_thumbs_cancel_prefetch(struct arsdk_media_thumbs *thumbs)
+{
+	struct thumb_job *job = NULL;
+	struct thumb_job *job_tmp = NULL;
+	int prio;
+
+	ARSDK_RETURN_IF_FAILED(thumbs != NULL, -EINVAL);
+
+	for (prio = 0; prio < ARSDK_FTP_REQ_PRIORITY_COUNT; prio++) {
+		list_walk_entry_forward_safe(&thumbs->queue[prio], job,
+				job_tmp, node) {
+			if (list_is_empty(&job->waiters))
+				job_complete(job,
+						ARSDK_MEDIA_REQ_STATUS_CANCELED,
+						-ECANCELED, NULL);
+		}
+	}
+}
@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_MEDIA_THUMB_PRIV_H_
+#define _ARSDK_MEDIA_THUMB_PRIV_H_
+
+struct arsdk_media_thumbs;
+struct arsdk_media_thumb_waiter;
+
+/**
+ * Thumbnail fetched callback.
+ * @param waiter : the waiter of the thumbnail.
+ * @param status : request status.
+ * @param error : request error.
+ * @param buf : the thumbnail, NULL in case of error.
+ * @param userdata : user data.
+ */
+typedef void (*arsdk_media_thumb_cb_t)(
+		struct arsdk_media_thumb_waiter *waiter,
+		enum arsdk_media_req_status status,
+		int error,
+		struct pomp_buffer *buf,
+		void *userdata);
+
+/**
+ * Create the thumbnail service of a device.
+ * @param ftp : ftp interface of the device.
+ * @param loop : event loop.
+ * @param dev_id : device id, naming the thumbnails cached on disk.
+ * @param ret_thumbs : will receive the service.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_media_thumbs_new(struct arsdk_ftp_itf *ftp,
+		struct pomp_loop *loop,
+		const char *dev_id,
+		struct arsdk_media_thumbs **ret_thumbs);
+
+/**
+ * Destroy the thumbnail service; it must be stopped.
+ * @param thumbs : the service.
+ */
+void arsdk_media_thumbs_destroy(struct arsdk_media_thumbs *thumbs);
+
+/**
+ * Stop the thumbnail service: the pending fetches are aborted.
+ * @param thumbs : the service.
+ */
+void arsdk_media_thumbs_stop(struct arsdk_media_thumbs *thumbs);
+
+/**
+ * Configure the thumbnail cache.
+ * @param thumbs : the service.
+ * @param cfg : configuration.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_media_thumbs_set_cfg(struct arsdk_media_thumbs *thumbs,
+		const struct arsdk_media_thumb_cfg *cfg);
+
+/**
+ * Fetch a thumbnail, from the cache if possible.
+ * The callback is always called asynchronously.
+ * @param thumbs : the service.
+ * @param uri : uri of the thumbnail.
+ * @param version : version of the media, from the size and modification
+ * time of its resources; a thumbnail cached for another version is
+ * downloaded again.
+ * @param dev_type : type of the device to access.
+ * @param prio : download priority.
+ * @param cb : fetched callback, NULL to only prefetch the thumbnail.
+ * @param userdata : user data of the callback.
+ * @param ret_waiter : will receive the waiter to cancel the fetch, NULL if
+ * cb is NULL.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_media_thumbs_fetch(struct arsdk_media_thumbs *thumbs,
+		const char *uri,
+		uint64_t version,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_req_priority prio,
+		arsdk_media_thumb_cb_t cb,
+		void *userdata,
+		struct arsdk_media_thumb_waiter **ret_waiter);
+
+/**
+ * Cancel a fetch; the callback is called with the canceled status.
+ * @param thumbs : the service.
+ * @param waiter : the waiter of the thumbnail.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_media_thumbs_cancel(struct arsdk_media_thumbs *thumbs,
+		struct arsdk_media_thumb_waiter *waiter);
+
+/**
+ * Cancel the thumbnails prefetched and not waited.
+ * @param thumbs : the service.
+ */
+void arsdk_media_thumbs_cancel_prefetch(struct arsdk_media_thumbs *thumbs);
+
+#endif /* !_ARSDK_MEDIA_THUMB_PRIV_H_ */
@@ -696,6 +696,7 @@ int arsdk_pud_itf_create_req(struct arsdk_pud_itf *itf,
 		goto error;
 	}
 
+	memset(&ftp_cbs, 0, sizeof(ftp_cbs));
 	memset(&ftp_cbs, 0, sizeof(ftp_cbs));
 	ftp_cbs.userdata = req;
 	ftp_cbs.complete = &puds_dir_list_complete_cb;
@@ -0,0 +1,394 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdkctrl_default_log.h"
+#include "updater/arsdk_updater_digest.h"
+
+/** Device of a fleet update */
+struct fleet_entry {
+	/* NULL once the fleet update is destroyed */
+	struct arsdk_updater_fleet              *fleet;
+	uint16_t                                handle;
+	enum arsdk_device_type                  dev_type;
+	struct arsdk_updater_req_upload         *req;
+	/* node in the queued or running list */
+	struct list_node                        node;
+};
+
+/** */
+struct arsdk_updater_fleet {
+	struct arsdk_ctrl                       *ctrl;
+	char                                    *fw_filepath;
+	uint32_t                                max_concurrent;
+	struct arsdk_updater_fleet_cbs          cbs;
+	struct arsdk_updater_digest_job         *digest_job;
+	struct list_node                        queued;
+	struct list_node                        running;
+	size_t                                  total_nb;
+	size_t                                  running_nb;
+	size_t                                  done_nb;
+	size_t                                  ok_nb;
+	/* error of the digest computation */
+	int                                     error;
+	int                                     started;
+	int                                     digested;
+	int                                     canceled;
+	int                                     completed;
+	int                                     destroying;
+	/* defers the processing while uploads are started or canceled */
+	int                                     busy;
+};
+
+/**
+ */
+static void fleet_entry_complete(struct fleet_entry *entry,
+		enum arsdk_updater_req_status status,
+		int error)
+{
+	struct arsdk_updater_fleet *fleet = entry->fleet;
+
+	list_del(&entry->node);
+	if (entry->req != NULL)
+		fleet->running_nb--;
+	fleet->done_nb++;
+	if (status == ARSDK_UPDATER_REQ_STATUS_OK)
+		fleet->ok_nb++;
+
+	if (!fleet->destroying) {
+		(*fleet->cbs.device_complete)(fleet, entry->handle, status,
+				error, fleet->cbs.userdata);
+	}
+
+	free(entry);
+}
+
+/**
+ */
+static void upload_progress_cb(struct arsdk_updater_itf *itf,
+		struct arsdk_updater_req_upload *req,
+		float percent,
+		void *userdata)
+{
+	struct fleet_entry *entry = userdata;
+	struct arsdk_updater_fleet *fleet = entry->fleet;
+
+	if (fleet == NULL || fleet->destroying)
+		return;
+
+	(*fleet->cbs.progress)(fleet, entry->handle, percent,
+			fleet->cbs.userdata);
+}
+
+static void fleet_process(struct arsdk_updater_fleet *fleet);
+
+/**
+ */
+static void upload_complete_cb(struct arsdk_updater_itf *itf,
+		struct arsdk_updater_req_upload *req,
+		enum arsdk_updater_req_status status,
+		int error,
+		void *userdata)
+{
+	struct fleet_entry *entry = userdata;
+	struct arsdk_updater_fleet *fleet = entry->fleet;
+
+	/* fleet update destroyed meanwhile */
+	if (fleet == NULL) {
+		free(entry);
+		return;
+	}
+
+	fleet_entry_complete(entry, status, error);
+	fleet_process(fleet);
+}
+
+/**
+ */
+static void fleet_entry_start(struct fleet_entry *entry)
+{
+	struct arsdk_updater_fleet *fleet = entry->fleet;
+	struct arsdk_updater_req_upload_cbs cbs;
+	struct arsdk_updater_itf *itf = NULL;
+	struct arsdk_device *device = NULL;
+	int res = 0;
+
+	/* the device may have been removed since it was added */
+	device = arsdk_ctrl_get_device(fleet->ctrl, entry->handle);
+	if (device == NULL) {
+		fleet_entry_complete(entry, ARSDK_UPDATER_REQ_STATUS_ABORTED,
+				-ENODEV);
+		return;
+	}
+
+	res = arsdk_device_get_updater_itf(device, &itf);
+	if (res < 0)
+		goto error;
+
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.userdata = entry;
+	cbs.progress = &upload_progress_cb;
+	cbs.complete = &upload_complete_cb;
+
+	res = arsdk_updater_itf_create_req_upload(itf, fleet->fw_filepath,
+			entry->dev_type, &cbs, &entry->req);
+	if (res < 0)
+		goto error;
+
+	list_del(&entry->node);
+	list_add_before(&fleet->running, &entry->node);
+	fleet->running_nb++;
+	return;
+
+error:
+	ARSDK_LOGW("fleet update: device 0x%04x not started: %s",
+			entry->handle, strerror(-res));
+	fleet_entry_complete(entry, ARSDK_UPDATER_REQ_STATUS_FAILED, res);
+}
+
+/**
+ */
+static void fleet_process(struct arsdk_updater_fleet *fleet)
+{
+	struct fleet_entry *entry = NULL;
+
+	if (fleet->busy > 0 || fleet->destroying)
+		return;
+
+	/* uploads may complete synchronously */
+	fleet->busy++;
+	while (!list_is_empty(&fleet->queued)) {
+		entry = list_entry(list_first(&fleet->queued),
+				struct fleet_entry, node);
+		if (fleet->canceled) {
+			fleet_entry_complete(entry,
+					ARSDK_UPDATER_REQ_STATUS_CANCELED, 0);
+		} else if (fleet->error < 0) {
+			fleet_entry_complete(entry,
+					ARSDK_UPDATER_REQ_STATUS_FAILED,
+					fleet->error);
+		} else if (!fleet->started || !fleet->digested ||
+			   (fleet->max_concurrent != 0 &&
+			    fleet->running_nb >= fleet->max_concurrent)) {
+			break;
+		} else {
+			fleet_entry_start(entry);
+		}
+	}
+	fleet->busy--;
+
+	/* a fleet update canceled before its start completes as well */
+	if (fleet->completed || (!fleet->started && !fleet->canceled) ||
+	    fleet->digest_job != NULL || fleet->done_nb < fleet->total_nb)
+		return;
+
+	/* the fleet update may be destroyed by the callback */
+	fleet->completed = 1;
+	(*fleet->cbs.complete)(fleet, fleet->ok_nb, fleet->total_nb,
+			fleet->cbs.userdata);
+}
+
+/**
+ */
+static void fleet_digest_cb(int status,
+		const uint8_t *md5,
+		void *userdata)
+{
+	struct arsdk_updater_fleet *fleet = userdata;
+
+	fleet->digest_job = NULL;
+
+	/* the uploads find the digest in cache */
+	if (status < 0) {
+		ARSDK_LOG_ERRNO("fleet update: firmware digest", -status);
+		fleet->error = status;
+	} else {
+		fleet->digested = 1;
+	}
+
+	fleet_process(fleet);
+}
+
+/**
+ */
+int arsdk_updater_fleet_new(struct arsdk_ctrl *ctrl,
+		const char *fw_filepath,
+		uint32_t max_concurrent,
+		const struct arsdk_updater_fleet_cbs *cbs,
+		struct arsdk_updater_fleet **ret_fleet)
+{
+	struct arsdk_updater_fleet *fleet = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_fleet != NULL, -EINVAL);
+	*ret_fleet = NULL;
+	ARSDK_RETURN_ERR_IF_FAILED(ctrl != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(fw_filepath != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs->progress != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs->device_complete != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cbs->complete != NULL, -EINVAL);
+
+	fleet = calloc(1, sizeof(*fleet));
+	if (fleet == NULL)
+		return -ENOMEM;
+
+	fleet->fw_filepath = strdup(fw_filepath);
+	if (fleet->fw_filepath == NULL) {
+		free(fleet);
+		return -ENOMEM;
+	}
+
+	fleet->ctrl = ctrl;
+	fleet->max_concurrent = max_concurrent;
+	fleet->cbs = *cbs;
+	list_init(&fleet->queued);
+	list_init(&fleet->running);
+
+	*ret_fleet = fleet;
+	return 0;
+}
+
+/**
+ */
+int arsdk_updater_fleet_add_device(struct arsdk_updater_fleet *fleet,
+		struct arsdk_device *device)
+{
+	const struct arsdk_device_info *info = NULL;
+	struct fleet_entry *entry = NULL;
+	int res = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(fleet != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(device != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(!fleet->completed, -EPERM);
+	ARSDK_RETURN_ERR_IF_FAILED(!fleet->canceled, -EPERM);
+
+	res = arsdk_device_get_info(device, &info);
+	if (res < 0)
+		return res;
+
+	entry = calloc(1, sizeof(*entry));
+	if (entry == NULL)
+		return -ENOMEM;
+
+	entry->fleet = fleet;
+	entry->handle = arsdk_device_get_handle(device);
+	entry->dev_type = info->type;
+	list_add_before(&fleet->queued, &entry->node);
+	fleet->total_nb++;
+
+	fleet_process(fleet);
+	return 0;
+}
+
+/**
+ */
+int arsdk_updater_fleet_start(struct arsdk_updater_fleet *fleet)
+{
+	int res = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(fleet != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(!fleet->started, -EBUSY);
+	ARSDK_RETURN_ERR_IF_FAILED(!fleet->canceled, -EPERM);
+
+	/* read the firmware once before the uploads */
+	res = arsdk_updater_digest_compute(
+			arsdk_ctrl_get_updater_digest(fleet->ctrl),
+			fleet->fw_filepath, &fleet_digest_cb, fleet,
+			&fleet->digest_job);
+	if (res < 0)
+		return res;
+
+	ARSDK_LOGI("fleet update: %zu devices, firmware '%s'",
+			fleet->total_nb, fleet->fw_filepath);
+
+	fleet->started = 1;
+	return 0;
+}
+
+/**
+ */
+static void fleet_cancel_running(struct arsdk_updater_fleet *fleet)
+{
+	struct fleet_entry *entry = NULL;
+	struct fleet_entry *entry_tmp = NULL;
+
+	if (fleet->digest_job != NULL) {
+		arsdk_updater_digest_cancel(fleet->digest_job);
+		fleet->digest_job = NULL;
+	}
+
+	/* requests complete synchronously when canceled */
+	fleet->busy++;
+	list_walk_entry_forward_safe(&fleet->running, entry, entry_tmp, node) {
+		arsdk_updater_req_upload_cancel(entry->req);
+	}
+	fleet->busy--;
+}
+
+/**
+ */
+int arsdk_updater_fleet_cancel(struct arsdk_updater_fleet *fleet)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(fleet != NULL, -EINVAL);
+
+	if (fleet->canceled || fleet->completed)
+		return 0;
+
+	fleet->canceled = 1;
+	fleet_cancel_running(fleet);
+	fleet_process(fleet);
+	return 0;
+}
+
+/**
+ */
+int arsdk_updater_fleet_destroy(struct arsdk_updater_fleet *fleet)
+{
+	struct fleet_entry *entry = NULL;
+	struct fleet_entry *entry_tmp = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(fleet != NULL, -EINVAL);
+
+	fleet->destroying = 1;
+	fleet_cancel_running(fleet);
+
+	list_walk_entry_forward_safe(&fleet->queued, entry, entry_tmp, node) {
+		list_del(&entry->node);
+		free(entry);
+	}
+
+	/* uploads not completed yet free their entry on completion */
+	list_walk_entry_forward_safe(&fleet->running, entry, entry_tmp, node) {
+		ARSDK_LOGW("fleet update: device 0x%04x upload still pending",
+				entry->handle);
+		list_del(&entry->node);
+		entry->fleet = NULL;
+	}
+
+	free(fleet->fw_filepath);
+	free(fleet);
+	return 0;
+}
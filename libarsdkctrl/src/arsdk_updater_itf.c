@@ -31,6 +31,7 @@
 
 #include "updater/arsdk_updater_transport_ftp.h"
 #include "updater/arsdk_updater_transport_mux.h"
+#include "updater/arsdk_updater_digest.h"
 
 #include "arsdk_updater_itf_priv.h"
 #ifdef BUILD_LIBPUF
@@ -41,6 +42,10 @@
 /** */
 struct arsdk_updater_itf {
 	struct arsdk_device_info                *dev_info;
+	struct pomp_loop                        *loop;
+	/* digest engine, shared or owned */
+	struct arsdk_updater_digest             *digest;
+	int                                     digest_owned;
 	struct arsdk_updater_transport_ftp      *ftp_tsprt;
 	struct arsdk_updater_transport_mux      *mux_tsprt;
 };
@@ -54,6 +59,7 @@ struct arsdk_updater_req_upload {
 };
 
 int arsdk_updater_itf_new(struct arsdk_device_info *dev_info,
+		struct pomp_loop *loop,
 		struct arsdk_ftp_itf *ftp_itf,
 		struct mux_ctx *mux,
 		struct arsdk_updater_itf **ret_itf)
@@ -64,6 +70,7 @@ int arsdk_updater_itf_new(struct arsdk_device_info *dev_info,
 	ARSDK_RETURN_ERR_IF_FAILED(ret_itf != NULL, -EINVAL);
 	*ret_itf = NULL;
 	ARSDK_RETURN_ERR_IF_FAILED(dev_info != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(loop != NULL, -EINVAL);
 
 	/* Allocate structure */
 	itf = calloc(1, sizeof(*itf));
@@ -72,6 +79,7 @@ int arsdk_updater_itf_new(struct arsdk_device_info *dev_info,
 
 	/* Initialize structure */
 	itf->dev_info = dev_info;
+	itf->loop = loop;
 
 	if (ftp_itf != NULL) {
 		res = arsdk_updater_transport_ftp_new(itf, ftp_itf,
@@ -131,10 +139,45 @@ int arsdk_updater_itf_destroy(struct arsdk_updater_itf *itf)
 	if (itf->mux_tsprt != NULL)
 		arsdk_updater_transport_mux_destroy(itf->mux_tsprt);
 
+	if (itf->digest_owned)
+		arsdk_updater_digest_destroy(itf->digest);
+
 	free(itf);
 	return 0;
 }
 
+int arsdk_updater_itf_set_digest(struct arsdk_updater_itf *itf,
+		struct arsdk_updater_digest *digest)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(itf != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(digest != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(itf->digest == NULL, -EBUSY);
+
+	itf->digest = digest;
+	return 0;
+}
+
+struct arsdk_updater_digest *arsdk_updater_itf_get_digest(
+		struct arsdk_updater_itf *itf)
+{
+	int res = 0;
+
+	if (itf == NULL)
+		return NULL;
+
+	/* own engine if none is shared */
+	if (itf->digest == NULL) {
+		res = arsdk_updater_digest_new(itf->loop, &itf->digest);
+		if (res < 0) {
+			ARSDK_LOG_ERRNO("arsdk_updater_digest_new", -res);
+			return NULL;
+		}
+		itf->digest_owned = 1;
+	}
+
+	return itf->digest;
+}
+
 static struct arsdk_updater_transport *get_tsprt(struct arsdk_updater_itf *itf,
 		enum arsdk_device_type dev_type)
 {
@@ -280,9 +323,7 @@ int arsdk_updater_read_fw_info(const char *fw_filepath,
 		goto end;
 	}
 	info->size = res;
-
-	/* calculate md5sum */
-	res = arsdk_md5_compute(fd, info->md5);
+	res = 0;
 
 end:
 	if (fd != -1) {
@@ -34,12 +34,14 @@
 /**
  * Create a updater interface.
  * @param dev_info : device information.
+ * @param loop : loop of the device.
  * @param ftp_itf : ftp interface.
  * @param mux_ctx : mux context.
  * @param ret_itf : will receive the updater interface.
  * @return 0 in case of success, negative errno value in case of error.
  */
 int arsdk_updater_itf_new(struct arsdk_device_info *dev_info,
+		struct pomp_loop *loop,
 		struct arsdk_ftp_itf *ftp_itf,
 		struct mux_ctx *mux,
 		struct arsdk_updater_itf **ret_itf);
@@ -58,6 +60,26 @@ int arsdk_updater_itf_destroy(struct arsdk_updater_itf *itf);
  */
 int arsdk_updater_itf_stop(struct arsdk_updater_itf *itf);
 
+struct arsdk_updater_digest;
+
+/**
+ * Share a firmware digest engine with other interfaces; must be called before
+ * any request.
+ * @param itf : updater interface.
+ * @param digest : digest engine running on the loop of the interface.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_updater_itf_set_digest(struct arsdk_updater_itf *itf,
+		struct arsdk_updater_digest *digest);
+
+/**
+ * Get the firmware digest engine, created if none is shared.
+ * @param itf : updater interface.
+ * @return digest engine, NULL in case of error.
+ */
+struct arsdk_updater_digest *arsdk_updater_itf_get_digest(
+		struct arsdk_updater_itf *itf);
+
 /**
  * Create a updater firmware "upload" request.
  * @param child : child.
@@ -112,7 +134,8 @@ struct arsdk_updater_fw_info {
 };
 
 /**
- * Read firmware information from file
+ * Read firmware information from file; the md5 is not computed, it is
+ * obtained from the digest engine of the interface.
  * @param fw_filepath : firmware file path.
  * @param info : information of the firmware.
  * @return 0 in case of success, negative errno value in case of error.
@@ -156,4 +156,9 @@ int arsdk_ctrl_register_discovery(struct arsdk_ctrl *ctrl,
 int arsdk_ctrl_unregister_discovery(struct arsdk_ctrl *ctrl,
 		struct arsdk_discovery *discovery);
 
+struct arsdk_ftp_sched *arsdk_ctrl_get_ftp_sched(struct arsdk_ctrl *ctrl);
+
+struct arsdk_updater_digest *arsdk_ctrl_get_updater_digest(
+		struct arsdk_ctrl *ctrl);
+
 #endif /* !_ARSDKCTRL_PRIV_H_ */
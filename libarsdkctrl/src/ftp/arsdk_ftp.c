@@ -29,6 +29,8 @@
 #include "arsdk_ftp_cmd.h"
 #include "arsdk_ftp_conn.h"
 #include "arsdk_ftp_seq.h"
+#include "arsdk_ftp_sched.h"
+#include "arsdk_ftp_rate.h"
 #include "arsdk_ftp.h"
 
 #ifdef BUILD_LIBULOG
@@ -51,15 +53,55 @@ struct arsdk_ftp_req {
 	struct list_node                node;
 	enum arsdk_ftp_req_type         type;
 	char                            *url;
+	struct sockaddr_in              addr;
 	struct arsdk_ftp_conn_elem      *conn_elem;
 	struct arsdk_ftp_seq            *ftp_seq;
 	struct {
 		size_t                  tsize;
 		size_t                  size;
 	} stream;
+	/* modification time given by a "size" request, 0 if unknown */
+	time_t                          mtime;
+	/* last progress notified */
+	struct {
+		size_t                  size;
+		uint64_t                ts_us;
+	} progress;
+	/* rate of the transfer, the timer resumes it once paused */
+	struct arsdk_ftp_rate           rate;
+	struct pomp_timer               *rate_timer;
+	/* byte range of "get range" requests, 'len' is 0 otherwise */
+	struct {
+		uint64_t                len;
+		int                     done;
+	} range;
+	/* transfer waiting for a slot of the scheduler */
+	struct arsdk_ftp_sched_entry    sched;
+	const char                      *path;
+	uint64_t                        offset;
 	uint8_t                         is_aborted;
+	/* to cancel by arsdk_ftp_cancel_all() or arsdk_ftp_abort_all() */
+	uint8_t                         is_canceling;
 };
 
+/** Count of buckets of idle connections, hashed by address */
+#define CONN_BUCKET_COUNT 16
+
+/** Maximum count of idle connections kept alive per context */
+#define CONN_IDLE_MAX 4
+
+/** Maximum count of servers whose features are kept */
+#define SERVER_MAX 8
+
+/** Period of the health checks of the idle connections (ms) */
+#define CONN_KEEPALIVE_PERIOD 15000
+
+/** Default minimal data transferred between two progress notifications */
+#define PROGRESS_MIN_LEN_DEFAULT (64 * 1024)
+
+/** Default minimal period between two progress notifications (ms) */
+#define PROGRESS_PERIOD_DEFAULT 100
+
 struct arsdk_ftp {
 	/* event loop */
 	struct pomp_loop *loop;
@@ -68,15 +110,42 @@ struct arsdk_ftp {
 	char *username;
 	char *password;
 
+	/* features of the servers already connected */
+	struct list_node servers;
+	int feat_query_disabled;
+
 	/* idle connections */
-	struct list_node conns_idle;
+	struct list_node conns_idle[CONN_BUCKET_COUNT];
+	uint32_t conns_idle_count;
 	/* busy connections */
 	struct list_node conns_busy;
 
+	/* transfer scheduler client, NULL to start transfers immediately */
+	struct arsdk_ftp_sched_client *sched_client;
+
 	/* request list */
 	struct list_node requests;
 
 	struct arsdk_ftp_cbs cbs;
+
+	/* fragmentation of "put" requests */
+	struct arsdk_ftp_seq_upload_cfg upload_cfg;
+
+	/* rate of the progress notifications, 0 to ignore a criterion */
+	struct {
+		size_t min_len;
+		uint32_t period_ms;
+	} progress_cfg;
+
+	/* bandwidth of the transfers */
+	struct {
+		/* rate of each transfer, 0 for no limit */
+		uint64_t req_max_rate;
+		/* rate of all the transfers of the context */
+		struct arsdk_ftp_rate rate;
+		/* data transferred since the creation of the context */
+		uint64_t transferred;
+	} bw;
 };
 
 enum arsdk_ftp_conn_elem_state {
@@ -85,10 +154,24 @@ enum arsdk_ftp_conn_elem_state {
 	ARSDK_FTP_CONN_ELEM_STATE_USED,
 };
 
+struct arsdk_ftp_server {
+	struct list_node                node;
+	struct sockaddr_in              addr;
+	uint32_t                        feats;
+};
+
 struct arsdk_ftp_conn_elem {
 	struct arsdk_ftp_conn           *conn;
 	struct arsdk_ftp                *ctx;
 	struct list_node                node;
+	/* request using the connection */
+	struct arsdk_ftp_req            *req;
+	/* health check of the idle connection */
+	struct pomp_timer               *timer;
+	int                             is_idle;
+	int                             check_pending;
+	/* replies to an interrupted transfer are still to be received */
+	int                             resync;
 };
 
 int arsdk_ftp_new(struct pomp_loop *loop,
@@ -98,6 +181,7 @@ int arsdk_ftp_new(struct pomp_loop *loop,
 		struct arsdk_ftp **ret_ctx)
 {
 	struct arsdk_ftp *ctx;
+	int i = 0;
 
 	ARSDK_RETURN_ERR_IF_FAILED(loop != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(cbs != NULL, -EINVAL);
@@ -112,9 +196,14 @@ int arsdk_ftp_new(struct pomp_loop *loop,
 	ctx->username = xstrdup(username);
 	ctx->password = xstrdup(password);
 	ctx->cbs = *cbs;
+	ctx->progress_cfg.min_len = PROGRESS_MIN_LEN_DEFAULT;
+	ctx->progress_cfg.period_ms = PROGRESS_PERIOD_DEFAULT;
+
+	list_init(&ctx->servers);
 
-	/* init list of idle connections */
-	list_init(&ctx->conns_idle);
+	/* init lists of idle connections */
+	for (i = 0; i < CONN_BUCKET_COUNT; i++)
+		list_init(&ctx->conns_idle[i]);
 	/* init list of busy connections */
 	list_init(&ctx->conns_busy);
 
@@ -124,12 +213,99 @@ int arsdk_ftp_new(struct pomp_loop *loop,
 	return 0;
 }
 
+int arsdk_ftp_set_upload_cfg(struct arsdk_ftp *ctx,
+		size_t frag_len,
+		uint32_t frag_count)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
+
+	ctx->upload_cfg.frag_len = frag_len;
+	ctx->upload_cfg.frag_count = frag_count;
+	return 0;
+}
+
+int arsdk_ftp_set_progress_cfg(struct arsdk_ftp *ctx,
+		size_t min_len,
+		uint32_t period_ms)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
+
+	ctx->progress_cfg.min_len = min_len;
+	ctx->progress_cfg.period_ms = period_ms;
+	return 0;
+}
+
+int arsdk_ftp_set_max_rate(struct arsdk_ftp *ctx, uint64_t max_rate)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
+
+	arsdk_ftp_rate_set(&ctx->bw.rate, max_rate);
+	return 0;
+}
+
+int arsdk_ftp_set_req_max_rate(struct arsdk_ftp *ctx, uint64_t max_rate)
+{
+	struct arsdk_ftp_req *req = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
+
+	ctx->bw.req_max_rate = max_rate;
+	list_walk_entry_forward(&ctx->requests, req, node)
+		arsdk_ftp_rate_set(&req->rate, max_rate);
+	return 0;
+}
+
+uint64_t arsdk_ftp_get_transferred(struct arsdk_ftp *ctx)
+{
+	return (ctx != NULL) ? ctx->bw.transferred : 0;
+}
+
+int arsdk_ftp_set_feat_query(struct arsdk_ftp *ctx, int enable)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
+
+	ctx->feat_query_disabled = !enable;
+	return 0;
+}
+
+int arsdk_ftp_set_sched(struct arsdk_ftp *ctx,
+		struct arsdk_ftp_sched *sched)
+{
+	int res = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(ctx->sched_client == NULL, -EBUSY);
+	ARSDK_RETURN_ERR_IF_FAILED(list_is_empty(&ctx->requests), -EBUSY);
+
+	if (sched == NULL)
+		return 0;
+
+	res = arsdk_ftp_sched_add_client(sched, &ctx->sched_client);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("arsdk_ftp_sched_add_client", -res);
+	return res;
+}
+
 int arsdk_ftp_destroy(struct arsdk_ftp *ctx)
 {
+	int res = 0;
+	struct arsdk_ftp_server *server = NULL;
+	struct arsdk_ftp_server *server_tmp = NULL;
+
 	if (ctx == NULL)
 		return -EINVAL;
 
 	arsdk_ftp_stop(ctx);
+	list_walk_entry_forward_safe(&ctx->servers, server, server_tmp,
+			node) {
+		list_del(&server->node);
+		free(server);
+	}
+	if (ctx->sched_client != NULL) {
+		res = arsdk_ftp_sched_remove_client(ctx->sched_client);
+		if (res < 0)
+			ARSDK_LOG_ERRNO("arsdk_ftp_sched_remove_client", -res);
+	}
 	free(ctx->username);
 	free(ctx->password);
 	free(ctx);
@@ -142,10 +318,17 @@ static void conn_elem_destroy(struct arsdk_ftp_conn_elem *elem)
 {
 	ARSDK_RETURN_IF_FAILED(elem != NULL, -EINVAL);
 
+	if (elem->timer != NULL) {
+		pomp_timer_clear(elem->timer);
+		pomp_timer_destroy(elem->timer);
+	}
 	arsdk_ftp_conn_destroy(elem->conn);
 	free(elem);
 }
 
+/* forward declaration */
+static void conn_keepalive_cb(struct pomp_timer *timer, void *userdata);
+
 /**
  */
 static int conn_elem_new(struct arsdk_ftp *ctx,
@@ -159,6 +342,12 @@ static int conn_elem_new(struct arsdk_ftp *ctx,
 	if (elem == NULL)
 		return -ENOMEM;
 
+	elem->timer = pomp_timer_new(ctx->loop, &conn_keepalive_cb, elem);
+	if (elem->timer == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
 	/* Create connection */
 	res = arsdk_ftp_conn_new(ctx->loop, addr, addrlen,
 			ctx->username, ctx->password, &elem->conn);
@@ -179,9 +368,120 @@ static void conn_elem_destroy_cb(void *userdata)
 	conn_elem_destroy(userdata);
 }
 
+/**
+ * Removes a connection element from its list.
+ */
+static void conn_elem_unlink(struct arsdk_ftp_conn_elem *elem)
+{
+	list_del(&elem->node);
+	if (elem->is_idle) {
+		elem->is_idle = 0;
+		elem->ctx->conns_idle_count--;
+		pomp_timer_clear(elem->timer);
+	}
+}
+
+/**
+ * Closes an idle connection, out of the connection callbacks.
+ */
+static void conn_elem_drop(struct arsdk_ftp_conn_elem *elem)
+{
+	conn_elem_unlink(elem);
+	arsdk_ftp_conn_remove_listener(elem->conn, elem);
+	pomp_loop_idle_add(elem->ctx->loop, &conn_elem_destroy_cb, elem);
+}
+
+static int conn_elem_send_noop(struct arsdk_ftp_conn_elem *elem)
+{
+	int res = 0;
+	struct pomp_buffer *buff = NULL;
+
+	res = arsdk_ftp_cmd_enc(&ARSDK_FTP_CMD_NOOP, "", &buff);
+	if (res < 0)
+		return res;
+
+	res = arsdk_ftp_conn_send(elem->conn, buff);
+	pomp_buffer_unref(buff);
+	return res;
+}
+
+static void conn_keepalive_cb(struct pomp_timer *timer, void *userdata)
+{
+	int res = 0;
+	struct arsdk_ftp_conn_elem *elem = userdata;
+
+	ARSDK_RETURN_IF_FAILED(elem != NULL, -EINVAL);
+
+	/* no answer to the previous check or login not done in time */
+	if (elem->check_pending) {
+		ARSDK_LOGW("ftp connection %p not responding, closing it",
+				elem);
+		conn_elem_drop(elem);
+		return;
+	}
+
+	/* checked by the login if it is still in progress */
+	elem->check_pending = 1;
+	if (arsdk_ftp_conn_is_connected(elem->conn)) {
+		res = conn_elem_send_noop(elem);
+		if (res < 0) {
+			ARSDK_LOG_ERRNO("conn_elem_send_noop", -res);
+			conn_elem_drop(elem);
+			return;
+		}
+	}
+
+	res = pomp_timer_set(elem->timer, CONN_KEEPALIVE_PERIOD);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("pomp_timer_set", -res);
+}
+
+static struct arsdk_ftp_server *find_server(struct arsdk_ftp *ctx,
+		const struct sockaddr_in *addr)
+{
+	struct arsdk_ftp_server *server = NULL;
+
+	list_walk_entry_forward(&ctx->servers, server, node) {
+		if (server->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+		    server->addr.sin_port == addr->sin_port)
+			return server;
+	}
+
+	return NULL;
+}
+
 static void connected_cb(struct arsdk_ftp_conn *conn, void *userdata)
 {
-	/* do nothing */
+	struct arsdk_ftp_conn_elem *elem = userdata;
+	const struct sockaddr *addr = NULL;
+	uint32_t addrlen = 0;
+	struct arsdk_ftp_server *server = NULL;
+
+	ARSDK_RETURN_IF_FAILED(elem != NULL, -EINVAL);
+
+	/* keep the features of the server for the next connections */
+	addr = arsdk_ftp_conn_get_addr(conn, &addrlen);
+	if (addr != NULL && addrlen == sizeof(server->addr) &&
+	    find_server(elem->ctx, (const struct sockaddr_in *)addr) == NULL) {
+		/* forget the oldest server */
+		if (list_length(&elem->ctx->servers) >= SERVER_MAX) {
+			server = list_entry(list_first(&elem->ctx->servers),
+					struct arsdk_ftp_server, node);
+			list_del(&server->node);
+			free(server);
+		}
+
+		server = calloc(1, sizeof(*server));
+		if (server != NULL) {
+			memcpy(&server->addr, addr, sizeof(server->addr));
+			server->feats = arsdk_ftp_conn_get_feats(conn);
+			list_add_before(&elem->ctx->servers, &server->node);
+		}
+	}
+
+	/* logged in, ready to be used */
+	if (elem->is_idle)
+		elem->check_pending = 0;
 }
 
 static void disconnected_cb(struct arsdk_ftp_conn *conn, void *userdata)
@@ -190,8 +490,12 @@ static void disconnected_cb(struct arsdk_ftp_conn *conn, void *userdata)
 
 	ARSDK_RETURN_IF_FAILED(elem != NULL, -EINVAL);
 
+	/* detach the connection from its request */
+	if (elem->req != NULL)
+		elem->req->conn_elem = NULL;
+
 	/* delete connection */
-	list_del(&elem->node);
+	conn_elem_unlink(elem);
 	/* dispatch req destroy out of ftp connection ctx */
 	pomp_loop_idle_add(elem->ctx->loop, &conn_elem_destroy_cb, elem);
 }
@@ -199,7 +503,32 @@ static void disconnected_cb(struct arsdk_ftp_conn *conn, void *userdata)
 static void recv_response_cb(struct arsdk_ftp_conn *conn,
 		struct arsdk_ftp_cmd_result *response, void *userdata)
 {
-	/* do nothing */
+	struct arsdk_ftp_conn_elem *elem = userdata;
+
+	ARSDK_RETURN_IF_FAILED(elem != NULL, -EINVAL);
+
+	/* responses to the requests are handled by their sequences */
+	if (!elem->is_idle)
+		return;
+
+	/* the health check is the last command sent, its reply is the last
+	 * one; the previous ones end the transfer interrupted before it */
+	if (elem->check_pending &&
+	    arsdk_ftp_conn_get_replies_pending(conn) == 0 &&
+	    response->code == 200) {
+		elem->check_pending = 0;
+		elem->resync = 0;
+		return;
+	}
+
+	/* end of the transfer interrupted before the health check */
+	if (elem->resync && arsdk_ftp_conn_get_replies_pending(conn) > 0)
+		return;
+
+	/* unexpected response, such as a server timeout (421) */
+	ARSDK_LOGI("idle ftp connection %p closed on response %d",
+			elem, response->code);
+	conn_elem_drop(elem);
 }
 
 static void conn_socket_cb(struct arsdk_ftp_conn *conn, int fd, void *userdata)
@@ -229,6 +558,74 @@ static int url_to_addr(const char *url_src, struct sockaddr_in *addr)
 	return 0;
 }
 
+/**
+ * Gives the list of idle connections to an address.
+ */
+static struct list_node *conn_bucket(struct arsdk_ftp *ctx,
+		const struct sockaddr_in *addr)
+{
+	uint32_t key = addr->sin_addr.s_addr ^ addr->sin_port;
+
+	key ^= key >> 16;
+	key ^= key >> 8;
+	return &ctx->conns_idle[key % CONN_BUCKET_COUNT];
+}
+
+static int conn_elem_match(struct arsdk_ftp_conn_elem *elem,
+		const struct sockaddr_in *addr)
+{
+	const struct sockaddr *elem_addr = NULL;
+	uint32_t elem_addrlen = 0;
+
+	elem_addr = arsdk_ftp_conn_get_addr(elem->conn, &elem_addrlen);
+	if ((elem_addr == NULL) || (elem_addrlen != sizeof(*addr)))
+		return 0;
+
+	return memcmp(addr, elem_addr, sizeof(*addr)) == 0;
+}
+
+/**
+ * Keeps a connection no more used by a request in the idle connections,
+ * checked periodically until its next use.
+ * A connection of an interrupted transfer is checked at once; it is reused
+ * after the reply to the check, which follows the replies to the transfer.
+ */
+static void conn_elem_release(struct arsdk_ftp_conn_elem *elem,
+		const struct sockaddr_in *addr,
+		int interrupted)
+{
+	int res = 0;
+	struct arsdk_ftp *ctx = elem->ctx;
+	int connected = arsdk_ftp_conn_is_connected(elem->conn);
+
+	elem->req = NULL;
+	if (ctx->conns_idle_count >= CONN_IDLE_MAX) {
+		conn_elem_drop(elem);
+		return;
+	}
+
+	if (interrupted && connected) {
+		res = conn_elem_send_noop(elem);
+		if (res < 0) {
+			ARSDK_LOG_ERRNO("conn_elem_send_noop", -res);
+			conn_elem_drop(elem);
+			return;
+		}
+	}
+
+	list_del(&elem->node);
+	list_add_before(conn_bucket(ctx, addr), &elem->node);
+	elem->is_idle = 1;
+	ctx->conns_idle_count++;
+
+	/* still logging in connections are checked by the login */
+	elem->check_pending = !connected || interrupted;
+	elem->resync = interrupted && connected;
+	res = pomp_timer_set(elem->timer, CONN_KEEPALIVE_PERIOD);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("pomp_timer_set", -res);
+}
+
 static enum arsdk_ftp_status
 seq_status_to_ftp_status(enum arsdk_ftp_seq_status status)
 {
@@ -246,28 +643,154 @@ seq_status_to_ftp_status(enum arsdk_ftp_seq_status status)
 	}
 }
 
+static void range_done_idle_cb(void *userdata)
+{
+	struct arsdk_ftp_req *req = userdata;
+
+	/* stop the transfer, the server still sends the end of the file */
+	arsdk_ftp_seq_stop(req->ftp_seq);
+}
+
 /**
  */
 static void req_destroy(struct arsdk_ftp_req *req)
 {
 	struct arsdk_ftp_conn_elem *elem = NULL;
-	struct arsdk_ftp_conn_elem *tmp = NULL;
 
 	ARSDK_RETURN_IF_FAILED(req != NULL, -EINVAL);
 	ARSDK_RETURN_IF_FAILED(req->ctx != NULL, -EINVAL);
 
-	list_walk_entry_forward_safe(&req->ctx->conns_busy, elem, tmp, node) {
-		if (elem == req->conn_elem) {
-			list_del(&elem->node);
-			list_add_before(&req->ctx->conns_idle, &elem->node);
-		}
+	pomp_loop_idle_remove(req->ctx->loop, &range_done_idle_cb, req);
+	arsdk_ftp_sched_release(&req->sched);
+	if (req->rate_timer != NULL) {
+		pomp_timer_clear(req->rate_timer);
+		pomp_timer_destroy(req->rate_timer);
 	}
 
+	/* the connection element is detached if disconnected */
+	/* a range transfer is interrupted before its end */
+	elem = req->conn_elem;
+	if (elem != NULL)
+		conn_elem_release(elem, &req->addr, req->range.len > 0);
+
 	arsdk_ftp_seq_destroy(req->ftp_seq);
 	free(req->url);
 	free(req);
 }
 
+static void rate_timer_cb(struct pomp_timer *timer, void *userdata)
+{
+	int res = 0;
+	struct arsdk_ftp_req *req = userdata;
+
+	if (req->ftp_seq == NULL)
+		return;
+
+	res = arsdk_ftp_seq_resume_data(req->ftp_seq);
+	if (res < 0)
+		ARSDK_LOG_ERRNO("arsdk_ftp_seq_resume_data", -res);
+}
+
+/**
+ * Accounts the data transferred by a request and pauses the transfer while
+ * it exceeds the rate of the request, of the context or of the scheduler.
+ */
+static void req_throttle(struct arsdk_ftp_req *req, size_t len)
+{
+	int res = 0;
+	struct timespec now;
+	uint64_t now_us = 0;
+	uint32_t delay = 0;
+	uint32_t ctx_delay = 0;
+	uint32_t sched_delay = 0;
+	struct arsdk_ftp *ctx = req->ctx;
+
+	ctx->bw.transferred += len;
+	if (req->rate.max_rate == 0 && ctx->bw.rate.max_rate == 0 &&
+	    ctx->sched_client == NULL)
+		return;
+
+	if (time_get_monotonic(&now) < 0)
+		return;
+	time_timespec_to_us(&now, &now_us);
+
+	/* all the limits account the data */
+	delay = arsdk_ftp_rate_consume(&req->rate, len, now_us);
+	ctx_delay = arsdk_ftp_rate_consume(&ctx->bw.rate, len, now_us);
+	sched_delay = arsdk_ftp_sched_consume(ctx->sched_client, len, now_us);
+	if (ctx_delay > delay)
+		delay = ctx_delay;
+	if (sched_delay > delay)
+		delay = sched_delay;
+	if (delay == 0 || req->ftp_seq == NULL)
+		return;
+
+	if (req->rate_timer == NULL) {
+		req->rate_timer = pomp_timer_new(ctx->loop, &rate_timer_cb,
+				req);
+		if (req->rate_timer == NULL)
+			return;
+	}
+
+	res = arsdk_ftp_seq_pause_data(req->ftp_seq);
+	if (res < 0)
+		return;
+
+	res = pomp_timer_set(req->rate_timer, delay);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_timer_set", -res);
+		arsdk_ftp_seq_resume_data(req->ftp_seq);
+	}
+}
+
+/**
+ * Notifies the progress of the transfer.
+ */
+static void req_notify_progress(struct arsdk_ftp_req *req)
+{
+	double total = req->stream.tsize;
+	double now = req->stream.size;
+	float percent = (total == 0) ? 0.0f : (float)((now / total) * 100);
+
+	req->progress.size = req->stream.size;
+	if (req->type == ARSDK_FTP_REQ_TYPE_PUT) {
+		(*req->cbs.progress)(req->ctx, req, 0, 0, 0,
+				req->stream.tsize, req->stream.size, percent,
+				req->cbs.userdata);
+	} else {
+		(*req->cbs.progress)(req->ctx, req,
+				req->stream.tsize, req->stream.size, percent,
+				0, 0, 0, req->cbs.userdata);
+	}
+}
+
+/**
+ * Checks if the progress is to be notified: at the end of the transfer,
+ * or once enough data is transferred or enough time elapsed since the last
+ * notification.
+ */
+static int req_progress_due(struct arsdk_ftp_req *req)
+{
+	struct timespec now;
+	uint64_t now_us = 0;
+	size_t min_len = req->ctx->progress_cfg.min_len;
+	uint32_t period_ms = req->ctx->progress_cfg.period_ms;
+
+	if (period_ms != 0 && time_get_monotonic(&now) == 0)
+		time_timespec_to_us(&now, &now_us);
+
+	if (req->stream.size == req->stream.tsize ||
+	    (min_len == 0 && period_ms == 0) ||
+	    (min_len != 0 && req->stream.size - req->progress.size >= min_len) ||
+	    (now_us != 0 &&
+	     now_us - req->progress.ts_us >= (uint64_t)period_ms * 1000)) {
+		req->progress.ts_us = now_us;
+		return 1;
+	}
+
+	return 0;
+}
+
 static void seq_complete_cb(struct arsdk_ftp_seq *seq,
 		enum arsdk_ftp_seq_status seq_status,
 		int error,
@@ -287,6 +810,12 @@ static void seq_complete_cb(struct arsdk_ftp_seq *seq,
 		status = ARSDK_FTP_STATUS_FAILED;
 	if (req->is_aborted)
 		status = ARSDK_FTP_STATUS_ABORTED;
+	else if (req->range.done)
+		status = ARSDK_FTP_STATUS_OK;
+
+	/* progress not notified yet */
+	if (req->progress.size != req->stream.size)
+		req_notify_progress(req);
 
 	(*req->cbs.complete)(req->ctx, req, status, error, req->cbs.userdata);
 
@@ -304,9 +833,6 @@ static int seq_data_recv_cb(struct arsdk_ftp_seq *seq,
 	size_t len = 0;
 	int res = 0;
 	size_t wr_len = 0;
-	double dltotal = 0.0;
-	double dlnow = 0.0;
-	float dlpercent = 0.0f;
 
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
 
@@ -314,16 +840,13 @@ static int seq_data_recv_cb(struct arsdk_ftp_seq *seq,
 	if (res < 0)
 		return res;
 
-	/* update stream info */
-	req->stream.size += len;
-	dltotal = req->stream.tsize;
-	dlnow = req->stream.size;
-	dlpercent = (dltotal == 0) ? 0.0f : (float)((dlnow / dltotal) * 100);
-
-	/* progress callback */
-	(*req->cbs.progress)(req->ctx, req,
-			req->stream.tsize, req->stream.size, dlpercent,
-			0, 0, 0, req->cbs.userdata);
+	if (req->range.len > 0) {
+		/* data after the end of the range */
+		if (req->range.done)
+			return 0;
+		if (len > req->stream.tsize - req->stream.size)
+			len = req->stream.tsize - req->stream.size;
+	}
 
 	/* write callback */
 	wr_len = (*req->cbs.write_data)(req->ctx, req, cdata, 1, len,
@@ -331,17 +854,37 @@ static int seq_data_recv_cb(struct arsdk_ftp_seq *seq,
 	if (wr_len != len)
 		return -EIO;
 
+	/* update stream info */
+	req->stream.size += len;
+	if (req_progress_due(req))
+		req_notify_progress(req);
+
+	req_throttle(req, len);
+
+	if (req->range.len > 0 && req->stream.size == req->stream.tsize) {
+		/* end of the range, stop out of the data stream callback */
+		req->range.done = 1;
+		pomp_loop_idle_add(req->ctx->loop, &range_done_idle_cb, req);
+	}
+
 	return 0;
 }
 
+static void req_upload_progress(struct arsdk_ftp_req *req, size_t len)
+{
+	/* update stream info */
+	req->stream.size += len;
+	if (req_progress_due(req))
+		req_notify_progress(req);
+
+	req_throttle(req, len);
+}
+
 static size_t seq_data_send_cb(struct arsdk_ftp_seq *seq, void *buffer,
 		size_t cap, void *userdata)
 {
 	struct arsdk_ftp_req *req = userdata;
 	size_t read_len = 0;
-	double ultotal = 0.0;
-	double ulnow = 0.0;
-	float ulpercent = 0.0f;
 
 	if (req == NULL)
 		return 0;
@@ -350,22 +893,33 @@ static size_t seq_data_send_cb(struct arsdk_ftp_seq *seq, void *buffer,
 	read_len = (*req->cbs.read_data)(req->ctx, req, buffer, 1, cap,
 			req->cbs.userdata);
 
-	if (read_len > 0) {
-		/* update stream info */
-		req->stream.size += read_len;
-		ultotal = req->stream.tsize;
-		ulnow = req->stream.size;
-		ulpercent = (float)((ulnow / ultotal) * 100);
-
-		/* progress callback */
-		(*req->cbs.progress)(req->ctx, req, 0, 0, 0,
-				req->stream.tsize, req->stream.size, ulpercent,
-				req->cbs.userdata);
-	}
+	if (read_len > 0)
+		req_upload_progress(req, read_len);
 
 	return read_len;
 }
 
+static int seq_data_send_fd_cb(struct arsdk_ftp_seq *seq, off_t *offset,
+		void *userdata)
+{
+	struct arsdk_ftp_req *req = userdata;
+
+	if (req == NULL || req->cbs.read_fd == NULL)
+		return -1;
+
+	return (*req->cbs.read_fd)(req->ctx, req, offset, req->cbs.userdata);
+}
+
+static void seq_data_sent_cb(struct arsdk_ftp_seq *seq, size_t len,
+		void *userdata)
+{
+	struct arsdk_ftp_req *req = userdata;
+
+	ARSDK_RETURN_IF_FAILED(req != NULL, -EINVAL);
+
+	req_upload_progress(req, len);
+}
+
 static void seq_get_file_size_cb(struct arsdk_ftp_seq *seq,
 		size_t size,
 		void *userdata)
@@ -374,9 +928,24 @@ static void seq_get_file_size_cb(struct arsdk_ftp_seq *seq,
 
 	ARSDK_RETURN_IF_FAILED(req != NULL, -EINVAL);
 
+	/* the size of a range request is the range length */
+	if (req->range.len > 0)
+		return;
+
 	req->stream.tsize = size;
 }
 
+static void seq_get_file_mtime_cb(struct arsdk_ftp_seq *seq,
+		time_t mtime,
+		void *userdata)
+{
+	struct arsdk_ftp_req *req = userdata;
+
+	ARSDK_RETURN_IF_FAILED(req != NULL, -EINVAL);
+
+	req->mtime = mtime;
+}
+
 static void seq_socket_cb(struct arsdk_ftp_seq *seq, int fd, void *userdata)
 {
 	struct arsdk_ftp_req *req = userdata;
@@ -392,64 +961,107 @@ static struct arsdk_ftp_seq_cbs s_seq_cbs = {
 	.complete = &seq_complete_cb,
 	.data_recv = &seq_data_recv_cb,
 	.data_send = &seq_data_send_cb,
+	.data_send_fd = &seq_data_send_fd_cb,
+	.data_sent = &seq_data_sent_cb,
 	.file_size = &seq_get_file_size_cb,
+	.file_mtime = &seq_get_file_mtime_cb,
 	.socketcb = &seq_socket_cb,
 	.userdata = NULL,
 };
 
-static int get_conn_elem(struct arsdk_ftp *ctx, struct sockaddr *addr,
-		size_t addrlen, struct arsdk_ftp_conn_elem **ret_elem)
+/**
+ * Opens a new connection, added to the busy connections.
+ */
+static int conn_elem_open(struct arsdk_ftp *ctx,
+		struct sockaddr_in *addr,
+		struct arsdk_ftp_conn_elem **ret_elem)
 {
 	int res = 0;
 	struct arsdk_ftp_conn_elem *elem = NULL;
-	struct arsdk_ftp_conn_elem *pos = NULL;
-	struct arsdk_ftp_conn_elem *tmp = NULL;
 	struct arsdk_ftp_conn_cbs conn_cbs;
-	const struct sockaddr *idel_addr = NULL;
-	uint32_t idel_addrlen = 0;
+	struct arsdk_ftp_server *server = NULL;
+
+	/* Create connection */
+	res = conn_elem_new(ctx, (struct sockaddr *)addr,
+			sizeof(*addr), &elem);
+	if (res < 0)
+		return res;
+
+	/* features queried by the first login only */
+	server = find_server(ctx, addr);
+	if (server != NULL)
+		arsdk_ftp_conn_set_feats(elem->conn, server->feats);
+	else if (ctx->feat_query_disabled)
+		arsdk_ftp_conn_set_feats(elem->conn, 0);
+
+	/* Connection callback initialization */
+	memset(&conn_cbs, 0, sizeof(conn_cbs));
+	conn_cbs.connected = &connected_cb;
+	conn_cbs.disconnected = &disconnected_cb;
+	conn_cbs.recv_response = &recv_response_cb;
+	conn_cbs.socketcb = &conn_socket_cb;
+	conn_cbs.userdata = elem;
+
+	res = arsdk_ftp_conn_add_listener(elem->conn, &conn_cbs);
+	if (res < 0) {
+		conn_elem_destroy(elem);
+		return res;
+	}
 
-	list_walk_entry_forward_safe(&ctx->conns_idle, pos, tmp, node) {
-		idel_addr = arsdk_ftp_conn_get_addr(pos->conn, &idel_addrlen);
+	list_add_before(&ctx->conns_busy, &elem->node);
+	*ret_elem = elem;
+	return 0;
+}
+
+static int get_conn_elem(struct arsdk_ftp_req *req)
+{
+	int res = 0;
+	struct arsdk_ftp *ctx = req->ctx;
+	struct sockaddr_in *addr = &req->addr;
+	struct arsdk_ftp_conn_elem *elem = NULL;
+	struct arsdk_ftp_conn_elem *pos = NULL;
+	struct list_node *bucket = conn_bucket(ctx, addr);
 
-		if ((idel_addr == NULL) || (addrlen != idel_addrlen))
+	list_walk_entry_forward(bucket, pos, node) {
+		/* a response to a health check would be taken for the
+		 * response of the first command of the request */
+		if (pos->check_pending &&
+		    arsdk_ftp_conn_is_connected(pos->conn))
 			continue;
 
-		res = memcmp(addr, idel_addr, addrlen);
-		if (res == 0) {
+		if (conn_elem_match(pos, addr)) {
 			elem = pos;
-			list_del(&elem->node);
 			break;
 		}
 	}
 
-	if (elem == NULL) {
-		/* Create connection */
-		res = conn_elem_new(ctx, addr, addrlen, &elem);
+	if (elem != NULL) {
+		/* add connection element as busy */
+		conn_elem_unlink(elem);
+		list_add_before(&ctx->conns_busy, &elem->node);
+	} else {
+		res = conn_elem_open(ctx, addr, &elem);
 		if (res < 0)
 			return res;
-
-		/* Connection callback initialization */
-		memset(&conn_cbs, 0, sizeof(conn_cbs));
-		conn_cbs.connected = &connected_cb;
-		conn_cbs.disconnected = &disconnected_cb;
-		conn_cbs.recv_response = &recv_response_cb;
-		conn_cbs.socketcb = &conn_socket_cb;
-		conn_cbs.userdata = elem;
-
-		res = arsdk_ftp_conn_add_listener(elem->conn, &conn_cbs);
-		if (res < 0)
-			goto error;
 	}
-	/* add connection element as busy */
-	list_add_before(&ctx->conns_busy, &elem->node);
 
-	*ret_elem = elem;
+	elem->check_pending = 0;
+	elem->resync = 0;
+	elem->req = req;
+	req->conn_elem = elem;
 	return 0;
-error:
-	conn_elem_destroy(elem);
-	return res;
 }
 
+static int req_is_transfer(struct arsdk_ftp_req *req)
+{
+	return req->type == ARSDK_FTP_REQ_TYPE_GET ||
+	       req->type == ARSDK_FTP_REQ_TYPE_PUT;
+}
+
+/* forward declarations */
+static void req_sched_start_cb(struct arsdk_ftp_sched_entry *entry);
+static int req_submit(struct arsdk_ftp_req *req);
+
 /**
  */
 static int req_new(struct arsdk_ftp *ctx,
@@ -486,12 +1098,18 @@ static int req_new(struct arsdk_ftp *ctx,
 		res = -ENOMEM;
 		goto error;
 	}
-
-	/* get */
-	res = get_conn_elem(ctx, (struct sockaddr *)&addr, sizeof(addr),
-			&req->conn_elem);
-	if (res < 0)
-		goto error;
+	req->addr = addr;
+	arsdk_ftp_rate_set(&req->rate, ctx->bw.req_max_rate);
+	req->sched.prio = ARSDK_FTP_REQ_PRIORITY_NORMAL;
+	req->sched.start = &req_sched_start_cb;
+	req->sched.userdata = req;
+
+	/* transfers get a connection when started by the scheduler */
+	if (!req_is_transfer(req)) {
+		res = get_conn_elem(req);
+		if (res < 0)
+			goto error;
+	}
 
 	list_add_after(&ctx->requests, &req->node);
 	*ret_req = req;
@@ -528,9 +1146,11 @@ static int create_get_seq(struct arsdk_ftp_req *req, const char *path,
 	if (res < 0)
 		goto error;
 
-	res = arsdk_ftp_seq_append(seq, &ARSDK_FTP_CMD_SIZE, path);
-	if (res < 0)
-		goto error;
+	if (req->range.len == 0) {
+		res = arsdk_ftp_seq_append(seq, &ARSDK_FTP_CMD_SIZE, path);
+		if (res < 0)
+			goto error;
+	}
 
 	if (resume_off > 0) {
 		res = arsdk_ftp_seq_append_uint64(seq, &ARSDK_FTP_CMD_REST,
@@ -575,7 +1195,7 @@ int arsdk_ftp_get(struct arsdk_ftp *ctx,
 	/* get path */
 	/* search "/" after "ftp://" */
 	/* url_src validity is checked by req_new() */
-	path = strchr(url + 6, '/');
+	path = strchr(req->url + 6, '/');
 	if (path == NULL) {
 		res = -EINVAL;
 		goto error;
@@ -583,8 +1203,10 @@ int arsdk_ftp_get(struct arsdk_ftp *ctx,
 
 	/* Set downloaded size*/
 	req->stream.size = resume_off;
-	/* Create get sequence */
-	res = create_get_seq(req, path, resume_off, &req->ftp_seq);
+	/* Create get sequence when scheduled */
+	req->path = path;
+	req->offset = resume_off;
+	res = req_submit(req);
 	if (res < 0)
 		goto error;
 
@@ -596,11 +1218,61 @@ int arsdk_ftp_get(struct arsdk_ftp *ctx,
 	/* error */
 error:
 	/* cleanup */
+	list_del(&req->node);
 	req_destroy(req);
 
 	return res;
 }
 
+int arsdk_ftp_get_range(struct arsdk_ftp *ctx,
+		const struct arsdk_ftp_req_cbs *cbs,
+		const char *url,
+		uint64_t offset,
+		uint64_t len,
+		struct arsdk_ftp_req **ret_req)
+{
+	int res = 0;
+	struct arsdk_ftp_req *req = NULL;
+	char *path = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(url != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(len > 0, -EINVAL);
+
+	/* Create request */
+	res = req_new(ctx, cbs, url, ARSDK_FTP_REQ_TYPE_GET, &req);
+	if (res < 0)
+		return res;
+
+	/* get path */
+	/* search "/" after "ftp://" */
+	/* url_src validity is checked by req_new() */
+	path = strchr(req->url + 6, '/');
+	if (path == NULL) {
+		res = -EINVAL;
+		goto error;
+	}
+
+	/* Set stream info, relative to the range */
+	req->range.len = len;
+	req->stream.tsize = len;
+	req->stream.size = 0;
+	/* Create get sequence when scheduled */
+	req->path = path;
+	req->offset = offset;
+	res = req_submit(req);
+	if (res < 0)
+		goto error;
+
+	*ret_req = req;
+	return 0;
+
+error:
+	list_del(&req->node);
+	req_destroy(req);
+	return res;
+}
+
 static int create_put_seq(struct arsdk_ftp_req *req, const char *path,
 		uint64_t resume_off, struct arsdk_ftp_seq **ret_seq)
 {
@@ -619,6 +1291,10 @@ static int create_put_seq(struct arsdk_ftp_req *req, const char *path,
 	if (res < 0)
 		return res;
 
+	res = arsdk_ftp_seq_set_upload_cfg(seq, &req->ctx->upload_cfg);
+	if (res < 0)
+		goto error;
+
 	res = arsdk_ftp_seq_append(seq, &ARSDK_FTP_CMD_EPSV, "");
 	if (res < 0)
 		goto error;
@@ -653,6 +1329,59 @@ error:
 	return res;
 }
 
+static int req_start_transfer(struct arsdk_ftp_req *req)
+{
+	int res = 0;
+
+	res = get_conn_elem(req);
+	if (res < 0)
+		return res;
+
+	switch (req->type) {
+	case ARSDK_FTP_REQ_TYPE_GET:
+		return create_get_seq(req, req->path, req->offset,
+				&req->ftp_seq);
+	case ARSDK_FTP_REQ_TYPE_PUT:
+		return create_put_seq(req, req->path, req->offset,
+				&req->ftp_seq);
+	default:
+		return -EINVAL;
+	}
+}
+
+static void req_sched_start_cb(struct arsdk_ftp_sched_entry *entry)
+{
+	int res = 0;
+	struct arsdk_ftp_req *req = entry->userdata;
+
+	res = req_start_transfer(req);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("req_start_transfer", -res);
+		(*req->cbs.complete)(req->ctx, req, ARSDK_FTP_STATUS_FAILED,
+				res, req->cbs.userdata);
+		list_del(&req->node);
+		req_destroy(req);
+	}
+}
+
+/**
+ * Starts a transfer request, or queues it until the scheduler gives it a
+ * slot.
+ */
+static int req_submit(struct arsdk_ftp_req *req)
+{
+	int res = 0;
+
+	if (req->ctx->sched_client == NULL)
+		return req_start_transfer(req);
+
+	res = arsdk_ftp_sched_submit(req->ctx->sched_client, &req->sched);
+	if (res <= 0)
+		return res;
+
+	return req_start_transfer(req);
+}
+
 int arsdk_ftp_put(struct arsdk_ftp *ctx,
 		const struct arsdk_ftp_req_cbs *cbs,
 		const char *url,
@@ -676,7 +1405,7 @@ int arsdk_ftp_put(struct arsdk_ftp *ctx,
 	/* get path */
 	/* search "/" after "ftp://" */
 	/* url_src validity is checked by req_new() */
-	path = strchr(url + 6, '/');
+	path = strchr(req->url + 6, '/');
 	if (path == NULL) {
 		res = -EINVAL;
 		goto error;
@@ -685,8 +1414,10 @@ int arsdk_ftp_put(struct arsdk_ftp *ctx,
 	/* Set stream info */
 	req->stream.tsize = in_size;
 	req->stream.size = resume_off;
-	/* Create put sequence */
-	res = create_put_seq(req, path, resume_off, &req->ftp_seq);
+	/* Create put sequence when scheduled */
+	req->path = path;
+	req->offset = resume_off;
+	res = req_submit(req);
 	if (res < 0)
 		goto error;
 
@@ -698,6 +1429,7 @@ int arsdk_ftp_put(struct arsdk_ftp *ctx,
 	/* error */
 error:
 	/* cleanup */
+	list_del(&req->node);
 	req_destroy(req);
 
 	return res;
@@ -721,7 +1453,8 @@ static int create_size_seq(struct arsdk_ftp_req *req, const char *path,
 	if (res < 0)
 		return res;
 
-	res = arsdk_ftp_seq_append(seq, &ARSDK_FTP_CMD_SIZE, path);
+	/* "MLST" also gives the modification time */
+	res = arsdk_ftp_seq_append(seq, &ARSDK_FTP_CMD_MLST, path);
 	if (res < 0)
 		goto error;
 
@@ -1010,7 +1743,8 @@ static int create_list_seq(struct arsdk_ftp_req *req, const char *path,
 	if (res < 0)
 		goto error;
 
-	res = arsdk_ftp_seq_append(seq, &ARSDK_FTP_CMD_LIST, path);
+	/* machine listing if supported by the server */
+	res = arsdk_ftp_seq_append(seq, &ARSDK_FTP_CMD_MLSD, path);
 	if (res < 0)
 		goto error;
 
@@ -1074,60 +1808,108 @@ size_t arsdk_ftp_req_get_size(struct arsdk_ftp_req *req)
 	return (req != NULL) ? req->stream.tsize : 0;
 }
 
+time_t arsdk_ftp_req_get_mtime(struct arsdk_ftp_req *req)
+{
+	return (req != NULL) ? req->mtime : 0;
+}
+
 const char *arsdk_ftp_req_get_url(struct arsdk_ftp_req *req)
 {
 	return (req != NULL) ? req->url : NULL;
 }
 
+int arsdk_ftp_set_req_priority(struct arsdk_ftp_req *req,
+		enum arsdk_ftp_req_priority prio)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
+
+	return arsdk_ftp_sched_set_prio(&req->sched, prio);
+}
+
 int arsdk_ftp_cancel_req(struct arsdk_ftp *ctx,
 			 struct arsdk_ftp_req *req)
 {
+	enum arsdk_ftp_status status = ARSDK_FTP_STATUS_CANCELED;
+
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
 
-	return arsdk_ftp_seq_stop(req->ftp_seq);
+	if (!req->sched.queued)
+		return arsdk_ftp_seq_stop(req->ftp_seq);
+
+	/* transfer not started */
+	if (req->is_aborted)
+		status = ARSDK_FTP_STATUS_ABORTED;
+	(*req->cbs.complete)(req->ctx, req, status, 0, req->cbs.userdata);
+	list_del(&req->node);
+	req_destroy(req);
+	return 0;
 }
 
-int arsdk_ftp_cancel_all(struct arsdk_ftp *ctx)
+/**
+ * Cancels the requests of a context. A completion callback may cancel or
+ * create other requests, the requests to cancel are marked first and the
+ * walk restarts after each cancellation.
+ */
+static void cancel_marked(struct arsdk_ftp *ctx, int aborted)
 {
 	struct arsdk_ftp_req *req = NULL;
-	struct arsdk_ftp_req *tmp = NULL;
+	struct arsdk_ftp_req *next = NULL;
+
+	list_walk_entry_forward(&ctx->requests, req, node) {
+		req->is_canceling = 1;
+		if (aborted)
+			req->is_aborted = 1;
+	}
 
+	do {
+		next = NULL;
+		list_walk_entry_forward(&ctx->requests, req, node) {
+			if (req->is_canceling) {
+				next = req;
+				break;
+			}
+		}
+		if (next != NULL) {
+			next->is_canceling = 0;
+			arsdk_ftp_cancel_req(ctx, next);
+		}
+	} while (next != NULL);
+}
+
+int arsdk_ftp_cancel_all(struct arsdk_ftp *ctx)
+{
 	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
 
 	/* cancel all pending requests */
-	list_walk_entry_forward_safe(&ctx->requests, req, tmp, node) {
-		arsdk_ftp_cancel_req(ctx, req);
-	}
+	cancel_marked(ctx, 0);
 
 	return 0;
 }
 
 static int arsdk_ftp_abort_all(struct arsdk_ftp *ctx)
 {
-	struct arsdk_ftp_req *req = NULL;
-	struct arsdk_ftp_req *tmp = NULL;
-
 	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
 
 	/* cancel all pending requests */
-	list_walk_entry_forward_safe(&ctx->requests, req, tmp, node) {
-		req->is_aborted = 1;
-		arsdk_ftp_cancel_req(ctx, req);
-	}
+	cancel_marked(ctx, 1);
 
 	return 0;
 }
 
 static int arsdk_ftp_stop_conns(struct arsdk_ftp *ctx)
 {
+	int i = 0;
 	struct arsdk_ftp_conn_elem *elem = NULL;
 	struct arsdk_ftp_conn_elem *tmp = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
 
-	list_walk_entry_forward_safe(&ctx->conns_idle, elem, tmp, node) {
-		list_del(&elem->node);
-		conn_elem_destroy(elem);
+	for (i = 0; i < CONN_BUCKET_COUNT; i++) {
+		list_walk_entry_forward_safe(&ctx->conns_idle[i], elem, tmp,
+				node) {
+			conn_elem_unlink(elem);
+			conn_elem_destroy(elem);
+		}
 	}
 
 	list_walk_entry_forward_safe(&ctx->conns_busy, elem, tmp, node) {
@@ -1138,6 +1920,40 @@ static int arsdk_ftp_stop_conns(struct arsdk_ftp *ctx)
 	return 0;
 }
 
+int arsdk_ftp_prepare_conn(struct arsdk_ftp *ctx, const char *url)
+{
+	int res = 0;
+	struct sockaddr_in addr;
+	struct arsdk_ftp_conn_elem *elem = NULL;
+	struct list_node *bucket = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(url != NULL, -EINVAL);
+
+	memset(&addr, 0, sizeof(addr));
+	res = url_to_addr(url, &addr);
+	if (res < 0)
+		return res;
+
+	/* already an idle connection to the server */
+	bucket = conn_bucket(ctx, &addr);
+	list_walk_entry_forward(bucket, elem, node) {
+		if (conn_elem_match(elem, &addr))
+			return 0;
+	}
+
+	if (ctx->conns_idle_count >= CONN_IDLE_MAX)
+		return -EBUSY;
+
+	res = conn_elem_open(ctx, &addr, &elem);
+	if (res < 0)
+		return res;
+
+	/* logged in while idle */
+	conn_elem_release(elem, &addr, 0);
+	return 0;
+}
+
 int arsdk_ftp_stop(struct arsdk_ftp *ctx)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(ctx != NULL, -EINVAL);
@@ -41,6 +41,7 @@
 
 struct arsdk_ftp;
 struct arsdk_ftp_req;
+struct arsdk_ftp_sched;
 
 enum arsdk_ftp_status {
 	ARSDK_FTP_STATUS_OK = 0,       /**< request succeeded */
@@ -61,6 +62,14 @@ struct arsdk_ftp_req_cbs {
 			size_t nmemb,
 			void *userdata);
 
+	/** Optional: local file descriptor and offset of the data to
+	 *  upload, sent by the kernel instead of calling 'read_data';
+	 *  negative to use 'read_data' */
+	int (*read_fd)(struct arsdk_ftp *ctx,
+			struct arsdk_ftp_req *req,
+			off_t *offset,
+			void *userdata);
+
 	size_t (*write_data)(struct arsdk_ftp *ctx,
 			struct arsdk_ftp_req *req,
 			const void *ptr,
@@ -123,6 +132,94 @@ int arsdk_ftp_destroy(struct arsdk_ftp *ctx);
  */
 int arsdk_ftp_stop(struct arsdk_ftp *ctx);
 
+/**
+ * Open and log in a connection to the server of an url, kept alive while
+ * idle, so that the next request to this server does not wait for it.
+ * @param ctx : ftp context.
+ * @param url : url of the server.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_prepare_conn(struct arsdk_ftp *ctx, const char *url);
+
+/**
+ * Set the fragmentation used by "put" requests created afterwards.
+ * @param ctx : ftp context.
+ * @param frag_len : length of the fragments sent; 0 for default.
+ * @param frag_count : count of fragments queued in the data socket;
+ * 0 for default.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_set_upload_cfg(struct arsdk_ftp *ctx,
+		size_t frag_len,
+		uint32_t frag_count);
+
+/**
+ * Limit the rate of all the transfers of the context.
+ * @param ctx : ftp context.
+ * @param max_rate : bytes per second, 0 for no limit.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_set_max_rate(struct arsdk_ftp *ctx, uint64_t max_rate);
+
+/**
+ * Limit the rate of each transfer of the context.
+ * @param ctx : ftp context.
+ * @param max_rate : bytes per second, 0 for no limit.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_set_req_max_rate(struct arsdk_ftp *ctx, uint64_t max_rate);
+
+/**
+ * Get the data transferred since the creation of the context.
+ * @param ctx : ftp context.
+ * @return The count of bytes received and sent.
+ */
+uint64_t arsdk_ftp_get_transferred(struct arsdk_ftp *ctx);
+
+/**
+ * Set the rate of the progress notifications of the requests.
+ * The progress is notified once 'min_len' bytes are transferred or
+ * 'period_ms' elapsed since the last notification, and at the end of the
+ * transfer.
+ * @param ctx : ftp context.
+ * @param min_len : minimal data transferred, 0 to ignore it.
+ * @param period_ms : minimal period, 0 to ignore it.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_set_progress_cfg(struct arsdk_ftp *ctx,
+		size_t min_len,
+		uint32_t period_ms);
+
+/**
+ * Enable the query of the server features ("FEAT") at the first login to a
+ * server, used to list directories with "MLSD". Enabled by default.
+ * @param ctx : ftp context.
+ * @param enable : 1 to query the features, 0 to use the basic commands.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_set_feat_query(struct arsdk_ftp *ctx, int enable);
+
+/**
+ * Set the transfer scheduler of the context; the "get" and "put" requests
+ * then wait for a free slot of the scheduler before being started.
+ * Must be called before any request.
+ * @param ctx : ftp context.
+ * @param sched : transfer scheduler, NULL to start the requests immediately.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_set_sched(struct arsdk_ftp *ctx,
+		struct arsdk_ftp_sched *sched);
+
+/**
+ * Set the priority of a request waiting for a free slot of the transfer
+ * scheduler.
+ * @param req : ftp req.
+ * @param prio : priority.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_set_req_priority(struct arsdk_ftp_req *req,
+		enum arsdk_ftp_req_priority prio);
+
 /**
  * Cancel a ftp request.
  * @param ctx : ftp context.
@@ -154,6 +251,25 @@ int arsdk_ftp_get(struct arsdk_ftp *ctx,
 		int64_t resume_off,
 		struct arsdk_ftp_req **ret_req);
 
+/**
+ * Create and send "get" request of a byte range of a file.
+ * The transfer is stopped at the end of the range, the progress and the
+ * size of the request are relative to the range.
+ * @param ctx : ftp context.
+ * @param cbs : ftp request callbacks.
+ * @param url : url to download.
+ * @param offset : offset of the range in the file.
+ * @param len : length of the range.
+ * @param ret_req : will receive the ftp request.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_get_range(struct arsdk_ftp *ctx,
+		const struct arsdk_ftp_req_cbs *cbs,
+		const char *url,
+		uint64_t offset,
+		uint64_t len,
+		struct arsdk_ftp_req **ret_req);
+
 /**
  * Create and send "put" request.
  * @param ctx : ftp context.
@@ -232,6 +348,14 @@ int arsdk_ftp_list(struct arsdk_ftp *ctx,
  */
 size_t arsdk_ftp_req_get_size(struct arsdk_ftp_req *req);
 
+/**
+ * Get file modification time
+ * @param req : the ftp "size" request.
+ * @return The modification time of the file if given by the server,
+ * otherwise 0.
+ */
+time_t arsdk_ftp_req_get_mtime(struct arsdk_ftp_req *req);
+
 /**
  * Get request url
  * @param req : the ftp request.
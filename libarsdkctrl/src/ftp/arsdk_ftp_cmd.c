@@ -27,6 +27,7 @@
 #include "arsdkctrl_priv.h"
 #include "arsdk_ftp_log.h"
 #include "arsdk_ftp_cmd.h"
+#include "arsdk_ftp_facts.h"
 
 #define ARSDK_FTP_CMD_FOOT_LEN 2
 
@@ -83,6 +84,57 @@ static int parse_213_param(struct arsdk_ftp_cmd_result *response, char *param)
 	return 0;
 }
 
+static int parse_211_param(struct arsdk_ftp_cmd_result *response, char *param)
+{
+	char *line = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(response != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(param != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(response->code == 211, -EINVAL);
+
+	/* one feature per line, after a space */
+	line = strchr(param, '\n');
+	while (line != NULL) {
+		line++;
+		while (*line == ' ')
+			line++;
+
+		if (strncasecmp(line, "MLST", 4) == 0 &&
+		    (line[4] == ' ' || line[4] == '\r' || line[4] == '\0'))
+			response->param.feats |= ARSDK_FTP_FEAT_MLST;
+
+		line = strchr(line, '\n');
+	}
+
+	return 0;
+}
+
+static int parse_250_param(struct arsdk_ftp_cmd_result *response, char *param)
+{
+	char *fact = NULL;
+	struct arsdk_ftp_facts facts;
+
+	ARSDK_RETURN_ERR_IF_FAILED(response != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(param != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(response->code == 250, -EINVAL);
+
+	/* the facts of a "MLST" response are on the second line:
+	 * " fact=value;...; path" */
+	fact = strchr(param, '\n');
+	if (fact == NULL)
+		return 0;
+	fact++;
+	while (*fact == ' ')
+		fact++;
+
+	if (arsdk_ftp_facts_parse(fact, &facts) < 0)
+		return 0;
+
+	response->param.facts.size = facts.size;
+	response->param.facts.mtime = facts.mtime;
+	return 0;
+}
+
 static int parse_param(struct arsdk_ftp_cmd_result *response, char *param)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(response != NULL, -EINVAL);
@@ -93,41 +145,69 @@ static int parse_param(struct arsdk_ftp_cmd_result *response, char *param)
 		return parse_229_param(response, param);
 	case 213:
 		return parse_213_param(response, param);
+	case 211:
+		return parse_211_param(response, param);
+	case 250:
+		return parse_250_param(response, param);
 	default:
 		return 0;
 	}
 }
 
-int arsdk_ftp_cmd_dec(struct pomp_buffer *buff,
+size_t arsdk_ftp_cmd_resp_len(const char *data, size_t len)
+{
+	const char *line = data;
+	const char *eol = NULL;
+	size_t remaining = len;
+
+	/* a multi-line response starts by "ddd-" and ends by "ddd " */
+	while (remaining > 0) {
+		eol = memchr(line, '\n', remaining);
+		if (eol == NULL)
+			return 0;
+
+		if (line == data) {
+			if (eol - line < 4 || data[3] != '-')
+				return eol + 1 - data;
+		} else if (eol - line >= 4 && line[3] == ' ' &&
+			   memcmp(line, data, 3) == 0) {
+			return eol + 1 - data;
+		}
+
+		remaining -= eol + 1 - line;
+		line = eol + 1;
+	}
+
+	return 0;
+}
+
+int arsdk_ftp_cmd_dec(const char *data, size_t len,
 		struct arsdk_ftp_cmd_result *result)
 {
 	int res = 0;
-	size_t len = 0;
-	const void *cdata = NULL;
 	char *str = NULL;
 	char *param = NULL;
 
-	ARSDK_RETURN_ERR_IF_FAILED(buff != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(data != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(result != NULL, -EINVAL);
 
 	/* initialize the response */
 	memset(result, 0, sizeof(*result));
 
-	res = pomp_buffer_get_cdata(buff, &cdata, &len, NULL);
-	if (res < 0)
-		return res;
-
 	/* check response length */
 	if (len < ARSDK_FTP_CMD_FOOT_LEN)
 		return -EPROTO;
 
-	str = strndup((const char *)cdata, len - ARSDK_FTP_CMD_FOOT_LEN);
+	str = strndup(data, len - ARSDK_FTP_CMD_FOOT_LEN);
+	if (str == NULL)
+		return -ENOMEM;
 	ARSDK_LOGI("< %s", str);
 	res = sscanf(str, "%d", &result->code);
 	if (res < 0)
 		goto end;
 
-	param = strchr(str, ' ');
+	/* first space or dash of multi-line responses */
+	param = strpbrk(str, " -");
 	if (param != NULL) {
 		param++;
 		res = parse_param(result, param);
@@ -29,11 +29,20 @@
 
 struct arsdk_ftp_cmd;
 
+/** features of a server, given by the "FEAT" command */
+#define ARSDK_FTP_FEAT_MLST     (1 << 0)
+
 struct arsdk_ftp_cmd_result {
 	int                     code;
 	union {
 		int             data_stream_port;
 		size_t          file_size;
+		uint32_t        feats;
+		/* facts of a "MLST" response */
+		struct {
+			size_t  size;
+			time_t  mtime;
+		} facts;
 	} param;
 };
 
@@ -55,6 +64,10 @@ enum arsdk_ftp_cmd_type {
 	ARSDK_FTP_CMD_TYPE_RNTO,
 	ARSDK_FTP_CMD_TYPE_REST,
 	ARSDK_FTP_CMD_TYPE_APPE,
+	ARSDK_FTP_CMD_TYPE_NOOP,
+	ARSDK_FTP_CMD_TYPE_FEAT,
+	ARSDK_FTP_CMD_TYPE_MLSD,
+	ARSDK_FTP_CMD_TYPE_MLST,
 };
 
 enum arsdk_ftp_cmd_data_type {
@@ -176,6 +189,36 @@ static const struct arsdk_ftp_cmd_desc ARSDK_FTP_CMD_APPE = {
 	.data_type = ARSDK_FTP_CMD_DATA_TYPE_OUT,
 };
 
+static const struct arsdk_ftp_cmd_desc ARSDK_FTP_CMD_NOOP = {
+	.cmd_type = ARSDK_FTP_CMD_TYPE_NOOP,
+	.code = "NOOP",
+	.resp_code = 200,
+	.data_type = ARSDK_FTP_CMD_DATA_TYPE_NONE,
+};
+
+static const struct arsdk_ftp_cmd_desc ARSDK_FTP_CMD_FEAT = {
+	.cmd_type = ARSDK_FTP_CMD_TYPE_FEAT,
+	.code = "FEAT",
+	.resp_code = 211,
+	.data_type = ARSDK_FTP_CMD_DATA_TYPE_NONE,
+};
+
+/* sent as "LIST" to the servers without ARSDK_FTP_FEAT_MLST */
+static const struct arsdk_ftp_cmd_desc ARSDK_FTP_CMD_MLSD = {
+	.cmd_type = ARSDK_FTP_CMD_TYPE_MLSD,
+	.code = "MLSD",
+	.resp_code = 150,
+	.data_type = ARSDK_FTP_CMD_DATA_TYPE_IN,
+};
+
+/* sent as "SIZE" to the servers without ARSDK_FTP_FEAT_MLST */
+static const struct arsdk_ftp_cmd_desc ARSDK_FTP_CMD_MLST = {
+	.cmd_type = ARSDK_FTP_CMD_TYPE_MLST,
+	.code = "MLST",
+	.resp_code = 250,
+	.data_type = ARSDK_FTP_CMD_DATA_TYPE_NONE,
+};
+
 
 int arsdk_ftp_cmd_enc(const struct arsdk_ftp_cmd_desc *desc, char *param,
 		struct pomp_buffer **ret_buff);
@@ -192,7 +235,16 @@ int arsdk_ftp_cmd_enc_pass(char *pass, struct pomp_buffer **ret_buff)
 	return arsdk_ftp_cmd_enc(&ARSDK_FTP_CMD_PASS, pass, ret_buff);
 };
 
-int arsdk_ftp_cmd_dec(struct pomp_buffer *buff,
+/**
+ * Decode a response, all its lines included the end of the last one.
+ */
+int arsdk_ftp_cmd_dec(const char *data, size_t len,
 		struct arsdk_ftp_cmd_result *result);
 
+/**
+ * Give the length of the first complete response of a received data, its
+ * last end of line included; 0 if incomplete.
+ */
+size_t arsdk_ftp_cmd_resp_len(const char *data, size_t len);
+
 #endif /* !_ARSDK_FTP_CMD_H_ */
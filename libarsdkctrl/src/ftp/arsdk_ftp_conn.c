@@ -40,6 +40,8 @@ enum arsdk_ftp_conn_state {
 	ARSDK_FTP_CONN_STATE_LOGIN_USER,
 	/* waiting for pass response (230) */
 	ARSDK_FTP_CONN_STATE_LOGIN_PASS,
+	/* waiting for feat response (211 or not supported) */
+	ARSDK_FTP_CONN_STATE_LOGIN_FEAT,
 	/* connected */
 	ARSDK_FTP_CONN_STATE_CONNECTED,
 };
@@ -55,6 +57,9 @@ enum arsdk_ftp_conn_event {
 	ARSDK_FTP_CONN_EVENT_FTP_RECV_FAILED,
 };
 
+/** Initial size of the buffer of the received responses */
+#define RX_BUFFER_SIZE 512
+
 #define ARSDK_FTP_DEFAULT_USER "anonymous"
 #define ARSDK_FTP_DEFAULT_PASS ""
 
@@ -70,6 +75,14 @@ struct arsdk_ftp_conn {
 	char                            *username;
 	char                            *password;
 	struct list_node                listeners;
+	/* server features, queried at login if not known */
+	uint32_t                        feats;
+	int                             feats_known;
+	/* commands sent whose final reply is not received yet */
+	uint32_t                        replies_pending;
+	/* received data not yet processed */
+	struct pomp_buffer              *rx;
+	size_t                          rx_off;
 };
 
 static int arsdk_ftp_conn_listener_new(const struct arsdk_ftp_conn_cbs *cbs,
@@ -117,7 +130,12 @@ int arsdk_ftp_conn_send(struct arsdk_ftp_conn *conn, struct pomp_buffer *buff)
 
 	/* send request */
 	res = pomp_ctx_send_raw_buf(conn->ctx, buff);
-	return res;
+	if (res < 0)
+		return res;
+
+	/* each command has one final reply, after its preliminary ones */
+	conn->replies_pending++;
+	return 0;
 }
 
 static void ftp_connected(struct arsdk_ftp_conn *conn)
@@ -144,6 +162,7 @@ static void ftp_disconnected(struct arsdk_ftp_conn *conn)
 	ARSDK_RETURN_IF_FAILED(conn != NULL, -EINVAL);
 
 	conn->state = ARSDK_FTP_CONN_STATE_DISCONNECTED;
+	conn->replies_pending = 0;
 
 	/* disconnected callback */
 	list_walk_entry_forward_safe(
@@ -195,6 +214,27 @@ end:
 	return res;
 }
 
+static int send_feat(struct arsdk_ftp_conn *conn)
+{
+	int res = 0;
+	struct pomp_buffer *buff = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(conn != NULL, -EINVAL);
+
+	res = arsdk_ftp_cmd_enc(&ARSDK_FTP_CMD_FEAT, "", &buff);
+	if (res < 0)
+		return res;
+
+	res = arsdk_ftp_conn_send(conn, buff);
+	if (res < 0)
+		goto end;
+
+	conn->state = ARSDK_FTP_CONN_STATE_LOGIN_FEAT;
+end:
+	pomp_buffer_unref(buff);
+	return res;
+}
+
 static int ftp_received(struct arsdk_ftp_conn *conn,
 		struct arsdk_ftp_cmd_result *response)
 {
@@ -204,6 +244,10 @@ static int ftp_received(struct arsdk_ftp_conn *conn,
 	ARSDK_RETURN_ERR_IF_FAILED(conn != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(response != NULL, -EINVAL);
 
+	/* the greeting (220) answers no command */
+	if (response->code >= 200 && conn->replies_pending > 0)
+		conn->replies_pending--;
+
 	switch (conn->state) {
 	case ARSDK_FTP_CONN_STATE_FTPCONNECTING:
 		/* waiting for ftp connection (220) */
@@ -222,6 +266,17 @@ static int ftp_received(struct arsdk_ftp_conn *conn,
 		if (response->code != 230)
 			return -EPERM;
 
+		if (!conn->feats_known)
+			return send_feat(conn);
+
+		ftp_connected(conn);
+		break;
+	case ARSDK_FTP_CONN_STATE_LOGIN_FEAT:
+		/* no feature if not supported (500, 502) */
+		if (response->code == 211)
+			conn->feats = response->param.feats;
+		conn->feats_known = 1;
+
 		ftp_connected(conn);
 		break;
 
@@ -312,24 +367,101 @@ static void arsdk_ftp_conn_event_cb(struct pomp_ctx *ctx,
 	}
 }
 
+/* forward declaration */
+static void rx_process_idle_cb(void *userdata);
+
+/**
+ * Moves the partial response received at the start of the buffer.
+ */
+static void rx_compact(struct arsdk_ftp_conn *conn)
+{
+	int res = 0;
+	void *data = NULL;
+	size_t len = 0;
+
+	res = pomp_buffer_get_data(conn->rx, &data, &len, NULL);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_buffer_get_data", -res);
+		return;
+	}
+
+	len -= conn->rx_off;
+	memmove(data, (char *)data + conn->rx_off, len);
+	(void)pomp_buffer_set_len(conn->rx, len);
+	conn->rx_off = 0;
+}
+
+/**
+ * Processes the first complete response received, the next ones are
+ * processed from the loop as the listeners can destroy the connection.
+ */
+static void rx_process(struct arsdk_ftp_conn *conn)
+{
+	int res = 0;
+	const void *cdata = NULL;
+	const char *data = NULL;
+	size_t len = 0;
+	size_t resp_len = 0;
+	struct arsdk_ftp_cmd_result response;
+
+	res = pomp_buffer_get_cdata(conn->rx, &cdata, &len, NULL);
+	if (res < 0)
+		return;
+
+	data = (const char *)cdata + conn->rx_off;
+	len -= conn->rx_off;
+	resp_len = arsdk_ftp_cmd_resp_len(data, len);
+	if (resp_len == 0) {
+		rx_compact(conn);
+		return;
+	}
+
+	res = arsdk_ftp_cmd_dec(data, resp_len, &response);
+	conn->rx_off += resp_len;
+
+	/* other responses already received */
+	if (arsdk_ftp_cmd_resp_len(data + resp_len, len - resp_len) > 0)
+		pomp_loop_idle_add(conn->loop, &rx_process_idle_cb, conn);
+	else
+		rx_compact(conn);
+
+	if (res < 0) {
+		ARSDK_LOGE("Fail to parse ftp response");
+		process_event(conn, ARSDK_FTP_CONN_EVENT_FTP_RECV_FAILED, NULL);
+		return;
+	}
+
+	process_event(conn, ARSDK_FTP_CONN_EVENT_FTP_RECV, &response);
+}
+
+static void rx_process_idle_cb(void *userdata)
+{
+	rx_process(userdata);
+}
+
 static void arsdk_ftp_conn_recv_cb(struct pomp_ctx *ctx,
 		struct pomp_conn *sk_conn,
 		struct pomp_buffer *buff, void *userdata)
 {
-	struct arsdk_ftp_conn *conn = userdata;
-	struct arsdk_ftp_cmd_result response;
 	int res = 0;
+	const void *cdata = NULL;
+	size_t len = 0;
+	struct arsdk_ftp_conn *conn = userdata;
 
 	ARSDK_RETURN_IF_FAILED(conn != NULL, -EINVAL);
 
-	res = arsdk_ftp_cmd_dec(buff, &response);
+	res = pomp_buffer_get_cdata(buff, &cdata, &len, NULL);
+	if (res < 0)
+		return;
+
+	/* responses can be split or grouped in the received buffers */
+	res = pomp_buffer_append_data(conn->rx, cdata, len);
 	if (res < 0) {
-		ARSDK_LOGE("Fail to parse ftp response");
-		process_event(conn, ARSDK_FTP_CONN_EVENT_FTP_RECV_FAILED, NULL);
+		ARSDK_LOG_ERRNO("pomp_buffer_append_data", -res);
+		return;
 	}
 
-	process_event(conn, ARSDK_FTP_CONN_EVENT_FTP_RECV, &response);
-	return;
+	rx_process(conn);
 }
 
 static int arsdk_ftp_conn_clear_listeners(struct arsdk_ftp_conn *conn)
@@ -392,6 +524,12 @@ int arsdk_ftp_conn_new(struct pomp_loop *loop,
 			xstrdup(ARSDK_FTP_DEFAULT_PASS);
 	list_init(&conn->listeners);
 
+	conn->rx = pomp_buffer_new(RX_BUFFER_SIZE);
+	if (conn->rx == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
 	/* create socket context */
 	conn->ctx = pomp_ctx_new_with_loop(&arsdk_ftp_conn_event_cb, conn,
 			conn->loop);
@@ -427,8 +565,13 @@ int arsdk_ftp_conn_destroy(struct arsdk_ftp_conn *conn)
 	/* remove all listeners */
 	arsdk_ftp_conn_clear_listeners(conn);
 
-	pomp_ctx_stop(conn->ctx);
-	pomp_ctx_destroy(conn->ctx);
+	pomp_loop_idle_remove(conn->loop, &rx_process_idle_cb, conn);
+	if (conn->ctx != NULL) {
+		pomp_ctx_stop(conn->ctx);
+		pomp_ctx_destroy(conn->ctx);
+	}
+	if (conn->rx != NULL)
+		pomp_buffer_unref(conn->rx);
 
 	free(conn->password);
 	free(conn->username);
@@ -436,6 +579,28 @@ int arsdk_ftp_conn_destroy(struct arsdk_ftp_conn *conn)
 	return 0;
 }
 
+int arsdk_ftp_conn_set_feats(struct arsdk_ftp_conn *conn, uint32_t feats)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(conn != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(
+			conn->state <= ARSDK_FTP_CONN_STATE_FTPCONNECTING,
+			-EBUSY);
+
+	conn->feats = feats;
+	conn->feats_known = 1;
+	return 0;
+}
+
+uint32_t arsdk_ftp_conn_get_feats(struct arsdk_ftp_conn *conn)
+{
+	return (conn != NULL) ? conn->feats : 0;
+}
+
+uint32_t arsdk_ftp_conn_get_replies_pending(struct arsdk_ftp_conn *conn)
+{
+	return (conn != NULL) ? conn->replies_pending : 0;
+}
+
 int arsdk_ftp_conn_is_connected(struct arsdk_ftp_conn *conn)
 {
 	if ((conn == NULL) ||
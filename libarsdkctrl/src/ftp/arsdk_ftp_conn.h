@@ -57,6 +57,22 @@ int arsdk_ftp_conn_destroy(struct arsdk_ftp_conn *conn);
 
 int arsdk_ftp_conn_send(struct arsdk_ftp_conn *conn, struct pomp_buffer *buff);
 
+/**
+ * Set the features of the server, known from a previous connection, to not
+ * query them at login.
+ */
+int arsdk_ftp_conn_set_feats(struct arsdk_ftp_conn *conn, uint32_t feats);
+
+/**
+ * Get the features of the server (ARSDK_FTP_FEAT_xxx), known once connected.
+ */
+uint32_t arsdk_ftp_conn_get_feats(struct arsdk_ftp_conn *conn);
+
+/**
+ * Get the count of commands sent whose final reply is not received yet.
+ */
+uint32_t arsdk_ftp_conn_get_replies_pending(struct arsdk_ftp_conn *conn);
+
 int arsdk_ftp_conn_is_connected(struct arsdk_ftp_conn *conn);
 
 const struct sockaddr *arsdk_ftp_conn_get_addr(struct arsdk_ftp_conn *conn,
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdk_ftp_log.h"
+#include "arsdk_ftp_facts.h"
+
+time_t arsdk_ftp_facts_parse_time(const char *value)
+{
+	struct tm tm;
+
+	memset(&tm, 0, sizeof(tm));
+	if (sscanf(value, "%4d%2d%2d%2d%2d%2d", &tm.tm_year, &tm.tm_mon,
+			&tm.tm_mday, &tm.tm_hour, &tm.tm_min,
+			&tm.tm_sec) != 6)
+		return 0;
+
+	tm.tm_year -= 1900;
+	tm.tm_mon -= 1;
+#ifdef _WIN32
+	return _mkgmtime(&tm);
+#else /* !_WIN32 */
+	return timegm(&tm);
+#endif /* !_WIN32 */
+}
+
+int arsdk_ftp_facts_parse(const char *str, struct arsdk_ftp_facts *facts)
+{
+	const char *fact = str;
+	const char *value = NULL;
+	const char *end = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(str != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(facts != NULL, -EINVAL);
+
+	memset(facts, 0, sizeof(*facts));
+	facts->type = ARSDK_FTP_FILE_TYPE_FILE;
+	facts->listed = 1;
+
+	/* facts end with a space before the name */
+	while (*fact != ' ' && *fact != '\0') {
+		end = strchr(fact, ';');
+		value = strchr(fact, '=');
+		if (end == NULL || value == NULL || value > end)
+			return -EINVAL;
+		value++;
+
+		if (strncasecmp(fact, "type=", 5) == 0) {
+			if (strncasecmp(value, "dir;", 4) == 0)
+				facts->type = ARSDK_FTP_FILE_TYPE_DIR;
+			else if (strncasecmp(value, "file;", 5) == 0)
+				facts->type = ARSDK_FTP_FILE_TYPE_FILE;
+			else if (strncasecmp(value, "OS.unix=slink", 13) == 0)
+				facts->type = ARSDK_FTP_FILE_TYPE_LINK;
+			else
+				/* current and parent directories */
+				facts->listed = 0;
+		} else if (strncasecmp(fact, "size=", 5) == 0) {
+			facts->size = strtoull(value, NULL, 10);
+		} else if (strncasecmp(fact, "modify=", 7) == 0) {
+			facts->mtime = arsdk_ftp_facts_parse_time(value);
+		}
+
+		fact = end + 1;
+	}
+
+	if (*fact != ' ')
+		return -EINVAL;
+
+	facts->name = fact + 1;
+	return 0;
+}
@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_FTP_FACTS_H_
+#define _ARSDK_FTP_FACTS_H_
+
+/**
+ * Facts of a machine listing entry ("MLSD" line or "MLST" response):
+ * "fact=value;...; name".
+ */
+struct arsdk_ftp_facts {
+	enum arsdk_ftp_file_type        type;
+	/* 0 for the current and parent directories */
+	int                             listed;
+	size_t                          size;
+	/* 0 if unknown */
+	time_t                          mtime;
+	/* points in the parsed string, up to its end */
+	const char                      *name;
+};
+
+/* returns 0 or a negative errno if the facts are malformed */
+int arsdk_ftp_facts_parse(const char *str, struct arsdk_ftp_facts *facts);
+
+/* parses a "YYYYMMDDHHMMSS[.sss]" UTC time, returns 0 if invalid */
+time_t arsdk_ftp_facts_parse_time(const char *value);
+
+#endif /* !_ARSDK_FTP_FACTS_H_ */
@@ -0,0 +1,431 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdk_ftp_log.h"
+#include "arsdk_ftp_journal.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define JOURNAL_MAGIC 0x4a544641 /* "AFTJ" */
+#define JOURNAL_VERSION 1
+#define JOURNAL_SUFFIX ".journal"
+
+/* count of checkpoints checked back from the last one on resume */
+#define JOURNAL_VERIFY_MAX 4
+
+/* largest prime lower than 2^16 */
+#define ADLER_MOD 65521
+/* largest count of bytes summed before the sums can overflow */
+#define ADLER_NMAX 5552
+
+#define READ_BUFFER_SIZE (64 * 1024)
+
+/** Header of the journal file, followed by the checksums of the blocks */
+struct journal_header {
+	uint32_t                        magic;
+	uint32_t                        version;
+	uint64_t                        remote_size;
+	int64_t                         remote_mtime;
+	uint32_t                        block_len;
+	uint32_t                        reserved;
+};
+
+/** */
+struct arsdk_ftp_journal {
+	char                            *path;
+	char                            *local_path;
+	FILE                            *f;
+	/* count of blocks checkpointed */
+	uint64_t                        count;
+	/* adler-32 of the current block */
+	uint32_t                        a;
+	uint32_t                        b;
+	uint32_t                        filled;
+};
+
+static void adler_update(uint32_t *a, uint32_t *b, const uint8_t *data,
+		size_t len)
+{
+	size_t n = 0;
+
+	while (len > 0) {
+		n = (len < ADLER_NMAX) ? len : ADLER_NMAX;
+		len -= n;
+		while (n-- > 0) {
+			*a += *data++;
+			*b += *a;
+		}
+		*a %= ADLER_MOD;
+		*b %= ADLER_MOD;
+	}
+}
+
+/**
+ * Computes the checksum of a block of the local file.
+ */
+static int block_checksum(FILE *fin, uint64_t index, uint32_t *sum)
+{
+	uint32_t a = 1;
+	uint32_t b = 0;
+	size_t remaining = ARSDK_FTP_JOURNAL_BLOCK_LEN;
+	size_t len = 0;
+	uint8_t *buf = NULL;
+
+	buf = malloc(READ_BUFFER_SIZE);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	if (fseeko(fin, index * ARSDK_FTP_JOURNAL_BLOCK_LEN, SEEK_SET) < 0)
+		goto error;
+
+	while (remaining > 0) {
+		len = fread(buf, 1, (remaining < READ_BUFFER_SIZE) ?
+				remaining : READ_BUFFER_SIZE, fin);
+		if (len == 0)
+			goto error;
+		adler_update(&a, &b, buf, len);
+		remaining -= len;
+	}
+
+	free(buf);
+	*sum = (b << 16) | a;
+	return 0;
+error:
+	free(buf);
+	return -EIO;
+}
+
+static int read_header(FILE *f, struct journal_header *header,
+		uint64_t *count)
+{
+	struct stat st;
+
+	if (fread(header, sizeof(*header), 1, f) != 1)
+		return -EPROTO;
+
+	if (header->magic != JOURNAL_MAGIC ||
+	    header->version != JOURNAL_VERSION ||
+	    header->block_len != ARSDK_FTP_JOURNAL_BLOCK_LEN)
+		return -EPROTO;
+
+	if (fstat(fileno(f), &st) < 0)
+		return -errno;
+
+	*count = (st.st_size - sizeof(*header)) / sizeof(uint32_t);
+	return 0;
+}
+
+static int read_checkpoint(FILE *f, uint64_t index, uint32_t *sum)
+{
+	off_t off = sizeof(struct journal_header) + index * sizeof(*sum);
+
+	if (fseeko(f, off, SEEK_SET) < 0)
+		return -errno;
+
+	if (fread(sum, sizeof(*sum), 1, f) != 1)
+		return -EIO;
+
+	return 0;
+}
+
+/**
+ * Gives the count of checkpoints matching the local file, checked back from
+ * the last one; the data after a corrupted block is downloaded again.
+ */
+static uint64_t verify_checkpoints(FILE *f, const char *local_path,
+		uint64_t count)
+{
+	int res = 0;
+	uint32_t i = 0;
+	uint32_t sum = 0;
+	uint32_t expected = 0;
+	FILE *fin = NULL;
+
+	if (count == 0)
+		return 0;
+
+	fin = fopen(local_path, "rb");
+	if (fin == NULL)
+		return 0;
+
+	for (i = 0; i < JOURNAL_VERIFY_MAX && count > 0; i++) {
+		res = read_checkpoint(f, count - 1, &expected);
+		if (res == 0)
+			res = block_checksum(fin, count - 1, &sum);
+		if (res == 0 && sum == expected)
+			break;
+
+		ARSDK_LOGW("journal of '%s': block %" PRIu64 " corrupted",
+				local_path, count - 1);
+		count--;
+	}
+
+	/* too many corrupted blocks to trust the file */
+	if (i == JOURNAL_VERIFY_MAX)
+		count = 0;
+
+	fclose(fin);
+	return count;
+}
+
+int arsdk_ftp_journal_open(const char *local_path,
+		uint64_t remote_size,
+		time_t remote_mtime,
+		uint64_t local_size,
+		struct arsdk_ftp_journal **ret_journal,
+		uint64_t *ret_off)
+{
+	int res = 0;
+	struct arsdk_ftp_journal *journal = NULL;
+	struct journal_header header;
+	uint64_t count = 0;
+	int valid = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(local_path != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(ret_journal != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(ret_off != NULL, -EINVAL);
+
+	journal = calloc(1, sizeof(*journal));
+	if (journal == NULL)
+		return -ENOMEM;
+
+	journal->a = 1;
+	journal->local_path = xstrdup(local_path);
+	if (journal->local_path == NULL ||
+	    asprintf(&journal->path, "%s" JOURNAL_SUFFIX, local_path) < 0) {
+		res = -ENOMEM;
+		goto error;
+	}
+
+	/* check the journal against the remote file */
+	journal->f = fopen(journal->path, "r+b");
+	if (journal->f != NULL &&
+	    read_header(journal->f, &header, &count) == 0 &&
+	    header.remote_size == remote_size &&
+	    (header.remote_mtime == 0 || remote_mtime == 0 ||
+	     header.remote_mtime == remote_mtime)) {
+		valid = 1;
+	}
+
+	/* the checkpoints beyond the local file are lost */
+	if (valid) {
+		if (count > local_size / ARSDK_FTP_JOURNAL_BLOCK_LEN)
+			count = local_size / ARSDK_FTP_JOURNAL_BLOCK_LEN;
+		count = verify_checkpoints(journal->f, local_path, count);
+		if (fflush(journal->f) != 0 ||
+		    ftruncate(fileno(journal->f), sizeof(header) +
+				count * sizeof(uint32_t)) < 0 ||
+		    fseeko(journal->f, 0, SEEK_END) < 0) {
+			res = -errno;
+			goto error;
+		}
+	} else {
+		count = 0;
+		if (journal->f != NULL)
+			fclose(journal->f);
+		journal->f = fopen(journal->path, "wb");
+		if (journal->f == NULL) {
+			res = -errno;
+			goto error;
+		}
+
+		memset(&header, 0, sizeof(header));
+		header.magic = JOURNAL_MAGIC;
+		header.version = JOURNAL_VERSION;
+		header.remote_size = remote_size;
+		header.remote_mtime = remote_mtime;
+		header.block_len = ARSDK_FTP_JOURNAL_BLOCK_LEN;
+		if (fwrite(&header, sizeof(header), 1, journal->f) != 1 ||
+		    fflush(journal->f) != 0) {
+			res = -errno;
+			goto error;
+		}
+	}
+
+	journal->count = count;
+	*ret_journal = journal;
+	*ret_off = count * ARSDK_FTP_JOURNAL_BLOCK_LEN;
+	return 0;
+error:
+	ARSDK_LOGE("Failed to open journal of '%s': err=%d(%s)",
+			local_path, -res, strerror(-res));
+	arsdk_ftp_journal_close(journal);
+	return res;
+}
+
+int arsdk_ftp_journal_close(struct arsdk_ftp_journal *journal)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(journal != NULL, -EINVAL);
+
+	if (journal->f != NULL)
+		fclose(journal->f);
+	free(journal->local_path);
+	free(journal->path);
+	free(journal);
+	return 0;
+}
+
+int arsdk_ftp_journal_remove(struct arsdk_ftp_journal *journal)
+{
+	int res = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(journal != NULL, -EINVAL);
+
+	if (unlink(journal->path) < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("unlink", -res);
+	}
+
+	arsdk_ftp_journal_close(journal);
+	return res;
+}
+
+uint64_t arsdk_ftp_journal_get_end(struct arsdk_ftp_journal *journal)
+{
+	if (journal == NULL)
+		return 0;
+
+	return journal->count * ARSDK_FTP_JOURNAL_BLOCK_LEN + journal->filled;
+}
+
+static int write_checkpoint(struct arsdk_ftp_journal *journal, uint32_t sum)
+{
+	if (fwrite(&sum, sizeof(sum), 1, journal->f) != 1 ||
+	    fflush(journal->f) != 0)
+		return -errno;
+
+	journal->count++;
+	return 0;
+}
+
+int arsdk_ftp_journal_write(struct arsdk_ftp_journal *journal,
+		FILE *fout,
+		const void *data,
+		size_t len)
+{
+	int res = 0;
+	size_t n = 0;
+	const uint8_t *ptr = data;
+
+	ARSDK_RETURN_ERR_IF_FAILED(journal != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(fout != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(data != NULL || len == 0, -EINVAL);
+
+	while (len > 0) {
+		n = ARSDK_FTP_JOURNAL_BLOCK_LEN - journal->filled;
+		if (n > len)
+			n = len;
+
+		adler_update(&journal->a, &journal->b, ptr, n);
+		journal->filled += n;
+		ptr += n;
+		len -= n;
+		if (journal->filled < ARSDK_FTP_JOURNAL_BLOCK_LEN)
+			break;
+
+		/* the checkpoint must not cover data not written */
+		if (fflush(fout) != 0)
+			return -errno;
+
+		res = write_checkpoint(journal,
+				(journal->b << 16) | journal->a);
+		if (res < 0)
+			return res;
+
+		journal->a = 1;
+		journal->b = 0;
+		journal->filled = 0;
+	}
+
+	return 0;
+}
+
+int arsdk_ftp_journal_sync(struct arsdk_ftp_journal *journal, uint64_t size)
+{
+	int res = 0;
+	uint32_t sum = 0;
+	FILE *fin = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(journal != NULL, -EINVAL);
+
+	if (size / ARSDK_FTP_JOURNAL_BLOCK_LEN <= journal->count)
+		return 0;
+
+	fin = fopen(journal->local_path, "rb");
+	if (fin == NULL)
+		return -errno;
+
+	/* the partial block is checksummed again from the file */
+	journal->a = 1;
+	journal->b = 0;
+	journal->filled = 0;
+	while (journal->count < size / ARSDK_FTP_JOURNAL_BLOCK_LEN) {
+		res = block_checksum(fin, journal->count, &sum);
+		if (res < 0)
+			break;
+
+		res = write_checkpoint(journal, sum);
+		if (res < 0)
+			break;
+	}
+
+	fclose(fin);
+	return res;
+}
+
+int arsdk_ftp_journal_get_info(const char *local_path,
+		uint64_t *remote_size,
+		uint64_t *checkpoint)
+{
+	int res = 0;
+	char *path = NULL;
+	FILE *f = NULL;
+	struct journal_header header;
+	uint64_t count = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(local_path != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(remote_size != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(checkpoint != NULL, -EINVAL);
+
+	if (asprintf(&path, "%s" JOURNAL_SUFFIX, local_path) < 0)
+		return -ENOMEM;
+
+	f = fopen(path, "rb");
+	free(path);
+	if (f == NULL)
+		return -errno;
+
+	res = read_header(f, &header, &count);
+	fclose(f);
+	if (res < 0)
+		return res;
+
+	*remote_size = header.remote_size;
+	*checkpoint = count * ARSDK_FTP_JOURNAL_BLOCK_LEN;
+	return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_FTP_JOURNAL_H_
+#define _ARSDK_FTP_JOURNAL_H_
+
+/**
+ * Journal of a file download, stored next to the local file with the
+ * ".journal" suffix. It records the size and the modification time of the
+ * remote file and a checkpoint per block of data received: the adler-32
+ * checksum of the block, written once the block is flushed to the local file.
+ * A resumed download is checked against the remote file and restarts after
+ * the last checkpoint matching the local file.
+ */
+struct arsdk_ftp_journal;
+
+/* length of the blocks checksummed */
+#define ARSDK_FTP_JOURNAL_BLOCK_LEN (1024 * 1024)
+
+/**
+ * Opens the journal of a download, created if missing or not matching the
+ * remote file.
+ * @param local_path : path of the local file.
+ * @param remote_size : size of the remote file.
+ * @param remote_mtime : modification time of the remote file, 0 if unknown.
+ * @param local_size : size of the local file.
+ * @param ret_journal : will receive the journal.
+ * @param ret_off : will receive the offset to resume the download from,
+ * the local file must be truncated to it.
+ * @return 0 in case of success, negative errno value in case of error.
+ */
+int arsdk_ftp_journal_open(const char *local_path,
+		uint64_t remote_size,
+		time_t remote_mtime,
+		uint64_t local_size,
+		struct arsdk_ftp_journal **ret_journal,
+		uint64_t *ret_off);
+
+/* closes the journal, kept to resume the download */
+int arsdk_ftp_journal_close(struct arsdk_ftp_journal *journal);
+
+/* closes and deletes the journal of a completed download */
+int arsdk_ftp_journal_remove(struct arsdk_ftp_journal *journal);
+
+/* end of the data checksummed */
+uint64_t arsdk_ftp_journal_get_end(struct arsdk_ftp_journal *journal);
+
+/**
+ * Checksums the data written at the end of the data checksummed; 'fout' is
+ * flushed before each checkpoint is written.
+ */
+int arsdk_ftp_journal_write(struct arsdk_ftp_journal *journal,
+		FILE *fout,
+		const void *data,
+		size_t len);
+
+/**
+ * Checksums the blocks of the local file from the end of the data
+ * checksummed to 'size', for data not given to arsdk_ftp_journal_write.
+ * The local file must be flushed.
+ */
+int arsdk_ftp_journal_sync(struct arsdk_ftp_journal *journal, uint64_t size);
+
+/**
+ * Reads the journal of a local file without checking it.
+ * @param local_path : path of the local file.
+ * @param remote_size : will receive the size of the remote file.
+ * @param checkpoint : will receive the end of the last checkpoint.
+ * @return 0 in case of success, -ENOENT if there is no journal,
+ * negative errno value in case of error.
+ */
+int arsdk_ftp_journal_get_info(const char *local_path,
+		uint64_t *remote_size,
+		uint64_t *checkpoint);
+
+#endif /* !_ARSDK_FTP_JOURNAL_H_ */
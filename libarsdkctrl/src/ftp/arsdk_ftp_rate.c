@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdk_ftp_log.h"
+#include "arsdk_ftp_rate.h"
+
+/** Burst allowed after an idle period (ms of transfer at the maximum rate) */
+#define RATE_BURST_MS 100
+
+/** Minimal burst, to not pause the transfers at each fragment */
+#define RATE_BURST_MIN (16 * 1024)
+
+static int64_t rate_burst(const struct arsdk_ftp_rate *rate)
+{
+	uint64_t burst = rate->max_rate * RATE_BURST_MS / 1000;
+
+	return (burst < RATE_BURST_MIN) ? RATE_BURST_MIN : (int64_t)burst;
+}
+
+void arsdk_ftp_rate_set(struct arsdk_ftp_rate *rate, uint64_t max_rate)
+{
+	ARSDK_RETURN_IF_FAILED(rate != NULL, -EINVAL);
+
+	rate->max_rate = max_rate;
+	if (rate->tokens > rate_burst(rate))
+		rate->tokens = rate_burst(rate);
+}
+
+uint32_t arsdk_ftp_rate_consume(struct arsdk_ftp_rate *rate, size_t len,
+		uint64_t now_us)
+{
+	int64_t burst = 0;
+	uint64_t added = 0;
+
+	if (rate == NULL || rate->max_rate == 0)
+		return 0;
+
+	/* refill since the last refill; the time is kept until a whole byte
+	 * is added */
+	burst = rate_burst(rate);
+	if (rate->last_us == 0) {
+		rate->tokens = burst;
+		rate->last_us = now_us;
+	} else if (now_us > rate->last_us) {
+		added = (now_us - rate->last_us) * rate->max_rate / 1000000;
+		if (added > 0) {
+			rate->tokens += added;
+			rate->last_us = now_us;
+		}
+		if (rate->tokens > burst)
+			rate->tokens = burst;
+	}
+
+	rate->tokens -= len;
+	if (rate->tokens >= 0)
+		return 0;
+
+	return (uint32_t)((-rate->tokens * 1000 + rate->max_rate - 1) /
+			rate->max_rate);
+}
@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_FTP_RATE_H_
+#define _ARSDK_FTP_RATE_H_
+
+/**
+ * Token bucket limiting the rate of the data transferred. The data is
+ * transferred first and the transfer is paused for the delay returned,
+ * until the bucket is refilled.
+ */
+struct arsdk_ftp_rate {
+	/* bytes per second, 0 for no limit */
+	uint64_t                        max_rate;
+	int64_t                         tokens;
+	uint64_t                        last_us;
+};
+
+/* 0 for no limit */
+void arsdk_ftp_rate_set(struct arsdk_ftp_rate *rate, uint64_t max_rate);
+
+/* returns the delay before the next transfer in ms, 0 if none */
+uint32_t arsdk_ftp_rate_consume(struct arsdk_ftp_rate *rate, size_t len,
+		uint64_t now_us);
+
+#endif /* !_ARSDK_FTP_RATE_H_ */
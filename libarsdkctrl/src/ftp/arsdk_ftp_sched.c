@@ -0,0 +1,321 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdk_ftp_log.h"
+#include "arsdk_ftp_sched.h"
+#include "arsdk_ftp_rate.h"
+
+struct arsdk_ftp_sched {
+	struct pomp_loop                *loop;
+	/* 0 for no limit */
+	uint32_t                        max_active;
+	uint32_t                        max_active_per_client;
+	uint32_t                        active;
+	/* clients in round-robin order, the last served at the end */
+	struct list_node                clients;
+	int                             dispatch_pending;
+	/* rate of all the transfers */
+	struct arsdk_ftp_rate           rate;
+};
+
+struct arsdk_ftp_sched_client {
+	struct arsdk_ftp_sched          *sched;
+	struct list_node                node;
+	uint32_t                        active;
+	uint32_t                        queued;
+	/* queued entries by priority */
+	struct list_node                queues[ARSDK_FTP_REQ_PRIORITY_COUNT];
+};
+
+static int has_free_slot(struct arsdk_ftp_sched *sched)
+{
+	return sched->max_active == 0 || sched->active < sched->max_active;
+}
+
+static int client_has_free_slot(struct arsdk_ftp_sched_client *client)
+{
+	struct arsdk_ftp_sched *sched = client->sched;
+
+	return sched->max_active_per_client == 0 ||
+	       client->active < sched->max_active_per_client;
+}
+
+static struct arsdk_ftp_sched_entry *client_pop(
+		struct arsdk_ftp_sched_client *client)
+{
+	int prio = 0;
+	struct list_node *queue = NULL;
+	struct arsdk_ftp_sched_entry *entry = NULL;
+
+	for (prio = ARSDK_FTP_REQ_PRIORITY_COUNT - 1; prio >= 0; prio--) {
+		queue = &client->queues[prio];
+		if (list_is_empty(queue))
+			continue;
+
+		entry = list_entry(list_first(queue),
+				struct arsdk_ftp_sched_entry, node);
+		list_del(&entry->node);
+		entry->queued = 0;
+		client->queued--;
+		return entry;
+	}
+
+	return NULL;
+}
+
+static void entry_activate(struct arsdk_ftp_sched_entry *entry)
+{
+	struct arsdk_ftp_sched_client *client = entry->client;
+
+	entry->active = 1;
+	client->active++;
+	client->sched->active++;
+}
+
+static void dispatch(struct arsdk_ftp_sched *sched)
+{
+	struct arsdk_ftp_sched_client *client = NULL;
+	struct arsdk_ftp_sched_client *next = NULL;
+	struct arsdk_ftp_sched_entry *entry = NULL;
+
+	while (has_free_slot(sched)) {
+		/* first client, from the least recently served, with a
+		 * queued entry and a free slot */
+		next = NULL;
+		list_walk_entry_forward(&sched->clients, client, node) {
+			if (client->queued > 0 &&
+			    client_has_free_slot(client)) {
+				next = client;
+				break;
+			}
+		}
+		if (next == NULL)
+			return;
+
+		/* move the client at the end of the round */
+		list_del(&next->node);
+		list_add_before(&sched->clients, &next->node);
+
+		/* the start callback can release or submit entries */
+		entry = client_pop(next);
+		entry_activate(entry);
+		(*entry->start)(entry);
+	}
+}
+
+static void dispatch_idle_cb(void *userdata)
+{
+	struct arsdk_ftp_sched *sched = userdata;
+
+	sched->dispatch_pending = 0;
+	dispatch(sched);
+}
+
+static void dispatch_later(struct arsdk_ftp_sched *sched)
+{
+	int res = 0;
+
+	if (sched->dispatch_pending)
+		return;
+
+	/* start the next transfers out of the callbacks of the ended one */
+	res = pomp_loop_idle_add(sched->loop, &dispatch_idle_cb, sched);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_loop_idle_add", -res);
+		return;
+	}
+	sched->dispatch_pending = 1;
+}
+
+int arsdk_ftp_sched_new(struct pomp_loop *loop,
+		struct arsdk_ftp_sched **ret_sched)
+{
+	struct arsdk_ftp_sched *sched = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(loop != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(ret_sched != NULL, -EINVAL);
+
+	sched = calloc(1, sizeof(*sched));
+	if (sched == NULL)
+		return -ENOMEM;
+
+	sched->loop = loop;
+	list_init(&sched->clients);
+
+	*ret_sched = sched;
+	return 0;
+}
+
+int arsdk_ftp_sched_destroy(struct arsdk_ftp_sched *sched)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(sched != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(list_is_empty(&sched->clients), -EBUSY);
+
+	pomp_loop_idle_remove(sched->loop, &dispatch_idle_cb, sched);
+	free(sched);
+	return 0;
+}
+
+int arsdk_ftp_sched_set_limits(struct arsdk_ftp_sched *sched,
+		uint32_t max_active,
+		uint32_t max_active_per_client)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(sched != NULL, -EINVAL);
+
+	sched->max_active = max_active;
+	sched->max_active_per_client = max_active_per_client;
+
+	/* start the transfers allowed by higher limits */
+	dispatch_later(sched);
+	return 0;
+}
+
+int arsdk_ftp_sched_set_max_rate(struct arsdk_ftp_sched *sched,
+		uint64_t max_rate)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(sched != NULL, -EINVAL);
+
+	arsdk_ftp_rate_set(&sched->rate, max_rate);
+	return 0;
+}
+
+uint32_t arsdk_ftp_sched_consume(struct arsdk_ftp_sched_client *client,
+		size_t len,
+		uint64_t now_us)
+{
+	if (client == NULL)
+		return 0;
+
+	return arsdk_ftp_rate_consume(&client->sched->rate, len, now_us);
+}
+
+int arsdk_ftp_sched_add_client(struct arsdk_ftp_sched *sched,
+		struct arsdk_ftp_sched_client **ret_client)
+{
+	int i = 0;
+	struct arsdk_ftp_sched_client *client = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(sched != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(ret_client != NULL, -EINVAL);
+
+	client = calloc(1, sizeof(*client));
+	if (client == NULL)
+		return -ENOMEM;
+
+	client->sched = sched;
+	for (i = 0; i < ARSDK_FTP_REQ_PRIORITY_COUNT; i++)
+		list_init(&client->queues[i]);
+	list_add_before(&sched->clients, &client->node);
+
+	*ret_client = client;
+	return 0;
+}
+
+int arsdk_ftp_sched_remove_client(struct arsdk_ftp_sched_client *client)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(client != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(client->queued == 0, -EBUSY);
+	ARSDK_RETURN_ERR_IF_FAILED(client->active == 0, -EBUSY);
+
+	list_del(&client->node);
+	free(client);
+	return 0;
+}
+
+int arsdk_ftp_sched_submit(struct arsdk_ftp_sched_client *client,
+		struct arsdk_ftp_sched_entry *entry)
+{
+	struct arsdk_ftp_sched *sched = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(client != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(entry != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(entry->start != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(entry->prio < ARSDK_FTP_REQ_PRIORITY_COUNT,
+			-EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(!entry->queued && !entry->active, -EBUSY);
+
+	sched = client->sched;
+	entry->client = client;
+
+	/* start now if nothing waits for a slot */
+	if (client->queued == 0 && has_free_slot(sched) &&
+	    client_has_free_slot(client)) {
+		entry_activate(entry);
+		return 1;
+	}
+
+	list_add_before(&client->queues[entry->prio], &entry->node);
+	entry->queued = 1;
+	client->queued++;
+	return 0;
+}
+
+int arsdk_ftp_sched_release(struct arsdk_ftp_sched_entry *entry)
+{
+	struct arsdk_ftp_sched_client *client = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(entry != NULL, -EINVAL);
+
+	client = entry->client;
+	if (client == NULL)
+		return 0;
+
+	if (entry->queued) {
+		list_del(&entry->node);
+		entry->queued = 0;
+		client->queued--;
+	} else if (entry->active) {
+		entry->active = 0;
+		client->active--;
+		client->sched->active--;
+		dispatch_later(client->sched);
+	}
+
+	entry->client = NULL;
+	return 0;
+}
+
+int arsdk_ftp_sched_set_prio(struct arsdk_ftp_sched_entry *entry,
+		enum arsdk_ftp_req_priority prio)
+{
+	struct arsdk_ftp_sched_client *client = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(entry != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(prio < ARSDK_FTP_REQ_PRIORITY_COUNT,
+			-EINVAL);
+
+	entry->prio = prio;
+
+	/* requeue at the end of its new priority */
+	client = entry->client;
+	if (entry->queued) {
+		list_del(&entry->node);
+		list_add_before(&client->queues[prio], &entry->node);
+	}
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_FTP_SCHED_H_
+#define _ARSDK_FTP_SCHED_H_
+
+/**
+ * Transfer scheduler shared by the ftp contexts of the devices of a
+ * controller. It limits the count of active transfers globally and per
+ * context, starts the queued transfers by priority and shares the free
+ * slots between the contexts in round-robin.
+ * All functions must be called from the loop of the scheduler.
+ */
+struct arsdk_ftp_sched;
+struct arsdk_ftp_sched_client;
+struct arsdk_ftp_sched_entry;
+
+typedef void (*arsdk_ftp_sched_start_t)(struct arsdk_ftp_sched_entry *entry);
+
+/** Transfer scheduled; embedded in the transfer object */
+struct arsdk_ftp_sched_entry {
+	struct list_node                node;
+	struct arsdk_ftp_sched_client   *client;
+	enum arsdk_ftp_req_priority     prio;
+	/* called when a queued transfer can start */
+	arsdk_ftp_sched_start_t         start;
+	void                            *userdata;
+	int                             queued;
+	int                             active;
+};
+
+int arsdk_ftp_sched_new(struct pomp_loop *loop,
+		struct arsdk_ftp_sched **ret_sched);
+
+int arsdk_ftp_sched_destroy(struct arsdk_ftp_sched *sched);
+
+/* 0 for no limit */
+int arsdk_ftp_sched_set_limits(struct arsdk_ftp_sched *sched,
+		uint32_t max_active,
+		uint32_t max_active_per_client);
+
+/* rate of all the transfers in bytes per second, 0 for no limit */
+int arsdk_ftp_sched_set_max_rate(struct arsdk_ftp_sched *sched,
+		uint64_t max_rate);
+
+/* accounts data transferred; returns the delay before the next transfer in
+ * ms, 0 if none */
+uint32_t arsdk_ftp_sched_consume(struct arsdk_ftp_sched_client *client,
+		size_t len,
+		uint64_t now_us);
+
+int arsdk_ftp_sched_add_client(struct arsdk_ftp_sched *sched,
+		struct arsdk_ftp_sched_client **ret_client);
+
+int arsdk_ftp_sched_remove_client(struct arsdk_ftp_sched_client *client);
+
+/* returns 1 if a slot is free, the caller starts the transfer immediately;
+ * 0 if the entry is queued, its start callback is called later */
+int arsdk_ftp_sched_submit(struct arsdk_ftp_sched_client *client,
+		struct arsdk_ftp_sched_entry *entry);
+
+/* end of an active transfer or removal of a queued one */
+int arsdk_ftp_sched_release(struct arsdk_ftp_sched_entry *entry);
+
+int arsdk_ftp_sched_set_prio(struct arsdk_ftp_sched_entry *entry,
+		enum arsdk_ftp_req_priority prio);
+
+#endif /* !_ARSDK_FTP_SCHED_H_ */
@@ -25,6 +25,12 @@
  */
 
 #include "arsdkctrl_priv.h"
+
+#ifdef __linux__
+#  include <unistd.h>
+#  include <sys/sendfile.h>
+#endif /* __linux__ */
+
 #include "arsdk_ftp_log.h"
 #include "arsdk_ftp_cmd.h"
 #include "arsdk_ftp_conn.h"
@@ -85,16 +91,34 @@ struct arsdk_ftp_seq {
 	struct list_node                        steps;
 	struct arsdk_ftp_seq_step               *current;
 	struct arsdk_ftp_seq_cbs                cbs;
+	struct arsdk_ftp_seq_upload_cfg         upload_cfg;
 	struct {
 		int                             opened;
 		struct pomp_ctx                 *ctx;
-		struct pomp_buffer              *output_buff;
 		int                             resp_226_received;
+		/* ring of recycled output buffers */
+		struct pomp_buffer              **out_buffs;
+		uint32_t                        out_count;
+		uint32_t                        out_next;
+		/* output buffers queued in the socket */
+		uint32_t                        out_pending;
+		int                             out_eof;
+		/* data_read in progress */
+		int                             out_reading;
+		/* data socket, given by the socket hook */
+		int                             fd;
+		/* sendfile upload: duplicate of the data socket and local
+		 * file to upload from, -1 when unused */
+		int                             sf_sock;
+		int                             sf_src;
+		off_t                           sf_off;
+		/* sf_sock monitored by the loop */
+		int                             sf_added;
+		/* transfer paused by the rate limitation */
+		int                             paused;
 	} data_stream;
 };
 
-#define ARSDK_FTP_SEQ_DATA_FRAG_LEN_MAX 1024
-
 /* forward declaration */
 static int process_event(struct arsdk_ftp_seq *seq,
 		struct arsdk_ftp_seq_event *event);
@@ -201,6 +225,11 @@ int arsdk_ftp_seq_new(struct pomp_loop *loop,
 	seq->conn = conn;
 	seq->cbs = *cbs;
 	seq->state = ARSDK_FTP_SEQ_STATE_INIT;
+	seq->upload_cfg.frag_len = ARSDK_FTP_SEQ_UPLOAD_FRAG_LEN_DEFAULT;
+	seq->upload_cfg.frag_count = ARSDK_FTP_SEQ_UPLOAD_FRAG_COUNT_DEFAULT;
+	seq->data_stream.fd = -1;
+	seq->data_stream.sf_sock = -1;
+	seq->data_stream.sf_src = -1;
 	list_init(&seq->steps);
 
 	memset(&conn_cbs, 0, sizeof(conn_cbs));
@@ -302,6 +331,14 @@ static int send_next_step(struct arsdk_ftp_seq *seq)
 	if (seq->current == NULL)
 		return process_event(seq, &event_end);
 
+	/* the server features are known once connected */
+	if (seq->current->cmd_desc->cmd_type == ARSDK_FTP_CMD_TYPE_MLSD &&
+	    !(arsdk_ftp_conn_get_feats(seq->conn) & ARSDK_FTP_FEAT_MLST))
+		seq->current->cmd_desc = &ARSDK_FTP_CMD_LIST;
+	else if (seq->current->cmd_desc->cmd_type == ARSDK_FTP_CMD_TYPE_MLST &&
+		 !(arsdk_ftp_conn_get_feats(seq->conn) & ARSDK_FTP_FEAT_MLST))
+		seq->current->cmd_desc = &ARSDK_FTP_CMD_SIZE;
+
 	res = arsdk_ftp_cmd_enc(seq->current->cmd_desc, seq->current->param,
 			&buff);
 	if (res < 0)
@@ -340,33 +377,41 @@ static int get_out_buff(struct arsdk_ftp_seq *seq, void **data, size_t *cap,
 		struct pomp_buffer **ret_buff)
 {
 	int res = 0;
+	uint32_t i = 0;
+	uint32_t idx = 0;
 	struct pomp_buffer *buff = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_buff != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(seq != NULL, -EINVAL);
-	buff = seq->data_stream.output_buff;
-	ARSDK_RETURN_ERR_IF_FAILED(buff != NULL, -EINVAL);
-
-	res = pomp_buffer_get_data(buff, data, NULL, cap);
-	if (res == -EPERM) {
-		/* output_buff still used */
-		/* replace by a new buffer */
-		pomp_buffer_unref(buff);
-		buff = pomp_buffer_new(ARSDK_FTP_SEQ_DATA_FRAG_LEN_MAX);
-		seq->data_stream.output_buff = buff;
-		if (buff == NULL)
-			return -ENOMEM;
+	ARSDK_RETURN_ERR_IF_FAILED(seq->data_stream.out_buffs != NULL, -EINVAL);
+
+	/* find a buffer of the ring no more referenced by the socket */
+	for (i = 0; i < seq->data_stream.out_count; i++) {
+		idx = (seq->data_stream.out_next + i) %
+				seq->data_stream.out_count;
+		buff = seq->data_stream.out_buffs[idx];
+		if (buff == NULL) {
+			buff = pomp_buffer_new(seq->upload_cfg.frag_len);
+			if (buff == NULL)
+				return -ENOMEM;
+			seq->data_stream.out_buffs[idx] = buff;
+		}
 
 		res = pomp_buffer_get_data(buff, data, NULL, cap);
-		if (res < 0)
+		if (res == -EPERM) {
+			/* still used */
+			continue;
+		} else if (res < 0) {
 			return res;
-	} else if (res < 0) {
+		}
 
-		return res;
+		seq->data_stream.out_next = (idx + 1) %
+				seq->data_stream.out_count;
+		*ret_buff = buff;
+		return 0;
 	}
 
-	*ret_buff = buff;
-	return 0;
+	return -EAGAIN;
 }
 
 static int data_read(struct arsdk_ftp_seq *seq)
@@ -380,31 +425,58 @@ static int data_read(struct arsdk_ftp_seq *seq)
 
 	ARSDK_RETURN_ERR_IF_FAILED(seq != NULL, -EINVAL);
 
-	res = get_out_buff(seq, &data, &cap, &buff);
-	if (res < 0)
-		goto error;
+	/* the send callback can be called while sending, the loop below
+	 * will continue to fill the socket */
+	if (seq->data_stream.out_reading)
+		return 0;
+	seq->data_stream.out_reading = 1;
+
+	/* keep up to 'frag_count' fragments queued in the socket */
+	while (!seq->data_stream.out_eof && !seq->data_stream.paused &&
+	       seq->data_stream.out_pending < seq->upload_cfg.frag_count) {
+		res = get_out_buff(seq, &data, &cap, &buff);
+		if (res == -EAGAIN)
+			break;
+		else if (res < 0)
+			goto error;
+
+		/* read callback */
+		read_len = (*seq->cbs.data_send)(seq, data, cap,
+				seq->cbs.userdata);
+		if (read_len == 0) {
+			/* end of read stream */
+			seq->data_stream.out_eof = 1;
+			break;
+		}
+
+		/* update buffer length */
+		res = pomp_buffer_set_len(buff, read_len);
+		if (res < 0)
+			goto error;
+
+		/* send the fragment */
+		seq->data_stream.out_pending++;
+		res = pomp_ctx_send_raw_buf(seq->data_stream.ctx, buff);
+		if (res < 0) {
+			seq->data_stream.out_pending--;
+			goto error;
+		}
+
+		/* stream stopped by the send callback */
+		if (seq->data_stream.out_buffs == NULL)
+			return 0;
+	}
+	seq->data_stream.out_reading = 0;
 
-	/* read callback */
-	read_len = (*seq->cbs.data_send)(seq, data, cap, seq->cbs.userdata);
-	if (read_len == 0) {
-		/* end of read stream*/
+	/* wait all fragments sent before closing the stream */
+	if (seq->data_stream.out_eof && seq->data_stream.out_pending == 0) {
 		event.type = ARSDK_FTP_SEQ_EVENT_TYPE_DATA_STREAM_STOP;
 		process_event(seq, &event);
-		return 0;
 	}
 
-	/* update buffer length */
-	res = pomp_buffer_set_len(buff, read_len);
-	if (res < 0)
-		goto error;
-
-	/* send the fragment */
-	res = pomp_ctx_send_raw_buf(seq->data_stream.ctx, buff);
-	if (res < 0)
-		goto error;
-
 	return 0;
 error:
+	seq->data_stream.out_reading = 0;
 	/* fail event */
 	event = arsdk_ftp_seq_event_fail(res);
 	process_event(seq, &event);
@@ -415,9 +487,194 @@ static void pomp_send_cb(struct pomp_ctx *ctx, struct pomp_conn *conn,
 		struct pomp_buffer *buf, uint32_t status, void *cookie,
 		void *userdata)
 {
-	data_read(userdata);
+	struct arsdk_ftp_seq *seq = userdata;
+	struct arsdk_ftp_seq_event event;
+
+	ARSDK_RETURN_IF_FAILED(seq != NULL, -EINVAL);
+
+	/* output stream already stopped */
+	if (seq->data_stream.out_buffs == NULL)
+		return;
+
+	if (seq->data_stream.out_pending > 0)
+		seq->data_stream.out_pending--;
+
+	if (status & (POMP_SEND_STATUS_ERROR | POMP_SEND_STATUS_ABORTED)) {
+		event = arsdk_ftp_seq_event_fail(-EIO);
+		process_event(seq, &event);
+		return;
+	}
+
+	data_read(seq);
+}
+
+#ifdef __linux__
+
+static void sendfile_stop(struct arsdk_ftp_seq *seq)
+{
+	if (seq->data_stream.sf_sock < 0)
+		return;
+
+	if (seq->data_stream.sf_added)
+		pomp_loop_remove(seq->loop, seq->data_stream.sf_sock);
+	seq->data_stream.sf_added = 0;
+	close(seq->data_stream.sf_sock);
+	seq->data_stream.sf_sock = -1;
+	seq->data_stream.sf_src = -1;
+}
+
+static int sendfile_write(struct arsdk_ftp_seq *seq)
+{
+	ssize_t len = 0;
+	size_t count = seq->upload_cfg.frag_len * seq->upload_cfg.frag_count;
+
+	len = sendfile(seq->data_stream.sf_sock, seq->data_stream.sf_src,
+			&seq->data_stream.sf_off, count);
+	if (len < 0)
+		return (errno == EAGAIN || errno == EINTR) ? 0 : -errno;
+
+	if (len == 0) {
+		/* end of file */
+		seq->data_stream.out_eof = 1;
+		return 0;
+	}
+
+	if (seq->cbs.data_sent != NULL)
+		(*seq->cbs.data_sent)(seq, (size_t)len, seq->cbs.userdata);
+
+	return 0;
+}
+
+static void sendfile_end(struct arsdk_ftp_seq *seq, int res)
+{
+	struct arsdk_ftp_seq_event event;
+
+	sendfile_stop(seq);
+
+	if (res < 0) {
+		/* fail event */
+		event = arsdk_ftp_seq_event_fail(res);
+		process_event(seq, &event);
+		return;
+	}
+
+	event.type = ARSDK_FTP_SEQ_EVENT_TYPE_DATA_STREAM_STOP;
+	process_event(seq, &event);
+}
+
+static void sendfile_fd_cb(int fd, uint32_t revents, void *userdata)
+{
+	int res = 0;
+	struct arsdk_ftp_seq *seq = userdata;
+
+	ARSDK_RETURN_IF_FAILED(seq != NULL, -EINVAL);
+
+	res = sendfile_write(seq);
+	if (res < 0 || seq->data_stream.out_eof)
+		sendfile_end(seq, res);
+}
+
+/**
+ * Starts to upload the local file given by the 'data_send_fd' callback with
+ * sendfile on a duplicate of the data socket, monitored by the loop.
+ * Returns -ENOTSUP if the upload must go through 'data_send'.
+ */
+static int sendfile_start(struct arsdk_ftp_seq *seq)
+{
+	int res = 0;
+	int src = -1;
+
+	if (seq->cbs.data_send_fd == NULL || seq->data_stream.fd < 0)
+		return -ENOTSUP;
+
+	src = (*seq->cbs.data_send_fd)(seq, &seq->data_stream.sf_off,
+			seq->cbs.userdata);
+	if (src < 0)
+		return -ENOTSUP;
+
+	seq->data_stream.sf_sock = dup(seq->data_stream.fd);
+	if (seq->data_stream.sf_sock < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("dup", -res);
+		return -ENOTSUP;
+	}
+	seq->data_stream.sf_src = src;
+	seq->data_stream.out_eof = 0;
+
+	/* first write; check that sendfile supports the source file */
+	res = sendfile_write(seq);
+	if (res == -EINVAL || res == -ENOSYS) {
+		sendfile_stop(seq);
+		return -ENOTSUP;
+	} else if (res < 0 || seq->data_stream.out_eof) {
+		sendfile_end(seq, res);
+		return 0;
+	}
+
+	/* the first write can pause the transfer, or pause and resume it */
+	if (seq->data_stream.paused || seq->data_stream.sf_added)
+		return 0;
+
+	res = pomp_loop_add(seq->loop, seq->data_stream.sf_sock,
+			POMP_FD_EVENT_OUT, &sendfile_fd_cb, seq);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_loop_add", -res);
+		sendfile_end(seq, res);
+		return 0;
+	}
+	seq->data_stream.sf_added = 1;
+
+	return 0;
+}
+
+static void sendfile_pause(struct arsdk_ftp_seq *seq)
+{
+	/* the first write may pause before the socket is monitored */
+	if (!seq->data_stream.sf_added)
+		return;
+
+	pomp_loop_remove(seq->loop, seq->data_stream.sf_sock);
+	seq->data_stream.sf_added = 0;
+}
+
+static void sendfile_resume(struct arsdk_ftp_seq *seq)
+{
+	int res = 0;
+
+	if (seq->data_stream.sf_sock < 0 || seq->data_stream.sf_added)
+		return;
+
+	res = pomp_loop_add(seq->loop, seq->data_stream.sf_sock,
+			POMP_FD_EVENT_OUT, &sendfile_fd_cb, seq);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_loop_add", -res);
+		sendfile_end(seq, res);
+		return;
+	}
+	seq->data_stream.sf_added = 1;
+}
+
+#else /* !__linux__ */
+
+static void sendfile_stop(struct arsdk_ftp_seq *seq)
+{
+}
+
+static int sendfile_start(struct arsdk_ftp_seq *seq)
+{
+	return -ENOTSUP;
 }
 
+static void sendfile_pause(struct arsdk_ftp_seq *seq)
+{
+}
+
+static void sendfile_resume(struct arsdk_ftp_seq *seq)
+{
+}
+
+#endif /* !__linux__ */
+
 static void dispatch_data_stream_ctx_destroy_cb(void *userdata)
 {
 	pomp_ctx_destroy(userdata);
@@ -425,12 +682,25 @@ static void dispatch_data_stream_ctx_destroy_cb(void *userdata)
 
 static int stop_send_data(struct arsdk_ftp_seq *seq)
 {
+	uint32_t i = 0;
+
 	ARSDK_RETURN_ERR_IF_FAILED(seq != NULL, -EINVAL);
 
-	if (seq->data_stream.output_buff != NULL) {
-		pomp_buffer_unref(seq->data_stream.output_buff);
-		seq->data_stream.output_buff = NULL;
+	sendfile_stop(seq);
+
+	if (seq->data_stream.out_buffs != NULL) {
+		for (i = 0; i < seq->data_stream.out_count; i++) {
+			if (seq->data_stream.out_buffs[i] != NULL)
+				pomp_buffer_unref(
+					seq->data_stream.out_buffs[i]);
+		}
+		free(seq->data_stream.out_buffs);
+		seq->data_stream.out_buffs = NULL;
 	}
+	seq->data_stream.out_count = 0;
+	seq->data_stream.out_next = 0;
+	seq->data_stream.out_pending = 0;
+	seq->data_stream.out_reading = 0;
 
 	return 0;
 }
@@ -441,12 +711,21 @@ static int start_send_data(struct arsdk_ftp_seq *seq)
 
 	ARSDK_RETURN_ERR_IF_FAILED(seq != NULL, -EINVAL);
 
-	seq->data_stream.output_buff =
-			pomp_buffer_new(ARSDK_FTP_SEQ_DATA_FRAG_LEN_MAX);
-	if (seq->data_stream.output_buff == NULL) {
+	/* kernel copy from the local file when possible */
+	res = sendfile_start(seq);
+	if (res != -ENOTSUP)
+		return res;
+
+	/* one more buffer than queued fragments, to refill the queue while
+	 * the socket releases the buffer it has just sent */
+	seq->data_stream.out_count = seq->upload_cfg.frag_count + 1;
+	seq->data_stream.out_buffs = calloc(seq->data_stream.out_count,
+			sizeof(*seq->data_stream.out_buffs));
+	if (seq->data_stream.out_buffs == NULL) {
 		res = -ENOMEM;
 		goto error;
 	}
+	seq->data_stream.out_eof = 0;
 
 	/* start to send data */
 	res = data_read(seq);
@@ -463,6 +742,7 @@ static int close_data_stream(struct arsdk_ftp_seq *seq)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(seq != NULL, -EINVAL);
 
+	seq->data_stream.fd = -1;
 	pomp_ctx_stop(seq->data_stream.ctx);
 	/* dispatch stream destroy out of stream ctx */
 	pomp_loop_idle_add(seq->loop, &dispatch_data_stream_ctx_destroy_cb,
@@ -609,6 +889,9 @@ static void data_event_cb(struct pomp_ctx *ctx,
 
 	switch (pomp_event) {
 	case POMP_EVENT_CONNECTED:
+		if (seq->data_stream.paused)
+			pomp_conn_suspend_read(sk_conn);
+
 		/* data socket stream connected */
 		event.type = ARSDK_FTP_SEQ_EVENT_TYPE_DATA_STREAM_START;
 		process_event(seq, &event);
@@ -645,6 +928,8 @@ static void socket_cb(struct pomp_ctx *ctx, int fd, enum pomp_socket_kind kind,
 
 	ARSDK_RETURN_IF_FAILED(seq != NULL, -EINVAL);
 
+	seq->data_stream.fd = fd;
+
 	/* socket hook callback */
 	(*seq->cbs.socketcb)(seq, fd, seq->cbs.userdata);
 }
@@ -713,6 +998,15 @@ static int manage_response(struct arsdk_ftp_seq *seq,
 		(*seq->cbs.file_size)(seq, response->param.file_size,
 				seq->cbs.userdata);
 		return 0;
+	case 250:
+		if (seq->current->cmd_desc->cmd_type != ARSDK_FTP_CMD_TYPE_MLST)
+			return 0;
+		(*seq->cbs.file_size)(seq, response->param.facts.size,
+				seq->cbs.userdata);
+		if (seq->cbs.file_mtime != NULL)
+			(*seq->cbs.file_mtime)(seq, response->param.facts.mtime,
+					seq->cbs.userdata);
+		return 0;
 	default:
 		return 0;
 	}
@@ -881,6 +1175,68 @@ int arsdk_ftp_seq_append(struct arsdk_ftp_seq *seq,
 	return process_event(seq, &event);
 }
 
+int arsdk_ftp_seq_set_upload_cfg(struct arsdk_ftp_seq *seq,
+		const struct arsdk_ftp_seq_upload_cfg *cfg)
+{
+	ARSDK_RETURN_ERR_IF_FAILED(seq != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cfg != NULL, -EINVAL);
+
+	if (seq->state != ARSDK_FTP_SEQ_STATE_INIT)
+		return -EBUSY;
+
+	seq->upload_cfg.frag_len = cfg->frag_len != 0 ? cfg->frag_len :
+			ARSDK_FTP_SEQ_UPLOAD_FRAG_LEN_DEFAULT;
+	seq->upload_cfg.frag_count = cfg->frag_count != 0 ? cfg->frag_count :
+			ARSDK_FTP_SEQ_UPLOAD_FRAG_COUNT_DEFAULT;
+	return 0;
+}
+
+int arsdk_ftp_seq_pause_data(struct arsdk_ftp_seq *seq)
+{
+	struct pomp_conn *conn = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(seq != NULL, -EINVAL);
+
+	if (seq->data_stream.paused)
+		return 0;
+	seq->data_stream.paused = 1;
+
+	/* stop reading the socket, the sender is slowed down by the tcp flow
+	 * control */
+	if (seq->data_stream.ctx != NULL) {
+		conn = pomp_ctx_get_conn(seq->data_stream.ctx);
+		if (conn != NULL)
+			pomp_conn_suspend_read(conn);
+	}
+
+	/* data_read() stops to queue fragments of buffered uploads */
+	sendfile_pause(seq);
+	return 0;
+}
+
+int arsdk_ftp_seq_resume_data(struct arsdk_ftp_seq *seq)
+{
+	struct pomp_conn *conn = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(seq != NULL, -EINVAL);
+
+	if (!seq->data_stream.paused)
+		return 0;
+	seq->data_stream.paused = 0;
+
+	if (seq->data_stream.ctx != NULL) {
+		conn = pomp_ctx_get_conn(seq->data_stream.ctx);
+		if (conn != NULL)
+			pomp_conn_resume_read(conn);
+	}
+
+	sendfile_resume(seq);
+	if (seq->data_stream.out_buffs != NULL)
+		return data_read(seq);
+
+	return 0;
+}
+
 int arsdk_ftp_seq_start(struct arsdk_ftp_seq *seq)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(seq != NULL, -EINVAL);
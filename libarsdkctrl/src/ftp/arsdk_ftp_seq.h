@@ -37,6 +37,18 @@ enum arsdk_ftp_seq_status {
 	ARSDK_FTP_SEQ_ABORTED,
 };
 
+/** Default length of the fragments sent by uploads */
+#define ARSDK_FTP_SEQ_UPLOAD_FRAG_LEN_DEFAULT (64 * 1024)
+
+/** Default count of fragments queued in the data socket by uploads */
+#define ARSDK_FTP_SEQ_UPLOAD_FRAG_COUNT_DEFAULT 4
+
+/** Upload configuration; 0 fields select the defaults */
+struct arsdk_ftp_seq_upload_cfg {
+	size_t          frag_len;
+	uint32_t        frag_count;
+};
+
 struct arsdk_ftp_seq_cbs {
 	void *userdata;
 
@@ -52,10 +64,24 @@ struct arsdk_ftp_seq_cbs {
 	size_t (*data_send)(struct arsdk_ftp_seq *seq, void *buffer,
 			size_t cap, void *userdata);
 
+	/* Optional: local file descriptor and offset to upload from with
+	 * sendfile, negative to read the data with 'data_send' */
+	int (*data_send_fd)(struct arsdk_ftp_seq *seq, off_t *offset,
+			void *userdata);
+
+	/* Optional: length uploaded with sendfile */
+	void (*data_sent)(struct arsdk_ftp_seq *seq, size_t len,
+			void *userdata);
+
 	void (*file_size)(struct arsdk_ftp_seq *seq,
 			size_t size,
 			void *userdata);
 
+	/* Optional: modification time given by a "MLST" command */
+	void (*file_mtime)(struct arsdk_ftp_seq *seq,
+			time_t mtime,
+			void *userdata);
+
 	void (*socketcb)(struct arsdk_ftp_seq *seq,
 			int fd,
 			void *userdata);
@@ -79,6 +105,14 @@ static inline int arsdk_ftp_seq_append_uint64(struct arsdk_ftp_seq *seq,
 	return arsdk_ftp_seq_append(seq, desc, param_str);
 };
 
+int arsdk_ftp_seq_set_upload_cfg(struct arsdk_ftp_seq *seq,
+		const struct arsdk_ftp_seq_upload_cfg *cfg);
+
+/* pauses the transfer of the data stream until resumed */
+int arsdk_ftp_seq_pause_data(struct arsdk_ftp_seq *seq);
+
+int arsdk_ftp_seq_resume_data(struct arsdk_ftp_seq *seq);
+
 int arsdk_ftp_seq_start(struct arsdk_ftp_seq *seq);
 
 int arsdk_ftp_seq_stop(struct arsdk_ftp_seq *seq);
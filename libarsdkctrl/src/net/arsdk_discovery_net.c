@@ -28,33 +28,122 @@
 #include <net/arsdk_net.h>
 #include "arsdkctrl_net_log.h"
 
+/** Default maximum number of concurrent connection attempts */
+#define ARSDK_DISCOVERY_NET_DEFAULT_MAX_PROBES 32
+/** Default connection attempt duration before probing next address (ms) */
+#define ARSDK_DISCOVERY_NET_DEFAULT_PROBE_TIMEOUT 2000
+/** Period of the probe rotation timer (ms) */
+#define ARSDK_DISCOVERY_NET_PROBE_TICK 200
+/** Minimum subnet prefix length accepted */
+#define ARSDK_DISCOVERY_NET_SUBNET_PREFIX_MIN 16
+
+/** Probe of one address */
+struct arsdk_discovery_net_probe {
+	struct list_node                   node;
+	struct arsdk_discovery_net         *discovery;
+	uint32_t                           addr_idx;
+	struct pomp_ctx                    *ctx;
+	char                               addr[INET_ADDRSTRLEN];
+	int                                connected;
+	uint64_t                           deadline;
+	struct arsdk_discovery_device_info dev_info;
+};
+
 /** */
 struct arsdk_discovery_net {
 	struct arsdk_discovery          *parent;
 	struct arsdkctrl_backend_net    *backend;
-	struct pomp_ctx                 *ctx;
-	char                            *addr;
+	struct arsdk_ctrl               *ctrl;
 	enum arsdk_device_type          *types;
 	size_t                          n_types;
-	struct arsdk_discovery_device_info dev_info;
+
+	/* addresses to probe (network byte order) */
+	in_addr_t                       *addrs;
+	uint8_t                         *addrs_active;
+	uint32_t                        addrs_count;
+	uint32_t                        next_addr;
+
+	/* active probes */
+	struct list_node                probes;
+	uint32_t                        pending_count;
+	uint32_t                        max_probes;
+	uint32_t                        probe_timeout;
+	struct pomp_timer               *timer;
 };
 
+static int get_time_us(uint64_t *us)
+{
+	struct timespec now = {0, 0};
+	int res;
+
+	if (time_get_monotonic(&now) < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("time_get_monotonic", errno);
+		return res;
+	}
+
+	return time_timespec_to_us(&now, us);
+}
+
+static void probe_reset_dev_info(struct arsdk_discovery_net_probe *probe)
+{
+	free((char *)probe->dev_info.name);
+	probe->dev_info.name = NULL;
+	free((char *)probe->dev_info.id);
+	probe->dev_info.id = NULL;
+}
+
+/**
+ * A probe is pending while it has not reported a device.
+ * Only pending probes are limited and rotated.
+ */
+static int probe_is_pending(const struct arsdk_discovery_net_probe *probe)
+{
+	return probe->dev_info.name == NULL;
+}
+
+static void probe_set_deadline(struct arsdk_discovery_net_probe *probe)
+{
+	uint64_t now = 0;
+
+	if (get_time_us(&now) < 0)
+		return;
+
+	probe->deadline = now +
+			(uint64_t)probe->discovery->probe_timeout * 1000;
+}
+
 static void event_cb(struct pomp_ctx *ctx,
 		enum pomp_event event,
 		struct pomp_conn *conn,
 		const struct pomp_msg *msg,
 		void *userdata)
 {
-	struct arsdk_discovery_net *self = userdata;
+	struct arsdk_discovery_net_probe *probe = userdata;
+	struct arsdk_discovery_net *self = probe->discovery;
 
-	if (event == POMP_EVENT_DISCONNECTED) {
-		arsdk_discovery_remove_device(self->parent, &self->dev_info);
+	switch (event) {
+	case POMP_EVENT_CONNECTED:
+		probe->connected = 1;
+		break;
+
+	case POMP_EVENT_DISCONNECTED:
+		probe->connected = 0;
+		if (probe_is_pending(probe))
+			break;
+
+		arsdk_discovery_remove_device(self->parent, &probe->dev_info);
 
 		/* Reset device info */
-		free((char *)self->dev_info.name);
-		self->dev_info.name = NULL;
-		free((char *)self->dev_info.id);
-		self->dev_info.id = NULL;
+		probe_reset_dev_info(probe);
+
+		/* Back in the pending probes */
+		self->pending_count++;
+		probe_set_deadline(probe);
+		break;
+
+	default:
+		break;
 	}
 }
 
@@ -122,15 +211,17 @@ out:
 static void raw_cb(struct pomp_ctx *ctx, struct pomp_conn *conn,
 		   struct pomp_buffer *buf, void *userdata)
 {
-	struct arsdk_discovery_net *self = userdata;
+	struct arsdk_discovery_net_probe *probe = userdata;
+	struct arsdk_discovery_net *self = NULL;
 	const void *cdata = NULL;
 	size_t len = 0;
 	int res = 0;
 
-	ARSDK_RETURN_IF_FAILED(self != NULL, -EINVAL);
+	ARSDK_RETURN_IF_FAILED(probe != NULL, -EINVAL);
+	self = probe->discovery;
 
-	/* Number of device is limited to one */
-	if (self->dev_info.name != NULL)
+	/* Number of device is limited to one per address */
+	if (!probe_is_pending(probe))
 		return;
 
 	/* Get data from buffer */
@@ -141,13 +232,21 @@ static void raw_cb(struct pomp_ctx *ctx, struct pomp_conn *conn,
 	}
 
 	/* setup device info */
-	res = json_parsing(cdata, len, &self->dev_info);
-	if (res < 0)
+	res = json_parsing(cdata, len, &probe->dev_info);
+	if (res < 0 || !is_devtype_supported(self, probe->dev_info.type)) {
+		/* Keep probe pending, it will be rotated out */
+		probe_reset_dev_info(probe);
 		return;
+	}
 
-	/* add device if type is supported */
-	if (is_devtype_supported(self, self->dev_info.type))
-		arsdk_discovery_add_device(self->parent, &self->dev_info);
+	/* add device */
+	res = arsdk_discovery_add_device(self->parent, &probe->dev_info);
+	if (res < 0) {
+		probe_reset_dev_info(probe);
+		return;
+	}
+
+	self->pending_count--;
 }
 
 /**
@@ -157,27 +256,260 @@ static void socket_cb(struct pomp_ctx *ctx,
 		enum pomp_socket_kind kind,
 		void *userdata)
 {
-	struct arsdk_discovery_net *self = userdata;
+	struct arsdk_discovery_net_probe *probe = userdata;
 	struct arsdkctrl_backend *base;
 
-	ARSDK_RETURN_IF_FAILED(self != NULL, -EINVAL);
-	ARSDK_RETURN_IF_FAILED(self->backend != NULL, -EINVAL);
+	ARSDK_RETURN_IF_FAILED(probe != NULL, -EINVAL);
+	ARSDK_RETURN_IF_FAILED(probe->discovery->backend != NULL, -EINVAL);
 
 	/* socket hook callback */
-	base = arsdkctrl_backend_net_get_parent(self->backend);
+	base = arsdkctrl_backend_net_get_parent(probe->discovery->backend);
 
 	arsdkctrl_backend_socket_cb(base, fd, ARSDK_SOCKET_KIND_DISCOVERY);
 }
 
 /**
  */
-int arsdk_discovery_net_new(struct arsdk_ctrl *ctrl,
+static void probe_destroy(struct arsdk_discovery_net_probe *probe)
+{
+	struct arsdk_discovery_net *self = probe->discovery;
+
+	list_del(&probe->node);
+
+	/* Stopping the context removes the device if any */
+	if (probe->ctx != NULL) {
+		pomp_ctx_stop(probe->ctx);
+		pomp_ctx_destroy(probe->ctx);
+	}
+
+	if (probe_is_pending(probe))
+		self->pending_count--;
+	probe_reset_dev_info(probe);
+
+	self->addrs_active[probe->addr_idx] = 0;
+	free(probe);
+}
+
+/**
+ */
+static int probe_start(struct arsdk_discovery_net *self, uint32_t addr_idx)
+{
+	struct arsdk_discovery_net_probe *probe = NULL;
+	struct sockaddr_in addr;
+	int res = 0;
+
+	/* Allocate structure */
+	probe = calloc(1, sizeof(*probe));
+	if (probe == NULL)
+		return -ENOMEM;
+
+	/* Initialize structure */
+	probe->discovery = self;
+	probe->addr_idx = addr_idx;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_port = htons(ARSDK_NET_DISCOVERY_PORT);
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = self->addrs[addr_idx];
+	inet_ntop(AF_INET, &addr.sin_addr, probe->addr, sizeof(probe->addr));
+	probe->dev_info.addr = probe->addr;
+
+	probe->ctx = pomp_ctx_new_with_loop(&event_cb, probe,
+			arsdk_ctrl_get_loop(self->ctrl));
+	if (probe->ctx == NULL) {
+		free(probe);
+		return -ENOMEM;
+	}
+
+	/* Register the probe before any callback */
+	list_add_after(list_last(&self->probes), &probe->node);
+	self->addrs_active[addr_idx] = 1;
+	self->pending_count++;
+	probe_set_deadline(probe);
+
+	/* Set socket callback*/
+	res = pomp_ctx_set_socket_cb(probe->ctx, socket_cb);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_ctx_set_socket_cb", -res);
+		goto error;
+	}
+
+	/* use pomp in raw mode */
+	res = pomp_ctx_set_raw(probe->ctx, &raw_cb);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_ctx_set_raw", -res);
+		goto error;
+	}
+
+	/* Disable TCP keepalive */
+	res = pomp_ctx_setup_keepalive(probe->ctx, 0, 0, 0, 0);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_ctx_setup_keepalive", -res);
+		goto error;
+	}
+
+	res = pomp_ctx_connect(probe->ctx, (struct sockaddr *)&addr,
+			sizeof(addr));
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_ctx_connect", -res);
+		goto error;
+	}
+
+	return 0;
+
+	/* Cleanup in case of error */
+error:
+	probe_destroy(probe);
+	return res;
+}
+
+/**
+ * Start probes on the next inactive addresses until the limit of pending
+ * probes is reached.
+ */
+static int probes_fill(struct arsdk_discovery_net *self)
+{
+	uint32_t tries = 0;
+	uint32_t idx = 0;
+	int res = 0;
+
+	while (self->pending_count < self->max_probes &&
+	       tries < self->addrs_count) {
+		idx = self->next_addr;
+		self->next_addr = (self->next_addr + 1) % self->addrs_count;
+		tries++;
+
+		if (self->addrs_active[idx])
+			continue;
+
+		res = probe_start(self, idx);
+		if (res < 0)
+			break;
+	}
+
+	return res;
+}
+
+/**
+ * Rotate pending probes which did not find any device in time.
+ */
+static void timer_cb(struct pomp_timer *timer, void *userdata)
+{
+	struct arsdk_discovery_net *self = userdata;
+	struct arsdk_discovery_net_probe *probe = NULL;
+	struct arsdk_discovery_net_probe *tmp = NULL;
+	uint64_t now = 0;
+
+	if (get_time_us(&now) < 0)
+		return;
+
+	list_walk_entry_forward_safe(&self->probes, probe, tmp, node) {
+		if (!probe_is_pending(probe) || probe->deadline > now)
+			continue;
+
+		probe_destroy(probe);
+	}
+
+	probes_fill(self);
+}
+
+/**
+ */
+static int addrs_reserve(struct arsdk_discovery_net *self, uint32_t count)
+{
+	in_addr_t *addrs = NULL;
+
+	addrs = realloc(self->addrs,
+			(self->addrs_count + count) * sizeof(*addrs));
+	if (addrs == NULL)
+		return -ENOMEM;
+
+	self->addrs = addrs;
+	return 0;
+}
+
+/**
+ * Add an address to the probe set, ignoring it if it is already in the
+ * 'dup_count' first addresses.
+ */
+static void addrs_add(struct arsdk_discovery_net *self, in_addr_t addr,
+		uint32_t dup_count)
+{
+	uint32_t i = 0;
+
+	for (i = 0; i < dup_count; i++) {
+		if (self->addrs[i] == addr)
+			return;
+	}
+
+	self->addrs[self->addrs_count++] = addr;
+}
+
+/**
+ */
+static int addrs_add_subnet(struct arsdk_discovery_net *self,
+		const char *subnet)
+{
+	char buf[INET_ADDRSTRLEN + 4];
+	struct in_addr net;
+	char *sep = NULL;
+	char *end = NULL;
+	long prefix = 0;
+	uint32_t mask = 0;
+	uint32_t first = 0;
+	uint32_t last = 0;
+	uint32_t host = 0;
+	uint32_t dup_count = self->addrs_count;
+	int res = 0;
+
+	if (strlen(subnet) >= sizeof(buf))
+		return -EINVAL;
+	snprintf(buf, sizeof(buf), "%s", subnet);
+
+	sep = strchr(buf, '/');
+	if (sep == NULL)
+		return -EINVAL;
+	*sep = '\0';
+
+	prefix = strtol(sep + 1, &end, 10);
+	if (*end != '\0' || prefix < ARSDK_DISCOVERY_NET_SUBNET_PREFIX_MIN ||
+	    prefix > 32)
+		return -EINVAL;
+
+	if (inet_pton(AF_INET, buf, &net) != 1)
+		return -EINVAL;
+
+	mask = prefix == 32 ? 0xffffffff : ~(0xffffffff >> prefix);
+	first = ntohl(net.s_addr) & mask;
+	last = first | ~mask;
+
+	/* Skip network and broadcast addresses */
+	if (prefix < 31) {
+		first++;
+		last--;
+	}
+
+	res = addrs_reserve(self, last - first + 1);
+	if (res < 0)
+		return res;
+
+	/* Explicit addresses are already in the set */
+	for (host = first; host <= last && host >= first; host++)
+		addrs_add(self, htonl(host), dup_count);
+
+	return 0;
+}
+
+/**
+ */
+int arsdk_discovery_net_new_with_probe_cfg(struct arsdk_ctrl *ctrl,
 		struct arsdkctrl_backend_net *backend,
 		const struct arsdk_discovery_cfg *cfg,
-		const char *addr,
+		const struct arsdk_discovery_net_probe_cfg *probe_cfg,
 		struct arsdk_discovery_net **ret_obj)
 {
 	struct arsdk_discovery_net *self = NULL;
+	struct in_addr addr;
+	uint32_t i = 0;
 	int res = 0;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_obj != NULL, -EINVAL);
@@ -187,7 +519,11 @@ int arsdk_discovery_net_new(struct arsdk_ctrl *ctrl,
 	ARSDK_RETURN_ERR_IF_FAILED(cfg != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(cfg->types != NULL, -EINVAL);
 	ARSDK_RETURN_ERR_IF_FAILED(cfg->count > 0, -EINVAL);
-	ARSDK_RETURN_ERR_IF_FAILED(addr != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(probe_cfg != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(probe_cfg->addrs != NULL ||
+			probe_cfg->addrs_count == 0, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(probe_cfg->addrs_count > 0 ||
+			probe_cfg->subnet != NULL, -EINVAL);
 
 	/* Allocate structure */
 	self = calloc(1, sizeof(*self));
@@ -196,29 +532,54 @@ int arsdk_discovery_net_new(struct arsdk_ctrl *ctrl,
 
 	/* Initialize structure */
 	self->backend = backend;
-	self->ctx = pomp_ctx_new_with_loop(&event_cb, self,
-			arsdk_ctrl_get_loop(ctrl));
-	self->addr = xstrdup(addr);
-	self->dev_info.addr = self->addr;
-
-	/* Set socket callback*/
-	res = pomp_ctx_set_socket_cb(self->ctx, socket_cb);
-	if (res < 0) {
-		ARSDK_LOG_ERRNO("pomp_ctx_set_socket_cb", -res);
+	self->ctrl = ctrl;
+	list_init(&self->probes);
+	self->max_probes = probe_cfg->max_probes != 0 ?
+			probe_cfg->max_probes :
+			ARSDK_DISCOVERY_NET_DEFAULT_MAX_PROBES;
+	self->probe_timeout = probe_cfg->probe_timeout_ms != 0 ?
+			probe_cfg->probe_timeout_ms :
+			ARSDK_DISCOVERY_NET_DEFAULT_PROBE_TIMEOUT;
+
+	/* Build the address set */
+	res = addrs_reserve(self, probe_cfg->addrs_count);
+	if (res < 0)
 		goto error;
+
+	for (i = 0; i < probe_cfg->addrs_count; i++) {
+		if (probe_cfg->addrs[i] == NULL ||
+		    inet_pton(AF_INET, probe_cfg->addrs[i], &addr) != 1) {
+			ARSDK_LOGE("invalid probe address '%s'",
+					probe_cfg->addrs[i] != NULL ?
+					probe_cfg->addrs[i] : "");
+			res = -EINVAL;
+			goto error;
+		}
+
+		addrs_add(self, addr.s_addr, self->addrs_count);
 	}
 
-	/* use pomp in raw mode */
-	res = pomp_ctx_set_raw(self->ctx, &raw_cb);
-	if (res < 0) {
-		ARSDK_LOG_ERRNO("pomp_ctx_set_raw", -res);
+	if (probe_cfg->subnet != NULL) {
+		res = addrs_add_subnet(self, probe_cfg->subnet);
+		if (res < 0) {
+			ARSDK_LOGE("invalid probe subnet '%s'",
+					probe_cfg->subnet);
+			goto error;
+		}
+	}
+
+	self->addrs_active = calloc(self->addrs_count,
+			sizeof(*self->addrs_active));
+	if (self->addrs_active == NULL) {
+		res = -ENOMEM;
 		goto error;
 	}
 
-	/* Disable TCP keepalive */
-	res = pomp_ctx_setup_keepalive(self->ctx, 0, 0, 0, 0);
-	if (res < 0) {
-		ARSDK_LOG_ERRNO("pomp_ctx_setup_keepalive", -res);
+	/* Create probe rotation timer */
+	self->timer = pomp_timer_new(arsdk_ctrl_get_loop(ctrl),
+			&timer_cb, self);
+	if (self->timer == NULL) {
+		res = -ENOMEM;
 		goto error;
 	}
 
@@ -251,19 +612,51 @@ error:
 	return res;
 }
 
+/**
+ */
+int arsdk_discovery_net_new(struct arsdk_ctrl *ctrl,
+		struct arsdkctrl_backend_net *backend,
+		const struct arsdk_discovery_cfg *cfg,
+		const char *addr,
+		struct arsdk_discovery_net **ret_obj)
+{
+	struct arsdk_discovery_net_probe_cfg probe_cfg;
+
+	ARSDK_RETURN_ERR_IF_FAILED(addr != NULL, -EINVAL);
+
+	memset(&probe_cfg, 0, sizeof(probe_cfg));
+	probe_cfg.addrs = &addr;
+	probe_cfg.addrs_count = 1;
+
+	return arsdk_discovery_net_new_with_probe_cfg(ctrl, backend, cfg,
+			&probe_cfg, ret_obj);
+}
+
 /**
  */
 int arsdk_discovery_net_destroy(struct arsdk_discovery_net *self)
 {
+	struct arsdk_discovery_net_probe *probe = NULL;
+	struct arsdk_discovery_net_probe *tmp = NULL;
+
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
 
-	pomp_ctx_destroy(self->ctx);
+	list_walk_entry_forward_safe(&self->probes, probe, tmp, node) {
+		probe_destroy(probe);
+	}
+
+	if (self->timer != NULL) {
+		pomp_timer_clear(self->timer);
+		pomp_timer_destroy(self->timer);
+	}
 
-	arsdk_discovery_destroy(self->parent);
+	if (self->parent != NULL)
+		arsdk_discovery_destroy(self->parent);
 	self->parent = NULL;
 
 	free(self->types);
-	free(self->addr);
+	free(self->addrs);
+	free(self->addrs_active);
 
 	/* Free resources */
 	free(self);
@@ -274,7 +667,6 @@ int arsdk_discovery_net_destroy(struct arsdk_discovery_net *self)
  */
 int arsdk_discovery_net_start(struct arsdk_discovery_net *self)
 {
-	struct sockaddr_in addr;
 	int res = 0;
 
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
@@ -286,15 +678,21 @@ int arsdk_discovery_net_start(struct arsdk_discovery_net *self)
 		return res;
 	}
 
-	addr.sin_port = htons(ARSDK_NET_DISCOVERY_PORT);
-	addr.sin_family = AF_INET;
-	addr.sin_addr.s_addr = inet_addr(self->addr);
-
-	res = pomp_ctx_connect(self->ctx, (struct sockaddr *)&addr,
-			sizeof(addr));
-	if (res < 0) {
-		ARSDK_LOG_ERRNO("pomp_ctx_connect", -res);
+	self->next_addr = 0;
+	res = probes_fill(self);
+	if (res < 0 && list_is_empty(&self->probes))
 		goto error;
+
+	/* Rotation is only needed if all addresses can not be probed at
+	 * the same time */
+	if (self->addrs_count > self->max_probes) {
+		res = pomp_timer_set_periodic(self->timer,
+				ARSDK_DISCOVERY_NET_PROBE_TICK,
+				ARSDK_DISCOVERY_NET_PROBE_TICK);
+		if (res < 0) {
+			ARSDK_LOG_ERRNO("pomp_timer_set_periodic", -res);
+			goto error;
+		}
 	}
 
 	return 0;
@@ -309,17 +707,18 @@ error:
  */
 int arsdk_discovery_net_stop(struct arsdk_discovery_net *self)
 {
-	int res = 0;
+	struct arsdk_discovery_net_probe *probe = NULL;
+	struct arsdk_discovery_net_probe *tmp = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(self != NULL, -EINVAL);
 
-	res = pomp_ctx_stop(self->ctx);
-	if (res < 0) {
-		ARSDK_LOG_ERRNO("pomp_ctx_connect", -res);
-		return res;
+	pomp_timer_clear(self->timer);
+
+	list_walk_entry_forward_safe(&self->probes, probe, tmp, node) {
+		probe_destroy(probe);
 	}
 
 	arsdk_discovery_stop(self->parent);
 
-	return res;
+	return 0;
 }
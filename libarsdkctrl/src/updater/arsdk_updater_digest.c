@@ -0,0 +1,498 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdkctrl_priv.h"
+#include "arsdkctrl_default_log.h"
+#include "updater/arsdk_updater_digest.h"
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/** Count of computed files kept in cache */
+#define DIGEST_CACHE_MAX 4
+
+/** */
+enum digest_file_state {
+	DIGEST_FILE_QUEUED,
+	DIGEST_FILE_RUNNING,
+	DIGEST_FILE_DONE,
+};
+
+/** File digested; only the fields marked as such are shared with the worker */
+struct digest_file {
+	struct arsdk_updater_digest     *digest;
+	/* identity, constant */
+	char                            *path;
+	dev_t                           dev;
+	ino_t                           ino;
+	off_t                           size;
+	time_t                          mtime;
+
+	/* protected by the mutex */
+	enum digest_file_state          state;
+	int                             status;
+	uint8_t                         md5[ARSDK_MD5_LENGTH];
+	/* node in the work or done queue */
+	struct list_node                qnode;
+	int                             in_done;
+
+	/* loop only */
+	struct list_node                jobs;
+	struct list_node                node;
+};
+
+/** */
+struct arsdk_updater_digest_job {
+	struct digest_file              *file;
+	arsdk_updater_digest_cb_t       cb;
+	void                            *userdata;
+	struct list_node                node;
+};
+
+/** */
+struct arsdk_updater_digest {
+	struct pomp_loop                *loop;
+	struct pomp_evt                 *evt;
+	pthread_t                       thread;
+	int                             thread_started;
+	pthread_mutex_t                 mutex;
+	pthread_cond_t                  cond;
+	/* protected by the mutex, also polled by the worker while reading */
+	int                             stopped;
+	struct list_node                queue;
+	struct list_node                done;
+	/* loop only */
+	struct list_node                files;
+	size_t                          files_nb;
+};
+
+/**
+ */
+static void digest_file_destroy(struct digest_file *file)
+{
+	struct arsdk_updater_digest_job *job = NULL;
+	struct arsdk_updater_digest_job *job_tmp = NULL;
+
+	list_walk_entry_forward_safe(&file->jobs, job, job_tmp, node) {
+		ARSDK_LOGW("digest job %p still pending", job);
+		list_del(&job->node);
+		free(job);
+	}
+
+	list_del(&file->node);
+	file->digest->files_nb--;
+	free(file->path);
+	free(file);
+}
+
+/**
+ */
+static int digest_file_compute(struct arsdk_updater_digest *digest,
+		struct digest_file *file,
+		uint8_t *md5)
+{
+	struct stat st;
+	int res = 0;
+	int fd = -1;
+
+	fd = open(file->path, O_RDONLY);
+	if (fd < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("open", -res);
+		return res;
+	}
+
+	/* the file must not have been replaced since the request */
+	if (fstat(fd, &st) < 0) {
+		res = -errno;
+		goto out;
+	}
+	if (st.st_dev != file->dev || st.st_ino != file->ino ||
+	    st.st_size != file->size || st.st_mtime != file->mtime) {
+		ARSDK_LOGW("firmware file '%s' modified", file->path);
+		res = -ESTALE;
+		goto out;
+	}
+
+	res = arsdk_md5_compute_stoppable(fd, md5, &digest->stopped);
+
+out:
+	close(fd);
+	return res;
+}
+
+/**
+ */
+static void *digest_thread(void *userdata)
+{
+	struct arsdk_updater_digest *digest = userdata;
+	struct digest_file *file = NULL;
+	uint8_t md5[ARSDK_MD5_LENGTH];
+	int status = 0;
+
+	pthread_mutex_lock(&digest->mutex);
+	while (!digest->stopped) {
+		if (list_is_empty(&digest->queue)) {
+			pthread_cond_wait(&digest->cond, &digest->mutex);
+			continue;
+		}
+
+		file = list_entry(list_first(&digest->queue),
+				struct digest_file, qnode);
+		list_del(&file->qnode);
+		file->state = DIGEST_FILE_RUNNING;
+		pthread_mutex_unlock(&digest->mutex);
+
+		/* the file is not freed while running */
+		status = digest_file_compute(digest, file, md5);
+
+		pthread_mutex_lock(&digest->mutex);
+		file->status = status;
+		if (status == 0)
+			memcpy(file->md5, md5, sizeof(file->md5));
+		file->state = DIGEST_FILE_DONE;
+		list_add_before(&digest->done, &file->qnode);
+		file->in_done = 1;
+		pomp_evt_signal(digest->evt);
+	}
+	pthread_mutex_unlock(&digest->mutex);
+
+	return NULL;
+}
+
+/**
+ */
+static void digest_trim(struct arsdk_updater_digest *digest)
+{
+	struct digest_file *file = NULL;
+	struct digest_file *file_tmp = NULL;
+
+	/* drop the oldest idle results, and the failures */
+	pthread_mutex_lock(&digest->mutex);
+	list_walk_entry_forward_safe(&digest->files, file, file_tmp, node) {
+		if (file->state != DIGEST_FILE_DONE || file->in_done ||
+		    !list_is_empty(&file->jobs))
+			continue;
+		if (file->status == 0 && digest->files_nb <= DIGEST_CACHE_MAX)
+			continue;
+		digest_file_destroy(file);
+	}
+	pthread_mutex_unlock(&digest->mutex);
+}
+
+/**
+ */
+static void digest_file_notify(struct digest_file *file)
+{
+	struct arsdk_updater_digest_job *job = NULL;
+
+	/* jobs may be canceled or added by the callbacks */
+	while (!list_is_empty(&file->jobs)) {
+		job = list_entry(list_first(&file->jobs),
+				struct arsdk_updater_digest_job, node);
+		list_del(&job->node);
+		(*job->cb)(file->status, file->status == 0 ? file->md5 : NULL,
+				job->userdata);
+		free(job);
+	}
+}
+
+/**
+ */
+static void digest_evt_cb(struct pomp_evt *evt, void *userdata)
+{
+	struct arsdk_updater_digest *digest = userdata;
+	struct digest_file *file = NULL;
+	struct list_node done;
+
+	/* Clear first so that results pushed while notifying signal again */
+	pomp_evt_clear(evt);
+
+	list_init(&done);
+	pthread_mutex_lock(&digest->mutex);
+	while (!list_is_empty(&digest->done)) {
+		file = list_entry(list_first(&digest->done),
+				struct digest_file, qnode);
+		list_del(&file->qnode);
+		list_add_before(&done, &file->qnode);
+		file->in_done = 0;
+	}
+	pthread_mutex_unlock(&digest->mutex);
+
+	/* files are only freed by digest_trim, the done nodes are kept local */
+	while (!list_is_empty(&done)) {
+		file = list_entry(list_first(&done), struct digest_file, qnode);
+		list_del(&file->qnode);
+		digest_file_notify(file);
+	}
+
+	digest_trim(digest);
+}
+
+/**
+ */
+int arsdk_updater_digest_new(struct pomp_loop *loop,
+		struct arsdk_updater_digest **ret_digest)
+{
+	struct arsdk_updater_digest *digest = NULL;
+	int res = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_digest != NULL, -EINVAL);
+	*ret_digest = NULL;
+	ARSDK_RETURN_ERR_IF_FAILED(loop != NULL, -EINVAL);
+
+	digest = calloc(1, sizeof(*digest));
+	if (digest == NULL)
+		return -ENOMEM;
+
+	digest->loop = loop;
+	list_init(&digest->queue);
+	list_init(&digest->done);
+	list_init(&digest->files);
+	pthread_mutex_init(&digest->mutex, NULL);
+	pthread_cond_init(&digest->cond, NULL);
+
+	digest->evt = pomp_evt_new();
+	if (digest->evt == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
+	res = pomp_evt_attach_to_loop(digest->evt, loop, &digest_evt_cb,
+			digest);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("pomp_evt_attach_to_loop", -res);
+		pomp_evt_destroy(digest->evt);
+		digest->evt = NULL;
+		goto error;
+	}
+
+	*ret_digest = digest;
+	return 0;
+
+error:
+	arsdk_updater_digest_destroy(digest);
+	return res;
+}
+
+/**
+ */
+int arsdk_updater_digest_destroy(struct arsdk_updater_digest *digest)
+{
+	struct digest_file *file = NULL;
+	struct digest_file *file_tmp = NULL;
+
+	ARSDK_RETURN_ERR_IF_FAILED(digest != NULL, -EINVAL);
+
+	/* the computation in progress is stopped at its next read */
+	if (digest->thread_started) {
+		pthread_mutex_lock(&digest->mutex);
+		__atomic_store_n(&digest->stopped, 1, __ATOMIC_RELEASE);
+		pthread_cond_signal(&digest->cond);
+		pthread_mutex_unlock(&digest->mutex);
+		pthread_join(digest->thread, NULL);
+		digest->thread_started = 0;
+	}
+
+	if (digest->evt != NULL) {
+		pomp_evt_detach_from_loop(digest->evt, digest->loop);
+		pomp_evt_destroy(digest->evt);
+		digest->evt = NULL;
+	}
+
+	list_walk_entry_forward_safe(&digest->files, file, file_tmp, node) {
+		digest_file_destroy(file);
+	}
+
+	pthread_cond_destroy(&digest->cond);
+	pthread_mutex_destroy(&digest->mutex);
+	free(digest);
+	return 0;
+}
+
+/**
+ */
+static struct digest_file *digest_file_find(
+		struct arsdk_updater_digest *digest,
+		const char *path,
+		const struct stat *st)
+{
+	struct digest_file *file = NULL;
+
+	list_walk_entry_forward(&digest->files, file, node) {
+		if (file->dev == st->st_dev && file->ino == st->st_ino &&
+		    file->size == st->st_size &&
+		    file->mtime == st->st_mtime &&
+		    strcmp(file->path, path) == 0)
+			return file;
+	}
+
+	return NULL;
+}
+
+/**
+ */
+static struct digest_file *digest_file_new(
+		struct arsdk_updater_digest *digest,
+		const char *path,
+		const struct stat *st)
+{
+	struct digest_file *file = NULL;
+
+	file = calloc(1, sizeof(*file));
+	if (file == NULL)
+		return NULL;
+
+	file->path = strdup(path);
+	if (file->path == NULL) {
+		free(file);
+		return NULL;
+	}
+
+	file->digest = digest;
+	file->dev = st->st_dev;
+	file->ino = st->st_ino;
+	file->size = st->st_size;
+	file->mtime = st->st_mtime;
+	file->state = DIGEST_FILE_QUEUED;
+	list_init(&file->jobs);
+	list_add_before(&digest->files, &file->node);
+	digest->files_nb++;
+
+	return file;
+}
+
+/**
+ */
+int arsdk_updater_digest_compute(struct arsdk_updater_digest *digest,
+		const char *path,
+		arsdk_updater_digest_cb_t cb,
+		void *userdata,
+		struct arsdk_updater_digest_job **ret_job)
+{
+	struct arsdk_updater_digest_job *job = NULL;
+	struct digest_file *file = NULL;
+	struct stat st;
+	int res = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(ret_job != NULL, -EINVAL);
+	*ret_job = NULL;
+	ARSDK_RETURN_ERR_IF_FAILED(digest != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(path != NULL, -EINVAL);
+	ARSDK_RETURN_ERR_IF_FAILED(cb != NULL, -EINVAL);
+
+	if (stat(path, &st) < 0) {
+		res = -errno;
+		ARSDK_LOG_ERRNO("stat", -res);
+		return res;
+	}
+
+	job = calloc(1, sizeof(*job));
+	if (job == NULL)
+		return -ENOMEM;
+	job->cb = cb;
+	job->userdata = userdata;
+
+	file = digest_file_find(digest, path, &st);
+	if (file != NULL) {
+		/* most recently used last */
+		list_del(&file->node);
+		list_add_before(&digest->files, &file->node);
+
+		/* notify a computed result from the loop */
+		pthread_mutex_lock(&digest->mutex);
+		if (file->state == DIGEST_FILE_DONE && !file->in_done) {
+			list_add_before(&digest->done, &file->qnode);
+			file->in_done = 1;
+			pomp_evt_signal(digest->evt);
+		}
+		pthread_mutex_unlock(&digest->mutex);
+		goto out;
+	}
+
+	file = digest_file_new(digest, path, &st);
+	if (file == NULL) {
+		free(job);
+		return -ENOMEM;
+	}
+
+	if (!digest->thread_started) {
+		res = pthread_create(&digest->thread, NULL, &digest_thread,
+				digest);
+		if (res != 0) {
+			ARSDK_LOG_ERRNO("pthread_create", res);
+			digest_file_destroy(file);
+			free(job);
+			return -res;
+		}
+		digest->thread_started = 1;
+	}
+
+	pthread_mutex_lock(&digest->mutex);
+	list_add_before(&digest->queue, &file->qnode);
+	pthread_cond_signal(&digest->cond);
+	pthread_mutex_unlock(&digest->mutex);
+
+out:
+	job->file = file;
+	list_add_before(&file->jobs, &job->node);
+	*ret_job = job;
+	return 0;
+}
+
+/**
+ */
+int arsdk_updater_digest_cancel(struct arsdk_updater_digest_job *job)
+{
+	struct arsdk_updater_digest *digest = NULL;
+	struct digest_file *file = NULL;
+	int queued = 0;
+
+	ARSDK_RETURN_ERR_IF_FAILED(job != NULL, -EINVAL);
+
+	file = job->file;
+	digest = file->digest;
+	list_del(&job->node);
+	free(job);
+
+	if (!list_is_empty(&file->jobs))
+		return 0;
+
+	/* nobody waits for a file not started yet; a running computation
+	 * completes and is kept in cache */
+	pthread_mutex_lock(&digest->mutex);
+	if (file->state == DIGEST_FILE_QUEUED) {
+		list_del(&file->qnode);
+		queued = 1;
+	}
+	pthread_mutex_unlock(&digest->mutex);
+
+	if (queued)
+		digest_file_destroy(file);
+
+	return 0;
+}
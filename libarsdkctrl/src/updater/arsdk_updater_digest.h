@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ARSDK_UPDATER_DIGEST_H_
+#define _ARSDK_UPDATER_DIGEST_H_
+
+/**
+ * Firmware digest engine. The md5 of the firmware files is computed by a
+ * worker thread and notified on the loop of the engine. Results are cached
+ * by file identity (device, inode, size and modification time) so that a
+ * firmware uploaded to several devices is read once, and the requests of a
+ * file being computed wait for the same computation.
+ * All functions must be called from the loop of the engine.
+ */
+struct arsdk_updater_digest;
+struct arsdk_updater_digest_job;
+
+/* status is 0 or a negative errno value; md5 is only valid if status is 0 */
+typedef void (*arsdk_updater_digest_cb_t)(int status,
+		const uint8_t *md5,
+		void *userdata);
+
+int arsdk_updater_digest_new(struct pomp_loop *loop,
+		struct arsdk_updater_digest **ret_digest);
+
+/* jobs still pending are dropped without notification */
+int arsdk_updater_digest_destroy(struct arsdk_updater_digest *digest);
+
+/* the callback is always called from the loop, never from this function */
+int arsdk_updater_digest_compute(struct arsdk_updater_digest *digest,
+		const char *path,
+		arsdk_updater_digest_cb_t cb,
+		void *userdata,
+		struct arsdk_updater_digest_job **ret_job);
+
+/* the callback of the job is not called */
+int arsdk_updater_digest_cancel(struct arsdk_updater_digest_job *job);
+
+#endif /* !_ARSDK_UPDATER_DIGEST_H_ */
@@ -30,6 +30,7 @@
 #include "updater/arsdk_updater_transport.h"
 #include "updater/arsdk_updater_transport_priv.h"
 #include "arsdk_updater_transport_ftp.h"
+#include "updater/arsdk_updater_digest.h"
 
 #define ARSDK_UPDATER_TRANSPORT_TAG             "ftp"
 
@@ -49,16 +50,32 @@ struct arsdk_updater_ftp_req_upload {
 	struct arsdk_updater_req_upload_cbs     cbs;
 	size_t                                  total_size;
 	struct {
+		struct arsdk_updater_digest_job *digest_job;
+		char                            str[2 * ARSDK_MD5_LENGTH + 1];
+		/* md5 file left on the device by a previous upload */
+		struct arsdk_ftp_req_get        *ftp_get_req;
+		char                            remote[2 * ARSDK_MD5_LENGTH + 1];
 		struct arsdk_ftp_req_put        *ftp_put_req;
+		int                             uploaded;
 		double                          ulsize;
 	} md5;
 	struct {
 		struct arsdk_ftp_req_put        *ftp_put_req;
 		const char                      *file_name;
+		char                            *local_path;
 		char                            *remote_tmp_path;
+		/* firmware of another upload removed */
+		struct arsdk_ftp_req_delete     *ftp_delete_req;
+		int                             cleaned;
+		int                             started;
+		/* data sent, the remote file has been truncated */
+		int                             sending;
 		double                          ulsize;
 	} fw;
 	struct arsdk_ftp_req_rename             *ftp_rename_req;
+	int                                     renamed;
+	/* defers the completion while sub-requests are canceled */
+	int                                     busy;
 	enum arsdk_updater_req_status           status;
 	int                                     error;
 };
@@ -84,12 +101,19 @@ static void arsdk_updater_req_upload_destroy(
 {
 	ARSDK_RETURN_IF_FAILED(req_upload != NULL, -EINVAL);
 
-	if ((req_upload->md5.ftp_put_req != NULL) ||
-	    (req_upload->fw.ftp_put_req != NULL))
+	if ((req_upload->md5.ftp_get_req != NULL) ||
+	    (req_upload->md5.ftp_put_req != NULL) ||
+	    (req_upload->fw.ftp_delete_req != NULL) ||
+	    (req_upload->fw.ftp_put_req != NULL) ||
+	    (req_upload->ftp_rename_req != NULL))
 		ARSDK_LOGW("request %p still pending", req_upload);
 
+	if (req_upload->md5.digest_job != NULL)
+		arsdk_updater_digest_cancel(req_upload->md5.digest_job);
+
 	arsdk_updater_destroy_req_upload(req_upload->parent);
 
+	free(req_upload->fw.local_path);
 	free(req_upload->fw.remote_tmp_path);
 	free(req_upload);
 }
@@ -236,11 +260,32 @@ int arsdk_updater_transport_ftp_destroy(
 	return 0;
 }
 
+static void update_check_done(
+		struct arsdk_updater_ftp_req_upload *req_upload);
+
 int arsdk_updater_ftp_req_upload_cancel(
 		struct arsdk_updater_ftp_req_upload *req)
 {
 	ARSDK_RETURN_ERR_IF_FAILED(req != NULL, -EINVAL);
 
+	/* sub-requests may complete synchronously */
+	req->busy++;
+
+	if (req->status == ARSDK_UPDATER_REQ_STATUS_OK) {
+		req->status = req->is_aborted ?
+				ARSDK_UPDATER_REQ_STATUS_ABORTED :
+				ARSDK_UPDATER_REQ_STATUS_CANCELED;
+	}
+
+	if (req->md5.digest_job != NULL) {
+		arsdk_updater_digest_cancel(req->md5.digest_job);
+		req->md5.digest_job = NULL;
+	}
+
+	if (req->md5.ftp_get_req != NULL)
+		arsdk_ftp_req_get_cancel(req->md5.ftp_get_req);
+	if (req->fw.ftp_delete_req != NULL)
+		arsdk_ftp_req_delete_cancel(req->fw.ftp_delete_req);
 	if (req->md5.ftp_put_req != NULL)
 		arsdk_ftp_req_put_cancel(req->md5.ftp_put_req);
 	if (req->fw.ftp_put_req != NULL)
@@ -248,6 +293,8 @@ int arsdk_updater_ftp_req_upload_cancel(
 	if (req->ftp_rename_req != NULL)
 		arsdk_ftp_req_rename_cancel(req->ftp_rename_req);
 
+	req->busy--;
+	update_check_done(req);
 	return 0;
 }
 
@@ -305,10 +352,121 @@ static void update_rename_complete_cb(struct arsdk_ftp_itf *itf,
 
 	ARSDK_RETURN_IF_FAILED(req_upload != NULL, -EINVAL);
 
-	req_upload->status = ftp_to_updater_status(status);
-	req_upload->error = error;
+	req_upload->ftp_rename_req = NULL;
+	req_upload->renamed = 1;
+	if (req_upload->status == ARSDK_UPDATER_REQ_STATUS_OK) {
+		req_upload->status = ftp_to_updater_status(status);
+		req_upload->error = error;
+	}
+
+	update_check_done(req_upload);
+}
+
+static int update_rename(struct arsdk_updater_ftp_req_upload *req_upload)
+{
+	struct arsdk_ftp_req_rename_cbs ftp_rename_cbs;
+
+	ftp_rename_cbs.userdata = req_upload;
+	ftp_rename_cbs.complete = &update_rename_complete_cb;
+
+	return arsdk_ftp_itf_create_req_rename(req_upload->tsprt->ftp,
+			&ftp_rename_cbs, req_upload->dev_type,
+			ARSDK_FTP_SRV_TYPE_UPDATE,
+			req_upload->fw.remote_tmp_path,
+			req_upload->fw.file_name,
+			&req_upload->ftp_rename_req);
+}
+
+static int update_put_md5(struct arsdk_updater_ftp_req_upload *req_upload);
+
+static int update_delete_fw(struct arsdk_updater_ftp_req_upload *req_upload);
+
+static int update_put_fw(struct arsdk_updater_ftp_req_upload *req_upload,
+		uint8_t is_resume);
+
+/**
+ * Upload without md5 file on the device: there is nothing to resume, the
+ * firmware is uploaded while its digest is computed.
+ */
+static int update_check_parallel(
+		struct arsdk_updater_ftp_req_upload *req_upload)
+{
+	if (!req_upload->fw.started)
+		return update_put_fw(req_upload, 0);
+
+	/* the md5 file is uploaded once the firmware of another upload has
+	 * been truncated, to never match it */
+	if (req_upload->md5.digest_job == NULL &&
+	    req_upload->md5.ftp_put_req == NULL &&
+	    !req_upload->md5.uploaded &&
+	    (req_upload->fw.sending || req_upload->fw.ftp_put_req == NULL))
+		return update_put_md5(req_upload);
+
+	if (req_upload->md5.uploaded &&
+	    req_upload->fw.ftp_put_req == NULL &&
+	    req_upload->ftp_rename_req == NULL)
+		return update_rename(req_upload);
 
-	update_upload_complete(req_upload);
+	return 0;
+}
+
+static void update_check_done(
+		struct arsdk_updater_ftp_req_upload *req_upload)
+{
+	int res = 0;
+	int pending = 0;
+
+	if (req_upload->busy > 0)
+		return;
+
+	pending = (req_upload->md5.digest_job != NULL) ||
+			(req_upload->md5.ftp_get_req != NULL) ||
+			(req_upload->md5.ftp_put_req != NULL) ||
+			(req_upload->fw.ftp_delete_req != NULL) ||
+			(req_upload->fw.ftp_put_req != NULL) ||
+			(req_upload->ftp_rename_req != NULL);
+
+	if ((req_upload->status != ARSDK_UPDATER_REQ_STATUS_OK) ||
+	    req_upload->renamed) {
+		if (!pending)
+			update_upload_complete(req_upload);
+		return;
+	}
+
+	/* no md5 file read from the device */
+	if (req_upload->md5.ftp_get_req == NULL &&
+	    req_upload->md5.remote[0] == '\0') {
+		res = update_check_parallel(req_upload);
+		goto out;
+	}
+
+	if (pending)
+		return;
+
+	/* a partial firmware left on the device always matches its md5 file:
+	 * the partial firmware of another upload is removed before the md5
+	 * file is uploaded, and the firmware is uploaded after it */
+	if (req_upload->fw.started) {
+		res = update_rename(req_upload);
+	} else if (req_upload->md5.remote[0] != '\0' &&
+		   strcmp(req_upload->md5.remote, req_upload->md5.str) == 0) {
+		ARSDK_LOGI("[%s] Resume firmware upload",
+				ARSDK_UPDATER_TRANSPORT_TAG);
+		res = update_put_fw(req_upload, 1);
+	} else if (!req_upload->fw.cleaned) {
+		res = update_delete_fw(req_upload);
+	} else if (!req_upload->md5.uploaded) {
+		res = update_put_md5(req_upload);
+	} else {
+		res = update_put_fw(req_upload, 0);
+	}
+
+out:
+	if (res < 0) {
+		req_upload->status = ARSDK_UPDATER_REQ_STATUS_FAILED;
+		req_upload->error = res;
+		arsdk_updater_ftp_req_upload_cancel(req_upload);
+	}
 }
 
 static void update_put_progress_cb(struct arsdk_ftp_itf *itf,
@@ -340,6 +498,13 @@ static void update_put_progress_cb(struct arsdk_ftp_itf *itf,
 	(*req_upload->cbs.progress)(updater_itf,
 			req_upload->parent, update_percent,
 			req_upload->cbs.userdata);
+
+	/* the md5 file may wait for the firmware data to be sent */
+	if (req == req_upload->fw.ftp_put_req && !req_upload->fw.sending &&
+	    req_upload->fw.ulsize > 0) {
+		req_upload->fw.sending = 1;
+		update_check_done(req_upload);
+	}
 }
 
 static void update_put_complete_cb(struct arsdk_ftp_itf *itf,
@@ -348,57 +513,168 @@ static void update_put_complete_cb(struct arsdk_ftp_itf *itf,
 			int error,
 			void *userdata)
 {
-	int res = 0;
-	struct arsdk_ftp_req_rename_cbs ftp_rename_cbs;
 	struct arsdk_updater_ftp_req_upload *req_upload = userdata;
 
 	ARSDK_RETURN_IF_FAILED(req_upload != NULL, -EINVAL);
 
-	if (req_upload->status != ARSDK_UPDATER_REQ_STATUS_OK)
-		goto end;
-
-	if (req_upload->is_aborted) {
-		req_upload->status = ARSDK_UPDATER_REQ_STATUS_ABORTED;
-		goto end;
+	if (req == req_upload->md5.ftp_put_req) {
+		req_upload->md5.ftp_put_req = NULL;
+		req_upload->md5.uploaded = (status == ARSDK_FTP_REQ_STATUS_OK);
+	} else if (req == req_upload->fw.ftp_put_req) {
+		req_upload->fw.ftp_put_req = NULL;
 	}
 
-	if (status != ARSDK_FTP_REQ_STATUS_OK) {
-		req_upload->status = ftp_to_updater_status(status);
-		req_upload->error = error;
-		arsdk_updater_ftp_req_upload_cancel(req_upload);
+	if (req_upload->status == ARSDK_UPDATER_REQ_STATUS_OK) {
+		if (req_upload->is_aborted) {
+			req_upload->status = ARSDK_UPDATER_REQ_STATUS_ABORTED;
+		} else if (status != ARSDK_FTP_REQ_STATUS_OK) {
+			req_upload->status = ftp_to_updater_status(status);
+			req_upload->error = error;
+		}
+
+		/* stop the other sub-requests, completes if none is left */
+		if (req_upload->status != ARSDK_UPDATER_REQ_STATUS_OK) {
+			arsdk_updater_ftp_req_upload_cancel(req_upload);
+			return;
+		}
 	}
 
-end:
-	if (req == req_upload->md5.ftp_put_req)
-		req_upload->md5.ftp_put_req = NULL;
-	else if (req == req_upload->fw.ftp_put_req)
-		req_upload->fw.ftp_put_req = NULL;
+	update_check_done(req_upload);
+}
 
-	if ((req_upload->md5.ftp_put_req != NULL) ||
-	    (req_upload->fw.ftp_put_req != NULL))
-		return;
+static int update_put_md5(struct arsdk_updater_ftp_req_upload *req_upload)
+{
+	int res = 0;
+	struct arsdk_ftp_req_put_cbs ftp_put_cbs;
+	struct pomp_buffer *md5_buff = NULL;
 
-	if (req_upload->status != ARSDK_UPDATER_REQ_STATUS_OK) {
-		update_upload_complete(req_upload);
-		return;
-	}
+	ftp_put_cbs.userdata = req_upload;
+	ftp_put_cbs.complete = &update_put_complete_cb;
+	ftp_put_cbs.progress = &update_put_progress_cb;
 
-	/* rename remote file */
-	ftp_rename_cbs.userdata = req_upload;
-	ftp_rename_cbs.complete = &update_rename_complete_cb;
+	/* create md5 buff*/
+	md5_buff = pomp_buffer_new_with_data(req_upload->md5.str,
+			strlen(req_upload->md5.str));
+	if (md5_buff == NULL)
+		return -ENOMEM;
 
-	res = arsdk_ftp_itf_create_req_rename(req_upload->tsprt->ftp,
-			&ftp_rename_cbs, req_upload->dev_type,
+	/* upload md5 file */
+	res =  arsdk_ftp_itf_create_req_put_buff(req_upload->tsprt->ftp,
+			&ftp_put_cbs, req_upload->dev_type,
+			ARSDK_FTP_SRV_TYPE_UPDATE, "/md5_check.md5",
+			md5_buff, 0, &req_upload->md5.ftp_put_req);
+	pomp_buffer_unref(md5_buff);
+	return res;
+}
+
+static int update_put_fw(struct arsdk_updater_ftp_req_upload *req_upload,
+		uint8_t is_resume)
+{
+	int res = 0;
+	struct arsdk_ftp_req_put_cbs ftp_put_cbs;
+
+	ftp_put_cbs.userdata = req_upload;
+	ftp_put_cbs.complete = &update_put_complete_cb;
+	ftp_put_cbs.progress = &update_put_progress_cb;
+
+	/* upload updater file, from the size already on the device if
+	 * resumed */
+	res =  arsdk_ftp_itf_create_req_put(req_upload->tsprt->ftp,
+			&ftp_put_cbs, req_upload->dev_type,
 			ARSDK_FTP_SRV_TYPE_UPDATE,
 			req_upload->fw.remote_tmp_path,
-			req_upload->fw.file_name,
-			&req_upload->ftp_rename_req);
-	if (res < 0) {
+			req_upload->fw.local_path, is_resume,
+			&req_upload->fw.ftp_put_req);
+	if (res < 0)
+		return res;
+
+	req_upload->fw.started = 1;
+	return 0;
+}
+
+static void update_delete_complete_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_delete *req,
+		enum arsdk_ftp_req_status status,
+		int error,
+		void *userdata)
+{
+	struct arsdk_updater_ftp_req_upload *req_upload = userdata;
+
+	ARSDK_RETURN_IF_FAILED(req_upload != NULL, -EINVAL);
+
+	/* usually fails as there is no partial firmware */
+	req_upload->fw.ftp_delete_req = NULL;
+	req_upload->fw.cleaned = 1;
+
+	update_check_done(req_upload);
+}
+
+static int update_delete_fw(struct arsdk_updater_ftp_req_upload *req_upload)
+{
+	struct arsdk_ftp_req_delete_cbs ftp_delete_cbs;
+
+	ftp_delete_cbs.userdata = req_upload;
+	ftp_delete_cbs.complete = &update_delete_complete_cb;
+
+	return arsdk_ftp_itf_create_req_delete(req_upload->tsprt->ftp,
+			&ftp_delete_cbs, req_upload->dev_type,
+			ARSDK_FTP_SRV_TYPE_UPDATE,
+			req_upload->fw.remote_tmp_path,
+			&req_upload->fw.ftp_delete_req);
+}
+
+static void update_get_md5_progress_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_get *req,
+		float percent,
+		void *userdata)
+{
+}
+
+static void update_get_md5_complete_cb(struct arsdk_ftp_itf *itf,
+		struct arsdk_ftp_req_get *req,
+		enum arsdk_ftp_req_status status,
+		int error,
+		void *userdata)
+{
+	struct arsdk_updater_ftp_req_upload *req_upload = userdata;
+	struct pomp_buffer *buff = NULL;
+	const void *data = NULL;
+	size_t len = 0;
+
+	ARSDK_RETURN_IF_FAILED(req_upload != NULL, -EINVAL);
+
+	req_upload->md5.ftp_get_req = NULL;
+
+	/* a missing md5 file only means there is no upload to resume */
+	buff = arsdk_ftp_req_get_get_buffer(req);
+	if (status == ARSDK_FTP_REQ_STATUS_OK && buff != NULL &&
+	    pomp_buffer_get_cdata(buff, &data, &len, NULL) == 0 &&
+	    len == 2 * ARSDK_MD5_LENGTH) {
+		memcpy(req_upload->md5.remote, data, len);
+		req_upload->md5.remote[len] = '\0';
+	}
+
+	update_check_done(req_upload);
+}
+
+static void update_digest_cb(int status,
+		const uint8_t *md5,
+		void *userdata)
+{
+	struct arsdk_updater_ftp_req_upload *req_upload = userdata;
+
+	req_upload->md5.digest_job = NULL;
+
+	if (status < 0) {
+		ARSDK_LOG_ERRNO("firmware digest", -status);
 		req_upload->status = ARSDK_UPDATER_REQ_STATUS_FAILED;
-		req_upload->error = res;
-		update_upload_complete(req_upload);
+		req_upload->error = status;
+		arsdk_updater_ftp_req_upload_cancel(req_upload);
 		return;
 	}
+
+	arsdk_md5_to_str(md5, req_upload->md5.str, sizeof(req_upload->md5.str));
+	update_check_done(req_upload);
 }
 
 static const char *get_file_name(enum arsdk_device_type dev_type)
@@ -450,12 +726,10 @@ int arsdk_updater_transport_ftp_create_req_upload(
 {
 	int res = 0;
 	struct arsdk_updater_ftp_req_upload *req_upload = NULL;
-	struct arsdk_ftp_req_put_cbs ftp_put_cbs;
+	struct arsdk_ftp_req_get_cbs ftp_get_cbs;
 	char remote_update_path[500] = "";
 	struct arsdk_updater_fw_info fw_info;
-	char md5_str[2 * ARSDK_MD5_LENGTH + 1];
-	size_t md5_str_len = 0;
-	struct pomp_buffer *md5_buff = NULL;
+	struct arsdk_updater_digest *digest = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_req != NULL, -EINVAL);
 	*ret_req = NULL;
@@ -474,6 +748,11 @@ int arsdk_updater_transport_ftp_create_req_upload(
 	if (!arsdk_updater_fw_dev_comp(&fw_info, dev_type))
 		return -EINVAL;
 
+	digest = arsdk_updater_itf_get_digest(
+			arsdk_updater_transport_get_itf(tsprt->parent));
+	if (digest == NULL)
+		return -ENOMEM;
+
 	/* Allocate structure */
 	req_upload = calloc(1, sizeof(*req_upload));
 	if (req_upload == NULL)
@@ -483,32 +762,8 @@ int arsdk_updater_transport_ftp_create_req_upload(
 	req_upload->tsprt = tsprt;
 	req_upload->dev_type = dev_type;
 	req_upload->cbs = *cbs;
+	req_upload->total_size = 2 * ARSDK_MD5_LENGTH + fw_info.size;
 
-	ftp_put_cbs.userdata = req_upload;
-	ftp_put_cbs.complete = &update_put_complete_cb;
-	ftp_put_cbs.progress = &update_put_progress_cb;
-
-	/* create md5 buff*/
-	arsdk_md5_to_str(fw_info.md5, md5_str, sizeof(md5_str));
-	md5_str_len = strlen(md5_str);
-	md5_buff = pomp_buffer_new_with_data(md5_str, md5_str_len);
-	if (md5_buff == NULL) {
-		res = -ENOMEM;
-		goto error;
-	}
-
-	/* upload md5 file */
-	res =  arsdk_ftp_itf_create_req_put_buff(tsprt->ftp, &ftp_put_cbs,
-			dev_type, ARSDK_FTP_SRV_TYPE_UPDATE, "/md5_check.md5",
-			md5_buff, 0, &req_upload->md5.ftp_put_req);
-	pomp_buffer_unref(md5_buff);
-	if (res < 0)
-		goto error;
-
-	req_upload->total_size += arsdk_ftp_req_put_get_total_size(
-			req_upload->md5.ftp_put_req);
-
-	/* upload updater file */
 	req_upload->fw.file_name = get_file_name(dev_type);
 	if (req_upload->fw.file_name == NULL) {
 		res = -ENOENT;
@@ -516,16 +771,33 @@ int arsdk_updater_transport_ftp_create_req_upload(
 	}
 	snprintf(remote_update_path, sizeof(remote_update_path),
 			"/%s.tmp", req_upload->fw.file_name);
-
 	req_upload->fw.remote_tmp_path = xstrdup(remote_update_path);
-	res =  arsdk_ftp_itf_create_req_put(tsprt->ftp, &ftp_put_cbs, dev_type,
-			ARSDK_FTP_SRV_TYPE_UPDATE, remote_update_path,
-			fw_filepath, 0, &req_upload->fw.ftp_put_req);
+	req_upload->fw.local_path = xstrdup(fw_filepath);
+	if (req_upload->fw.remote_tmp_path == NULL ||
+	    req_upload->fw.local_path == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
+	/* compute md5 off the loop, the upload starts once known */
+	res = arsdk_updater_digest_compute(digest, fw_filepath,
+			&update_digest_cb, req_upload,
+			&req_upload->md5.digest_job);
 	if (res < 0)
 		goto error;
 
-	req_upload->total_size += arsdk_ftp_req_put_get_total_size(
-			req_upload->fw.ftp_put_req);
+	/* meanwhile read the md5 of a previous upload to resume it */
+	ftp_get_cbs.userdata = req_upload;
+	ftp_get_cbs.progress = &update_get_md5_progress_cb;
+	ftp_get_cbs.complete = &update_get_md5_complete_cb;
+
+	res = arsdk_ftp_itf_create_req_get(tsprt->ftp, &ftp_get_cbs, dev_type,
+			ARSDK_FTP_SRV_TYPE_UPDATE, "/md5_check.md5", NULL, 0,
+			&req_upload->md5.ftp_get_req);
+	if (res < 0) {
+		ARSDK_LOG_ERRNO("md5 file get", -res);
+		res = 0;
+	}
 
 	ARSDK_LOGI("[%s] Start to upload firmware :\n"
 			"\t- product:\t0x%04x\n"
@@ -33,12 +33,15 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include "arsdk_updater_transport_mux.h"
+#include "arsdk_updater_digest.h"
 #include "arsdkctrl_default_log.h"
 #ifdef BUILD_LIBMUX
 #include "mux/arsdk_mux.h"
 
 #define ARSDK_UPDATER_TRANSPORT_TAG                     "mux"
 #define ARSDK_UPDATER_TRANSPORT_MUX_CHUNK_SIZE          (128*1024)
+/* count of chunks sent without being acknowledged */
+#define ARSDK_UPDATER_TRANSPORT_MUX_WINDOW              4
 
 struct arsdk_updater_transport_mux {
 	struct arsdk_updater_transport          *parent;
@@ -56,10 +59,15 @@ struct arsdk_updater_mux_req_upload {
 	struct arsdk_updater_req_upload         *parent;
 	struct arsdk_updater_req_upload_cbs     cbs;
 	int                                     fd;
+	struct arsdk_updater_fw_info            fw_info;
+	struct arsdk_updater_digest_job         *digest_job;
 	size_t                                  size;
 	size_t                                  n_written;
 	void                                    *chunk;
+	/* id of the next chunk to send */
 	size_t                                  chunk_id;
+	/* id of the next chunk to be acknowledged */
+	size_t                                  ack_id;
 	enum arsdk_updater_req_status           status;
 	int                                     error;
 };
@@ -230,6 +238,9 @@ static void arsdk_updater_req_upload_destroy(
 
 	arsdk_updater_destroy_req_upload(req_upload->parent);
 
+	if (req_upload->digest_job != NULL)
+		arsdk_updater_digest_cancel(req_upload->digest_job);
+
 	mux_channel_close(req_upload->tsprt->mux, MUX_UPDATE_CHANNEL_ID_UPDATE);
 	close(req_upload->fd);
 	free(req_upload->chunk);
@@ -327,7 +338,10 @@ static int updater_mux_send_next_chunk(struct arsdk_updater_mux_req_upload *req)
 	uint32_t n_bytes;
 
 	/* read file chunk */
-	ret = read(req->fd, req->chunk, ARSDK_UPDATER_TRANSPORT_MUX_CHUNK_SIZE);
+	do {
+		ret = read(req->fd, req->chunk,
+				ARSDK_UPDATER_TRANSPORT_MUX_CHUNK_SIZE);
+	} while (ret < 0 && errno == EINTR);
 	if (ret < 0) {
 		ARSDK_LOG_ERRNO("read update file failed", errno);
 		ret = -errno;
@@ -335,14 +349,14 @@ static int updater_mux_send_next_chunk(struct arsdk_updater_mux_req_upload *req)
 	}
 
 	if (ret == 0) {
-		ARSDK_LOGI("read update file eof");
-		return 0;
+		ARSDK_LOGE("read update file: unexpected eof");
+		return -EIO;
 	}
 
-	/* send chunk over mux */
+	/* send chunk over mux, the data is copied in the message */
 	n_bytes = ret;
 
-	ARSDK_LOGI("sending chunk: id=%zu size=%d", req->chunk_id, n_bytes);
+	ARSDK_LOGD("sending chunk: id=%zu size=%d", req->chunk_id, n_bytes);
 
 	ret = updater_mux_write_msg(req->tsprt->mux, MUX_UPDATE_MSG_ID_CHUNK,
 			MUX_UPDATE_MSG_FMT_ENC_CHUNK, req->chunk_id,
@@ -350,10 +364,27 @@ static int updater_mux_send_next_chunk(struct arsdk_updater_mux_req_upload *req)
 	if (ret < 0)
 		return ret;
 
+	req->chunk_id++;
 	req->n_written += n_bytes;
 	return 0;
 }
 
+static int updater_mux_fill_window(struct arsdk_updater_mux_req_upload *req)
+{
+	int res = 0;
+
+	/* keep chunks in flight while the previous ones are acknowledged */
+	while (req->n_written < req->size &&
+	       req->chunk_id - req->ack_id <
+			ARSDK_UPDATER_TRANSPORT_MUX_WINDOW) {
+		res = updater_mux_send_next_chunk(req);
+		if (res < 0)
+			return res;
+	}
+
+	return 0;
+}
+
 static void updater_mux_channel_recv(
 		struct arsdk_updater_mux_req_upload *req,
 		struct pomp_buffer *buf)
@@ -362,6 +393,7 @@ static void updater_mux_channel_recv(
 	float percent;
 	int ret, status;
 	unsigned int id;
+	size_t n_acked;
 
 	/* Create pomp message from buffer */
 	msg = pomp_msg_new_with_buffer(buf);
@@ -387,13 +419,17 @@ static void updater_mux_channel_recv(
 			goto error;
 		}
 
-		/* update accepted: start sensing file */
+		/* update accepted: start sending file */
 		req->n_written = 0;
 		req->chunk_id = 0;
+		req->ack_id = 0;
 		lseek(req->fd, 0, SEEK_SET);
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(req->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif /* POSIX_FADV_SEQUENTIAL */
 
-		/* send 1st chunk */
-		ret = updater_mux_send_next_chunk(req);
+		/* send 1st chunks */
+		ret = updater_mux_fill_window(req);
 		if (ret < 0)
 			goto error;
 		break;
@@ -406,24 +442,28 @@ static void updater_mux_channel_recv(
 			goto error;
 		}
 
-		ARSDK_LOGI("chunk ack: id=%d", id);
+		ARSDK_LOGD("chunk ack: id=%d", id);
 
-		if (id != req->chunk_id) {
+		/* chunks are acknowledged in order */
+		if (id != req->ack_id || req->ack_id >= req->chunk_id) {
 			ARSDK_LOGE("chunk id mismatch %d != %zu",
-					id, req->chunk_id);
+					id, req->ack_id);
 			goto error;
 		}
+		req->ack_id++;
 
-		/* notify progression */
-		percent = (double) (100.f * req->n_written) /
+		/* notify progression of the acknowledged data */
+		n_acked = req->ack_id * ARSDK_UPDATER_TRANSPORT_MUX_CHUNK_SIZE;
+		if (n_acked > req->size)
+			n_acked = req->size;
+		percent = (double) (100.f * n_acked) /
 				   (double)req->size;
 		ARSDK_LOGI("progression: %f%%", percent);
 		update_mux_notify_progression(req, percent);
 
-		/* send next chunk */
-		if (req->n_written < req->size) {
-			req->chunk_id++;
-			ret = updater_mux_send_next_chunk(req);
+		/* send next chunks */
+		if (n_acked < req->size) {
+			ret = updater_mux_fill_window(req);
 			if (ret < 0)
 				goto error;
 		} else {
@@ -490,6 +530,43 @@ static void update_mux_channel_cb(struct mux_ctx *ctx, uint32_t chanid,
 	}
 }
 
+static void update_mux_digest_cb(int status,
+		const uint8_t *md5,
+		void *userdata)
+{
+	struct arsdk_updater_mux_req_upload *req = userdata;
+	struct arsdk_updater_fw_info *fw_info = &req->fw_info;
+
+	req->digest_job = NULL;
+
+	if (status < 0) {
+		ARSDK_LOG_ERRNO("firmware digest", -status);
+		goto error;
+	}
+	memcpy(fw_info->md5, md5, sizeof(fw_info->md5));
+
+	/* send update request */
+	status = updater_mux_write_msg(req->tsprt->mux,
+			MUX_UPDATE_MSG_ID_UPDATE_REQ,
+			MUX_UPDATE_MSG_FMT_ENC_UPDATE_REQ, fw_info->name,
+			fw_info->md5, sizeof(fw_info->md5), fw_info->size);
+	if (status < 0)
+		goto error;
+
+	ARSDK_LOGI("[%s] Start to upload firmware :\n"
+			"\t- product:\t0x%04x\n"
+			"\t- version:\t%s\n"
+			"\t- size:\t\t%zu",
+			ARSDK_UPDATER_TRANSPORT_TAG,
+			fw_info->devtype,
+			fw_info->name,
+			fw_info->size);
+	return;
+
+error:
+	update_mux_notify_status(req, ARSDK_UPDATER_REQ_STATUS_FAILED);
+}
+
 int arsdk_updater_transport_mux_create_req_upload(
 		struct arsdk_updater_transport_mux *tsprt,
 		const char *fw_filepath,
@@ -500,6 +577,7 @@ int arsdk_updater_transport_mux_create_req_upload(
 	int res = 0;
 	struct arsdk_updater_mux_req_upload *req_upload = NULL;
 	struct arsdk_updater_fw_info fw_info;
+	struct arsdk_updater_digest *digest = NULL;
 
 	ARSDK_RETURN_ERR_IF_FAILED(ret_req != NULL, -EINVAL);
 	*ret_req = NULL;
@@ -518,6 +596,11 @@ int arsdk_updater_transport_mux_create_req_upload(
 	if (!arsdk_updater_fw_dev_comp(&fw_info, dev_type))
 		return -EINVAL;
 
+	digest = arsdk_updater_itf_get_digest(
+			arsdk_updater_transport_get_itf(tsprt->parent));
+	if (digest == NULL)
+		return -ENOMEM;
+
 	/* Allocate structure */
 	req_upload = calloc(1, sizeof(*req_upload));
 	if (req_upload == NULL)
@@ -527,6 +610,7 @@ int arsdk_updater_transport_mux_create_req_upload(
 	req_upload->tsprt = tsprt;
 	req_upload->dev_type = dev_type;
 	req_upload->cbs = *cbs;
+	req_upload->fw_info = fw_info;
 	req_upload->size = fw_info.size;
 	req_upload->fd = -1;
 
@@ -555,22 +639,13 @@ int arsdk_updater_transport_mux_create_req_upload(
 		goto error;
 	}
 
-	/* send update request */
-	res = updater_mux_write_msg(tsprt->mux, MUX_UPDATE_MSG_ID_UPDATE_REQ,
-			MUX_UPDATE_MSG_FMT_ENC_UPDATE_REQ, fw_info.name,
-			fw_info.md5, sizeof(fw_info.md5), fw_info.size);
+	/* compute md5 off the loop, the update request is sent once known */
+	res = arsdk_updater_digest_compute(digest, fw_filepath,
+			&update_mux_digest_cb, req_upload,
+			&req_upload->digest_job);
 	if (res < 0)
 		goto error;
 
-	ARSDK_LOGI("[%s] Start to upload firmware :\n"
-			"\t- product:\t0x%04x\n"
-			"\t- version:\t%s\n"
-			"\t- size:\t\t%zu",
-			ARSDK_UPDATER_TRANSPORT_TAG,
-			fw_info.devtype,
-			fw_info.name,
-			fw_info.size);
-
 	list_add_after(&tsprt->reqs, &req_upload->node);
 	*ret_req = req_upload;
 	return 0;
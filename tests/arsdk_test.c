@@ -147,6 +147,12 @@ int main(int argc, char *argv[])
 	CU_initialize_registry();
 	CU_register_suites(g_suites_protoc);
 	CU_register_suites(g_suites_enc_dec);
+	CU_register_suites(g_suites_mpsc_ring);
+	CU_register_suites(g_suites_ftp);
+	CU_register_suites(g_suites_cmd_dispatcher);
+	CU_register_suites(g_suites_updater);
+	CU_register_suites(g_suites_media);
+	CU_register_suites(g_suites_discovery_net);
 
 	if (argc >= 2 && (strcmp(argv[1], "-h") == 0
 			|| strcmp(argv[1], "--help") == 0)) {
@@ -52,5 +52,23 @@ extern CU_SuiteInfo g_suites_protoc[];
 /**
  */
 extern CU_SuiteInfo g_suites_enc_dec[];
+/**
+ */
+extern CU_SuiteInfo g_suites_mpsc_ring[];
+/**
+ */
+extern CU_SuiteInfo g_suites_ftp[];
+/**
+ */
+extern CU_SuiteInfo g_suites_cmd_dispatcher[];
+/**
+ */
+extern CU_SuiteInfo g_suites_updater[];
+/**
+ */
+extern CU_SuiteInfo g_suites_media[];
+/**
+ */
+extern CU_SuiteInfo g_suites_discovery_net[];
 
 #endif /* !_ARSDK_TEST_H_ */
@@ -0,0 +1,264 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdk_test.h"
+
+/** */
+struct test_dispatch {
+	const struct arsdk_cmd_desc  *desc;
+	const struct arsdk_cmd       *cmd;
+	uint32_t                     handled;
+	uint32_t                     fallback;
+};
+
+/** */
+static void test_handler(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd,
+		const struct arsdk_cmd_desc *desc,
+		void *userdata)
+{
+	struct test_dispatch *dispatch = userdata;
+
+	dispatch->desc = desc;
+	dispatch->cmd = cmd;
+	dispatch->handled++;
+}
+
+/** */
+static void test_fallback(struct arsdk_cmd_itf *itf,
+		const struct arsdk_cmd *cmd,
+		void *userdata)
+{
+	struct test_dispatch *dispatch = userdata;
+
+	dispatch->cmd = cmd;
+	dispatch->fallback++;
+}
+
+/** */
+static void test_cmd_init(struct arsdk_cmd *cmd, uint8_t prj_id,
+		uint8_t cls_id, uint16_t cmd_id)
+{
+	arsdk_cmd_init(cmd);
+	cmd->prj_id = prj_id;
+	cmd->cls_id = cls_id;
+	cmd->cmd_id = cmd_id;
+	cmd->id = ARSDK_CMD_FULL_ID(prj_id, cls_id, cmd_id);
+}
+
+/** */
+static void test_cmd_dispatcher_index(void)
+{
+	const struct arsdk_cmd_desc * const * const * const *project_table =
+			g_arsdk_cmd_desc_table;
+	const struct arsdk_cmd_desc * const * const *class_table = NULL;
+	const struct arsdk_cmd_desc * const *cmd_table = NULL;
+	const struct arsdk_cmd_desc *desc = NULL;
+	struct arsdk_cmd cmd;
+	uint32_t count = 0;
+
+	/* Every generated description is found through the index */
+	for (; *project_table != NULL; project_table++) {
+		class_table = *project_table;
+		for (; *class_table != NULL; class_table++) {
+			cmd_table = *class_table;
+			for (; *cmd_table != NULL; cmd_table++) {
+				desc = *cmd_table;
+				test_cmd_init(&cmd, desc->prj_id,
+						desc->cls_id, desc->cmd_id);
+				CU_ASSERT_PTR_EQUAL(arsdk_cmd_find_desc(&cmd),
+						desc);
+				count++;
+			}
+		}
+	}
+	CU_ASSERT(count > 0);
+	CU_ASSERT(count <= ARSDK_CMD_DESC_SLOT_COUNT);
+
+	/* Unknown command of a known class */
+	desc = &g_arsdk_cmd_desc_Common_Common_AllStates;
+	test_cmd_init(&cmd, desc->prj_id, desc->cls_id, UINT16_MAX);
+	CU_ASSERT_PTR_NULL(arsdk_cmd_find_desc(&cmd));
+
+	/* Unknown class of a known project */
+	test_cmd_init(&cmd, desc->prj_id, UINT8_MAX, desc->cmd_id);
+	CU_ASSERT_PTR_NULL(arsdk_cmd_find_desc(&cmd));
+}
+
+/** */
+static void test_cmd_dispatcher_register(void)
+{
+	const struct arsdk_cmd_desc *desc =
+			&g_arsdk_cmd_desc_Common_Common_AllStates;
+	struct arsdk_cmd_desc copy = *desc;
+	struct arsdk_cmd_dispatcher *dispatcher = NULL;
+	struct test_dispatch dispatch;
+	int res = 0;
+
+	memset(&dispatch, 0, sizeof(dispatch));
+
+	res = arsdk_cmd_dispatcher_new(NULL);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+
+	res = arsdk_cmd_dispatcher_new(&dispatcher);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	res = arsdk_cmd_dispatcher_register(dispatcher, desc, NULL, &dispatch);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+
+	res = arsdk_cmd_dispatcher_register(dispatcher, desc, &test_handler,
+			&dispatch);
+	CU_ASSERT_EQUAL(res, 0);
+
+	res = arsdk_cmd_dispatcher_register(dispatcher, desc, &test_handler,
+			&dispatch);
+	CU_ASSERT_EQUAL(res, -EBUSY);
+
+	/* Only generated descriptions can be registered */
+	res = arsdk_cmd_dispatcher_register(dispatcher, &copy, &test_handler,
+			&dispatch);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+	res = arsdk_cmd_dispatcher_unregister(dispatcher, &copy);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+
+	res = arsdk_cmd_dispatcher_unregister(dispatcher, desc);
+	CU_ASSERT_EQUAL(res, 0);
+
+	res = arsdk_cmd_dispatcher_unregister(dispatcher, desc);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+
+	/* Registered again once unregistered */
+	res = arsdk_cmd_dispatcher_register(dispatcher, desc, &test_handler,
+			&dispatch);
+	CU_ASSERT_EQUAL(res, 0);
+
+	res = arsdk_cmd_dispatcher_destroy(dispatcher);
+	CU_ASSERT_EQUAL(res, 0);
+}
+
+/** */
+static void test_cmd_dispatcher_dispatch(void)
+{
+	const struct arsdk_cmd_desc * const * const * const *project_table =
+			g_arsdk_cmd_desc_table;
+	const struct arsdk_cmd_desc * const * const *class_table = NULL;
+	const struct arsdk_cmd_desc * const *cmd_table = NULL;
+	const struct arsdk_cmd_desc *desc = NULL;
+	struct arsdk_cmd_dispatcher *dispatcher = NULL;
+	struct test_dispatch dispatch;
+	struct test_dispatch unhandled;
+	struct arsdk_cmd cmd;
+	uint32_t count = 0;
+	int res = 0;
+
+	memset(&dispatch, 0, sizeof(dispatch));
+	memset(&unhandled, 0, sizeof(unhandled));
+
+	res = arsdk_cmd_dispatcher_new(&dispatcher);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	/* Unhandled commands are ignored without fallback */
+	desc = &g_arsdk_cmd_desc_Common_Common_AllStates;
+	test_cmd_init(&cmd, desc->prj_id, desc->cls_id, desc->cmd_id);
+	res = arsdk_cmd_dispatcher_dispatch(dispatcher, NULL, &cmd);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+
+	res = arsdk_cmd_dispatcher_set_fallback(dispatcher, &test_fallback,
+			&unhandled);
+	CU_ASSERT_EQUAL(res, 0);
+
+	res = arsdk_cmd_dispatcher_dispatch(dispatcher, NULL, &cmd);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+	CU_ASSERT_EQUAL(unhandled.fallback, 1);
+	CU_ASSERT_PTR_EQUAL(unhandled.cmd, &cmd);
+
+	/* Each command has its own dispatch slot */
+	for (; *project_table != NULL; project_table++) {
+		class_table = *project_table;
+		for (; *class_table != NULL; class_table++) {
+			cmd_table = *class_table;
+			for (; *cmd_table != NULL; cmd_table++) {
+				res = arsdk_cmd_dispatcher_register(dispatcher,
+						*cmd_table, &test_handler,
+						&dispatch);
+				CU_ASSERT_EQUAL(res, 0);
+				count++;
+			}
+		}
+	}
+
+	project_table = g_arsdk_cmd_desc_table;
+	for (; *project_table != NULL; project_table++) {
+		class_table = *project_table;
+		for (; *class_table != NULL; class_table++) {
+			cmd_table = *class_table;
+			for (; *cmd_table != NULL; cmd_table++) {
+				desc = *cmd_table;
+				test_cmd_init(&cmd, desc->prj_id,
+						desc->cls_id, desc->cmd_id);
+				arsdk_cmd_dispatcher_recv_cmd(NULL, &cmd,
+						dispatcher);
+				CU_ASSERT_PTR_EQUAL(dispatch.desc, desc);
+				CU_ASSERT_PTR_EQUAL(dispatch.cmd, &cmd);
+			}
+		}
+	}
+	CU_ASSERT_EQUAL(dispatch.handled, count);
+	CU_ASSERT_EQUAL(unhandled.fallback, 1);
+
+	/* Unknown commands go to the fallback */
+	desc = &g_arsdk_cmd_desc_Common_Common_AllStates;
+	test_cmd_init(&cmd, desc->prj_id, desc->cls_id, UINT16_MAX);
+	res = arsdk_cmd_dispatcher_dispatch(dispatcher, NULL, &cmd);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+	CU_ASSERT_EQUAL(unhandled.fallback, 2);
+
+	/* Unregistered commands go to the fallback */
+	res = arsdk_cmd_dispatcher_unregister(dispatcher, desc);
+	CU_ASSERT_EQUAL(res, 0);
+	test_cmd_init(&cmd, desc->prj_id, desc->cls_id, desc->cmd_id);
+	res = arsdk_cmd_dispatcher_dispatch(dispatcher, NULL, &cmd);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+	CU_ASSERT_EQUAL(unhandled.fallback, 3);
+	CU_ASSERT_EQUAL(dispatch.handled, count);
+
+	res = arsdk_cmd_dispatcher_destroy(dispatcher);
+	CU_ASSERT_EQUAL(res, 0);
+}
+
+/** */
+static CU_TestInfo s_cmd_dispatcher_tests[] = {
+	{(char *)"index", &test_cmd_dispatcher_index},
+	{(char *)"register", &test_cmd_dispatcher_register},
+	{(char *)"dispatch", &test_cmd_dispatcher_dispatch},
+	CU_TEST_INFO_NULL,
+};
+
+/** */
+/*extern*/ CU_SuiteInfo g_suites_cmd_dispatcher[] = {
+	{(char *)"cmd_dispatcher", NULL, NULL, s_cmd_dispatcher_tests},
+	CU_SUITE_INFO_NULL,
+};
@@ -0,0 +1,526 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdk_test.h"
+#include "arsdkctrl_priv.h"
+#include "net/arsdkctrl_net_log.h"
+#include <net/arsdk_net.h>
+
+/* ulog requires 1 source file to declare the log tag */
+#ifdef BUILD_LIBULOG
+ULOG_DECLARE_TAG(arsdkctrl_net);
+#endif /* BUILD_LIBULOG */
+
+/** Timeout of the loop driven tests */
+#define TEST_LOOP_TIMEOUT_MS 5000
+
+/** Count of loopback addresses served by the tests: 127.0.0.1 to 127.0.0.8 */
+#define TEST_DISCO_SRV_COUNT 8
+
+/** Serial of the device answering the probes */
+#define TEST_DISCO_SERIAL "PI040416000000"
+
+/**
+ * Discovery server of a loopback address.
+ * The probes connect to real sockets; Linux routes the whole 127.0.0.0/8
+ * to the loopback interface, a subnet of it is probed without any network.
+ */
+struct test_disco_srv {
+	struct pomp_ctx                 *ctx;
+	uint32_t                        connections;
+	uint32_t                        disconnections;
+	int                             is_device;
+};
+
+/** */
+struct test_disco {
+	struct pomp_loop                *loop;
+	struct test_disco_srv           srvs[TEST_DISCO_SRV_COUNT];
+	uint32_t                        added;
+	uint32_t                        removed;
+	char                            added_addr[INET_ADDRSTRLEN];
+	char                            added_id[32];
+};
+
+static struct test_disco s_disco;
+
+/** */
+struct pomp_loop *arsdk_ctrl_get_loop(struct arsdk_ctrl *ctrl)
+{
+	return s_disco.loop;
+}
+
+/** */
+struct arsdkctrl_backend *arsdkctrl_backend_net_get_parent(
+		struct arsdkctrl_backend_net *self)
+{
+	return (struct arsdkctrl_backend *)&s_disco;
+}
+
+/** */
+int arsdkctrl_backend_socket_cb(struct arsdkctrl_backend *self,
+		int fd, enum arsdk_socket_kind kind)
+{
+	return 0;
+}
+
+/** */
+int arsdk_discovery_new(const char *name,
+		struct arsdkctrl_backend *backend,
+		struct arsdk_ctrl *ctrl,
+		struct arsdk_discovery **ret_obj)
+{
+	*ret_obj = (struct arsdk_discovery *)&s_disco;
+	return 0;
+}
+
+/** */
+int arsdk_discovery_destroy(struct arsdk_discovery *self)
+{
+	return 0;
+}
+
+/** */
+int arsdk_discovery_start(struct arsdk_discovery *self)
+{
+	return 0;
+}
+
+/** */
+int arsdk_discovery_stop(struct arsdk_discovery *self)
+{
+	return 0;
+}
+
+/** */
+int arsdk_discovery_add_device(struct arsdk_discovery *self,
+		const struct arsdk_discovery_device_info *info)
+{
+	s_disco.added++;
+	snprintf(s_disco.added_addr, sizeof(s_disco.added_addr), "%s",
+			info->addr);
+	snprintf(s_disco.added_id, sizeof(s_disco.added_id), "%s", info->id);
+	return 0;
+}
+
+/** */
+int arsdk_discovery_remove_device(struct arsdk_discovery *self,
+		const struct arsdk_discovery_device_info *info)
+{
+	s_disco.removed++;
+	return 0;
+}
+
+/** */
+static void test_srv_event_cb(struct pomp_ctx *ctx,
+		enum pomp_event event,
+		struct pomp_conn *conn,
+		const struct pomp_msg *msg,
+		void *userdata)
+{
+	struct test_disco_srv *srv = userdata;
+	struct pomp_buffer *buf = NULL;
+	char json[128];
+	int len = 0;
+
+	if (event == POMP_EVENT_DISCONNECTED) {
+		srv->disconnections++;
+		return;
+	}
+
+	if (event != POMP_EVENT_CONNECTED)
+		return;
+
+	srv->connections++;
+	if (!srv->is_device)
+		return;
+
+	/* answer as the device publisher does */
+	len = snprintf(json, sizeof(json),
+			"{\"%s\": \"%04x\", \"%s\": \"%s\", \"%s\": \"%s\", "
+			"\"%s\": %d}",
+			ARSDK_NET_DISCOVERY_KEY_TYPE, ARSDK_DEVICE_TYPE_ANAFI4K,
+			ARSDK_NET_DISCOVERY_KEY_ID, TEST_DISCO_SERIAL,
+			ARSDK_NET_DISCOVERY_KEY_NAME, "anafi",
+			ARSDK_NET_DISCOVERY_KEY_PORT, 44444);
+	buf = pomp_buffer_new_with_data(json, len + 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf);
+	CU_ASSERT_EQUAL(pomp_conn_send_raw_buf(conn, buf), 0);
+	pomp_buffer_unref(buf);
+}
+
+/** */
+static void test_srv_raw_cb(struct pomp_ctx *ctx,
+		struct pomp_conn *conn,
+		struct pomp_buffer *buf,
+		void *userdata)
+{
+}
+
+/**
+ * Serve the discovery port of 127.0.0.1 to 127.0.0.8.
+ */
+static void test_disco_setup(void)
+{
+	struct test_disco_srv *srv = NULL;
+	struct sockaddr_in addr;
+	uint32_t i = 0;
+	int res = 0;
+
+	memset(&s_disco, 0, sizeof(s_disco));
+	s_disco.loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(s_disco.loop);
+
+	for (i = 0; i < TEST_DISCO_SRV_COUNT; i++) {
+		srv = &s_disco.srvs[i];
+		srv->ctx = pomp_ctx_new_with_loop(&test_srv_event_cb, srv,
+				s_disco.loop);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(srv->ctx);
+		res = pomp_ctx_set_raw(srv->ctx, &test_srv_raw_cb);
+		CU_ASSERT_EQUAL_FATAL(res, 0);
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(ARSDK_NET_DISCOVERY_PORT);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK + i);
+		res = pomp_ctx_listen(srv->ctx, (struct sockaddr *)&addr,
+				sizeof(addr));
+		CU_ASSERT_EQUAL_FATAL(res, 0);
+	}
+}
+
+/** */
+static void test_disco_teardown(void)
+{
+	uint32_t i = 0;
+
+	for (i = 0; i < TEST_DISCO_SRV_COUNT; i++) {
+		if (s_disco.srvs[i].ctx == NULL)
+			continue;
+		pomp_ctx_stop(s_disco.srvs[i].ctx);
+		pomp_ctx_destroy(s_disco.srvs[i].ctx);
+	}
+
+	pomp_loop_destroy(s_disco.loop);
+}
+
+/**
+ * Server of the 127.0.0.<host> address.
+ */
+static struct test_disco_srv *test_disco_srv(uint32_t host)
+{
+	CU_ASSERT_FATAL(host >= 1 && host <= TEST_DISCO_SRV_COUNT);
+	return &s_disco.srvs[host - 1];
+}
+
+/** */
+static uint64_t test_disco_now_ms(void)
+{
+	struct timespec now;
+	uint64_t now_us = 0;
+
+	time_get_monotonic(&now);
+	time_timespec_to_us(&now, &now_us);
+	return now_us / 1000;
+}
+
+/**
+ * Check whether the hosts from 'first' to 'last' are all connected.
+ */
+static int test_disco_is_connected(uint32_t first, uint32_t last)
+{
+	uint32_t host = 0;
+
+	for (host = first; host <= last; host++) {
+		if (test_disco_srv(host)->connections == 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * Run the loop until the hosts from 'first' to 'last' are all connected, or
+ * for the given duration if 'first' is 0.
+ */
+static void test_disco_run(uint32_t first, uint32_t last,
+		uint32_t duration_ms)
+{
+	uint64_t end = test_disco_now_ms() + duration_ms;
+
+	do {
+		if (first != 0 && test_disco_is_connected(first, last))
+			return;
+		pomp_loop_wait_and_process(s_disco.loop, 10);
+	} while (test_disco_now_ms() < end);
+}
+
+/** */
+static int test_disco_new(const char * const *addrs,
+		uint32_t addrs_count,
+		const char *subnet,
+		uint32_t max_probes,
+		uint32_t probe_timeout_ms,
+		struct arsdk_discovery_net **ret_obj)
+{
+	static const enum arsdk_device_type types[] = {
+		ARSDK_DEVICE_TYPE_ANAFI4K,
+	};
+	struct arsdk_discovery_cfg cfg;
+	struct arsdk_discovery_net_probe_cfg probe_cfg;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.types = types;
+	cfg.count = sizeof(types) / sizeof(types[0]);
+
+	memset(&probe_cfg, 0, sizeof(probe_cfg));
+	probe_cfg.addrs = addrs;
+	probe_cfg.addrs_count = addrs_count;
+	probe_cfg.subnet = subnet;
+	probe_cfg.max_probes = max_probes;
+	probe_cfg.probe_timeout_ms = probe_timeout_ms;
+
+	/* the controller and the backend are only given back to the
+	 * stand-ins above */
+	return arsdk_discovery_net_new_with_probe_cfg(
+			(struct arsdk_ctrl *)&s_disco,
+			(struct arsdkctrl_backend_net *)&s_disco,
+			&cfg, &probe_cfg, ret_obj);
+}
+
+/** */
+static void test_discovery_net_subnet(void)
+{
+	static const char * const invalid[] = {
+		"127.0.0.0/15",
+		"127.0.0.0/33",
+		"127.0.0.0/-24",
+		"127.0.0.0/24x",
+		"127.0.0.0/",
+		"127.0.0.0",
+		"127.0.0/24",
+		"127.0.0.256/24",
+		"127.000.000.000.000/24",
+	};
+	static const char * const bad_addrs[] = {"127.0.0.1", "localhost"};
+	struct arsdk_discovery_net *disco = NULL;
+	uint32_t i = 0;
+	uint32_t host = 0;
+	int res = 0;
+
+	test_disco_setup();
+
+	/* Prefix length in [16;32] */
+	for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		res = test_disco_new(NULL, 0, invalid[i], 0, 0, &disco);
+		CU_ASSERT_EQUAL(res, -EINVAL);
+		CU_ASSERT_PTR_NULL(disco);
+	}
+
+	res = test_disco_new(NULL, 0, "10.0.0.0/16", 0, 0, &disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	arsdk_discovery_net_destroy(disco);
+
+	/* Something to probe, all addresses valid */
+	res = test_disco_new(NULL, 0, NULL, 0, 0, &disco);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	res = test_disco_new(bad_addrs, 2, NULL, 0, 0, &disco);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	CU_ASSERT_PTR_NULL(disco);
+
+	/* Network and broadcast addresses are not probed, the host bits of
+	 * the given address are ignored */
+	res = test_disco_new(NULL, 0, "127.0.0.6/30", 0, 0, &disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_discovery_net_start(disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	test_disco_run(5, 6, TEST_LOOP_TIMEOUT_MS);
+	test_disco_run(0, 0, 100);
+	for (host = 1; host <= TEST_DISCO_SRV_COUNT; host++) {
+		CU_ASSERT_EQUAL(test_disco_srv(host)->connections,
+				host == 5 || host == 6 ? 1 : 0);
+	}
+	arsdk_discovery_net_stop(disco);
+	arsdk_discovery_net_destroy(disco);
+
+	/* Point to point and single host subnets */
+	for (host = 1; host <= TEST_DISCO_SRV_COUNT; host++)
+		test_disco_srv(host)->connections = 0;
+
+	res = test_disco_new(NULL, 0, "127.0.0.2/31", 0, 0, &disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_discovery_net_start(disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	test_disco_run(2, 3, TEST_LOOP_TIMEOUT_MS);
+	arsdk_discovery_net_stop(disco);
+	arsdk_discovery_net_destroy(disco);
+
+	res = test_disco_new(NULL, 0, "127.0.0.8/32", 0, 0, &disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_discovery_net_start(disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	test_disco_run(8, 8, TEST_LOOP_TIMEOUT_MS);
+	test_disco_run(0, 0, 100);
+	arsdk_discovery_net_stop(disco);
+	arsdk_discovery_net_destroy(disco);
+
+	for (host = 1; host <= TEST_DISCO_SRV_COUNT; host++) {
+		CU_ASSERT_EQUAL(test_disco_srv(host)->connections,
+				host == 2 || host == 3 || host == 8 ? 1 : 0);
+	}
+
+	test_disco_teardown();
+}
+
+/** */
+static void test_discovery_net_dedup(void)
+{
+	static const char * const addrs[] = {
+		"127.0.0.6",
+		"127.0.0.1",
+		"127.0.0.6",
+		"127.0.0.5",
+	};
+	struct arsdk_discovery_net *disco = NULL;
+	uint32_t host = 0;
+	int res = 0;
+
+	test_disco_setup();
+
+	/* Each address probed once, explicit or in the subnet */
+	res = test_disco_new(addrs, sizeof(addrs) / sizeof(addrs[0]),
+			"127.0.0.4/30", 0, 0, &disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_discovery_net_start(disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	test_disco_run(5, 6, TEST_LOOP_TIMEOUT_MS);
+	test_disco_run(0, 0, 100);
+
+	for (host = 1; host <= TEST_DISCO_SRV_COUNT; host++) {
+		CU_ASSERT_EQUAL(test_disco_srv(host)->connections,
+				host == 1 || host == 5 || host == 6 ? 1 : 0);
+	}
+
+	arsdk_discovery_net_stop(disco);
+	arsdk_discovery_net_destroy(disco);
+	test_disco_teardown();
+}
+
+/** */
+static void test_discovery_net_timeout(void)
+{
+	struct arsdk_discovery_net *disco = NULL;
+	uint32_t host = 0;
+	int res = 0;
+
+	test_disco_setup();
+
+	/* The pending probes are kept until their timeout */
+	res = test_disco_new(NULL, 0, "127.0.0.0/29", 2, 60000, &disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_discovery_net_start(disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	test_disco_run(1, 2, TEST_LOOP_TIMEOUT_MS);
+	test_disco_run(0, 0, 500);
+
+	for (host = 1; host <= TEST_DISCO_SRV_COUNT; host++) {
+		CU_ASSERT_EQUAL(test_disco_srv(host)->connections,
+				host <= 2 ? 1 : 0);
+		CU_ASSERT_EQUAL(test_disco_srv(host)->disconnections, 0);
+	}
+
+	/* All stopped */
+	arsdk_discovery_net_stop(disco);
+	test_disco_run(0, 0, 100);
+	CU_ASSERT_EQUAL(test_disco_srv(1)->disconnections, 1);
+	CU_ASSERT_EQUAL(test_disco_srv(2)->disconnections, 1);
+
+	arsdk_discovery_net_destroy(disco);
+	test_disco_teardown();
+}
+
+/** */
+static void test_discovery_net_rotation(void)
+{
+	struct arsdk_discovery_net *disco = NULL;
+	struct test_disco_srv *device = NULL;
+	int res = 0;
+
+	test_disco_setup();
+	device = test_disco_srv(3);
+	device->is_device = 1;
+
+	/* Six hosts probed two at a time */
+	res = test_disco_new(NULL, 0, "127.0.0.0/29", 2, 1, &disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_discovery_net_start(disco);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	/* Each pending probe makes room for the next host once timed out */
+	test_disco_run(1, 6, TEST_LOOP_TIMEOUT_MS);
+	CU_ASSERT_TRUE(test_disco_is_connected(1, 6));
+	CU_ASSERT_EQUAL(test_disco_srv(7)->connections, 0);
+	CU_ASSERT(test_disco_srv(1)->disconnections >= 1);
+
+	/* The device found is not rotated out */
+	CU_ASSERT_EQUAL(s_disco.added, 1);
+	CU_ASSERT_STRING_EQUAL(s_disco.added_addr, "127.0.0.3");
+	CU_ASSERT_STRING_EQUAL(s_disco.added_id, TEST_DISCO_SERIAL);
+
+	/* The other hosts are probed again */
+	test_disco_srv(1)->connections = 0;
+	test_disco_run(1, 1, TEST_LOOP_TIMEOUT_MS);
+	CU_ASSERT_EQUAL(test_disco_srv(1)->connections, 1);
+	CU_ASSERT_EQUAL(device->connections, 1);
+	CU_ASSERT_EQUAL(device->disconnections, 0);
+	CU_ASSERT_EQUAL(s_disco.added, 1);
+
+	/* A device lost is removed */
+	pomp_ctx_stop(device->ctx);
+	device->is_device = 0;
+	test_disco_run(0, 0, 100);
+	CU_ASSERT_EQUAL(s_disco.removed, 1);
+	CU_ASSERT_EQUAL(s_disco.added, 1);
+
+	arsdk_discovery_net_stop(disco);
+	arsdk_discovery_net_destroy(disco);
+	test_disco_teardown();
+}
+
+/** */
+static CU_TestInfo s_discovery_net_tests[] = {
+	{(char *)"subnet", &test_discovery_net_subnet},
+	{(char *)"dedup", &test_discovery_net_dedup},
+	{(char *)"timeout", &test_discovery_net_timeout},
+	{(char *)"rotation", &test_discovery_net_rotation},
+	CU_TEST_INFO_NULL,
+};
+
+/** */
+/*extern*/ CU_SuiteInfo g_suites_discovery_net[] = {
+	{(char *)"discovery_net", NULL, NULL, s_discovery_net_tests},
+	CU_SUITE_INFO_NULL,
+};
@@ -0,0 +1,491 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdk_test.h"
+#include "arsdkctrl_priv.h"
+#include "ftp/arsdk_ftp_log.h"
+#include "ftp/arsdk_ftp_cmd.h"
+#include "ftp/arsdk_ftp_facts.h"
+#include "ftp/arsdk_ftp_journal.h"
+#include "ftp/arsdk_ftp_rate.h"
+#include "ftp/arsdk_ftp_sched.h"
+
+#include <unistd.h>
+
+/* ulog requires 1 source file to declare the log tag */
+#ifdef BUILD_LIBULOG
+ULOG_DECLARE_TAG(arsdk_ftp);
+#endif /* BUILD_LIBULOG */
+
+/** 2019-01-02 03:04:05 UTC */
+#define TEST_FACTS_MTIME 1546398245
+
+#define TEST_BLOCK_LEN ARSDK_FTP_JOURNAL_BLOCK_LEN
+#define TEST_JOURNAL_REMOTE_SIZE (5 * TEST_BLOCK_LEN)
+#define TEST_JOURNAL_MTIME 100
+
+/** */
+static void test_ftp_facts_parse(void)
+{
+	struct arsdk_ftp_facts facts;
+	int res = 0;
+
+	res = arsdk_ftp_facts_parse(
+			"type=file;size=1234;modify=20190102030405; a.mp4",
+			&facts);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(facts.type, ARSDK_FTP_FILE_TYPE_FILE);
+	CU_ASSERT_EQUAL(facts.listed, 1);
+	CU_ASSERT_EQUAL(facts.size, 1234);
+	CU_ASSERT_EQUAL(facts.mtime, TEST_FACTS_MTIME);
+	CU_ASSERT_STRING_EQUAL(facts.name, "a.mp4");
+
+	/* facts are case insensitive, fractions of seconds ignored */
+	res = arsdk_ftp_facts_parse("Modify=20190102030405.123;Type=dir; d e",
+			&facts);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(facts.type, ARSDK_FTP_FILE_TYPE_DIR);
+	CU_ASSERT_EQUAL(facts.size, 0);
+	CU_ASSERT_EQUAL(facts.mtime, TEST_FACTS_MTIME);
+	CU_ASSERT_STRING_EQUAL(facts.name, "d e");
+
+	res = arsdk_ftp_facts_parse("type=OS.unix=slink:/a;unique=1; l",
+			&facts);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(facts.type, ARSDK_FTP_FILE_TYPE_LINK);
+	CU_ASSERT_EQUAL(facts.listed, 1);
+
+	/* current and parent directories are not listed */
+	res = arsdk_ftp_facts_parse("type=cdir;modify=20190102030405; .",
+			&facts);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(facts.listed, 0);
+	res = arsdk_ftp_facts_parse("type=pdir; ..", &facts);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(facts.listed, 0);
+
+	/* no facts */
+	res = arsdk_ftp_facts_parse(" a", &facts);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_STRING_EQUAL(facts.name, "a");
+
+	/* malformed */
+	res = arsdk_ftp_facts_parse("size=12 a", &facts);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	res = arsdk_ftp_facts_parse("size;=12; a", &facts);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	res = arsdk_ftp_facts_parse("type=file;", &facts);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+	res = arsdk_ftp_facts_parse("", &facts);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+}
+
+/** */
+static void test_ftp_facts_time(void)
+{
+	CU_ASSERT_EQUAL(arsdk_ftp_facts_parse_time("19700101000000"), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_facts_parse_time("20190102030405"),
+			TEST_FACTS_MTIME);
+	/* leap day */
+	CU_ASSERT_EQUAL(arsdk_ftp_facts_parse_time("20200229235959"),
+			1583020799);
+
+	/* invalid */
+	CU_ASSERT_EQUAL(arsdk_ftp_facts_parse_time("2019"), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_facts_parse_time("modify"), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_facts_parse_time(""), 0);
+}
+
+/** */
+static void test_ftp_facts_mlst(void)
+{
+	static const char resp[] = "250-Listing /a.mp4\r\n"
+			" type=file;size=42;modify=20190102030405; /a.mp4\r\n"
+			"250 End\r\n";
+	static const char resp_no_facts[] = "250 Okay\r\n";
+	struct arsdk_ftp_cmd_result result;
+	int res = 0;
+
+	res = arsdk_ftp_cmd_dec(resp, strlen(resp), &result);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(result.code, 250);
+	CU_ASSERT_EQUAL(result.param.facts.size, 42);
+	CU_ASSERT_EQUAL(result.param.facts.mtime, TEST_FACTS_MTIME);
+
+	res = arsdk_ftp_cmd_dec(resp_no_facts, strlen(resp_no_facts),
+			&result);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(result.code, 250);
+	CU_ASSERT_EQUAL(result.param.facts.size, 0);
+	CU_ASSERT_EQUAL(result.param.facts.mtime, 0);
+}
+
+/** */
+static void test_journal_fill(uint8_t *data, size_t len, uint64_t off)
+{
+	size_t i = 0;
+
+	for (i = 0; i < len; i++)
+		data[i] = (uint8_t)((off + i) * 31 + (off + i) / 4099);
+}
+
+/** */
+static uint64_t test_journal_reopen(const char *path,
+		uint64_t remote_size,
+		time_t remote_mtime,
+		uint64_t local_size)
+{
+	struct arsdk_ftp_journal *journal = NULL;
+	uint64_t off = UINT64_MAX;
+	int res = 0;
+
+	res = arsdk_ftp_journal_open(path, remote_size, remote_mtime,
+			local_size, &journal, &off);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_journal_get_end(journal), off);
+	arsdk_ftp_journal_close(journal);
+	return off;
+}
+
+/** */
+static void test_journal_corrupt(const char *path, uint64_t off)
+{
+	FILE *f = NULL;
+	int c = 0;
+
+	f = fopen(path, "r+b");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(f);
+	fseeko(f, off, SEEK_SET);
+	c = fgetc(f);
+	fseeko(f, off, SEEK_SET);
+	fputc(c ^ 0xff, f);
+	fclose(f);
+}
+
+/** */
+static void test_ftp_journal(void)
+{
+	char dir[] = "/tmp/arsdk_test_XXXXXX";
+	char path[64];
+	struct arsdk_ftp_journal *journal = NULL;
+	uint8_t *data = NULL;
+	uint64_t local_size = 3 * TEST_BLOCK_LEN + TEST_BLOCK_LEN / 2;
+	uint64_t off = 0;
+	uint64_t remote_size = 0;
+	uint64_t checkpoint = 0;
+	size_t len = 0;
+	FILE *fout = NULL;
+	int res = 0;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+	snprintf(path, sizeof(path), "%s/file.mp4", dir);
+
+	/* no journal */
+	res = arsdk_ftp_journal_get_info(path, &remote_size, &checkpoint);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+
+	/* download with a checkpoint per block written */
+	res = arsdk_ftp_journal_open(path, TEST_JOURNAL_REMOTE_SIZE,
+			TEST_JOURNAL_MTIME, 0, &journal, &off);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_EQUAL(off, 0);
+
+	fout = fopen(path, "wb");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(fout);
+	data = malloc(100000);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+	while (off < local_size) {
+		len = local_size - off < 100000 ? local_size - off : 100000;
+		test_journal_fill(data, len, off);
+		CU_ASSERT_EQUAL(fwrite(data, 1, len, fout), len);
+		res = arsdk_ftp_journal_write(journal, fout, data, len);
+		CU_ASSERT_EQUAL(res, 0);
+		off += len;
+	}
+	fclose(fout);
+	free(data);
+	CU_ASSERT_EQUAL(arsdk_ftp_journal_get_end(journal), local_size);
+	arsdk_ftp_journal_close(journal);
+
+	res = arsdk_ftp_journal_get_info(path, &remote_size, &checkpoint);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(remote_size, TEST_JOURNAL_REMOTE_SIZE);
+	CU_ASSERT_EQUAL(checkpoint, 3 * TEST_BLOCK_LEN);
+
+	/* resumed after the last checkpoint, remote time unknown */
+	off = test_journal_reopen(path, TEST_JOURNAL_REMOTE_SIZE,
+			TEST_JOURNAL_MTIME, local_size);
+	CU_ASSERT_EQUAL(off, 3 * TEST_BLOCK_LEN);
+	off = test_journal_reopen(path, TEST_JOURNAL_REMOTE_SIZE, 0,
+			local_size);
+	CU_ASSERT_EQUAL(off, 3 * TEST_BLOCK_LEN);
+
+	/* checkpoints beyond a truncated local file are dropped */
+	off = test_journal_reopen(path, TEST_JOURNAL_REMOTE_SIZE,
+			TEST_JOURNAL_MTIME, 2 * TEST_BLOCK_LEN + 10);
+	CU_ASSERT_EQUAL(off, 2 * TEST_BLOCK_LEN);
+	res = arsdk_ftp_journal_get_info(path, &remote_size, &checkpoint);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(checkpoint, 2 * TEST_BLOCK_LEN);
+
+	/* data written without checksum is checkpointed from the file */
+	res = arsdk_ftp_journal_open(path, TEST_JOURNAL_REMOTE_SIZE,
+			TEST_JOURNAL_MTIME, local_size, &journal, &off);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_EQUAL(off, 2 * TEST_BLOCK_LEN);
+	res = arsdk_ftp_journal_sync(journal, local_size);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_journal_get_end(journal),
+			3 * TEST_BLOCK_LEN);
+	arsdk_ftp_journal_close(journal);
+
+	/* a corrupted block and the following ones are downloaded again */
+	test_journal_corrupt(path, 2 * TEST_BLOCK_LEN + 12345);
+	off = test_journal_reopen(path, TEST_JOURNAL_REMOTE_SIZE,
+			TEST_JOURNAL_MTIME, local_size);
+	CU_ASSERT_EQUAL(off, 2 * TEST_BLOCK_LEN);
+
+	/* the remote file changed */
+	off = test_journal_reopen(path, TEST_JOURNAL_REMOTE_SIZE,
+			TEST_JOURNAL_MTIME + 1, local_size);
+	CU_ASSERT_EQUAL(off, 0);
+	off = test_journal_reopen(path, TEST_JOURNAL_REMOTE_SIZE + 1,
+			TEST_JOURNAL_MTIME, local_size);
+	CU_ASSERT_EQUAL(off, 0);
+
+	/* journal of a completed download */
+	res = arsdk_ftp_journal_open(path, TEST_JOURNAL_REMOTE_SIZE + 1,
+			TEST_JOURNAL_MTIME, local_size, &journal, &off);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_ftp_journal_remove(journal);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_ftp_journal_get_info(path, &remote_size, &checkpoint);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+
+	unlink(path);
+	rmdir(dir);
+}
+
+/** */
+static void test_ftp_rate(void)
+{
+	struct arsdk_ftp_rate rate;
+	uint64_t now_us = 1000000;
+	uint64_t start_us = 0;
+	uint64_t total = 0;
+	uint32_t delay = 0;
+	uint32_t i = 0;
+	double measured = 0;
+
+	memset(&rate, 0, sizeof(rate));
+
+	/* no limit */
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 1000000, now_us), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(NULL, 1000000, now_us), 0);
+
+	/* 1 MB/s: burst of 100 ms */
+	arsdk_ftp_rate_set(&rate, 1000000);
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 100000, now_us), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 1000, now_us), 1);
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 49000, now_us), 50);
+
+	/* refilled after the delay */
+	now_us += 50000;
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 0, now_us), 0);
+	now_us += 10000;
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 10000, now_us), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 1, now_us), 1);
+
+	/* refill capped to the burst after an idle period */
+	now_us += 10000000;
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 100000, now_us), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 1000, now_us), 1);
+
+	/* minimal burst at low rates, lowering the rate caps the tokens */
+	now_us += 10000000;
+	arsdk_ftp_rate_set(&rate, 10000);
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 16384, now_us), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_rate_consume(&rate, 100, now_us), 10);
+
+	/* transfer paused for the delays given: average rate respected */
+	memset(&rate, 0, sizeof(rate));
+	arsdk_ftp_rate_set(&rate, 500000);
+	start_us = now_us;
+	for (i = 0; i < 1000; i++) {
+		delay = arsdk_ftp_rate_consume(&rate, 16384, now_us);
+		total += 16384;
+		now_us += (delay != 0) ? delay * 1000 : 100;
+	}
+	measured = total / ((now_us - start_us) / 1000000.0);
+	CU_ASSERT(measured > 500000 * 0.95 && measured < 500000 * 1.05);
+}
+
+/** */
+struct test_sched_entry {
+	struct arsdk_ftp_sched_entry    entry;
+	int                             id;
+};
+
+/** ids of the entries started by the scheduler, in order */
+static int s_sched_started[8];
+static int s_sched_started_count;
+
+/** */
+static void test_sched_start_cb(struct arsdk_ftp_sched_entry *entry)
+{
+	struct test_sched_entry *e = entry->userdata;
+
+	CU_ASSERT_FATAL(s_sched_started_count < 8);
+	CU_ASSERT_TRUE(entry->active);
+	s_sched_started[s_sched_started_count++] = e->id;
+}
+
+/** */
+static int test_sched_submit(struct arsdk_ftp_sched_client *client,
+		struct test_sched_entry *e,
+		int id,
+		enum arsdk_ftp_req_priority prio)
+{
+	memset(e, 0, sizeof(*e));
+	e->id = id;
+	e->entry.prio = prio;
+	e->entry.start = &test_sched_start_cb;
+	e->entry.userdata = e;
+	return arsdk_ftp_sched_submit(client, &e->entry);
+}
+
+/** */
+static void test_ftp_sched(void)
+{
+	struct pomp_loop *loop = NULL;
+	struct arsdk_ftp_sched *sched = NULL;
+	struct arsdk_ftp_sched_client *a = NULL;
+	struct arsdk_ftp_sched_client *b = NULL;
+	struct test_sched_entry a1, a2, a3, a4, b1, b2;
+	int res = 0;
+
+	loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+	res = arsdk_ftp_sched_new(loop, &sched);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_ftp_sched_add_client(sched, &a);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_ftp_sched_add_client(sched, &b);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	/* 2 active transfers, 1 per client */
+	res = arsdk_ftp_sched_set_limits(sched, 2, 1);
+	CU_ASSERT_EQUAL(res, 0);
+	s_sched_started_count = 0;
+
+	/* started at once if a slot is free, queued otherwise */
+	CU_ASSERT_EQUAL(test_sched_submit(a, &a1, 1,
+			ARSDK_FTP_REQ_PRIORITY_NORMAL), 1);
+	CU_ASSERT_EQUAL(test_sched_submit(a, &a2, 2,
+			ARSDK_FTP_REQ_PRIORITY_NORMAL), 0);
+	CU_ASSERT_EQUAL(test_sched_submit(b, &b1, 11,
+			ARSDK_FTP_REQ_PRIORITY_NORMAL), 1);
+	CU_ASSERT_EQUAL(test_sched_submit(b, &b2, 12,
+			ARSDK_FTP_REQ_PRIORITY_LOW), 0);
+	CU_ASSERT_EQUAL(test_sched_submit(a, &a3, 3,
+			ARSDK_FTP_REQ_PRIORITY_HIGH), 0);
+	CU_ASSERT_EQUAL(test_sched_submit(a, &a4, 4,
+			ARSDK_FTP_REQ_PRIORITY_LOW), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_sched_submit(a, &a4.entry), -EBUSY);
+
+	/* clients with active transfers can not be removed */
+	CU_ASSERT_EQUAL(arsdk_ftp_sched_remove_client(a), -EBUSY);
+
+	/* the next transfer starts out of the release, by priority */
+	arsdk_ftp_sched_release(&a1.entry);
+	CU_ASSERT_EQUAL(s_sched_started_count, 0);
+	pomp_loop_idle_flush(loop);
+	CU_ASSERT_EQUAL_FATAL(s_sched_started_count, 1);
+	CU_ASSERT_EQUAL(s_sched_started[0], 3);
+
+	/* client limit: the slot freed by b goes to b */
+	arsdk_ftp_sched_release(&b1.entry);
+	pomp_loop_idle_flush(loop);
+	CU_ASSERT_EQUAL_FATAL(s_sched_started_count, 2);
+	CU_ASSERT_EQUAL(s_sched_started[1], 12);
+
+	/* queued entries reordered and removed */
+	arsdk_ftp_sched_set_prio(&a4.entry, ARSDK_FTP_REQ_PRIORITY_HIGH);
+	arsdk_ftp_sched_release(&a2.entry);
+	CU_ASSERT_FALSE(a2.entry.queued);
+
+	/* higher limits start the queued transfers: round-robin, a served
+	 * before b was */
+	CU_ASSERT_EQUAL(test_sched_submit(b, &b1, 13,
+			ARSDK_FTP_REQ_PRIORITY_NORMAL), 0);
+	arsdk_ftp_sched_set_limits(sched, 0, 0);
+	pomp_loop_idle_flush(loop);
+	CU_ASSERT_EQUAL_FATAL(s_sched_started_count, 4);
+	CU_ASSERT_EQUAL(s_sched_started[2], 4);
+	CU_ASSERT_EQUAL(s_sched_started[3], 13);
+
+	/* nothing left to start */
+	arsdk_ftp_sched_release(&a3.entry);
+	arsdk_ftp_sched_release(&a4.entry);
+	arsdk_ftp_sched_release(&b1.entry);
+	arsdk_ftp_sched_release(&b2.entry);
+	pomp_loop_idle_flush(loop);
+	CU_ASSERT_EQUAL(s_sched_started_count, 4);
+
+	CU_ASSERT_EQUAL(arsdk_ftp_sched_destroy(sched), -EBUSY);
+	CU_ASSERT_EQUAL(arsdk_ftp_sched_remove_client(a), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_sched_remove_client(b), 0);
+	CU_ASSERT_EQUAL(arsdk_ftp_sched_destroy(sched), 0);
+	CU_ASSERT_EQUAL(pomp_loop_destroy(loop), 0);
+}
+
+/** */
+static void test_ftp_facts(void)
+{
+	test_ftp_facts_parse();
+	test_ftp_facts_time();
+	test_ftp_facts_mlst();
+}
+
+/* Disable some gcc warnings for test suite descriptions */
+#ifdef __GNUC__
+#  pragma GCC diagnostic ignored "-Wcast-qual"
+#endif /* __GNUC__ */
+
+/** */
+static CU_TestInfo s_ftp_tests[] = {
+	{(char *)"facts", &test_ftp_facts},
+	{(char *)"journal", &test_ftp_journal},
+	{(char *)"rate", &test_ftp_rate},
+	{(char *)"sched", &test_ftp_sched},
+	CU_TEST_INFO_NULL,
+};
+
+/** */
+/*extern*/ CU_SuiteInfo g_suites_ftp[] = {
+	{(char *)"ftp", NULL, NULL, s_ftp_tests},
+	CU_SUITE_INFO_NULL,
+};
@@ -0,0 +1,1429 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdk_test.h"
+#include "arsdkctrl_priv.h"
+#include "arsdk_ftp_itf_priv.h"
+#include "arsdk_media_itf_priv.h"
+#include "arsdk_media_arena_priv.h"
+#include "arsdk_media_index_priv.h"
+#include "arsdk_media_thumb_priv.h"
+
+#include <unistd.h>
+
+/** Count of allocations and strings of the arena tests */
+#define TEST_ARENA_COUNT 2000
+
+/** Maximum count of downloads of the thumbnail tests */
+#define TEST_THUMB_REQ_MAX 16
+
+/** Maximum count of medias removed of the index tests */
+#define TEST_INDEX_REMOVED_MAX 4
+
+/** Count of medias of the delete batch tests */
+#define TEST_BATCH_MEDIA_COUNT 4
+
+/** Maximum count of deletions of the delete batch tests */
+#define TEST_BATCH_DELETE_MAX 16
+
+/**
+ * Ftp get request stand-in, completed by the tests.
+ * The media interface and its thumbnail service are tested against the
+ * stand-ins of the ftp interface below; libarsdkctrl itself is not linked.
+ */
+struct arsdk_ftp_req_get {
+	struct arsdk_ftp_req_get_cbs    cbs;
+	char                            uri[64];
+	enum arsdk_ftp_req_priority     prio;
+	struct pomp_buffer              *buf;
+	int                             running;
+};
+
+/** Ftp file stand-in */
+struct arsdk_ftp_file {
+	char                            name[128];
+	size_t                          size;
+	time_t                          mtime;
+	int                             refcount;
+};
+
+/** Ftp file list stand-in, filled by the tests */
+struct arsdk_ftp_file_list {
+	struct arsdk_ftp_file           *files[TEST_BATCH_MEDIA_COUNT];
+	size_t                          count;
+};
+
+/** Ftp list request stand-in, completed by the tests */
+struct arsdk_ftp_req_list {
+	struct arsdk_ftp_req_list_cbs   cbs;
+	int                             running;
+};
+
+/** Ftp delete request stand-in, completed by the tests */
+struct arsdk_ftp_req_delete {
+	struct arsdk_ftp_req_delete_cbs cbs;
+	char                            uri[128];
+	int                             running;
+};
+
+/** */
+struct test_thumb {
+	struct arsdk_ftp_req_get        reqs[TEST_THUMB_REQ_MAX];
+	uint32_t                        req_count;
+	int                             create_error;
+};
+
+/** */
+struct test_thumb_result {
+	uint32_t                        count;
+	enum arsdk_media_req_status     status;
+	int                             error;
+	char                            data[64];
+};
+
+/** */
+struct test_index_removed {
+	uint32_t                        count;
+	char                            names[TEST_INDEX_REMOVED_MAX][32];
+};
+
+/** */
+struct test_batch {
+	struct arsdk_ftp_req_list       list_req;
+	struct arsdk_ftp_file_list      files;
+	struct arsdk_ftp_req_delete     dels[TEST_BATCH_DELETE_MAX];
+	uint32_t                        del_count;
+	struct arsdk_media_list         *medias;
+};
+
+/** */
+struct test_batch_result {
+	uint32_t                        progress_count;
+	char                            names[TEST_BATCH_MEDIA_COUNT][64];
+	enum arsdk_media_req_status     statuses[TEST_BATCH_MEDIA_COUNT];
+	int                             errors[TEST_BATCH_MEDIA_COUNT];
+	size_t                          done;
+	size_t                          total;
+	uint32_t                        count;
+	enum arsdk_media_req_status     status;
+	int                             error;
+};
+
+static struct test_thumb s_thumb;
+static struct test_batch s_batch;
+
+/** */
+int arsdk_ftp_itf_create_req_get(struct arsdk_ftp_itf *itf,
+		const struct arsdk_ftp_req_get_cbs *cbs,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_srv_type srv_type,
+		const char *remote_path,
+		const char *local_path,
+		uint8_t is_resume,
+		struct arsdk_ftp_req_get **ret_req)
+{
+	struct arsdk_ftp_req_get *req = NULL;
+
+	/* thumbnails are downloaded in memory */
+	CU_ASSERT_PTR_NULL(local_path);
+	if (s_thumb.create_error < 0)
+		return s_thumb.create_error;
+
+	CU_ASSERT_FATAL(s_thumb.req_count < TEST_THUMB_REQ_MAX);
+	req = &s_thumb.reqs[s_thumb.req_count++];
+	req->cbs = *cbs;
+	snprintf(req->uri, sizeof(req->uri), "%s", remote_path);
+	req->running = 1;
+	*ret_req = req;
+	return 0;
+}
+
+/** */
+int arsdk_ftp_req_get_set_priority(struct arsdk_ftp_req_get *req,
+		enum arsdk_ftp_req_priority prio)
+{
+	req->prio = prio;
+	return 0;
+}
+
+/** */
+struct pomp_buffer *arsdk_ftp_req_get_get_buffer(
+		const struct arsdk_ftp_req_get *req)
+{
+	return req->buf;
+}
+
+/** */
+static void test_thumb_req_complete(struct arsdk_ftp_req_get *req,
+		enum arsdk_ftp_req_status status,
+		const char *data)
+{
+	CU_ASSERT_FATAL(req->running);
+	req->running = 0;
+	if (data != NULL)
+		req->buf = pomp_buffer_new_with_data(data, strlen(data));
+
+	(*req->cbs.complete)(NULL, req, status, 0, req->cbs.userdata);
+
+	if (req->buf != NULL)
+		pomp_buffer_unref(req->buf);
+	req->buf = NULL;
+}
+
+/** */
+int arsdk_ftp_req_get_cancel(struct arsdk_ftp_req_get *req)
+{
+	/* canceled requests complete synchronously */
+	test_thumb_req_complete(req, ARSDK_FTP_REQ_STATUS_CANCELED, NULL);
+	return 0;
+}
+
+/** */
+const char *arsdk_device_type_to_fld(enum arsdk_device_type dev_type)
+{
+	return "dev";
+}
+
+/** */
+int arsdk_ftp_file_new(struct arsdk_ftp_file **ret_file)
+{
+	struct arsdk_ftp_file *file = calloc(1, sizeof(*file));
+
+	if (file == NULL)
+		return -ENOMEM;
+
+	file->refcount = 1;
+	*ret_file = file;
+	return 0;
+}
+
+/** */
+int arsdk_ftp_file_set_name(struct arsdk_ftp_file *file, const char *name)
+{
+	snprintf(file->name, sizeof(file->name), "%s", name);
+	return 0;
+}
+
+/** */
+void arsdk_ftp_file_ref(struct arsdk_ftp_file *file)
+{
+	file->refcount++;
+}
+
+/** */
+void arsdk_ftp_file_unref(struct arsdk_ftp_file *file)
+{
+	if (--file->refcount == 0)
+		free(file);
+}
+
+/** */
+const char *arsdk_ftp_file_get_name(const struct arsdk_ftp_file *file)
+{
+	return file->name;
+}
+
+/** */
+size_t arsdk_ftp_file_get_size(const struct arsdk_ftp_file *file)
+{
+	return file->size;
+}
+
+/** */
+time_t arsdk_ftp_file_get_mtime(const struct arsdk_ftp_file *file)
+{
+	return file->mtime;
+}
+
+/** */
+size_t arsdk_ftp_file_list_get_count(struct arsdk_ftp_file_list *list)
+{
+	return list->count;
+}
+
+/** */
+struct arsdk_ftp_file *arsdk_ftp_file_list_next_file(
+		struct arsdk_ftp_file_list *list,
+		struct arsdk_ftp_file *prev)
+{
+	size_t i = 0;
+
+	if (prev == NULL)
+		return list->count > 0 ? list->files[0] : NULL;
+
+	for (i = 0; i + 1 < list->count; i++) {
+		if (list->files[i] == prev)
+			return list->files[i + 1];
+	}
+
+	return NULL;
+}
+
+/** */
+int arsdk_ftp_itf_create_req_list(struct arsdk_ftp_itf *itf,
+		const struct arsdk_ftp_req_list_cbs *cbs,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_srv_type srv_type,
+		const char *remote_path,
+		struct arsdk_ftp_req_list **ret_req)
+{
+	CU_ASSERT_FATAL(!s_batch.list_req.running);
+	s_batch.list_req.cbs = *cbs;
+	s_batch.list_req.running = 1;
+	*ret_req = &s_batch.list_req;
+	return 0;
+}
+
+/** */
+struct arsdk_ftp_file_list *arsdk_ftp_req_list_get_result(
+		struct arsdk_ftp_req_list *req)
+{
+	return &s_batch.files;
+}
+
+/** */
+int arsdk_ftp_req_list_cancel(struct arsdk_ftp_req_list *req)
+{
+	req->running = 0;
+	(*req->cbs.complete)(NULL, req, ARSDK_FTP_REQ_STATUS_CANCELED, 0,
+			req->cbs.userdata);
+	return 0;
+}
+
+/** */
+int arsdk_ftp_itf_create_req_stat(struct arsdk_ftp_itf *itf,
+		const struct arsdk_ftp_req_stat_cbs *cbs,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_srv_type srv_type,
+		const char *remote_path,
+		struct arsdk_ftp_req_stat **ret_req)
+{
+	/* only used by the media index, not set by the tests */
+	return -ENOSYS;
+}
+
+/** */
+int arsdk_ftp_req_stat_cancel(struct arsdk_ftp_req_stat *req)
+{
+	return -ENOSYS;
+}
+
+/** */
+int arsdk_ftp_itf_create_req_delete(struct arsdk_ftp_itf *itf,
+		const struct arsdk_ftp_req_delete_cbs *cbs,
+		enum arsdk_device_type dev_type,
+		enum arsdk_ftp_srv_type srv_type,
+		const char *remote_path,
+		struct arsdk_ftp_req_delete **ret_req)
+{
+	struct arsdk_ftp_req_delete *req = NULL;
+
+	CU_ASSERT_FATAL(s_batch.del_count < TEST_BATCH_DELETE_MAX);
+	req = &s_batch.dels[s_batch.del_count++];
+	req->cbs = *cbs;
+	snprintf(req->uri, sizeof(req->uri), "%s", remote_path);
+	req->running = 1;
+	*ret_req = req;
+	return 0;
+}
+
+/** */
+static void test_batch_del_complete(struct arsdk_ftp_req_delete *req,
+		enum arsdk_ftp_req_status status,
+		int error)
+{
+	CU_ASSERT_FATAL(req->running);
+	req->running = 0;
+	(*req->cbs.complete)(NULL, req, status, error, req->cbs.userdata);
+}
+
+/** */
+int arsdk_ftp_req_delete_cancel(struct arsdk_ftp_req_delete *req)
+{
+	/* canceled requests complete synchronously */
+	test_batch_del_complete(req, ARSDK_FTP_REQ_STATUS_CANCELED, 0);
+	return 0;
+}
+
+/** */
+static void test_thumb_cb(struct arsdk_media_thumb_waiter *waiter,
+		enum arsdk_media_req_status status,
+		int error,
+		struct pomp_buffer *buf,
+		void *userdata)
+{
+	struct test_thumb_result *result = userdata;
+	const void *data = NULL;
+	size_t len = 0;
+
+	result->count++;
+	result->status = status;
+	result->error = error;
+	result->data[0] = '\0';
+	if (buf != NULL) {
+		pomp_buffer_get_cdata(buf, &data, &len, NULL);
+		CU_ASSERT_FATAL(len < sizeof(result->data));
+		memcpy(result->data, data, len);
+		result->data[len] = '\0';
+	}
+}
+
+/** */
+static void test_media_thumb_fetch(void)
+{
+	struct pomp_loop *loop = NULL;
+	struct arsdk_media_thumbs *thumbs = NULL;
+	struct arsdk_media_thumb_waiter *waiter1 = NULL;
+	struct arsdk_media_thumb_waiter *waiter2 = NULL;
+	struct arsdk_media_thumb_waiter *waiter3 = NULL;
+	struct test_thumb_result res1;
+	struct test_thumb_result res2;
+	struct test_thumb_result res3;
+	/* the service only gives the interface back to the stand-ins */
+	struct arsdk_ftp_itf *ftp = (struct arsdk_ftp_itf *)&s_thumb;
+	int res = 0;
+
+	memset(&s_thumb, 0, sizeof(s_thumb));
+	memset(&res1, 0, sizeof(res1));
+	memset(&res2, 0, sizeof(res2));
+	memset(&res3, 0, sizeof(res3));
+
+	loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+	res = arsdk_media_thumbs_new(ftp, loop, "dev", &thumbs);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	/* Waiters of a same thumbnail share the download */
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &res1, &waiter1);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_HIGH,
+			&test_thumb_cb, &res2, &waiter2);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL_FATAL(s_thumb.req_count, 1);
+	CU_ASSERT_STRING_EQUAL(s_thumb.reqs[0].uri, "/a.jpg");
+	CU_ASSERT_EQUAL(s_thumb.reqs[0].prio, ARSDK_FTP_REQ_PRIORITY_HIGH);
+
+	test_thumb_req_complete(&s_thumb.reqs[0], ARSDK_FTP_REQ_STATUS_OK,
+			"thumb a");
+
+	/* Always notified from the loop */
+	CU_ASSERT_EQUAL(res1.count, 0);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(res1.count, 1);
+	CU_ASSERT_EQUAL(res1.status, ARSDK_MEDIA_REQ_STATUS_OK);
+	CU_ASSERT_STRING_EQUAL(res1.data, "thumb a");
+	CU_ASSERT_EQUAL(res2.count, 1);
+	CU_ASSERT_STRING_EQUAL(res2.data, "thumb a");
+
+	/* Cached in memory */
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &res3, &waiter3);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(s_thumb.req_count, 1);
+	CU_ASSERT_EQUAL(res3.count, 0);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(res3.count, 1);
+	CU_ASSERT_STRING_EQUAL(res3.data, "thumb a");
+
+	/* A download failing to start is notified from the loop as well */
+	s_thumb.create_error = -EIO;
+	res = arsdk_media_thumbs_fetch(thumbs, "/b.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &res1, &waiter1);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(res1.count, 1);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(res1.count, 2);
+	CU_ASSERT_EQUAL(res1.status, ARSDK_MEDIA_REQ_STATUS_FAILED);
+	CU_ASSERT_EQUAL(res1.error, -EIO);
+	s_thumb.create_error = 0;
+
+	/* A failed download is not cached */
+	res = arsdk_media_thumbs_fetch(thumbs, "/b.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &res1, &waiter1);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL_FATAL(s_thumb.req_count, 2);
+	test_thumb_req_complete(&s_thumb.reqs[1], ARSDK_FTP_REQ_STATUS_FAILED,
+			NULL);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(res1.count, 3);
+	CU_ASSERT_EQUAL(res1.status, ARSDK_MEDIA_REQ_STATUS_FAILED);
+
+	arsdk_media_thumbs_stop(thumbs);
+	arsdk_media_thumbs_destroy(thumbs);
+	pomp_loop_destroy(loop);
+}
+
+/** */
+static void test_media_thumb_queue(void)
+{
+	struct pomp_loop *loop = NULL;
+	struct arsdk_media_thumbs *thumbs = NULL;
+	struct arsdk_media_thumb_waiter *waiters[4];
+	struct test_thumb_result results[4];
+	struct arsdk_media_thumb_cfg cfg;
+	struct arsdk_ftp_itf *ftp = (struct arsdk_ftp_itf *)&s_thumb;
+	int res = 0;
+
+	memset(&s_thumb, 0, sizeof(s_thumb));
+	memset(results, 0, sizeof(results));
+
+	loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+	res = arsdk_media_thumbs_new(ftp, loop, "dev", &thumbs);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.mem_max_size = 1024;
+	cfg.max_downloads = 1;
+	res = arsdk_media_thumbs_set_cfg(thumbs, &cfg);
+	CU_ASSERT_EQUAL(res, 0);
+
+	res = arsdk_media_thumbs_fetch(thumbs, "/0.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &results[0], &waiters[0]);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_media_thumbs_fetch(thumbs, "/1.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &results[1], &waiters[1]);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_media_thumbs_fetch(thumbs, "/2.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_HIGH,
+			&test_thumb_cb, &results[2], &waiters[2]);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_media_thumbs_fetch(thumbs, "/3.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			NULL, NULL, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+
+	/* One download at a time */
+	CU_ASSERT_EQUAL_FATAL(s_thumb.req_count, 1);
+	CU_ASSERT_STRING_EQUAL(s_thumb.reqs[0].uri, "/0.jpg");
+
+	/* A queued waiter canceled is notified, its thumbnail not fetched */
+	res = arsdk_media_thumbs_cancel(thumbs, waiters[1]);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_media_thumbs_cancel(thumbs, waiters[1]);
+	CU_ASSERT_EQUAL(res, -EALREADY);
+	CU_ASSERT_EQUAL(results[1].count, 0);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(results[1].count, 1);
+	CU_ASSERT_EQUAL(results[1].status, ARSDK_MEDIA_REQ_STATUS_CANCELED);
+
+	/* Higher priority first */
+	test_thumb_req_complete(&s_thumb.reqs[0], ARSDK_FTP_REQ_STATUS_OK,
+			"0");
+	CU_ASSERT_EQUAL_FATAL(s_thumb.req_count, 2);
+	CU_ASSERT_STRING_EQUAL(s_thumb.reqs[1].uri, "/2.jpg");
+
+	/* A running download canceled still completes to be cached */
+	res = arsdk_media_thumbs_cancel(thumbs, waiters[2]);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT(s_thumb.reqs[1].running);
+	test_thumb_req_complete(&s_thumb.reqs[1], ARSDK_FTP_REQ_STATUS_OK,
+			"2");
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(results[2].status, ARSDK_MEDIA_REQ_STATUS_CANCELED);
+	CU_ASSERT_EQUAL(results[2].count, 1);
+
+	/* Prefetches canceled */
+	CU_ASSERT_EQUAL_FATAL(s_thumb.req_count, 3);
+	CU_ASSERT_STRING_EQUAL(s_thumb.reqs[2].uri, "/3.jpg");
+	test_thumb_req_complete(&s_thumb.reqs[2], ARSDK_FTP_REQ_STATUS_OK,
+			"3");
+	res = arsdk_media_thumbs_fetch(thumbs, "/4.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			NULL, NULL, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_media_thumbs_fetch(thumbs, "/5.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			NULL, NULL, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	arsdk_media_thumbs_cancel_prefetch(thumbs);
+	test_thumb_req_complete(&s_thumb.reqs[3], ARSDK_FTP_REQ_STATUS_OK,
+			"4");
+	CU_ASSERT_EQUAL(s_thumb.req_count, 4);
+
+	/* The cached thumbnails are notified without download */
+	res = arsdk_media_thumbs_fetch(thumbs, "/2.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &results[2], &waiters[2]);
+	CU_ASSERT_EQUAL(res, 0);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(results[2].count, 2);
+	CU_ASSERT_STRING_EQUAL(results[2].data, "2");
+	CU_ASSERT_EQUAL(s_thumb.req_count, 4);
+
+	/* Stopped: the pending waiters are aborted */
+	res = arsdk_media_thumbs_fetch(thumbs, "/6.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &results[3], &waiters[3]);
+	CU_ASSERT_EQUAL(res, 0);
+	arsdk_media_thumbs_stop(thumbs);
+	CU_ASSERT(!s_thumb.reqs[4].running);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(results[3].count, 1);
+	CU_ASSERT_EQUAL(results[3].status, ARSDK_MEDIA_REQ_STATUS_ABORTED);
+
+	res = arsdk_media_thumbs_fetch(thumbs, "/6.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &results[3], &waiters[3]);
+	CU_ASSERT_EQUAL(res, -EPIPE);
+
+	arsdk_media_thumbs_destroy(thumbs);
+	pomp_loop_destroy(loop);
+}
+
+/** */
+static void test_media_thumb_version(void)
+{
+	struct pomp_loop *loop = NULL;
+	struct arsdk_media_thumbs *thumbs = NULL;
+	struct arsdk_media_thumb_waiter *waiter1 = NULL;
+	struct arsdk_media_thumb_waiter *waiter2 = NULL;
+	struct test_thumb_result res1;
+	struct test_thumb_result res2;
+	struct arsdk_ftp_itf *ftp = (struct arsdk_ftp_itf *)&s_thumb;
+	int res = 0;
+
+	memset(&s_thumb, 0, sizeof(s_thumb));
+	memset(&res1, 0, sizeof(res1));
+	memset(&res2, 0, sizeof(res2));
+
+	loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+	res = arsdk_media_thumbs_new(ftp, loop, "dev", &thumbs);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &res1, &waiter1);
+	CU_ASSERT_EQUAL(res, 0);
+
+	/* Versions of a media are not downloaded together */
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 2,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &res2, &waiter2);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL_FATAL(s_thumb.req_count, 2);
+	test_thumb_req_complete(&s_thumb.reqs[0], ARSDK_FTP_REQ_STATUS_OK,
+			"thumb 1");
+	test_thumb_req_complete(&s_thumb.reqs[1], ARSDK_FTP_REQ_STATUS_OK,
+			"thumb 2");
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_STRING_EQUAL(res1.data, "thumb 1");
+	CU_ASSERT_STRING_EQUAL(res2.data, "thumb 2");
+
+	/* The last version downloaded replaced the previous one */
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 2,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &res2, &waiter2);
+	CU_ASSERT_EQUAL(res, 0);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(res2.count, 2);
+	CU_ASSERT_STRING_EQUAL(res2.data, "thumb 2");
+	CU_ASSERT_EQUAL(s_thumb.req_count, 2);
+
+	/* A media replaced under the same name is not served stale */
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 3,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &res1, &waiter1);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL_FATAL(s_thumb.req_count, 3);
+	test_thumb_req_complete(&s_thumb.reqs[2], ARSDK_FTP_REQ_STATUS_OK,
+			"thumb 3");
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(res1.count, 2);
+	CU_ASSERT_STRING_EQUAL(res1.data, "thumb 3");
+
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 2,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &res2, &waiter2);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(s_thumb.req_count, 4);
+
+	arsdk_media_thumbs_stop(thumbs);
+	arsdk_media_thumbs_destroy(thumbs);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(res2.count, 3);
+	CU_ASSERT_EQUAL(res2.status, ARSDK_MEDIA_REQ_STATUS_ABORTED);
+	pomp_loop_destroy(loop);
+}
+
+/** */
+static void test_media_thumb_disk(void)
+{
+	char dir[] = "/tmp/arsdk_test_thumb_XXXXXX";
+	char cmd[128];
+	struct pomp_loop *loop = NULL;
+	struct arsdk_media_thumbs *thumbs = NULL;
+	struct arsdk_media_thumb_waiter *waiter = NULL;
+	struct test_thumb_result result;
+	struct arsdk_media_thumb_cfg cfg;
+	struct arsdk_ftp_itf *ftp = (struct arsdk_ftp_itf *)&s_thumb;
+	int res = 0;
+
+	memset(&s_thumb, 0, sizeof(s_thumb));
+	memset(&result, 0, sizeof(result));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+
+	loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+	res = arsdk_media_thumbs_new(ftp, loop, "dev:1", &thumbs);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	/* Disk cache only */
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.dir = dir;
+	cfg.disk_max_size = 1024;
+	res = arsdk_media_thumbs_set_cfg(thumbs, &cfg);
+	CU_ASSERT_EQUAL(res, 0);
+
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &result, &waiter);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL_FATAL(s_thumb.req_count, 1);
+	test_thumb_req_complete(&s_thumb.reqs[0], ARSDK_FTP_REQ_STATUS_OK,
+			"thumb a");
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(result.count, 1);
+
+	arsdk_media_thumbs_stop(thumbs);
+	arsdk_media_thumbs_destroy(thumbs);
+
+	/* Read back by another service of the same device */
+	res = arsdk_media_thumbs_new(ftp, loop, "dev:1", &thumbs);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_media_thumbs_set_cfg(thumbs, &cfg);
+	CU_ASSERT_EQUAL(res, 0);
+
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 1,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &result, &waiter);
+	CU_ASSERT_EQUAL(res, 0);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(result.count, 2);
+	CU_ASSERT_EQUAL(result.status, ARSDK_MEDIA_REQ_STATUS_OK);
+	CU_ASSERT_STRING_EQUAL(result.data, "thumb a");
+	CU_ASSERT_EQUAL(s_thumb.req_count, 1);
+
+	/* Not read back for another version of the media */
+	res = arsdk_media_thumbs_fetch(thumbs, "/a.jpg", 2,
+			ARSDK_DEVICE_TYPE_ANAFI4K, ARSDK_FTP_REQ_PRIORITY_LOW,
+			&test_thumb_cb, &result, &waiter);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL_FATAL(s_thumb.req_count, 2);
+	test_thumb_req_complete(&s_thumb.reqs[1], ARSDK_FTP_REQ_STATUS_OK,
+			"thumb a2");
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(result.count, 3);
+	CU_ASSERT_STRING_EQUAL(result.data, "thumb a2");
+
+	arsdk_media_thumbs_stop(thumbs);
+	arsdk_media_thumbs_destroy(thumbs);
+	pomp_loop_destroy(loop);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	CU_ASSERT_EQUAL(system(cmd), 0);
+}
+
+/** */
+static void test_media_arena_alloc(void)
+{
+	struct arsdk_media_arena *arena = NULL;
+	uint8_t *ptrs[TEST_ARENA_COUNT];
+	size_t sizes[TEST_ARENA_COUNT];
+	uint8_t *large = NULL;
+	char *str = NULL;
+	size_t i = 0;
+	size_t j = 0;
+	int res = 0;
+
+	res = arsdk_media_arena_new(&arena);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	/* Zeroed and aligned, filled to check they do not overlap */
+	for (i = 0; i < TEST_ARENA_COUNT; i++) {
+		sizes[i] = 1 + (i * 37) % 300;
+		/* some allocations get their own chunk */
+		if (i % 500 == 499)
+			sizes[i] = 20000;
+		ptrs[i] = arsdk_media_arena_alloc(arena, sizes[i]);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(ptrs[i]);
+		CU_ASSERT_EQUAL((uintptr_t)ptrs[i] % sizeof(uint64_t), 0);
+		for (j = 0; j < sizes[i]; j++)
+			CU_ASSERT_EQUAL_FATAL(ptrs[i][j], 0);
+		memset(ptrs[i], (int)(i & 0xff), sizes[i]);
+	}
+
+	for (i = 0; i < TEST_ARENA_COUNT; i++) {
+		for (j = 0; j < sizes[i]; j++)
+			CU_ASSERT_EQUAL_FATAL(ptrs[i][j], (uint8_t)(i & 0xff));
+	}
+
+	/* A large allocation does not end the current chunk */
+	ptrs[0] = arsdk_media_arena_alloc(arena, 8);
+	large = arsdk_media_arena_alloc(arena, 64 * 1024);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(large);
+	memset(large, 0xff, 64 * 1024);
+	ptrs[1] = arsdk_media_arena_alloc(arena, 8);
+	CU_ASSERT_PTR_EQUAL(ptrs[1], ptrs[0] + 8);
+
+	/* Strings */
+	str = arsdk_media_arena_strndup(arena, "media.jpg", 5);
+	CU_ASSERT_STRING_EQUAL(str, "media");
+	CU_ASSERT_PTR_NULL(arsdk_media_arena_strndup(arena, NULL, 0));
+	str = arsdk_media_arena_concat(arena, "/internal_000/DCIM/",
+			"media.jpg");
+	CU_ASSERT_STRING_EQUAL(str, "/internal_000/DCIM/media.jpg");
+	str = arsdk_media_arena_concat(arena, "", "");
+	CU_ASSERT_STRING_EQUAL(str, "");
+
+	/* Freed with the last reference */
+	arsdk_media_arena_ref(arena);
+	arsdk_media_arena_unref(arena);
+	CU_ASSERT_EQUAL(ptrs[1][0], 0);
+	arsdk_media_arena_unref(arena);
+}
+
+/** */
+static void test_media_arena_intern(void)
+{
+	struct arsdk_media_arena *arena = NULL;
+	struct arsdk_media_arena *other = NULL;
+	const char *strs[TEST_ARENA_COUNT];
+	const char *str = NULL;
+	char buf[32];
+	size_t i = 0;
+	int res = 0;
+
+	res = arsdk_media_arena_new(&arena);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_media_arena_new(&other);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	CU_ASSERT_PTR_NULL(arsdk_media_arena_intern(arena, NULL));
+
+	/* Equal strings share a copy, kept while the table grows */
+	for (i = 0; i < TEST_ARENA_COUNT; i++) {
+		snprintf(buf, sizeof(buf), "/DCIM/100MEDIA/P%07zu.JPG", i);
+		strs[i] = arsdk_media_arena_intern(arena, buf);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(strs[i]);
+		CU_ASSERT_PTR_NOT_EQUAL(strs[i], buf);
+		CU_ASSERT_STRING_EQUAL(strs[i], buf);
+	}
+
+	for (i = 0; i < TEST_ARENA_COUNT; i++) {
+		snprintf(buf, sizeof(buf), "/DCIM/100MEDIA/P%07zu.JPG", i);
+		CU_ASSERT_PTR_EQUAL(arsdk_media_arena_intern(arena, buf),
+				strs[i]);
+	}
+
+	str = arsdk_media_arena_intern(arena, "");
+	CU_ASSERT_STRING_EQUAL(str, "");
+	CU_ASSERT_PTR_EQUAL(arsdk_media_arena_intern(arena, ""), str);
+
+	/* Not shared between arenas */
+	str = arsdk_media_arena_intern(other, strs[0]);
+	CU_ASSERT_STRING_EQUAL(str, strs[0]);
+	CU_ASSERT_PTR_NOT_EQUAL(str, strs[0]);
+
+	arsdk_media_arena_unref(other);
+	arsdk_media_arena_unref(arena);
+}
+
+/** */
+static void test_index_removed_cb(const char *name, void *userdata)
+{
+	struct test_index_removed *removed = userdata;
+
+	CU_ASSERT_FATAL(removed->count < TEST_INDEX_REMOVED_MAX);
+	snprintf(removed->names[removed->count++], sizeof(removed->names[0]),
+			"%s", name);
+}
+
+/** */
+static void test_index_write_file(const char *path, const char *data)
+{
+	FILE *file = fopen(path, "w");
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+	CU_ASSERT_EQUAL(fwrite(data, 1, strlen(data), file), strlen(data));
+	fclose(file);
+}
+
+/** */
+static void test_media_index_parse(void)
+{
+	char dir[] = "/tmp/arsdk_test_index_XXXXXX";
+	char path[128];
+	char cmd[128];
+	struct arsdk_media_index *index = NULL;
+	struct test_index_removed removed;
+	int res = 0;
+
+	memset(&removed, 0, sizeof(removed));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+	snprintf(path, sizeof(path), "%s/dev.index", dir);
+
+	/* Missing file, built by the first refresh */
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+	arsdk_media_index_destroy(index);
+
+	/* Valid file */
+	test_index_write_file(path, "arsdk-media-index 2 100 200 50\n"
+			"0000002a P001.JPG\n"
+			"0000002b P002 with spaces.MP4\n");
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_TRUE(arsdk_media_index_is_current(index, 100));
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 101));
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 0));
+
+	arsdk_media_index_begin(index);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P001.JPG", 0x2a), 0);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index,
+			"P002 with spaces.MP4", 0x2b), 0);
+	res = arsdk_media_index_end(index, 100, 200, 50,
+			&test_index_removed_cb, &removed);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(removed.count, 0);
+	arsdk_media_index_destroy(index);
+
+	/* Previous version, rebuilt */
+	test_index_write_file(path, "arsdk-media-index 1 100\n"
+			"0000002a P001.JPG\n");
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+	arsdk_media_index_begin(index);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P001.JPG", 0x2a), 1);
+	arsdk_media_index_destroy(index);
+
+	/* Corrupted signature, none of the medias kept */
+	test_index_write_file(path, "arsdk-media-index 2 100 200 50\n"
+			"0000002a P001.JPG\n"
+			"zz P002.JPG\n");
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+	arsdk_media_index_begin(index);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P001.JPG", 0x2a), 1);
+	arsdk_media_index_destroy(index);
+
+	/* Missing name */
+	test_index_write_file(path, "arsdk-media-index 2 100 200 50\n"
+			"0000002a \n");
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+	arsdk_media_index_destroy(index);
+
+	/* Truncated header */
+	test_index_write_file(path, "arsdk-media-index 2 100\n");
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+	arsdk_media_index_destroy(index);
+
+	CU_ASSERT_EQUAL(arsdk_media_index_new(NULL, &index), -EINVAL);
+	CU_ASSERT_EQUAL(arsdk_media_index_new(path, NULL), -EINVAL);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	CU_ASSERT_EQUAL(system(cmd), 0);
+}
+
+/** */
+static void test_media_index_round_trip(void)
+{
+	char dir[] = "/tmp/arsdk_test_index_XXXXXX";
+	char path[128];
+	char cmd[128];
+	struct arsdk_media_index *index = NULL;
+	struct test_index_removed removed;
+	int res = 0;
+
+	memset(&removed, 0, sizeof(removed));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+	snprintf(path, sizeof(path), "%s/dev.index", dir);
+
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	arsdk_media_index_begin(index);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P001.JPG", 1), 1);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P002.MP4", 2), 1);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P003.DNG", 3), 1);
+	res = arsdk_media_index_end(index, 100, 200, 90,
+			&test_index_removed_cb, &removed);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(removed.count, 0);
+	arsdk_media_index_destroy(index);
+
+	/* Reloaded: a media changed, one removed, one added */
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_TRUE(arsdk_media_index_is_current(index, 100));
+	arsdk_media_index_begin(index);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P001.JPG", 1), 0);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P002.MP4", 5), 2);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P004.JPG", 4), 1);
+	res = arsdk_media_index_end(index, 110, 300, 110,
+			&test_index_removed_cb, &removed);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL_FATAL(removed.count, 1);
+	CU_ASSERT_STRING_EQUAL(removed.names[0], "P003.DNG");
+	arsdk_media_index_destroy(index);
+
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+	CU_ASSERT_TRUE(arsdk_media_index_is_current(index, 110));
+	arsdk_media_index_begin(index);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P001.JPG", 1), 0);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P002.MP4", 5), 0);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P004.JPG", 4), 0);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P003.DNG", 3), 1);
+	arsdk_media_index_destroy(index);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	CU_ASSERT_EQUAL(system(cmd), 0);
+}
+
+/** */
+static void test_media_index_stale(void)
+{
+	char dir[] = "/tmp/arsdk_test_index_XXXXXX";
+	char path[128];
+	char cmd[128];
+	struct arsdk_media_index *index = NULL;
+	int res = 0;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+	snprintf(path, sizeof(path), "%s/dev.index", dir);
+
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	/* Modified in the second of the listing */
+	arsdk_media_index_begin(index);
+	res = arsdk_media_index_end(index, 100, 200, 200, NULL, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+
+	/* Within the margin */
+	arsdk_media_index_begin(index);
+	res = arsdk_media_index_end(index, 100, 200,
+			200 - ARSDK_MEDIA_INDEX_MTIME_MARGIN + 1, NULL, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+
+	/* Device clock ahead */
+	arsdk_media_index_begin(index);
+	res = arsdk_media_index_end(index, 100, 200, 260, NULL, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+
+	/* Old enough, also once reloaded */
+	arsdk_media_index_begin(index);
+	res = arsdk_media_index_end(index, 100, 200,
+			200 - ARSDK_MEDIA_INDEX_MTIME_MARGIN, NULL, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_TRUE(arsdk_media_index_is_current(index, 100));
+	arsdk_media_index_destroy(index);
+
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_TRUE(arsdk_media_index_is_current(index, 100));
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 0));
+	arsdk_media_index_destroy(index);
+
+	/* Invalidated, the medias are kept */
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	arsdk_media_index_begin(index);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P001.JPG", 1), 1);
+	res = arsdk_media_index_end(index, 100, 200, 100, NULL, NULL);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_TRUE(arsdk_media_index_is_current(index, 100));
+	CU_ASSERT_EQUAL(arsdk_media_index_invalidate(index), 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+	arsdk_media_index_destroy(index);
+
+	res = arsdk_media_index_new(path, &index);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(index, 100));
+	arsdk_media_index_begin(index);
+	CU_ASSERT_EQUAL(arsdk_media_index_update(index, "P001.JPG", 1), 0);
+	arsdk_media_index_destroy(index);
+
+	CU_ASSERT_FALSE(arsdk_media_index_is_current(NULL, 100));
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	CU_ASSERT_EQUAL(system(cmd), 0);
+}
+
+/** */
+static void test_batch_list_cb(struct arsdk_media_itf *itf,
+		struct arsdk_media_req_list *req,
+		enum arsdk_media_req_status status,
+		int error,
+		void *userdata)
+{
+	CU_ASSERT_EQUAL(status, ARSDK_MEDIA_REQ_STATUS_OK);
+	s_batch.medias = arsdk_media_req_list_get_result(req);
+	if (s_batch.medias != NULL)
+		arsdk_media_list_ref(s_batch.medias);
+}
+
+/** */
+static void test_batch_progress_cb(struct arsdk_media_itf *itf,
+		struct arsdk_media_req_delete_batch *req,
+		const struct arsdk_media *media,
+		enum arsdk_media_req_status status,
+		int error,
+		size_t done,
+		size_t total,
+		void *userdata)
+{
+	struct test_batch_result *result = userdata;
+	uint32_t i = result->progress_count;
+
+	CU_ASSERT_FATAL(i < TEST_BATCH_MEDIA_COUNT);
+	snprintf(result->names[i], sizeof(result->names[i]), "%s",
+			arsdk_media_get_name(media));
+	result->statuses[i] = status;
+	result->errors[i] = error;
+	result->done = done;
+	result->total = total;
+	result->progress_count++;
+}
+
+/** */
+static void test_batch_complete_cb(struct arsdk_media_itf *itf,
+		struct arsdk_media_req_delete_batch *req,
+		enum arsdk_media_req_status status,
+		int error,
+		void *userdata)
+{
+	struct test_batch_result *result = userdata;
+
+	result->count++;
+	result->status = status;
+	result->error = error;
+}
+
+/**
+ * Create a media interface and list its medias: a photo and its thumbnail
+ * per media, so the window of the deletions holds two medias.
+ */
+static void test_batch_setup(struct pomp_loop **ret_loop,
+		struct arsdk_media_itf **ret_itf,
+		struct arsdk_media **medias)
+{
+	struct pomp_loop *loop = NULL;
+	struct arsdk_media_itf *itf = NULL;
+	struct arsdk_media_req_list *req = NULL;
+	struct arsdk_media_req_list_cbs cbs;
+	struct arsdk_media *media = NULL;
+	struct arsdk_ftp_file *file = NULL;
+	struct arsdk_ftp_itf *ftp = (struct arsdk_ftp_itf *)&s_batch;
+	char name[64];
+	size_t i = 0;
+	int res = 0;
+
+	memset(&s_thumb, 0, sizeof(s_thumb));
+	memset(&s_batch, 0, sizeof(s_batch));
+
+	loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+	res = arsdk_media_itf_new(ftp, loop, "dev", &itf);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	for (i = 0; i < TEST_BATCH_MEDIA_COUNT; i++) {
+		res = arsdk_ftp_file_new(&file);
+		CU_ASSERT_EQUAL_FATAL(res, 0);
+		snprintf(name, sizeof(name),
+				"product_2019-01-01T00000%zu+0000_1.jpg", i);
+		arsdk_ftp_file_set_name(file, name);
+		file->size = 100;
+		file->mtime = 1;
+		s_batch.files.files[s_batch.files.count++] = file;
+	}
+
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.complete = &test_batch_list_cb;
+	res = arsdk_media_itf_create_req_list(itf, &cbs,
+			ARSDK_MEDIA_TYPE_ALL, ARSDK_DEVICE_TYPE_ANAFI4K, &req);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_FATAL(s_batch.list_req.running);
+	s_batch.list_req.running = 0;
+	(*s_batch.list_req.cbs.complete)(NULL, &s_batch.list_req,
+			ARSDK_FTP_REQ_STATUS_OK, 0,
+			s_batch.list_req.cbs.userdata);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(s_batch.medias);
+
+	/* the files are kept by the medias */
+	for (i = 0; i < s_batch.files.count; i++)
+		arsdk_ftp_file_unref(s_batch.files.files[i]);
+
+	i = 0;
+	media = arsdk_media_list_next_media(s_batch.medias, NULL);
+	while (media != NULL) {
+		CU_ASSERT_FATAL(i < TEST_BATCH_MEDIA_COUNT);
+		CU_ASSERT_EQUAL(arsdk_media_get_res_count(media), 2);
+		medias[i++] = media;
+		media = arsdk_media_list_next_media(s_batch.medias, media);
+	}
+	CU_ASSERT_EQUAL_FATAL(i, TEST_BATCH_MEDIA_COUNT);
+
+	*ret_loop = loop;
+	*ret_itf = itf;
+}
+
+/** */
+static void test_batch_teardown(struct pomp_loop *loop,
+		struct arsdk_media_itf *itf)
+{
+	arsdk_media_list_unref(s_batch.medias);
+	arsdk_media_itf_destroy(itf);
+	pomp_loop_destroy(loop);
+}
+
+/** */
+static void test_media_delete_batch_window(void)
+{
+	struct pomp_loop *loop = NULL;
+	struct arsdk_media_itf *itf = NULL;
+	struct arsdk_media *medias[TEST_BATCH_MEDIA_COUNT];
+	struct arsdk_media_req_delete_batch *req = NULL;
+	struct arsdk_media_req_delete_batch_cbs cbs;
+	struct test_batch_result result;
+	uint32_t i = 0;
+	int res = 0;
+
+	test_batch_setup(&loop, &itf, medias);
+	memset(&result, 0, sizeof(result));
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.userdata = &result;
+	cbs.progress = &test_batch_progress_cb;
+	cbs.complete = &test_batch_complete_cb;
+
+	res = arsdk_media_itf_create_req_delete_batch(itf, &cbs, medias,
+			TEST_BATCH_MEDIA_COUNT, ARSDK_DEVICE_TYPE_ANAFI4K, &req);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_EQUAL(arsdk_media_req_delete_batch_get_count(req),
+			TEST_BATCH_MEDIA_COUNT);
+
+	/* A window of deletions in flight */
+	CU_ASSERT_EQUAL_FATAL(s_batch.del_count, 4);
+	CU_ASSERT_STRING_EQUAL(s_batch.dels[0].uri, arsdk_media_res_get_uri(
+			arsdk_media_next_res(medias[0], NULL)));
+
+	/* Refilled by each deletion done */
+	test_batch_del_complete(&s_batch.dels[0], ARSDK_FTP_REQ_STATUS_OK, 0);
+	CU_ASSERT_EQUAL(s_batch.del_count, 5);
+	CU_ASSERT_EQUAL(result.progress_count, 0);
+
+	/* A media is notified once all its resources are deleted */
+	test_batch_del_complete(&s_batch.dels[1], ARSDK_FTP_REQ_STATUS_OK, 0);
+	CU_ASSERT_EQUAL(s_batch.del_count, 6);
+	CU_ASSERT_EQUAL_FATAL(result.progress_count, 1);
+	CU_ASSERT_STRING_EQUAL(result.names[0],
+			arsdk_media_get_name(medias[0]));
+	CU_ASSERT_EQUAL(result.statuses[0], ARSDK_MEDIA_REQ_STATUS_OK);
+	CU_ASSERT_EQUAL(result.done, 1);
+	CU_ASSERT_EQUAL(result.total, TEST_BATCH_MEDIA_COUNT);
+
+	/* Completed out of order */
+	test_batch_del_complete(&s_batch.dels[3], ARSDK_FTP_REQ_STATUS_OK, 0);
+	test_batch_del_complete(&s_batch.dels[2], ARSDK_FTP_REQ_STATUS_OK, 0);
+	CU_ASSERT_EQUAL(s_batch.del_count, 8);
+	CU_ASSERT_EQUAL(result.progress_count, 2);
+
+	for (i = 4; i < 8; i++) {
+		CU_ASSERT_EQUAL(result.count, 0);
+		test_batch_del_complete(&s_batch.dels[i],
+				ARSDK_FTP_REQ_STATUS_OK, 0);
+	}
+	CU_ASSERT_EQUAL(s_batch.del_count, 8);
+
+	CU_ASSERT_EQUAL(result.progress_count, TEST_BATCH_MEDIA_COUNT);
+	for (i = 0; i < TEST_BATCH_MEDIA_COUNT; i++) {
+		CU_ASSERT_STRING_EQUAL(result.names[i],
+				arsdk_media_get_name(medias[i]));
+		CU_ASSERT_EQUAL(result.statuses[i], ARSDK_MEDIA_REQ_STATUS_OK);
+	}
+	CU_ASSERT_EQUAL(result.count, 1);
+	CU_ASSERT_EQUAL(result.status, ARSDK_MEDIA_REQ_STATUS_OK);
+	CU_ASSERT_EQUAL(result.error, 0);
+
+	/* Medias without resources are not deleted */
+	res = arsdk_media_itf_create_req_delete_batch(itf, &cbs, medias, 0,
+			ARSDK_DEVICE_TYPE_ANAFI4K, &req);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+	CU_ASSERT_PTR_NULL(req);
+
+	test_batch_teardown(loop, itf);
+}
+
+/** */
+static void test_media_delete_batch_failure(void)
+{
+	struct pomp_loop *loop = NULL;
+	struct arsdk_media_itf *itf = NULL;
+	struct arsdk_media *medias[TEST_BATCH_MEDIA_COUNT];
+	struct arsdk_media_req_delete_batch *req = NULL;
+	struct arsdk_media_req_delete_batch_cbs cbs;
+	struct test_batch_result result;
+	uint32_t i = 0;
+	int res = 0;
+
+	test_batch_setup(&loop, &itf, medias);
+	memset(&result, 0, sizeof(result));
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.userdata = &result;
+	cbs.progress = &test_batch_progress_cb;
+	cbs.complete = &test_batch_complete_cb;
+
+	res = arsdk_media_itf_create_req_delete_batch(itf, &cbs, medias,
+			TEST_BATCH_MEDIA_COUNT, ARSDK_DEVICE_TYPE_ANAFI4K, &req);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	CU_ASSERT_EQUAL_FATAL(s_batch.del_count, 4);
+
+	/* A resource not deleted fails its media only */
+	test_batch_del_complete(&s_batch.dels[0], ARSDK_FTP_REQ_STATUS_OK, 0);
+	test_batch_del_complete(&s_batch.dels[1], ARSDK_FTP_REQ_STATUS_OK, 0);
+	test_batch_del_complete(&s_batch.dels[2], ARSDK_FTP_REQ_STATUS_FAILED,
+			-EPERM);
+	CU_ASSERT_EQUAL(result.progress_count, 1);
+	test_batch_del_complete(&s_batch.dels[3], ARSDK_FTP_REQ_STATUS_OK, 0);
+	CU_ASSERT_EQUAL_FATAL(result.progress_count, 2);
+	CU_ASSERT_STRING_EQUAL(result.names[1],
+			arsdk_media_get_name(medias[1]));
+	CU_ASSERT_EQUAL(result.statuses[1], ARSDK_MEDIA_REQ_STATUS_FAILED);
+	CU_ASSERT_EQUAL(result.errors[1], -EPERM);
+
+	/* The next medias are still deleted */
+	CU_ASSERT_EQUAL_FATAL(s_batch.del_count, 8);
+	for (i = 4; i < 8; i++)
+		test_batch_del_complete(&s_batch.dels[i],
+				ARSDK_FTP_REQ_STATUS_OK, 0);
+
+	CU_ASSERT_EQUAL(result.progress_count, TEST_BATCH_MEDIA_COUNT);
+	CU_ASSERT_EQUAL(result.statuses[0], ARSDK_MEDIA_REQ_STATUS_OK);
+	CU_ASSERT_EQUAL(result.statuses[2], ARSDK_MEDIA_REQ_STATUS_OK);
+	CU_ASSERT_EQUAL(result.statuses[3], ARSDK_MEDIA_REQ_STATUS_OK);
+	CU_ASSERT_EQUAL(result.done, TEST_BATCH_MEDIA_COUNT);
+
+	/* The batch fails if a media was not deleted */
+	CU_ASSERT_EQUAL(result.count, 1);
+	CU_ASSERT_EQUAL(result.status, ARSDK_MEDIA_REQ_STATUS_FAILED);
+	CU_ASSERT_EQUAL(result.error, -EIO);
+
+	test_batch_teardown(loop, itf);
+}
+
+/** */
+static void test_media_delete_batch_cancel(void)
+{
+	struct pomp_loop *loop = NULL;
+	struct arsdk_media_itf *itf = NULL;
+	struct arsdk_media *medias[TEST_BATCH_MEDIA_COUNT];
+	struct arsdk_media_req_delete_batch *req = NULL;
+	struct arsdk_media_req_delete_batch_cbs cbs;
+	struct test_batch_result result;
+	uint32_t i = 0;
+	int res = 0;
+
+	test_batch_setup(&loop, &itf, medias);
+	memset(&result, 0, sizeof(result));
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.userdata = &result;
+	cbs.progress = &test_batch_progress_cb;
+	cbs.complete = &test_batch_complete_cb;
+
+	res = arsdk_media_itf_create_req_delete_batch(itf, &cbs, medias,
+			TEST_BATCH_MEDIA_COUNT, ARSDK_DEVICE_TYPE_ANAFI4K, &req);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	test_batch_del_complete(&s_batch.dels[0], ARSDK_FTP_REQ_STATUS_OK, 0);
+	test_batch_del_complete(&s_batch.dels[1], ARSDK_FTP_REQ_STATUS_OK, 0);
+	CU_ASSERT_EQUAL_FATAL(s_batch.del_count, 6);
+	CU_ASSERT_EQUAL(result.progress_count, 1);
+
+	/* The deletions in flight are canceled, no other one is sent */
+	res = arsdk_media_req_delete_batch_cancel(req);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(s_batch.del_count, 6);
+	for (i = 0; i < s_batch.del_count; i++)
+		CU_ASSERT(!s_batch.dels[i].running);
+
+	/* The medias not deleted are notified canceled */
+	CU_ASSERT_EQUAL_FATAL(result.progress_count, TEST_BATCH_MEDIA_COUNT);
+	CU_ASSERT_EQUAL(result.statuses[0], ARSDK_MEDIA_REQ_STATUS_OK);
+	for (i = 1; i < TEST_BATCH_MEDIA_COUNT; i++)
+		CU_ASSERT_EQUAL(result.statuses[i],
+				ARSDK_MEDIA_REQ_STATUS_CANCELED);
+	CU_ASSERT_STRING_EQUAL(result.names[3],
+			arsdk_media_get_name(medias[3]));
+	CU_ASSERT_EQUAL(result.done, TEST_BATCH_MEDIA_COUNT);
+
+	CU_ASSERT_EQUAL(result.count, 1);
+	CU_ASSERT_EQUAL(result.status, ARSDK_MEDIA_REQ_STATUS_CANCELED);
+
+	test_batch_teardown(loop, itf);
+}
+
+/** */
+static CU_TestInfo s_media_tests[] = {
+	{(char *)"arena_alloc", &test_media_arena_alloc},
+	{(char *)"arena_intern", &test_media_arena_intern},
+	{(char *)"index_parse", &test_media_index_parse},
+	{(char *)"index_round_trip", &test_media_index_round_trip},
+	{(char *)"index_stale", &test_media_index_stale},
+	{(char *)"thumb_fetch", &test_media_thumb_fetch},
+	{(char *)"thumb_queue", &test_media_thumb_queue},
+	{(char *)"thumb_version", &test_media_thumb_version},
+	{(char *)"thumb_disk", &test_media_thumb_disk},
+	{(char *)"delete_batch_window", &test_media_delete_batch_window},
+	{(char *)"delete_batch_failure", &test_media_delete_batch_failure},
+	{(char *)"delete_batch_cancel", &test_media_delete_batch_cancel},
+	CU_TEST_INFO_NULL,
+};
+
+/** */
+/*extern*/ CU_SuiteInfo g_suites_media[] = {
+	{(char *)"media", NULL, NULL, s_media_tests},
+	CU_SUITE_INFO_NULL,
+};
@@ -0,0 +1,203 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdk_test.h"
+#include "arsdk_mpsc_ring.h"
+
+#include <sched.h>
+#include <pthread.h>
+
+#define TEST_RING_SIZE 64
+#define TEST_PRODUCER_COUNT 4
+#define TEST_PRODUCER_ITEMS 20000
+
+/** */
+struct test_item {
+	uint32_t  producer;
+	uint32_t  seq;
+};
+
+/** */
+struct test_producer {
+	struct arsdk_mpsc_ring  *ring;
+	uint32_t                id;
+};
+
+/** */
+static void test_mpsc_ring_bad_args(void)
+{
+	struct arsdk_mpsc_ring ring;
+	int res = 0;
+
+	res = arsdk_mpsc_ring_init(NULL, sizeof(struct test_item), 8);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+
+	res = arsdk_mpsc_ring_init(&ring, 0, 8);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+
+	/* count must be a power of 2 */
+	res = arsdk_mpsc_ring_init(&ring, sizeof(struct test_item), 6);
+	CU_ASSERT_EQUAL(res, -EINVAL);
+}
+
+/** */
+static void test_mpsc_ring_full_empty(void)
+{
+	struct arsdk_mpsc_ring ring;
+	struct test_item item;
+	uint32_t i = 0;
+	int res = 0;
+
+	res = arsdk_mpsc_ring_init(&ring, sizeof(struct test_item),
+			TEST_RING_SIZE);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	/* Empty */
+	res = arsdk_mpsc_ring_pop(&ring, &item);
+	CU_ASSERT_EQUAL(res, -EAGAIN);
+
+	/* Fill twice to check cells are recycled */
+	for (i = 0; i < 2 * TEST_RING_SIZE; i++) {
+		item.producer = 0;
+		item.seq = i;
+		res = arsdk_mpsc_ring_push(&ring, &item);
+		CU_ASSERT_EQUAL(res, 0);
+
+		if (i == TEST_RING_SIZE - 1) {
+			/* Full */
+			res = arsdk_mpsc_ring_push(&ring, &item);
+			CU_ASSERT_EQUAL(res, -EAGAIN);
+			CU_ASSERT_EQUAL(arsdk_mpsc_ring_count(&ring),
+					TEST_RING_SIZE);
+		}
+
+		if (i >= TEST_RING_SIZE - 1) {
+			res = arsdk_mpsc_ring_pop(&ring, &item);
+			CU_ASSERT_EQUAL(res, 0);
+			CU_ASSERT_EQUAL(item.seq, i - (TEST_RING_SIZE - 1));
+		}
+	}
+
+	/* Drain */
+	for (i = 0; i < TEST_RING_SIZE - 1; i++) {
+		res = arsdk_mpsc_ring_pop(&ring, &item);
+		CU_ASSERT_EQUAL(res, 0);
+		CU_ASSERT_EQUAL(item.seq, TEST_RING_SIZE + i + 1);
+	}
+
+	res = arsdk_mpsc_ring_pop(&ring, &item);
+	CU_ASSERT_EQUAL(res, -EAGAIN);
+	CU_ASSERT_EQUAL(arsdk_mpsc_ring_count(&ring), 0);
+
+	arsdk_mpsc_ring_clear(&ring);
+}
+
+/** */
+static void *producer_thread(void *userdata)
+{
+	struct test_producer *producer = userdata;
+	struct test_item item;
+	uint32_t i = 0;
+
+	item.producer = producer->id;
+	for (i = 0; i < TEST_PRODUCER_ITEMS; i++) {
+		item.seq = i;
+		while (arsdk_mpsc_ring_push(producer->ring, &item) == -EAGAIN)
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+/** */
+static void test_mpsc_ring_producers(void)
+{
+	struct arsdk_mpsc_ring ring;
+	struct test_producer producers[TEST_PRODUCER_COUNT];
+	pthread_t threads[TEST_PRODUCER_COUNT];
+	uint32_t next_seq[TEST_PRODUCER_COUNT];
+	struct test_item item;
+	uint32_t total = 0;
+	uint32_t i = 0;
+	int res = 0;
+
+	res = arsdk_mpsc_ring_init(&ring, sizeof(struct test_item),
+			TEST_RING_SIZE);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	for (i = 0; i < TEST_PRODUCER_COUNT; i++) {
+		next_seq[i] = 0;
+		producers[i].ring = &ring;
+		producers[i].id = i;
+		res = pthread_create(&threads[i], NULL, &producer_thread,
+				&producers[i]);
+		CU_ASSERT_EQUAL_FATAL(res, 0);
+	}
+
+	/* Items of each producer must be received in order, without loss */
+	while (total < TEST_PRODUCER_COUNT * TEST_PRODUCER_ITEMS) {
+		if (arsdk_mpsc_ring_pop(&ring, &item) < 0) {
+			sched_yield();
+			continue;
+		}
+
+		CU_ASSERT_FATAL(item.producer < TEST_PRODUCER_COUNT);
+		CU_ASSERT_EQUAL(item.seq, next_seq[item.producer]);
+		next_seq[item.producer] = item.seq + 1;
+		total++;
+	}
+
+	for (i = 0; i < TEST_PRODUCER_COUNT; i++)
+		pthread_join(threads[i], NULL);
+
+	CU_ASSERT_EQUAL(arsdk_mpsc_ring_count(&ring), 0);
+	arsdk_mpsc_ring_clear(&ring);
+}
+
+/** */
+static void test_mpsc_ring(void)
+{
+	test_mpsc_ring_bad_args();
+	test_mpsc_ring_full_empty();
+	test_mpsc_ring_producers();
+}
+
+/* Disable some gcc warnings for test suite descriptions */
+#ifdef __GNUC__
+#  pragma GCC diagnostic ignored "-Wcast-qual"
+#endif /* __GNUC__ */
+
+/** */
+static CU_TestInfo s_mpsc_ring_tests[] = {
+	{(char *)"mpsc_ring", &test_mpsc_ring},
+	CU_TEST_INFO_NULL,
+};
+
+/** */
+/*extern*/ CU_SuiteInfo g_suites_mpsc_ring[] = {
+	{(char *)"mpsc_ring", NULL, NULL, s_mpsc_ring_tests},
+	CU_SUITE_INFO_NULL,
+};
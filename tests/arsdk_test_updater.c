@@ -0,0 +1,631 @@
+/**
+ * Copyright (c) 2019 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "arsdk_test.h"
+#include "arsdkctrl_priv.h"
+#include "updater/arsdk_updater_digest.h"
+
+#include <unistd.h>
+
+/** Timeout of the loop driven tests */
+#define TEST_LOOP_TIMEOUT_MS 5000
+
+/** */
+struct test_md5_vector {
+	const char  *data;
+	const char  *md5;
+};
+
+/** RFC 1321 test suite */
+static const struct test_md5_vector s_md5_vectors[] = {
+	{"", "d41d8cd98f00b204e9800998ecf8427e"},
+	{"a", "0cc175b9c0f1b6a831c399e269772661"},
+	{"abc", "900150983cd24fb0d6963f7d28e17f72"},
+	{"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+	{"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+	{"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+		"d174ab98d277d9f5a5611c2c9f419d9f"},
+	{"1234567890123456789012345678901234567890"
+	 "1234567890123456789012345678901234567890",
+		"57edf4a22be3c955ac49da2e2107b67a"},
+};
+
+/** */
+struct test_digest_result {
+	uint32_t  count;
+	int       status;
+	char      md5[2 * ARSDK_MD5_LENGTH + 1];
+};
+
+/** */
+static void test_md5_str(const void *data, size_t len, size_t offset,
+		size_t chunk, char *str)
+{
+	struct arsdk_md5_ctx ctx;
+	uint8_t md5[ARSDK_MD5_LENGTH];
+	uint8_t *buf = NULL;
+	size_t i = 0;
+
+	/* copy at the given offset to exercise unaligned loads */
+	buf = malloc(len + offset + 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf);
+	memcpy(buf + offset, data, len);
+
+	arsdk_md5_init(&ctx);
+	for (i = 0; i < len; i += chunk)
+		arsdk_md5_update(&ctx, buf + offset + i,
+				len - i < chunk ? len - i : chunk);
+	arsdk_md5_final(md5, &ctx);
+	arsdk_md5_to_str(md5, str, 2 * ARSDK_MD5_LENGTH + 1);
+
+	free(buf);
+}
+
+/** */
+static void test_updater_md5(void)
+{
+	char str[2 * ARSDK_MD5_LENGTH + 1];
+	const struct test_md5_vector *vector = NULL;
+	uint8_t *data = NULL;
+	char expected[2 * ARSDK_MD5_LENGTH + 1];
+	size_t offset = 0;
+	size_t i = 0;
+	size_t len = 0;
+
+	for (i = 0; i < sizeof(s_md5_vectors) / sizeof(s_md5_vectors[0]);
+			i++) {
+		vector = &s_md5_vectors[i];
+		len = strlen(vector->data);
+		for (offset = 0; offset < 4; offset++) {
+			test_md5_str(vector->data, len, offset, 64, str);
+			CU_ASSERT_STRING_EQUAL(str, vector->md5);
+			test_md5_str(vector->data, len, offset, 7, str);
+			CU_ASSERT_STRING_EQUAL(str, vector->md5);
+		}
+	}
+
+	/* several blocks, whatever the alignment and the update sizes */
+	len = 1000;
+	data = malloc(len);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+	for (i = 0; i < len; i++)
+		data[i] = (uint8_t)(i * 31 + 7);
+	test_md5_str(data, len, 0, len, expected);
+	for (offset = 1; offset < 8; offset++) {
+		test_md5_str(data, len, offset, len, str);
+		CU_ASSERT_STRING_EQUAL(str, expected);
+		test_md5_str(data, len, offset, 13 + offset, str);
+		CU_ASSERT_STRING_EQUAL(str, expected);
+	}
+	free(data);
+}
+
+/** */
+static void test_digest_cb(int status, const uint8_t *md5, void *userdata)
+{
+	struct test_digest_result *result = userdata;
+
+	result->count++;
+	result->status = status;
+	if (status == 0) {
+		CU_ASSERT_PTR_NOT_NULL_FATAL(md5);
+		arsdk_md5_to_str(md5, result->md5, sizeof(result->md5));
+	} else {
+		CU_ASSERT_PTR_NULL(md5);
+	}
+}
+
+/** */
+static void test_loop_run(struct pomp_loop *loop, const uint32_t *count,
+		uint32_t expected)
+{
+	uint32_t elapsed = 0;
+
+	while (*count < expected && elapsed < TEST_LOOP_TIMEOUT_MS) {
+		pomp_loop_wait_and_process(loop, 10);
+		elapsed += 10;
+	}
+	CU_ASSERT_EQUAL(*count, expected);
+}
+
+/** */
+static void test_write_file(const char *path, const char *data)
+{
+	FILE *file = fopen(path, "wb");
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+	CU_ASSERT_EQUAL(fwrite(data, 1, strlen(data), file), strlen(data));
+	fclose(file);
+}
+
+/** */
+static void test_updater_digest(void)
+{
+	char dir[] = "/tmp/arsdk_test_digest_XXXXXX";
+	char path[128];
+	char missing[128];
+	struct pomp_loop *loop = NULL;
+	struct arsdk_updater_digest *digest = NULL;
+	struct arsdk_updater_digest_job *job1 = NULL;
+	struct arsdk_updater_digest_job *job2 = NULL;
+	struct arsdk_updater_digest_job *job3 = NULL;
+	struct test_digest_result res1;
+	struct test_digest_result res2;
+	struct test_digest_result res3;
+	int res = 0;
+
+	memset(&res1, 0, sizeof(res1));
+	memset(&res2, 0, sizeof(res2));
+	memset(&res3, 0, sizeof(res3));
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+	snprintf(path, sizeof(path), "%s/fw.plf", dir);
+	snprintf(missing, sizeof(missing), "%s/missing.plf", dir);
+	test_write_file(path, "abc");
+
+	loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+
+	res = arsdk_updater_digest_new(loop, &digest);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	res = arsdk_updater_digest_compute(digest, missing, &test_digest_cb,
+			&res1, &job1);
+	CU_ASSERT_EQUAL(res, -ENOENT);
+	CU_ASSERT_PTR_NULL(job1);
+
+	/* Requests of the same file share the computation */
+	res = arsdk_updater_digest_compute(digest, path, &test_digest_cb,
+			&res1, &job1);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_updater_digest_compute(digest, path, &test_digest_cb,
+			&res2, &job2);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_updater_digest_compute(digest, path, &test_digest_cb,
+			&res3, &job3);
+	CU_ASSERT_EQUAL(res, 0);
+
+	/* A canceled job is not notified */
+	res = arsdk_updater_digest_cancel(job3);
+	CU_ASSERT_EQUAL(res, 0);
+
+	/* Never notified from the compute function */
+	CU_ASSERT_EQUAL(res1.count, 0);
+
+	test_loop_run(loop, &res2.count, 1);
+	CU_ASSERT_EQUAL(res1.count, 1);
+	CU_ASSERT_EQUAL(res1.status, 0);
+	CU_ASSERT_STRING_EQUAL(res1.md5, "900150983cd24fb0d6963f7d28e17f72");
+	CU_ASSERT_EQUAL(res2.status, 0);
+	CU_ASSERT_STRING_EQUAL(res2.md5, "900150983cd24fb0d6963f7d28e17f72");
+	CU_ASSERT_EQUAL(res3.count, 0);
+
+	/* Cached result, notified from the loop */
+	res = arsdk_updater_digest_compute(digest, path, &test_digest_cb,
+			&res1, &job1);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(res1.count, 1);
+	test_loop_run(loop, &res1.count, 2);
+	CU_ASSERT_STRING_EQUAL(res1.md5, "900150983cd24fb0d6963f7d28e17f72");
+
+	/* A modified file is computed again */
+	test_write_file(path, "message digest");
+	res = arsdk_updater_digest_compute(digest, path, &test_digest_cb,
+			&res2, &job2);
+	CU_ASSERT_EQUAL(res, 0);
+	test_loop_run(loop, &res2.count, 2);
+	CU_ASSERT_EQUAL(res2.status, 0);
+	CU_ASSERT_STRING_EQUAL(res2.md5, "f96b697d7cb7938d525a2f31aaf161d0");
+
+	/* Pending jobs are dropped at destruction */
+	res = arsdk_updater_digest_compute(digest, path, &test_digest_cb,
+			&res3, &job3);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_updater_digest_destroy(digest);
+	CU_ASSERT_EQUAL(res, 0);
+	pomp_loop_wait_and_process(loop, 10);
+	CU_ASSERT_EQUAL(res3.count, 0);
+
+	pomp_loop_destroy(loop);
+	unlink(path);
+	rmdir(dir);
+}
+
+/** Count of devices of the fleet update tests */
+#define TEST_FLEET_DEVICE_COUNT 6
+
+/**
+ * Upload request stand-in, completed from the loop.
+ * The fleet update is tested against stand-ins of the controller, devices
+ * and updater interface below; libarsdkctrl itself is not linked.
+ */
+struct arsdk_updater_req_upload {
+	struct arsdk_updater_req_upload_cbs  cbs;
+	uint16_t                             handle;
+};
+
+/** */
+struct test_fleet {
+	struct pomp_loop                     *loop;
+	struct arsdk_updater_digest          *digest;
+	struct arsdk_device_info             info;
+	struct arsdk_device                  *devices;
+	struct arsdk_updater_req_upload      reqs[TEST_FLEET_DEVICE_COUNT];
+	int                                  removed[TEST_FLEET_DEVICE_COUNT];
+	int                                  failing[TEST_FLEET_DEVICE_COUNT];
+	uint32_t                             started_nb;
+	uint32_t                             running_nb;
+	uint32_t                             running_max;
+	enum arsdk_updater_req_status        status[TEST_FLEET_DEVICE_COUNT];
+	int                                  error[TEST_FLEET_DEVICE_COUNT];
+	uint32_t                             progress_nb;
+	uint32_t                             dev_complete_nb;
+	uint32_t                             complete_nb;
+	size_t                               ok_count;
+	size_t                               total_count;
+	int                                  destroy_on_complete;
+};
+
+static struct test_fleet s_fleet;
+
+/** */
+static uint16_t test_fleet_handle(struct arsdk_device *device)
+{
+	return (uint16_t)(device - s_fleet.devices);
+}
+
+/** */
+struct arsdk_updater_digest *arsdk_ctrl_get_updater_digest(
+		struct arsdk_ctrl *ctrl)
+{
+	return s_fleet.digest;
+}
+
+/** */
+struct arsdk_device *arsdk_ctrl_get_device(struct arsdk_ctrl *ctrl,
+		uint16_t handle)
+{
+	if (handle >= TEST_FLEET_DEVICE_COUNT || s_fleet.removed[handle])
+		return NULL;
+	return &s_fleet.devices[handle];
+}
+
+/** */
+uint16_t arsdk_device_get_handle(struct arsdk_device *self)
+{
+	return test_fleet_handle(self);
+}
+
+/** */
+int arsdk_device_get_info(struct arsdk_device *self,
+		const struct arsdk_device_info **info)
+{
+	*info = &s_fleet.info;
+	return 0;
+}
+
+/** */
+int arsdk_device_get_updater_itf(struct arsdk_device *self,
+		struct arsdk_updater_itf **ret_itf)
+{
+	/* the device stands for its interface */
+	*ret_itf = (struct arsdk_updater_itf *)self;
+	return 0;
+}
+
+/** */
+static void test_upload_idle_cb(void *userdata)
+{
+	struct arsdk_updater_req_upload *req = userdata;
+
+	s_fleet.running_nb--;
+	(*req->cbs.progress)(NULL, req, 100.0f, req->cbs.userdata);
+	(*req->cbs.complete)(NULL, req, ARSDK_UPDATER_REQ_STATUS_OK, 0,
+			req->cbs.userdata);
+}
+
+/** */
+int arsdk_updater_itf_create_req_upload(struct arsdk_updater_itf *itf,
+		const char *fw_filepath,
+		enum arsdk_device_type dev_type,
+		const struct arsdk_updater_req_upload_cbs *cbs,
+		struct arsdk_updater_req_upload **ret_req)
+{
+	uint16_t handle = test_fleet_handle((struct arsdk_device *)itf);
+	struct arsdk_updater_req_upload *req = &s_fleet.reqs[handle];
+
+	CU_ASSERT_EQUAL(dev_type, s_fleet.info.type);
+	if (s_fleet.failing[handle])
+		return -EIO;
+
+	req->cbs = *cbs;
+	req->handle = handle;
+	pomp_loop_idle_add(s_fleet.loop, &test_upload_idle_cb, req);
+
+	s_fleet.started_nb++;
+	s_fleet.running_nb++;
+	if (s_fleet.running_nb > s_fleet.running_max)
+		s_fleet.running_max = s_fleet.running_nb;
+
+	*ret_req = req;
+	return 0;
+}
+
+/** */
+int arsdk_updater_req_upload_cancel(struct arsdk_updater_req_upload *req)
+{
+	/* canceled requests complete synchronously */
+	pomp_loop_idle_remove(s_fleet.loop, &test_upload_idle_cb, req);
+	s_fleet.running_nb--;
+	(*req->cbs.complete)(NULL, req, ARSDK_UPDATER_REQ_STATUS_CANCELED, 0,
+			req->cbs.userdata);
+	return 0;
+}
+
+/** */
+static void test_fleet_progress(struct arsdk_updater_fleet *fleet,
+		uint16_t handle,
+		float percent,
+		void *userdata)
+{
+	s_fleet.progress_nb++;
+}
+
+/** */
+static void test_fleet_device_complete(struct arsdk_updater_fleet *fleet,
+		uint16_t handle,
+		enum arsdk_updater_req_status status,
+		int error,
+		void *userdata)
+{
+	CU_ASSERT_FATAL(handle < TEST_FLEET_DEVICE_COUNT);
+	s_fleet.status[handle] = status;
+	s_fleet.error[handle] = error;
+	s_fleet.dev_complete_nb++;
+}
+
+/** */
+static void test_fleet_complete(struct arsdk_updater_fleet *fleet,
+		size_t ok_count,
+		size_t total_count,
+		void *userdata)
+{
+	s_fleet.complete_nb++;
+	s_fleet.ok_count = ok_count;
+	s_fleet.total_count = total_count;
+	if (s_fleet.destroy_on_complete)
+		arsdk_updater_fleet_destroy(fleet);
+}
+
+/** */
+static const struct arsdk_updater_fleet_cbs s_fleet_cbs = {
+	.userdata = NULL,
+	.progress = &test_fleet_progress,
+	.device_complete = &test_fleet_device_complete,
+	.complete = &test_fleet_complete,
+};
+
+/** */
+static struct arsdk_ctrl *test_fleet_setup(const char *dir, char *path,
+		size_t path_len)
+{
+	int res = 0;
+
+	memset(&s_fleet, 0, sizeof(s_fleet));
+	s_fleet.info.type = ARSDK_DEVICE_TYPE_ANAFI4K;
+
+	/* only the addresses of the devices are used */
+	s_fleet.devices = calloc(TEST_FLEET_DEVICE_COUNT, 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(s_fleet.devices);
+
+	s_fleet.loop = pomp_loop_new();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(s_fleet.loop);
+	res = arsdk_updater_digest_new(s_fleet.loop, &s_fleet.digest);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	snprintf(path, path_len, "%s/fw.plf", dir);
+	test_write_file(path, "firmware");
+
+	/* the controller is only given back to the stand-ins */
+	return (struct arsdk_ctrl *)&s_fleet;
+}
+
+/** */
+static void test_fleet_cleanup(const char *path)
+{
+	arsdk_updater_digest_destroy(s_fleet.digest);
+	pomp_loop_destroy(s_fleet.loop);
+	free(s_fleet.devices);
+	unlink(path);
+}
+
+/** */
+static void test_updater_fleet_run(void)
+{
+	char dir[] = "/tmp/arsdk_test_fleet_XXXXXX";
+	char path[128];
+	struct arsdk_ctrl *ctrl = NULL;
+	struct arsdk_updater_fleet *fleet = NULL;
+	uint16_t i = 0;
+	int res = 0;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+	ctrl = test_fleet_setup(dir, path, sizeof(path));
+
+	res = arsdk_updater_fleet_new(ctrl, path, 2, &s_fleet_cbs, &fleet);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+
+	for (i = 0; i < TEST_FLEET_DEVICE_COUNT; i++) {
+		res = arsdk_updater_fleet_add_device(fleet,
+				&s_fleet.devices[i]);
+		CU_ASSERT_EQUAL(res, 0);
+	}
+
+	/* a device removed before its upload, a device failing to start */
+	s_fleet.removed[2] = 1;
+	s_fleet.failing[4] = 1;
+
+	/* Nothing starts before the fleet update and its digest */
+	pomp_loop_wait_and_process(s_fleet.loop, 10);
+	CU_ASSERT_EQUAL(s_fleet.started_nb, 0);
+
+	res = arsdk_updater_fleet_start(fleet);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_updater_fleet_start(fleet);
+	CU_ASSERT_EQUAL(res, -EBUSY);
+	CU_ASSERT_EQUAL(s_fleet.started_nb, 0);
+
+	test_loop_run(s_fleet.loop, &s_fleet.complete_nb, 1);
+
+	/* at most 2 uploads at a time */
+	CU_ASSERT_EQUAL(s_fleet.started_nb, 4);
+	CU_ASSERT_EQUAL(s_fleet.running_max, 2);
+	CU_ASSERT_EQUAL(s_fleet.progress_nb, 4);
+	CU_ASSERT_EQUAL(s_fleet.dev_complete_nb, TEST_FLEET_DEVICE_COUNT);
+	CU_ASSERT_EQUAL(s_fleet.ok_count, 4);
+	CU_ASSERT_EQUAL(s_fleet.total_count, TEST_FLEET_DEVICE_COUNT);
+	CU_ASSERT_EQUAL(s_fleet.status[0], ARSDK_UPDATER_REQ_STATUS_OK);
+	CU_ASSERT_EQUAL(s_fleet.status[2], ARSDK_UPDATER_REQ_STATUS_ABORTED);
+	CU_ASSERT_EQUAL(s_fleet.error[2], -ENODEV);
+	CU_ASSERT_EQUAL(s_fleet.status[4], ARSDK_UPDATER_REQ_STATUS_FAILED);
+	CU_ASSERT_EQUAL(s_fleet.error[4], -EIO);
+	CU_ASSERT_EQUAL(s_fleet.status[5], ARSDK_UPDATER_REQ_STATUS_OK);
+
+	/* Completed only once */
+	res = arsdk_updater_fleet_add_device(fleet, &s_fleet.devices[0]);
+	CU_ASSERT_EQUAL(res, -EPERM);
+	pomp_loop_wait_and_process(s_fleet.loop, 10);
+	CU_ASSERT_EQUAL(s_fleet.complete_nb, 1);
+
+	res = arsdk_updater_fleet_destroy(fleet);
+	CU_ASSERT_EQUAL(res, 0);
+
+	test_fleet_cleanup(path);
+	rmdir(dir);
+}
+
+/** */
+static void test_updater_fleet_cancel(void)
+{
+	char dir[] = "/tmp/arsdk_test_fleet_XXXXXX";
+	char path[128];
+	struct arsdk_ctrl *ctrl = NULL;
+	struct arsdk_updater_fleet *fleet = NULL;
+	uint16_t i = 0;
+	int res = 0;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+	ctrl = test_fleet_setup(dir, path, sizeof(path));
+
+	/* Canceled before its start */
+	res = arsdk_updater_fleet_new(ctrl, path, 2, &s_fleet_cbs, &fleet);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	for (i = 0; i < 3; i++) {
+		res = arsdk_updater_fleet_add_device(fleet,
+				&s_fleet.devices[i]);
+		CU_ASSERT_EQUAL(res, 0);
+	}
+
+	res = arsdk_updater_fleet_cancel(fleet);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(s_fleet.dev_complete_nb, 3);
+	CU_ASSERT_EQUAL(s_fleet.status[1], ARSDK_UPDATER_REQ_STATUS_CANCELED);
+	CU_ASSERT_EQUAL(s_fleet.complete_nb, 1);
+	CU_ASSERT_EQUAL(s_fleet.ok_count, 0);
+	CU_ASSERT_EQUAL(s_fleet.total_count, 3);
+
+	res = arsdk_updater_fleet_start(fleet);
+	CU_ASSERT_EQUAL(res, -EPERM);
+	res = arsdk_updater_fleet_add_device(fleet, &s_fleet.devices[3]);
+	CU_ASSERT_EQUAL(res, -EPERM);
+	pomp_loop_wait_and_process(s_fleet.loop, 10);
+	CU_ASSERT_EQUAL(s_fleet.started_nb, 0);
+	CU_ASSERT_EQUAL(s_fleet.complete_nb, 1);
+
+	res = arsdk_updater_fleet_destroy(fleet);
+	CU_ASSERT_EQUAL(res, 0);
+
+	/* Canceled while uploading, destroyed on completion */
+	s_fleet.dev_complete_nb = 0;
+	s_fleet.complete_nb = 0;
+	s_fleet.destroy_on_complete = 1;
+	res = arsdk_updater_fleet_new(ctrl, path, 2, &s_fleet_cbs, &fleet);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	for (i = 0; i < TEST_FLEET_DEVICE_COUNT; i++) {
+		res = arsdk_updater_fleet_add_device(fleet,
+				&s_fleet.devices[i]);
+		CU_ASSERT_EQUAL(res, 0);
+	}
+
+	res = arsdk_updater_fleet_start(fleet);
+	CU_ASSERT_EQUAL(res, 0);
+	test_loop_run(s_fleet.loop, &s_fleet.started_nb, 2);
+	CU_ASSERT_EQUAL(s_fleet.running_nb, 2);
+
+	res = arsdk_updater_fleet_cancel(fleet);
+	CU_ASSERT_EQUAL(res, 0);
+	CU_ASSERT_EQUAL(s_fleet.running_nb, 0);
+	CU_ASSERT_EQUAL(s_fleet.started_nb, 2);
+	CU_ASSERT_EQUAL(s_fleet.dev_complete_nb, TEST_FLEET_DEVICE_COUNT);
+	CU_ASSERT_EQUAL(s_fleet.status[0], ARSDK_UPDATER_REQ_STATUS_CANCELED);
+	CU_ASSERT_EQUAL(s_fleet.status[5], ARSDK_UPDATER_REQ_STATUS_CANCELED);
+	CU_ASSERT_EQUAL(s_fleet.complete_nb, 1);
+	CU_ASSERT_EQUAL(s_fleet.ok_count, 0);
+
+	/* Destroyed while digesting, without notification */
+	s_fleet.dev_complete_nb = 0;
+	s_fleet.complete_nb = 0;
+	s_fleet.destroy_on_complete = 0;
+	res = arsdk_updater_fleet_new(ctrl, path, 0, &s_fleet_cbs, &fleet);
+	CU_ASSERT_EQUAL_FATAL(res, 0);
+	res = arsdk_updater_fleet_add_device(fleet, &s_fleet.devices[0]);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_updater_fleet_start(fleet);
+	CU_ASSERT_EQUAL(res, 0);
+	res = arsdk_updater_fleet_destroy(fleet);
+	CU_ASSERT_EQUAL(res, 0);
+	pomp_loop_wait_and_process(s_fleet.loop, 10);
+	CU_ASSERT_EQUAL(s_fleet.dev_complete_nb, 0);
+	CU_ASSERT_EQUAL(s_fleet.complete_nb, 0);
+
+	test_fleet_cleanup(path);
+	rmdir(dir);
+}
+
+/** */
+static CU_TestInfo s_updater_tests[] = {
+	{(char *)"md5", &test_updater_md5},
+	{(char *)"digest", &test_updater_digest},
+	{(char *)"fleet_run", &test_updater_fleet_run},
+	{(char *)"fleet_cancel", &test_updater_fleet_cancel},
+	CU_TEST_INFO_NULL,
+};
+
+/** */
+/*extern*/ CU_SuiteInfo g_suites_updater[] = {
+	{(char *)"updater", NULL, NULL, s_updater_tests},
+	CU_SUITE_INFO_NULL,
+};
@@ -96,6 +96,43 @@ def _get_max_args_count(ctx):
 
     return max_count
 
+
+def _get_cmd_desc_index(ctx):
+    # Direct index of command descriptions:
+    # list of (featureObj, [(classId, tableName, base, {cmdId: descName})])
+    # 'base' is the dispatch slot of command id 0 of the class.
+    index = []
+    base = 0
+    for featureId in sorted(ctx.featuresById.keys()):
+        featureObj = ctx.featuresById[featureId]
+        classes = []
+        if featureObj.classes:
+            for classId in sorted(featureObj.classesById.keys()):
+                classObj = featureObj.classesById[classId]
+                descs = {}
+                for cmdId in sorted(classObj.cmdsById.keys()):
+                    cmdObj = classObj.cmdsById[cmdId]
+                    descs[cmdId] = "g_arsdk_cmd_desc_%s_%s_%s" % (
+                            _to_c_name(featureObj.name),
+                            _to_c_name(classObj.name),
+                            _to_c_name(cmdObj.name))
+                classes.append((classId, "%s_%s" % (
+                        _to_c_name(featureObj.name),
+                        _to_c_name(classObj.name)), base, descs))
+                base += max(descs.keys()) + 1 if descs else 0
+        else:
+            descs = {}
+            for msgId in sorted(featureObj.getMsgsById().keys()):
+                msgObj = featureObj.getMsgsById()[msgId]
+                descs[msgId] = "g_arsdk_cmd_desc_%s_%s" % (
+                        _to_c_name(featureObj.name),
+                        _to_c_name(msgObj.name))
+            classes.append((0, "%s_Default" % _to_c_name(featureObj.name),
+                    base, descs))
+            base += max(descs.keys()) + 1 if descs else 0
+        index.append((featureObj, classes))
+    return index, base
+
 #===============================================================================
 #===============================================================================
 def gen_ids_h(ctx, out):
@@ -216,6 +253,10 @@ def gen_cmd_desc_h(ctx, out):
                         _to_c_name(msgObj.name))
     out.write("extern ARSDK_API const struct arsdk_cmd_desc * const * const *g_arsdk_cmd_desc_table[];\n")
 
+    _, slotCount = _get_cmd_desc_index(ctx)
+    out.write("\n#define ARSDK_CMD_DESC_SLOT_COUNT %d\n", slotCount)
+    out.write("extern ARSDK_API const struct arsdk_cmd_desc_idx_prj g_arsdk_cmd_desc_idx_table[256];\n")
+
 #===============================================================================
 #===============================================================================
 def gen_cmd_desc_c(ctx, out):
@@ -374,6 +415,44 @@ def gen_cmd_desc_c(ctx, out):
     out.write("\tNULL,\n")
     out.write("};\n\n")
 
+    # Direct index tables: project id -> class id -> command id
+    index, _ = _get_cmd_desc_index(ctx)
+    for featureObj, classes in index:
+        for classId, tableName, base, descs in classes:
+            if not descs:
+                continue
+            out.write("static const struct arsdk_cmd_desc * const s_arsdk_cmd_desc_idx_%s_table[] = {\n",
+                    tableName)
+            for cmdId in sorted(descs.keys()):
+                out.write("\t[%d] = &%s,\n", cmdId, descs[cmdId])
+            out.write("};\n\n")
+
+        if not any(descs for _, _, _, descs in classes):
+            continue
+        out.write("static const struct arsdk_cmd_desc_idx_cls s_arsdk_cmd_desc_idx_%s_table[] = {\n",
+                _to_c_name(featureObj.name))
+        for classId, tableName, base, descs in classes:
+            if not descs:
+                continue
+            out.write("\t[%d] = {\n", classId)
+            out.write("\t\ts_arsdk_cmd_desc_idx_%s_table,\n", tableName)
+            out.write("\t\tsizeof(s_arsdk_cmd_desc_idx_%s_table) / sizeof(s_arsdk_cmd_desc_idx_%s_table[0]),\n",
+                    tableName, tableName)
+            out.write("\t\t%d\n", base)
+            out.write("\t},\n")
+        out.write("};\n\n")
+
+    out.write("/*extern*/ const struct arsdk_cmd_desc_idx_prj g_arsdk_cmd_desc_idx_table[256] = {\n")
+    for featureObj, classes in index:
+        if not any(descs for _, _, _, descs in classes):
+            continue
+        tableName = "s_arsdk_cmd_desc_idx_%s_table" % _to_c_name(featureObj.name)
+        out.write("\t[%d] = {\n", featureObj.featureId)
+        out.write("\t\t%s,\n", tableName)
+        out.write("\t\tsizeof(%s) / sizeof(%s[0])\n", tableName, tableName)
+        out.write("\t},\n")
+    out.write("};\n\n")
+
 #===============================================================================
 #===============================================================================
 def gen_cmd_dec_h(ctx, out):
@@ -474,12 +553,20 @@ def gen_cmd_enc_c(ctx, out):
 #===============================================================================
 #===============================================================================
 def gen_cmd_send_h(ctx, out):
+    # 'send' helpers must be called from the loop thread,
+    # 'submit' helpers can be called from any thread.
+    for (prefix, func) in [("send", "arsdk_cmd_itf_send"),
+                           ("submit", "arsdk_cmd_itf_submit")]:
+        _gen_cmd_send_h(ctx, out, prefix, func)
+
+def _gen_cmd_send_h(ctx, out, prefix, func):
     for featureId in sorted(ctx.featuresById.keys()):
         featureObj = ctx.featuresById[featureId]
         for msgObj in featureObj.getMsgs():
             msgName = _to_c_name(msgObj.name) if msgObj.cls == None else \
                     _to_c_name(msgObj.cls.name)+'_'+_to_c_name(msgObj.name)
-            out.write("static inline int\narsdk_cmd_send_%s_%s(\n",
+            out.write("static inline int\narsdk_cmd_%s_%s_%s(\n",
+                    prefix,
                     _to_c_name(featureObj.name),
                     msgName)
             out.write("\t\tstruct arsdk_cmd_itf *itf,\n")
@@ -509,7 +596,7 @@ def gen_cmd_send_h(ctx, out):
                 out.write(",\n\t\t\t_%s" % argObj.name)
             out.write(");\n")
             out.write("\tif (res == 0)\n")
-            out.write("\t\tres = arsdk_cmd_itf_send(itf, &cmd, send_status, userdata);\n")
+            out.write("\t\tres = %s(itf, &cmd, send_status, userdata);\n", func)
             out.write("\tarsdk_cmd_clear(&cmd);\n")
             out.write("\treturn res;\n")
             out.write("}\n\n")